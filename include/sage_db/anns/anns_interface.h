@@ -1,6 +1,7 @@
 #pragma once
 
 #include "sage_db/common.h"
+#include <atomic>
 #include <memory>
 #include <string>
 #include <vector>
@@ -8,6 +9,8 @@
 #include <algorithm>
 #include <chrono>
 #include <functional>
+#include <limits>
+#include <span>
 #include <utility>
 #include <stdexcept>
 #include <type_traits>
@@ -51,6 +54,9 @@ private:
     std::string stringify_value(const T& value) const;
 };
 
+// Neighbour rows a graph search prefetches ahead of the one it is scoring
+inline constexpr uint32_t kDefaultPrefetchDepth = 4;
+
 /**
  * @brief Query configuration for search operations
  */
@@ -58,6 +64,12 @@ struct QueryConfig {
     uint32_t k = 10;                    // Number of nearest neighbors
     bool return_distances = true;       // Whether to return distances
     AlgorithmParams algorithm_params;   // Algorithm-specific parameters
+    // Graph searches (hnsw, Vamana) prefetch the rows of this many upcoming
+    // neighbours while scoring the current one; 0 disables prefetching
+    uint32_t prefetch_depth = kDefaultPrefetchDepth;
+    // Restricts results to points carrying any of these labels; only
+    // honoured by plugins that report supports_filtered_search()
+    std::vector<FilterLabel> filter_labels;
     
     template<typename T>
     T get_param(const std::string& key, const T& default_value = T{}) const {
@@ -87,6 +99,43 @@ struct ANNSResult {
         : ids(std::move(ids_)), distances(std::move(distances_)), actual_k(ids.size()) {}
 };
 
+// Id written to result slots a query could not fill
+inline constexpr VectorId kInvalidVectorId = std::numeric_limits<VectorId>::max();
+
+/**
+ * @brief Non-owning row-major block of query vectors, e.g. a NumPy array.
+ */
+struct QueryMatrix {
+    const float* data = nullptr;  // row i starts at data + i * stride
+    size_t rows = 0;
+    Dimension dimension = 0;
+    size_t stride = 0;            // floats between consecutive rows, >= dimension
+
+    QueryMatrix() = default;
+    QueryMatrix(const float* data_, size_t rows_, Dimension dimension_, size_t stride_ = 0)
+        : data(data_), rows(rows_), dimension(dimension_), stride(stride_ ? stride_ : dimension_) {}
+
+    const float* row(size_t i) const { return data + i * stride; }
+};
+
+/**
+ * @brief Caller-owned result buffers for QueryMatrix searches.
+ *
+ * Query i owns slots [i * k, (i + 1) * k) of ids and, when set, distances,
+ * best first, where k is the call's QueryConfig::k. Unfilled slots hold
+ * kInvalidVectorId; counts, when set, receives the number of hits per query.
+ */
+struct QueryOutput {
+    VectorId* ids = nullptr;
+    float* distances = nullptr;
+    size_t* counts = nullptr;
+
+    // Pads the row of `query` after `filled` hits and records the count
+    void finish(size_t query, size_t k, size_t filled) const;
+    // Copies an ANNSResult into the row of `query`
+    void store(size_t query, size_t k, const ANNSResult& result) const;
+};
+
 /**
  * @brief Performance metrics for ANNS operations
  */
@@ -116,8 +165,118 @@ struct ANNSMetrics {
     }
 };
 
+/**
+ * @brief Lock-free search counters for the concurrent query path.
+ *
+ * Queries run concurrently under VectorStore's shared lock, so plugins
+ * record per-call time and distance counts here instead of writing
+ * ANNSMetrics fields from const methods; get_metrics() folds them in.
+ * Indexes that re-rank estimates on float rows also count the rows they
+ * scored exactly ("reranked_rows").
+ */
+class QueryCounters {
+public:
+    void record(double seconds, size_t distance_computations, size_t reranked_rows = 0) {
+        search_time_seconds_.fetch_add(seconds, std::memory_order_relaxed);
+        distance_computations_.fetch_add(distance_computations, std::memory_order_relaxed);
+        reranked_rows_.fetch_add(reranked_rows, std::memory_order_relaxed);
+        queries_.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void reset() {
+        search_time_seconds_.store(0.0, std::memory_order_relaxed);
+        distance_computations_.store(0, std::memory_order_relaxed);
+        reranked_rows_.store(0, std::memory_order_relaxed);
+        queries_.store(0, std::memory_order_relaxed);
+    }
+
+    void merge_into(ANNSMetrics& metrics) const {
+        metrics.search_time_seconds += search_time_seconds_.load(std::memory_order_relaxed);
+        metrics.distance_computations += distance_computations_.load(std::memory_order_relaxed);
+        metrics.additional_metrics["search_calls"] =
+            static_cast<double>(queries_.load(std::memory_order_relaxed));
+        if (const uint64_t reranked = reranked_rows_.load(std::memory_order_relaxed)) {
+            metrics.additional_metrics["reranked_rows"] = static_cast<double>(reranked);
+        }
+    }
+
+private:
+    std::atomic<double> search_time_seconds_{0.0};
+    std::atomic<uint64_t> distance_computations_{0};
+    std::atomic<uint64_t> reranked_rows_{0};
+    std::atomic<uint64_t> queries_{0};
+};
+
 using VectorEntry = std::pair<VectorId, Vector>;
 
+/**
+ * @brief Non-owning (id, row) matrix view handed to ANNS plugins.
+ *
+ * Rows are plain float pointers of dimension() values each. When storage()
+ * is set, it keeps the rows alive and unchanged for as long as a copy of it
+ * is held, so a plugin may borrow the pointers instead of copying the data.
+ * Without storage the rows are only valid for the duration of the call.
+ *
+ * Rows may carry a sorted set of filter labels; the view keeps its own copy
+ * of them.
+ */
+class DatasetView {
+public:
+    DatasetView() = default;
+    explicit DatasetView(Dimension dimension, std::shared_ptr<const void> storage = nullptr)
+        : dimension_(dimension), storage_(std::move(storage)) {}
+
+    // View over caller-owned entries; valid only while they are
+    static DatasetView from_entries(const std::vector<VectorEntry>& entries);
+
+    void reserve(size_t count) {
+        rows_.reserve(count);
+        ids_.reserve(count);
+    }
+
+    void append(VectorId id, const float* row) {
+        ids_.push_back(id);
+        rows_.push_back(row);
+        if (!label_offsets_.empty()) {
+            label_offsets_.push_back(labels_.size());
+        }
+    }
+
+    void append(VectorId id, const float* row, std::span<const FilterLabel> labels) {
+        if (label_offsets_.empty() && !labels.empty()) {
+            label_offsets_.assign(ids_.size() + 1, 0);
+        }
+        labels_.insert(labels_.end(), labels.begin(), labels.end());
+        append(id, row);
+    }
+
+    size_t size() const { return ids_.size(); }
+    bool empty() const { return ids_.empty(); }
+    Dimension dimension() const { return dimension_; }
+    VectorId id(size_t i) const { return ids_[i]; }
+    const float* row(size_t i) const { return rows_[i]; }
+    const float* const* rows() const { return rows_.data(); }
+    const std::shared_ptr<const void>& storage() const { return storage_; }
+    bool has_labels() const { return !label_offsets_.empty(); }
+    std::span<const FilterLabel> labels(size_t i) const {
+        if (label_offsets_.empty()) {
+            return {};
+        }
+        return {labels_.data() + label_offsets_[i], label_offsets_[i + 1] - label_offsets_[i]};
+    }
+
+    // Materializes the rows for plugins that keep their own copy
+    std::vector<VectorEntry> to_entries() const;
+
+private:
+    Dimension dimension_ = 0;
+    std::vector<const float*> rows_;
+    std::vector<VectorId> ids_;
+    std::shared_ptr<const void> storage_;
+    std::vector<size_t> label_offsets_;  // row i's labels: [offsets[i], offsets[i + 1])
+    std::vector<FilterLabel> labels_;
+};
+
 /**
  * @brief Base interface for all ANNS algorithms
  * 
@@ -139,10 +298,27 @@ public:
     virtual bool supports_updates() const = 0;
     virtual bool supports_deletions() const = 0;
     virtual bool supports_range_search() const = 0;
+    // True when queries honour QueryConfig::filter_labels using the labels
+    // passed in through DatasetView
+    virtual bool supports_filtered_search() const { return false; }
+    // True when add_vector(s) and remove_vector(s) may run while other
+    // threads query, without the caller serializing them
+    virtual bool supports_concurrent_updates() const { return false; }
     
     // Index lifecycle
     virtual void fit(const std::vector<VectorEntry>& dataset, 
                     const AlgorithmParams& params = {}) = 0;
+    // Plugins that can borrow rows override this; the default copies them
+    virtual void fit(const DatasetView& dataset, const AlgorithmParams& params = {}) {
+        fit(dataset.to_entries(), params);
+    }
+    // Learns data-dependent structure (coarse centroids, codebooks) from a
+    // training sample ahead of fit(), which then only has to encode the
+    // dataset. Algorithms without such structure ignore it.
+    virtual void train(const DatasetView& training, const AlgorithmParams& params = {}) {
+        (void)training;
+        (void)params;
+    }
     virtual bool save(const std::string& path) const = 0;
     virtual bool load(const std::string& path) = 0;
     virtual bool is_built() const = 0;
@@ -154,6 +330,13 @@ public:
     virtual std::vector<ANNSResult> batch_query(
         const std::vector<Vector>& query_vectors,
         const QueryConfig& config = {}) const = 0;
+
+    // Zero-copy batch search: reads the queries in place and writes into
+    // caller-owned buffers. The default materializes per-row vectors;
+    // plugins override it to search the matrix directly.
+    virtual void batch_query(const QueryMatrix& queries,
+                             const QueryConfig& config,
+                             const QueryOutput& output) const;
     
     // Optional operations (throw std::runtime_error if not supported)
     virtual ANNSResult range_query(const Vector& query_vector, 
@@ -174,6 +357,10 @@ public:
         (void)entries;
         throw std::runtime_error(name() + " does not support adding vectors");
     }
+
+    virtual void add_vectors(const DatasetView& entries) {
+        add_vectors(entries.to_entries());
+    }
     
     virtual void remove_vector(VectorId id) {
         (void)id;
@@ -0,0 +1,116 @@
+#pragma once
+
+#include "sage_db/anns/anns_interface.h"
+#include "sage_db/vector_arena.h"
+#include <memory>
+#include <unordered_map>
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief Sign-bit codes scanned by Hamming distance, re-ranked on float rows.
+ *
+ * Each row is kept as one bit per dimension (set when positive), 32x
+ * smaller than its floats. A query packs its own signs, scans every code
+ * with popcount Hamming distance (simd/hamming.h) and keeps the
+ * k * oversample nearest codes; only those are scored on float rows,
+ * which the index borrows from the caller's storage when a DatasetView
+ * shares it and copies otherwise. The first stage thus reads 1/32 of the
+ * bytes of a brute-force scan. Works best on centred or normalized
+ * embeddings, whose signs carry their angle.
+ *
+ * "oversample" (build default, overridable per query through
+ * QueryConfig::algorithm_params) trades re-rank work for recall.
+ */
+class BinaryANNS : public ANNSAlgorithm {
+public:
+    BinaryANNS();
+    ~BinaryANNS() override = default;
+
+    std::string name() const override { return "binary"; }
+    std::string version() const override;
+    std::string description() const override;
+
+    std::vector<DistanceMetric> supported_distances() const override;
+    bool supports_distance(DistanceMetric metric) const override;
+    bool supports_updates() const override { return true; }
+    bool supports_deletions() const override { return true; }
+    bool supports_range_search() const override { return false; }
+
+    void fit(const std::vector<VectorEntry>& dataset,
+             const AlgorithmParams& params = {}) override;
+    void fit(const DatasetView& dataset, const AlgorithmParams& params = {}) override;
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path) override;
+    bool is_built() const override { return built_; }
+
+    ANNSResult query(const Vector& query_vector,
+                     const QueryConfig& config = {}) const override;
+    std::vector<ANNSResult> batch_query(const std::vector<Vector>& query_vectors,
+                                        const QueryConfig& config = {}) const override;
+    void batch_query(const QueryMatrix& queries,
+                     const QueryConfig& config,
+                     const QueryOutput& output) const override;
+
+    void add_vector(const VectorEntry& entry) override;
+    void add_vectors(const std::vector<VectorEntry>& entries) override;
+    void add_vectors(const DatasetView& entries) override;
+    void remove_vector(VectorId id) override;
+    void remove_vectors(const std::vector<VectorId>& ids) override;
+
+    size_t get_index_size() const override;
+    size_t get_memory_usage() const override;
+    std::unordered_map<std::string, std::string> get_build_params() const override;
+    ANNSMetrics get_metrics() const override;
+
+    bool validate_params(const AlgorithmParams& params) const override;
+    AlgorithmParams get_default_params() const override;
+    QueryConfig get_default_query_config() const override;
+
+private:
+    float compute_distance(const float* a, const float* b) const;
+    bool better(const std::pair<float, VectorId>& a, const std::pair<float, VectorId>& b) const;
+    float oversample_for(const QueryConfig& config) const;
+    // Leaves the k best hits in hits, best first; returns the number of
+    // rows re-ranked
+    size_t search(const float* query, size_t k, float oversample,
+                  std::vector<std::pair<float, VectorId>>& hits) const;
+
+    void configure(const AlgorithmParams& params);
+    void reset_rows(Dimension dimension, size_t expected);
+    void check_dimension(Dimension dimension);
+    void append_row(VectorId id, const float* values, size_t owned_slot);
+    void append_owned(VectorId id, const float* values);
+    void append_borrowed(const DatasetView& view);
+    void compact_owned();
+    const uint64_t* code(size_t index) const { return codes_.data() + index * words_; }
+
+    DistanceMetric metric_;
+    Dimension dimension_;
+    size_t words_;                        // 64-bit words per code
+    float oversample_;                    // candidates per result re-ranked by default
+    std::vector<uint64_t> codes_;         // row i's sign bits at i * words_
+    std::vector<const float*> rows_;      // row i, owned or borrowed, for re-ranking
+    std::vector<VectorId> ids_;           // ids_[i] owns row i
+    std::vector<size_t> owned_slots_;     // slot in owned_ backing row i, or kBorrowed
+    std::unique_ptr<VectorArena> owned_;  // copies of rows nobody shared with us
+    std::vector<std::shared_ptr<const void>> borrowed_; // keeps borrowed rows alive
+    std::unordered_map<VectorId, size_t> id_to_index_;
+    ANNSMetrics metrics_;                 // build-time metrics, written only by mutators
+    mutable QueryCounters query_counters_;
+    bool built_;
+};
+
+class BinaryANNSFactory : public ANNSFactory {
+public:
+    std::unique_ptr<ANNSAlgorithm> create() const override;
+    std::string algorithm_name() const override { return "binary"; }
+    std::string algorithm_description() const override;
+    std::vector<DistanceMetric> supported_distances() const override;
+    AlgorithmParams default_build_params() const override;
+    QueryConfig default_query_config() const override;
+};
+
+} // namespace anns
+} // namespace sage_db
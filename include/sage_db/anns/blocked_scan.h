@@ -0,0 +1,56 @@
+#pragma once
+
+#include "sage_db/anns/anns_interface.h"
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief Read-only view of a flat row-major vector store scanned by
+ * blocked_knn_search. Squared norms must be cached per row for L2 and
+ * cosine; they are ignored for inner product.
+ */
+struct FlatScanView {
+    const float* data = nullptr;        // row i starts at data + i * stride
+    const float* const* rows = nullptr; // or, when set, row i is rows[i]
+    size_t count = 0;
+    size_t stride = 0;                  // floats between consecutive rows
+    const float* norms_sq = nullptr;    // |x_i|^2, one per row
+    const VectorId* ids = nullptr;
+    Dimension dimension = 0;
+    DistanceMetric metric = DistanceMetric::L2;
+};
+
+struct BlockedScanOptions {
+    size_t query_block = 64;     // queries sharing one pass over the dataset
+    size_t base_block = 1024;    // database rows per distance tile
+    bool use_blas = false;       // opt into sgemm for the inner-product tile
+};
+
+/**
+ * @brief Exact k-NN for a batch of queries over a flat store.
+ *
+ * Computes query x database inner-product tiles (see
+ * simd::inner_product_block) and turns them into distances via
+ * ||x||^2 + ||q||^2 - 2 x.q with cached norms, feeding one bounded top-k heap
+ * per query. Distances follow the flat-index convention: L2 is the
+ * Euclidean distance, inner product is the raw score (higher is better) and
+ * cosine is 1 - cos.
+ */
+std::vector<ANNSResult> blocked_knn_search(const FlatScanView& view,
+                                           const float* queries,
+                                           size_t num_queries,
+                                           size_t query_stride,
+                                           size_t k,
+                                           bool return_distances,
+                                           const BlockedScanOptions& options = {});
+
+// Same scan writing straight into caller-owned buffers (see QueryOutput)
+void blocked_knn_search(const FlatScanView& view,
+                        const QueryMatrix& queries,
+                        size_t k,
+                        const QueryOutput& output,
+                        const BlockedScanOptions& options = {});
+
+} // namespace anns
+} // namespace sage_db
@@ -1,11 +1,29 @@
 #pragma once
 
 #include "sage_db/anns/anns_interface.h"
+#include "sage_db/anns/scalar_quantizer.h"
+#include "sage_db/simd/aligned_allocator.h"
 #include <unordered_map>
 
 namespace sage_db {
 namespace anns {
 
+/**
+ * @brief Exact scan over every stored row.
+ *
+ * Rows are copied into one 64-byte-aligned row-major arena, also when fit()
+ * is handed a DatasetView that could be borrowed: the scan streams the
+ * arena at memory bandwidth and batch queries tile it straight into
+ * simd::inner_product_block (sgemm with the use_blas query param when the
+ * build links BLAS). This is the one plugin that does not borrow the
+ * caller's rows.
+ *
+ * With storage_precision set to fp16, bf16, int8 or int4 the scan reads
+ * compact codes (see ScalarQuantizer) instead of float rows, and
+ * distances are the quantized estimates. rerank > 0 re-scores the best
+ * max(k, rerank) candidates on float rows, which are then kept in the
+ * arena; otherwise only the codes are stored.
+ */
 class BruteForceANNS : public ANNSAlgorithm {
 public:
     BruteForceANNS();
@@ -23,6 +41,9 @@ public:
 
     void fit(const std::vector<VectorEntry>& dataset,
              const AlgorithmParams& params = {}) override;
+    void fit(const DatasetView& dataset, const AlgorithmParams& params = {}) override;
+    // Learns the int8/int4 value range ahead of fit()
+    void train(const DatasetView& training, const AlgorithmParams& params = {}) override;
     bool save(const std::string& path) const override;
     bool load(const std::string& path) override;
     bool is_built() const override { return built_; }
@@ -31,39 +52,69 @@ public:
                      const QueryConfig& config = {}) const override;
     std::vector<ANNSResult> batch_query(const std::vector<Vector>& query_vectors,
                                         const QueryConfig& config = {}) const override;
+    void batch_query(const QueryMatrix& queries,
+                     const QueryConfig& config,
+                     const QueryOutput& output) const override;
     ANNSResult range_query(const Vector& query_vector,
                            float radius,
                            const QueryConfig& config = {}) const override;
 
     void add_vector(const VectorEntry& entry) override;
     void add_vectors(const std::vector<VectorEntry>& entries) override;
+    void add_vectors(const DatasetView& entries) override;
     void remove_vector(VectorId id) override;
     void remove_vectors(const std::vector<VectorId>& ids) override;
 
     size_t get_index_size() const override;
     size_t get_memory_usage() const override;
     std::unordered_map<std::string, std::string> get_build_params() const override;
-    ANNSMetrics get_metrics() const override { return metrics_; }
+    ANNSMetrics get_metrics() const override;
 
     bool validate_params(const AlgorithmParams& params) const override;
     AlgorithmParams get_default_params() const override;
     QueryConfig get_default_query_config() const override;
 
 private:
-    struct Entry {
-        VectorId id;
-        Vector vector;
-    };
-
-    float compute_distance(const Vector& a, const Vector& b) const;
+    float compute_distance(const float* a, const float* b) const;
     ANNSResult perform_query(const Vector& query_vector,
                              const QueryConfig& config) const;
+    void scan_top_k(const float* query, size_t k, size_t rerank,
+                    std::vector<std::pair<float, VectorId>>& heap) const;
+    size_t rerank_for(const QueryConfig& config) const;
+
+    void configure_storage(const AlgorithmParams& params);
+    void train_quantizer(const float* const* rows, size_t n);
+    void requantize();
+    bool quantized() const { return precision_ != StoragePrecision::FP32; }
+    bool keeps_rows() const { return !quantized() || rerank_ > 0; }
+    const uint8_t* code(size_t index) const {
+        return codes_.data() + index * quantizer_.code_size();
+    }
+    float quantized_distance(const ScalarQuantizer::Query& query, float query_norm_sq,
+                             size_t index) const;
+
+    void reset_rows(Dimension dimension, size_t expected);
+    void check_dimension(Dimension dimension);
+    void append_row(VectorId id, const float* values);
+    // Null when the row is stored only as a code
+    const float* row(size_t index) const {
+        return data_.empty() ? nullptr : data_.data() + index * stride_;
+    }
 
     DistanceMetric metric_;
     Dimension dimension_;
-    std::vector<Entry> dataset_;
+    size_t stride_;                       // floats per row, padded to a cache line
+    simd::AlignedFloatVector data_;       // row-major arena, row i at data_[i * stride_]
+    std::vector<VectorId> ids_;           // ids_[i] owns row i
+    std::vector<float> norms_sq_;         // |row i|^2 (of its decoded code when quantized)
+    StoragePrecision precision_;
+    ScalarQuantizer quantizer_;
+    std::vector<uint8_t> codes_;          // row i's code at i * code_size when quantized
+    uint32_t rerank_;                     // candidates re-scored on float rows by default
+    bool quantizer_from_train_;           // keep the train() range across fit()
     std::unordered_map<VectorId, size_t> id_to_index_;
-    mutable ANNSMetrics metrics_;
+    ANNSMetrics metrics_;                 // build-time metrics, written only by mutators
+    mutable QueryCounters query_counters_;
     bool built_;
 };
 
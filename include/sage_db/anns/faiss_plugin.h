@@ -43,6 +43,9 @@ public:
     bool supports_range_search() const override { return true; }
     
     // Index lifecycle
+    // Keeps its own copy of the data; DatasetView overloads materialize rows
+    using ANNSAlgorithm::fit;
+    using ANNSAlgorithm::add_vectors;
     void fit(const std::vector<VectorEntry>& dataset,
              const AlgorithmParams& params = {}) override;
     bool save(const std::string& path) const override;
@@ -56,6 +59,9 @@ public:
     std::vector<ANNSResult> batch_query(
         const std::vector<Vector>& query_vectors,
         const QueryConfig& config = {}) const override;
+    void batch_query(const QueryMatrix& queries,
+                     const QueryConfig& config,
+                     const QueryOutput& output) const override;
     
     ANNSResult range_query(const Vector& query_vector, 
                           float radius,
@@ -102,7 +108,7 @@ private:
                                      size_t k) const;
     void normalize_vector(std::vector<float>& vec) const;
     std::string metadata_path(const std::string& base_path) const;
-    void apply_query_params(const QueryConfig& config) const;
+    std::unique_ptr<faiss::SearchParameters> make_search_params(const QueryConfig& config) const;
 
     // State
     std::unique_ptr<faiss::Index> index_;
@@ -115,7 +121,8 @@ private:
     size_t last_index_size_bytes_ = 0;
     
     // Metrics
-    mutable ANNSMetrics metrics_;
+    ANNSMetrics metrics_;
+    mutable QueryCounters query_counters_;
     bool is_built_;
 };
 
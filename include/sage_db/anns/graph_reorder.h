@@ -0,0 +1,49 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief Cache-locality renumbering of a proximity graph.
+ *
+ * Returns the new id of every node: breadth-first order from start,
+ * expanding each node's neighbours in their stored order (closest first in
+ * the Vamana and HNSW graphs). A search that expands a node then scores its
+ * neighbours, so giving them consecutive ids puts their rows and adjacency
+ * on the same pages. Nodes the walk does not reach keep their relative
+ * order after the reached ones.
+ *
+ * for_each_neighbor(node, visit) calls visit(neighbor) for each out-edge.
+ */
+template <typename Id, typename ForEachNeighbor>
+std::vector<Id> bfs_order(size_t node_count, Id start, ForEachNeighbor&& for_each_neighbor) {
+    constexpr Id kUnassigned = std::numeric_limits<Id>::max();
+    std::vector<Id> new_id(node_count, kUnassigned);
+    std::vector<Id> queue;
+    queue.reserve(node_count);
+    Id next = 0;
+    auto enqueue = [&](Id node) {
+        if (node < node_count && new_id[node] == kUnassigned) {
+            new_id[node] = next++;
+            queue.push_back(node);
+        }
+    };
+    enqueue(start);
+    for (size_t head = 0; head < queue.size(); ++head) {
+        for_each_neighbor(queue[head], enqueue);
+    }
+    for (size_t node = 0; node < node_count; ++node) {
+        if (new_id[node] == kUnassigned) {
+            new_id[node] = next++;
+        }
+    }
+    return new_id;
+}
+
+} // namespace anns
+} // namespace sage_db
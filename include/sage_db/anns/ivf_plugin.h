@@ -0,0 +1,112 @@
+#pragma once
+
+#include "sage_db/anns/anns_interface.h"
+
+#include <memory>
+#include <unordered_map>
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief Native inverted-file index (IVF-Flat / IVF-PQ).
+ *
+ * A k-means coarse quantizer splits the collection into nlist inverted
+ * lists, each stored contiguously. With m == 0 lists hold raw vectors
+ * (IVF-Flat); otherwise residuals to the list centroid are product-quantized
+ * into m sub-quantizer codes of nbits (<= 8, one byte each) and scanned with
+ * asymmetric-distance lookup tables (IVF-PQ). Queries probe the nprobe
+ * closest lists. fast_scan (with nbits = 4) stores IVF-PQ lists in the
+ * blocked layout of pq_fast_scan.h and scans them with uint8 tables in
+ * registers. storage_precision = "rabitq" (with m == 0) stores RaBitQ
+ * codes of rabitq_bits per dimension instead (rabitq.h), whose estimates
+ * come with error bounds. rerank > 0 also keeps quantized lists' rows in
+ * float and re-scores the best max(k, rerank) estimates on them; RaBitQ
+ * only scores those whose lower bound can still reach the top k.
+ * pre_transform = "opq" (with m > 0) rotates every row and query by a
+ * learned OPQ rotation (pre_transform.h) before the coarse quantizer sees
+ * it.
+ *
+ * train() learns the quantizers from a sample; fit() trains on the dataset
+ * itself when it was not called (or with different structural params).
+ *
+ * Build params: nlist, m, nbits, fast_scan, storage_precision, rabitq_bits,
+ * pre_transform, opq_iters, rerank, kmeans_iters, kmeans_batch,
+ * max_points_per_centroid, seed. Query params: nprobe, rerank.
+ */
+class IvfANNS : public ANNSAlgorithm {
+public:
+    IvfANNS();
+    ~IvfANNS() override;
+
+    // Identification
+    std::string name() const override { return "ivf"; }
+    std::string version() const override;
+    std::string description() const override;
+
+    // Capabilities
+    std::vector<DistanceMetric> supported_distances() const override;
+    bool supports_distance(DistanceMetric metric) const override;
+    bool supports_updates() const override { return true; }
+    bool supports_deletions() const override { return true; }
+    bool supports_range_search() const override { return false; }
+
+    // Lifecycle
+    void fit(const std::vector<VectorEntry>& dataset,
+             const AlgorithmParams& params = {}) override;
+    void fit(const DatasetView& dataset, const AlgorithmParams& params = {}) override;
+    void train(const DatasetView& training, const AlgorithmParams& params = {}) override;
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path) override;
+    bool is_built() const override { return built_; }
+
+    // Query
+    ANNSResult query(const Vector& query_vector,
+                     const QueryConfig& config = {}) const override;
+    std::vector<ANNSResult> batch_query(
+        const std::vector<Vector>& query_vectors,
+        const QueryConfig& config = {}) const override;
+    void batch_query(const QueryMatrix& queries,
+                     const QueryConfig& config,
+                     const QueryOutput& output) const override;
+
+    // Mutations
+    void add_vector(const VectorEntry& entry) override;
+    void add_vectors(const std::vector<VectorEntry>& entries) override;
+    void add_vectors(const DatasetView& entries) override;
+    void remove_vector(VectorId id) override;
+    void remove_vectors(const std::vector<VectorId>& ids) override;
+
+    // Stats
+    size_t get_index_size() const override;
+    size_t get_memory_usage() const override;
+    std::unordered_map<std::string, std::string> get_build_params() const override;
+    ANNSMetrics get_metrics() const override;
+
+    // Configuration helpers
+    bool validate_params(const AlgorithmParams& params) const override;
+    AlgorithmParams get_default_params() const override;
+    QueryConfig get_default_query_config() const override;
+
+private:
+    class Impl;
+    std::unique_ptr<Impl> impl_;
+
+    bool built_;
+    AlgorithmParams build_params_;
+    ANNSMetrics metrics_;
+    mutable QueryCounters query_counters_;
+};
+
+class IvfANNSFactory : public ANNSFactory {
+public:
+    std::unique_ptr<ANNSAlgorithm> create() const override;
+    std::string algorithm_name() const override { return "ivf"; }
+    std::string algorithm_description() const override;
+    std::vector<DistanceMetric> supported_distances() const override;
+    AlgorithmParams default_build_params() const override;
+    QueryConfig default_query_config() const override;
+};
+
+} // namespace anns
+} // namespace sage_db
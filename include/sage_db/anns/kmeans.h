@@ -0,0 +1,41 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+
+struct KMeansOptions {
+    size_t iterations = 20;
+    size_t batch_size = 8192;    // points per mini-batch step
+    uint32_t seed = 1234;
+};
+
+/**
+ * @brief Parallel k-means over n contiguous row-major points.
+ *
+ * Returns k * dim centroids. Sets no larger than batch_size run full Lloyd
+ * iterations; bigger ones take mini-batch steps (Sculley 2010) with
+ * per-centroid learning rates, so the cost per iteration is bounded by the
+ * batch rather than the training set. Empty clusters are re-seeded by
+ * splitting the largest one. With fewer points than centroids the surplus
+ * centroids repeat points.
+ */
+std::vector<float> train_kmeans(const float* points, size_t n, size_t dim, size_t k,
+                                const KMeansOptions& options = {});
+
+/**
+ * @brief Nearest centroid for each of n contiguous points.
+ *
+ * Uses squared L2 (centroid_norms_sq must hold |c|^2 per centroid), or the
+ * largest inner product when by_inner_product is set. Work is tiled through
+ * simd::inner_product_block and spread over the shared thread pool.
+ */
+void assign_nearest(const float* points, size_t n, size_t dim,
+                    const float* centroids, const float* centroid_norms_sq, size_t k,
+                    bool by_inner_product, uint32_t* labels);
+
+} // namespace anns
+} // namespace sage_db
@@ -0,0 +1,75 @@
+#pragma once
+
+#include "sage_db/simd/fast_scan.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief Float ADC table quantized to the uint8 tables fast scan sums.
+ *
+ * Each sub-quantizer's 16 entries lose their minimum (summed into bias)
+ * and share one scale, chosen so the largest row spans 255 levels, or
+ * fewer when m tables could overflow a uint16 sum. A summed code then
+ * estimates the float table distance as bias + sum * inv_scale.
+ */
+struct FastScanTable {
+    std::vector<uint8_t> luts;  // 2 * fast_scan_pairs(m) x 16
+    float bias = 0.0f;
+    float inv_scale = 0.0f;
+
+    // table is m x 16 floats, as ProductQuantizer::compute_table writes
+    // for nbits = 4
+    void quantize(const float* table, size_t m);
+
+    float key(uint16_t sum) const { return bias + static_cast<float>(sum) * inv_scale; }
+};
+
+/**
+ * @brief 4-bit PQ codes in the interleaved fast-scan layout.
+ *
+ * Holds m codes (values below 16) per vector in blocks of 32 vectors, as
+ * simd/fast_scan.h describes; the last block is zero padded. Codes are
+ * appended and removed by index, removal moving the last code into the
+ * hole like every other dense table in the library.
+ */
+class FastScanCodes {
+public:
+    FastScanCodes() = default;
+    explicit FastScanCodes(size_t m) : m_(m) {}
+
+    size_t m() const { return m_; }
+    size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+    size_t block_count() const {
+        return (size_ + simd::kFastScanBlock - 1) / simd::kFastScanBlock;
+    }
+
+    void push_back(const uint8_t* code);
+    void set(size_t index, const uint8_t* code);
+    void get(size_t index, uint8_t* code) const;
+    void remove(size_t index);
+    void clear();
+    void reserve(size_t count);
+
+    // sums[i] for i < block_count() * 32; entries past size() are padding
+    void scan(const FastScanTable& table, uint16_t* sums) const;
+
+    // Raw blocks, for index files
+    const std::vector<uint8_t>& data() const { return data_; }
+    bool assign(std::vector<uint8_t> data, size_t size);
+
+    size_t memory_usage() const { return data_.capacity(); }
+
+private:
+    size_t m_ = 0;
+    size_t size_ = 0;
+    std::vector<uint8_t> data_;  // block_count() * fast_scan_block_bytes(m)
+};
+
+} // namespace anns
+} // namespace sage_db
@@ -0,0 +1,131 @@
+#pragma once
+
+#include "sage_db/anns/anns_interface.h"
+#include "sage_db/anns/kmeans.h"
+#include "sage_db/anns/pq_fast_scan.h"
+#include "sage_db/anns/pre_transform.h"
+#include "sage_db/anns/product_quantizer.h"
+#include "sage_db/vector_arena.h"
+#include <memory>
+#include <unordered_map>
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief Flat 4-bit product quantization scanned with in-register tables.
+ *
+ * Rows encode to m 4-bit PQ codes (16 centroids per sub-space, trained on
+ * up to max_train_points rows by fit() or the first add), stored in the
+ * fast-scan layout of pq_fast_scan.h. A query builds its ADC table,
+ * quantizes it to uint8 and sums it over 32 codes per shuffle, reading
+ * m / 2 bytes per row. The best max(k, rerank) estimates are then
+ * re-scored on float rows, borrowed from the caller's storage when a
+ * DatasetView shares it and copied otherwise; rerank = 0 returns the
+ * estimates themselves.
+ *
+ * m defaults to dimension / 2 (or ProductQuantizer::default_m for odd
+ * dimensions); "rerank" is overridable per query through
+ * QueryConfig::algorithm_params. "pre_transform" = "opq" rotates rows and
+ * queries before they are coded (pre_transform.h); re-ranking still reads
+ * the rows as stored.
+ */
+class PQFastScanANNS : public ANNSAlgorithm {
+public:
+    PQFastScanANNS();
+    ~PQFastScanANNS() override = default;
+
+    std::string name() const override { return "pq_fast_scan"; }
+    std::string version() const override;
+    std::string description() const override;
+
+    std::vector<DistanceMetric> supported_distances() const override;
+    bool supports_distance(DistanceMetric metric) const override;
+    bool supports_updates() const override { return true; }
+    bool supports_deletions() const override { return true; }
+    bool supports_range_search() const override { return false; }
+
+    void fit(const std::vector<VectorEntry>& dataset,
+             const AlgorithmParams& params = {}) override;
+    void fit(const DatasetView& dataset, const AlgorithmParams& params = {}) override;
+    bool save(const std::string& path) const override;
+    bool load(const std::string& path) override;
+    bool is_built() const override { return built_; }
+
+    ANNSResult query(const Vector& query_vector,
+                     const QueryConfig& config = {}) const override;
+    std::vector<ANNSResult> batch_query(const std::vector<Vector>& query_vectors,
+                                        const QueryConfig& config = {}) const override;
+    void batch_query(const QueryMatrix& queries,
+                     const QueryConfig& config,
+                     const QueryOutput& output) const override;
+
+    void add_vector(const VectorEntry& entry) override;
+    void add_vectors(const std::vector<VectorEntry>& entries) override;
+    void add_vectors(const DatasetView& entries) override;
+    void remove_vector(VectorId id) override;
+    void remove_vectors(const std::vector<VectorId>& ids) override;
+
+    size_t get_index_size() const override;
+    size_t get_memory_usage() const override;
+    std::unordered_map<std::string, std::string> get_build_params() const override;
+    ANNSMetrics get_metrics() const override;
+
+    bool validate_params(const AlgorithmParams& params) const override;
+    AlgorithmParams get_default_params() const override;
+    QueryConfig get_default_query_config() const override;
+
+private:
+    float compute_distance(const float* a, const float* b) const;
+    bool better(const std::pair<float, VectorId>& a, const std::pair<float, VectorId>& b) const;
+    float key_to_distance(float key) const;
+    size_t rerank_for(const QueryConfig& config) const;
+    // Leaves the k best hits in hits, best first; returns the number of
+    // codes scanned plus rows re-ranked
+    size_t search(const float* query, size_t k, size_t rerank,
+                  std::vector<std::pair<float, VectorId>>& hits) const;
+
+    void configure(const AlgorithmParams& params);
+    void reset_rows(Dimension dimension, size_t expected);
+    void check_dimension(Dimension dimension);
+    // Trains the quantizer on up to max_train_points_ of the given rows
+    void train(const std::vector<const float*>& rows);
+    void encode(const float* values, uint8_t* code) const;
+    void append_row(VectorId id, const float* values, size_t owned_slot);
+    void append_owned(VectorId id, const float* values);
+    void append_borrowed(const DatasetView& view);
+    void compact_owned();
+
+    DistanceMetric metric_;
+    Dimension dimension_;
+    uint32_t requested_m_;                // 0 picks a default from the dimension
+    uint32_t rerank_;                     // candidates re-scored on float rows by default
+    uint32_t max_train_points_;
+    KMeansOptions kmeans_;
+    bool trained_;
+    ProductQuantizer quantizer_;          // nbits = 4
+    PreTransform pre_transform_;          // applied ahead of quantizer_, trained with it
+    FastScanCodes codes_;                 // row i's codes at index i
+    std::vector<const float*> rows_;      // row i, owned or borrowed, for re-ranking
+    std::vector<VectorId> ids_;           // ids_[i] owns row i
+    std::vector<size_t> owned_slots_;     // slot in owned_ backing row i, or kBorrowed
+    std::unique_ptr<VectorArena> owned_;  // copies of rows nobody shared with us
+    std::vector<std::shared_ptr<const void>> borrowed_; // keeps borrowed rows alive
+    std::unordered_map<VectorId, size_t> id_to_index_;
+    ANNSMetrics metrics_;                 // build-time metrics, written only by mutators
+    mutable QueryCounters query_counters_;
+    bool built_;
+};
+
+class PQFastScanANNSFactory : public ANNSFactory {
+public:
+    std::unique_ptr<ANNSAlgorithm> create() const override;
+    std::string algorithm_name() const override { return "pq_fast_scan"; }
+    std::string algorithm_description() const override;
+    std::vector<DistanceMetric> supported_distances() const override;
+    AlgorithmParams default_build_params() const override;
+    QueryConfig default_query_config() const override;
+};
+
+} // namespace anns
+} // namespace sage_db
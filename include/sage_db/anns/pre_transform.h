@@ -0,0 +1,82 @@
+#pragma once
+
+#include "sage_db/anns/anns_interface.h"
+#include "sage_db/anns/kmeans.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+
+// Map applied to vectors ahead of product quantization, chosen with the
+// pre_transform build param
+enum class PreTransformKind : uint32_t {
+    NONE = 0,
+    OPQ = 1,
+};
+
+PreTransformKind parse_pre_transform(const std::string& name);
+std::string pre_transform_name(PreTransformKind kind);
+
+/**
+ * @brief Linear map a PQ-based plugin applies to rows and queries first.
+ *
+ * A plugin takes one from its build params with from_params() ("none" is
+ * the identity), trains it on the sample its codebooks learn from, and
+ * passes every row it encodes and every query it builds tables for
+ * through apply(). The map is orthogonal, so L2 distances and inner
+ * products, and with them exact re-ranking, are unchanged by it.
+ *
+ * "opq" learns the rotation of non-parametric Optimized Product
+ * Quantization (Ge et al., CVPR 2013). Starting from the identity, each of
+ * opq_iters rounds trains a product quantizer on the rotated sample and
+ * then solves the orthogonal Procrustes problem min |R X - Y| for the
+ * reconstructions Y, through the SVD of Y^T X (LAPACK sgesvd when the
+ * build links it, one-sided Jacobi otherwise). The rotation spreads
+ * variance evenly over the sub-spaces, which is what PQ assumes.
+ */
+class PreTransform {
+public:
+    PreTransform() = default;
+    PreTransform(PreTransformKind kind, size_t dimension, uint32_t iterations);
+
+    // From "pre_transform" and "opq_iters"
+    static PreTransform from_params(const AlgorithmParams& params, size_t dimension);
+    static bool valid_params(const AlgorithmParams& params);
+    // Sets the params from_params() reads
+    void record_params(AlgorithmParams& params) const;
+
+    // m and nbits describe the product quantizer the map feeds
+    void train(const float* points, size_t n, size_t m, size_t nbits,
+               const KMeansOptions& options);
+
+    // out = R in; in and out must not overlap
+    void apply(const float* in, float* out) const;
+    // Rows in place, n at a time through the block kernel
+    void apply(float* rows, size_t n) const;
+
+    // Kind, then the rounds and matrix of a trained map
+    void write(std::ostream& out) const;
+    bool read(std::istream& in, size_t dimension);
+
+    bool identity() const { return kind_ == PreTransformKind::NONE; }
+    PreTransformKind kind() const { return kind_; }
+    uint32_t iterations() const { return iterations_; }
+    // dimension x dimension, row-major: output d is <row d, input>
+    const std::vector<float>& matrix() const { return matrix_; }
+    size_t memory_usage() const { return matrix_.capacity() * sizeof(float); }
+
+private:
+    PreTransformKind kind_ = PreTransformKind::NONE;
+    size_t dimension_ = 0;
+    uint32_t iterations_ = 0;
+    std::vector<float> matrix_;
+};
+
+} // namespace anns
+} // namespace sage_db
@@ -0,0 +1,72 @@
+#pragma once
+
+#include "sage_db/anns/kmeans.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief Product quantizer with up to 256 codewords per sub-space.
+ *
+ * Splits dimension into m sub-vectors of dimension / m floats and learns a
+ * k-means codebook of 2^nbits centroids for each, so a vector encodes to m
+ * bytes. Distances are estimated with per-query lookup tables (ADC).
+ */
+class ProductQuantizer {
+public:
+    ProductQuantizer() = default;
+
+    // dimension must be divisible by m; nbits is in [1, 8]
+    ProductQuantizer(size_t dimension, size_t m, size_t nbits);
+
+    void train(const float* points, size_t n, const KMeansOptions& options = {});
+
+    // Writes m codes for one row
+    void encode(const float* row, uint8_t* code) const;
+
+    // The row's reconstruction: the codewords its m codes select
+    void decode(const uint8_t* code, float* row) const;
+
+    // table[j * ksub() + c] is the squared L2 distance (or the negated dot
+    // product when inner_product is set) between sub-vector j of query and
+    // codeword c
+    void compute_table(const float* query, bool inner_product, float* table) const;
+
+    float table_distance(const float* table, const uint8_t* code) const {
+        float sum = 0.0f;
+        for (size_t j = 0; j < m_; ++j) {
+            sum += table[j * ksub_ + code[j]];
+        }
+        return sum;
+    }
+
+    size_t dimension() const { return dimension_; }
+    size_t m() const { return m_; }
+    size_t nbits() const { return nbits_; }
+    size_t ksub() const { return ksub_; }
+    size_t dsub() const { return dsub_; }
+    size_t code_size() const { return m_; }
+    size_t table_size() const { return m_ * ksub_; }
+
+    // m x ksub x dsub floats
+    const std::vector<float>& codebooks() const { return codebooks_; }
+    void set_codebooks(std::vector<float> codebooks) { codebooks_ = std::move(codebooks); }
+
+    // Largest divisor of dimension that is at most dimension / 4 (and >= 1)
+    static size_t default_m(size_t dimension);
+
+private:
+    size_t dimension_ = 0;
+    size_t m_ = 0;
+    size_t nbits_ = 8;
+    size_t ksub_ = 0;
+    size_t dsub_ = 0;
+    std::vector<float> codebooks_;
+};
+
+} // namespace anns
+} // namespace sage_db
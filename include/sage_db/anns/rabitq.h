@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+
+/**
+ * @brief RaBitQ codes: randomly rotated residuals with error-bounded estimates.
+ *
+ * A residual r = row - center is normalized and turned by a random
+ * orthogonal rotation P (generated from seed, so indexes only persist the
+ * seed). Its rotated unit vector u' is rounded to the nearest point x of a
+ * grid of 2^bits levels per dimension: the signs for 1 bit (Gao & Long,
+ * SIGMOD 2024), a rescaled uniform grid for more (the extended-bit
+ * variant). A code keeps the grid indices plus |r| and <x, u'>.
+ *
+ * For a target t (the query minus the same center for L2, the query for
+ * inner products), <x, P t> / <x, u'> estimates <r / |r|, t> without bias,
+ * and with high probability misses it by at most
+ *   |t| * eps0 * sqrt(1 - <x, u'>^2) / <x, u'> / sqrt(dimension - 1)
+ * with eps0 = 1.9. estimate() returns <r, t> with that bound scaled by |r|,
+ * so callers can skip exact distances whose lower bound cannot make the
+ * top k.
+ *
+ * One-bit codes are scored with per-query tables of byte sums; wider ones
+ * with the u4 / u8 weighted-sum kernels of simd/quantized_distance.h.
+ */
+class RaBitQuantizer {
+public:
+    // A target prepared for one quantizer
+    struct Query {
+        std::vector<float> rotated;    // P t, padded with zeros to whole bytes
+        std::vector<float> byte_sums;  // 1 bit: per code byte, sums of rotated over its set bits
+        float norm = 0.0f;             // |t|
+        float sum = 0.0f;              // sum of rotated
+    };
+
+    // dot estimates <r, t>; the true value lies within dot +- error with
+    // high probability
+    struct Estimate {
+        float dot;
+        float error;
+    };
+
+    RaBitQuantizer() = default;
+    // bits is in [1, 8]
+    RaBitQuantizer(size_t dimension, size_t bits, uint32_t seed);
+
+    // residual = row - center
+    void encode(const float* residual, uint8_t* code) const;
+
+    void rotate(const float* in, float* out) const;
+    void prepare(const float* target, Query& query) const;
+    // For a target already rotated, e.g. P q - P c from precomputed parts
+    void prepare_rotated(const float* rotated, Query& query) const;
+    Estimate estimate(const Query& query, const uint8_t* code) const;
+
+    // |r| of an encoded residual
+    float residual_norm(const uint8_t* code) const;
+
+    size_t dimension() const { return dimension_; }
+    size_t bits() const { return bits_; }
+    uint32_t seed() const { return seed_; }
+    size_t code_size() const { return code_size_; }
+
+private:
+    size_t dimension_ = 0;
+    size_t bits_ = 1;
+    uint32_t seed_ = 0;
+    size_t code_size_ = 0;
+    std::vector<float> rotation_;  // dimension x dimension, orthonormal rows
+};
+
+} // namespace anns
+} // namespace sage_db
@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+
+// Element format of stored rows, chosen with the storage_precision build
+// parameter ("fp32", "fp16", "bf16", "int8", "int4", "rabitq"). RABITQ
+// codes come from RaBitQuantizer (rabitq.h), not ScalarQuantizer, and only
+// the graph and IVF indexes offer them.
+enum class StoragePrecision : uint32_t {
+    FP32 = 0,
+    FP16 = 1,
+    BF16 = 2,
+    INT8 = 3,
+    INT4 = 4,
+    RABITQ = 5
+};
+
+// Throws std::runtime_error for a name that is not one of the above
+StoragePrecision parse_storage_precision(const std::string& name);
+std::string storage_precision_name(StoragePrecision precision);
+
+/**
+ * @brief Per-dimension scalar quantizer for compact row storage.
+ *
+ * fp16 and bf16 round every value to a 16-bit float. int8 and int4 map
+ * each dimension's [min, max] range, learned by train(), onto 256 or 16
+ * evenly spaced levels; values outside it are clamped. int4 packs two
+ * dimensions per byte, the lower one in the low nibble.
+ *
+ * Distances are asymmetric: the query stays in float and only the stored
+ * row is quantized. prepare() folds the per-dimension offsets into the
+ * query once, so each code is scored with one SIMD pass over its bytes.
+ */
+class ScalarQuantizer {
+public:
+    // A query prepared for one quantizer
+    struct Query {
+        std::vector<float> residual;  // query - min; the query itself for 16-bit floats
+        std::vector<float> weight;    // query * step (integer codes)
+        float bias = 0.0f;            // query . min (integer codes)
+    };
+
+    ScalarQuantizer() = default;
+    // precision must be one of the 16-bit float or integer formats
+    ScalarQuantizer(size_t dimension, StoragePrecision precision);
+
+    // Learns the per-dimension range of the integer formats from n rows;
+    // the 16-bit float formats need no training
+    void train(const float* const* rows, size_t n);
+    bool trained() const { return trained_; }
+
+    void encode(const float* row, uint8_t* code) const;
+    void decode(const uint8_t* code, float* row) const;
+
+    void prepare(const float* query, Query& prepared) const;
+    float l2_squared(const Query& query, const uint8_t* code) const;
+    float inner_product(const Query& query, const uint8_t* code) const;
+
+    size_t dimension() const { return dimension_; }
+    StoragePrecision precision() const { return precision_; }
+    size_t code_size() const { return code_size_; }
+
+    // Lowest value and level spacing of each dimension (integer codes)
+    const std::vector<float>& mins() const { return mins_; }
+    const std::vector<float>& steps() const { return steps_; }
+    void set_range(std::vector<float> mins, std::vector<float> steps);
+
+private:
+    size_t dimension_ = 0;
+    StoragePrecision precision_ = StoragePrecision::FP32;
+    size_t code_size_ = 0;
+    bool trained_ = false;
+    std::vector<float> mins_;
+    std::vector<float> steps_;
+};
+
+} // namespace anns
+} // namespace sage_db
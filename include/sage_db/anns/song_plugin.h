@@ -35,6 +35,9 @@ public:
     bool supports_range_search() const override { return false; }
     
     // Index lifecycle
+    // Keeps its own copy of the data; DatasetView overloads materialize rows
+    using ANNSAlgorithm::fit;
+    using ANNSAlgorithm::add_vectors;
     void fit(const std::vector<VectorEntry>& dataset,
              const AlgorithmParams& params = {}) override;
     bool save(const std::string& path) const override;
@@ -48,6 +51,9 @@ public:
     std::vector<ANNSResult> batch_query(
         const std::vector<Vector>& query_vectors,
         const QueryConfig& config = {}) const override;
+    void batch_query(const QueryMatrix& queries,
+                     const QueryConfig& config,
+                     const QueryOutput& output) const override;
     
     // Update operations
     void add_vector(const VectorEntry& entry) override;
@@ -72,7 +78,8 @@ private:
     int dimension_;
     size_t max_vectors_;
     bool is_built_;
-    mutable ANNSMetrics metrics_;
+    ANNSMetrics metrics_;
+    mutable QueryCounters query_counters_;
 };
 
 /**
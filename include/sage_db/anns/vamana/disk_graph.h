@@ -0,0 +1,89 @@
+#pragma once
+
+#include "sage_db/anns/vamana/graph.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+namespace vamana {
+
+/**
+ * @brief Read-only Vamana graph stored in a sector-aligned file.
+ *
+ * A 4 KiB header sector is followed by one record per slot: the
+ * full-precision row, the degree and max_degree neighbour ids. Records never
+ * straddle a sector boundary. Small records are packed several to a
+ * sector; larger ones start on a boundary and span whole sectors. Reads
+ * use pread, so one open file serves any number of concurrent searches.
+ */
+class DiskGraph {
+public:
+    static constexpr size_t kSectorSize = 4096;
+    static constexpr uint32_t kVersion = 1;
+
+    struct Header {
+        char magic[8];
+        uint32_t version;
+        uint32_t dimension;
+        uint32_t max_degree;
+        uint32_t metric;
+        uint64_t node_count;
+        uint32_t entry_point;
+        uint32_t record_bytes;
+        uint32_t nodes_per_sector;   // 0 when a record spans several sectors
+        uint32_t sectors_per_node;
+    };
+
+    // Points into a record buffer
+    struct NodeView {
+        const float* vector;
+        uint32_t degree;
+        const idx_t* neighbors;
+    };
+
+    DiskGraph() = default;
+    ~DiskGraph();
+    DiskGraph(const DiskGraph&) = delete;
+    DiskGraph& operator=(const DiskGraph&) = delete;
+
+    static size_t record_bytes(uint32_t dimension, uint32_t max_degree) {
+        return (static_cast<size_t>(dimension) + 1 + max_degree) * sizeof(float);
+    }
+
+    // rows[i] may be null for unused slots. The file is written next to
+    // path and renamed over it, so a reader holding the old file open keeps
+    // a consistent copy.
+    static bool write(const std::string& path, const FixedDegreeGraph& graph,
+                      const std::vector<const float*>& rows, uint32_t dimension,
+                      uint32_t metric, idx_t entry_point);
+
+    // Serializes one record into record_bytes(dimension, max_degree) bytes
+    static void encode_record(const float* row, uint32_t dimension, const idx_t* neighbors,
+                              uint32_t degree, uint32_t max_degree, char* out);
+
+    NodeView view(const char* record) const;
+
+    bool open(const std::string& path);
+    const Header& header() const { return header_; }
+    const std::string& path() const { return path_; }
+    size_t record_size() const { return header_.record_bytes; }
+
+    // Reads `count` records with back-to-back preads; record i lands at
+    // buffer.data() + i * record_size(). Safe to call concurrently.
+    bool read(const idx_t* nodes, size_t count, std::vector<char>& buffer) const;
+
+private:
+    uint64_t offset_of(idx_t node) const;
+
+    int fd_ = -1;
+    std::string path_;
+    Header header_{};
+};
+
+} // namespace vamana
+} // namespace anns
+} // namespace sage_db
@@ -1,10 +1,9 @@
 #pragma once
 
 #include "sage_db/common.h"
+#include "sage_db/simd/distance.h"
 
-#include <cmath>
-#include <stdexcept>
-#include <vector>
+#include <cstddef>
 
 namespace sage_db {
 namespace anns {
@@ -12,46 +11,17 @@ namespace vamana {
 
 class Distance {
 public:
-    static float l2(const Vector& a, const Vector& b) {
-        if (a.size() != b.size()) {
-            throw std::invalid_argument("Vamana distance: vector dimensions mismatch");
-        }
-        float sum = 0.0f;
-        for (size_t i = 0; i < a.size(); ++i) {
-            float diff = a[i] - b[i];
-            sum += diff * diff;
-        }
-        return std::sqrt(sum);
+    // Rows are dim floats each; callers check dimensions at the plugin boundary
+    static float l2(const float* a, const float* b, size_t dim) {
+        return simd::l2_distance(a, b, dim);
     }
 
-    static float inner_product(const Vector& a, const Vector& b) {
-        if (a.size() != b.size()) {
-            throw std::invalid_argument("Vamana distance: vector dimensions mismatch");
-        }
-        float dot = 0.0f;
-        for (size_t i = 0; i < a.size(); ++i) {
-            dot += a[i] * b[i];
-        }
-        return 1.0f - dot;
+    static float inner_product(const float* a, const float* b, size_t dim) {
+        return 1.0f - simd::inner_product(a, b, dim);
     }
 
-    static float cosine(const Vector& a, const Vector& b) {
-        if (a.size() != b.size()) {
-            throw std::invalid_argument("Vamana distance: vector dimensions mismatch");
-        }
-        float dot = 0.0f;
-        float norm_a = 0.0f;
-        float norm_b = 0.0f;
-        for (size_t i = 0; i < a.size(); ++i) {
-            dot += a[i] * b[i];
-            norm_a += a[i] * a[i];
-            norm_b += b[i] * b[i];
-        }
-        if (norm_a == 0.0f || norm_b == 0.0f) {
-            return 1.0f;
-        }
-        float cosine_similarity = dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
-        return 1.0f - cosine_similarity;
+    static float cosine(const float* a, const float* b, size_t dim) {
+        return simd::cosine_distance(a, b, dim);
     }
 };
 
@@ -0,0 +1,160 @@
+#pragma once
+
+#include "sage_db/anns/vamana/node_array.h"
+#include "sage_db/common.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+namespace vamana {
+
+using idx_t = uint32_t;
+
+/**
+ * @brief Fixed-degree adjacency of the Vamana proximity graph.
+ *
+ * Nodes are dense ids. Each owns a padded record of 2 + max_degree ids: a
+ * version, its degree, then its neighbours, so a hop reads one contiguous
+ * record instead of hashing into a per-vertex list. Records live in
+ * fixed-size chunks that never move, so growing the graph leaves existing
+ * records where they are.
+ *
+ * The version makes each record a seqlock: writers (serialized per node by
+ * the caller) bump it to odd before changing the record and back to even
+ * after, and read() retries until it copies a record no writer touched.
+ * Searches therefore read adjacency without locks while inserts relink
+ * the graph. degree() and neighbors() read in place and are for callers
+ * that exclude writers of that node.
+ */
+class FixedDegreeGraph {
+public:
+    static constexpr size_t kNodesPerChunk = 4096;
+
+    void reset(uint32_t max_degree) {
+        max_degree_ = max_degree;
+        stride_ = static_cast<size_t>(max_degree) + 2;
+        size_.store(0, std::memory_order_release);
+        chunks_.clear();
+    }
+
+    uint32_t max_degree() const { return max_degree_; }
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+    // ids per record: version, degree, then max_degree() neighbours
+    size_t stride() const { return stride_; }
+
+    // Takes over count records laid out back to back at records, which
+    // must span whole chunks of kNodesPerChunk and outlive reset(); only on
+    // an empty graph. Later nodes fill the last chunk, then new ones.
+    void adopt(idx_t* records, size_t count) {
+        for (size_t first = 0; first < count; first += kNodesPerChunk) {
+            chunks_.adopt_chunk(records + first * stride_);
+        }
+        size_.store(count, std::memory_order_release);
+    }
+
+    // Appends a node with no neighbours and returns its id
+    idx_t add_node() {
+        const size_t node = size_.load(std::memory_order_relaxed);
+        if (node == chunks_.chunk_count() * kNodesPerChunk) {
+            chunks_.add_chunk(kNodesPerChunk * stride_);
+        }
+        size_.store(node + 1, std::memory_order_release);
+        return static_cast<idx_t>(node);
+    }
+
+    uint32_t degree(idx_t node) const { return record(node)[1]; }
+    const idx_t* neighbors(idx_t node) const { return record(node) + 2; }
+
+    bool contains(idx_t node, idx_t neighbor) const {
+        const idx_t* begin = neighbors(node);
+        return std::find(begin, begin + degree(node), neighbor) != begin + degree(node);
+    }
+
+    // Consistent copy of the node's neighbours into out (resized to
+    // max_degree()); returns the degree. Safe against concurrent writers.
+    uint32_t read(idx_t node, std::vector<idx_t>& out) const {
+        out.resize(max_degree_);
+        idx_t* rec = record(node);
+        while (true) {
+            const idx_t before = word(rec, 0).load(std::memory_order_acquire);
+            if (before & 1) {
+                continue;
+            }
+            const uint32_t degree =
+                std::min<uint32_t>(word(rec, 1).load(std::memory_order_relaxed), max_degree_);
+            for (uint32_t i = 0; i < degree; ++i) {
+                out[i] = word(rec, 2 + i).load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (word(rec, 0).load(std::memory_order_relaxed) == before) {
+                return degree;
+            }
+        }
+    }
+
+    // Keeps at most max_degree() of the given ids
+    void set_neighbors(idx_t node, const idx_t* ids, size_t count) {
+        idx_t* rec = record(node);
+        const idx_t version = begin_write(rec);
+        const size_t kept = std::min<size_t>(count, max_degree_);
+        for (size_t i = 0; i < kept; ++i) {
+            word(rec, 2 + i).store(ids[i], std::memory_order_relaxed);
+        }
+        word(rec, 1).store(static_cast<idx_t>(kept), std::memory_order_relaxed);
+        end_write(rec, version);
+    }
+
+    // False when the node is already at max_degree()
+    bool try_append(idx_t node, idx_t neighbor) {
+        idx_t* rec = record(node);
+        const idx_t degree = rec[1];
+        if (degree >= max_degree_) {
+            return false;
+        }
+        const idx_t version = begin_write(rec);
+        word(rec, 2 + degree).store(neighbor, std::memory_order_relaxed);
+        word(rec, 1).store(degree + 1, std::memory_order_relaxed);
+        end_write(rec, version);
+        return true;
+    }
+
+    void clear(idx_t node) { set_neighbors(node, nullptr, 0); }
+
+    // Adopted records belong to whoever lent them and are not counted
+    size_t memory_usage() const {
+        return chunks_.owned_chunk_count() * kNodesPerChunk * stride_ * sizeof(idx_t) +
+               chunks_.directory_bytes();
+    }
+
+private:
+    idx_t* record(idx_t node) const {
+        return chunks_.chunk(node / kNodesPerChunk) + (node % kNodesPerChunk) * stride_;
+    }
+
+    static std::atomic_ref<idx_t> word(idx_t* rec, size_t i) { return std::atomic_ref<idx_t>(rec[i]); }
+
+    static idx_t begin_write(idx_t* rec) {
+        const idx_t version = word(rec, 0).load(std::memory_order_relaxed);
+        word(rec, 0).store(version + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        return version;
+    }
+
+    static void end_write(idx_t* rec, idx_t version) {
+        word(rec, 0).store(version + 2, std::memory_order_release);
+    }
+
+    uint32_t max_degree_ = 0;
+    size_t stride_ = 2;
+    std::atomic<size_t> size_{0};
+    ChunkDirectory<idx_t> chunks_;
+};
+
+} // namespace vamana
+} // namespace anns
+} // namespace sage_db
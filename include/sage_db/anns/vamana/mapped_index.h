@@ -0,0 +1,95 @@
+#pragma once
+
+#include "sage_db/anns/vamana/graph.h"
+#include "sage_db/common.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+namespace sage_db {
+namespace anns {
+namespace vamana {
+
+/**
+ * @brief In-memory Vamana index file laid out to be searched from mmap.
+ *
+ * A 4 KiB header page is followed by page-aligned blocks: slot states,
+ * external ids, full-precision rows, adjacency records in
+ * FixedDegreeGraph's layout, the id map sorted by external id, and the
+ * filter labels. Per-slot blocks are padded to whole chunks of
+ * kSlotsPerChunk so the node table and graph adopt them in place.
+ *
+ * The mapping is private and writable. Loading reads only the header;
+ * pages fault in on first touch, or up front with populate. Later inserts
+ * and deletes copy the pages they change and never write to the file.
+ * Block contents are trusted as save() wrote them.
+ */
+class MappedIndex {
+public:
+    static constexpr uint32_t kVersion = 4;
+    static constexpr size_t kPageSize = 4096;
+    static constexpr size_t kSlotsPerChunk = 4096;
+
+    struct Header {
+        uint32_t version;  // where the streamed formats keep their version tag
+        uint32_t dimension;
+        uint32_t metric;
+        uint32_t M;
+        uint32_t max_degree;
+        uint32_t ef_construction;
+        uint32_t ef_search;
+        float alpha;
+        uint64_t slot_count;
+        uint64_t live_count;
+        uint32_t entry_point;
+        uint32_t record_stride;  // ids per adjacency record
+        uint64_t states_offset;
+        uint64_t ids_offset;
+        uint64_t vectors_offset;
+        uint64_t adjacency_offset;
+        uint64_t id_map_offset;
+        uint64_t labels_offset;
+        uint64_t file_size;
+    };
+
+    struct IdEntry {
+        VectorId id;
+        idx_t slot;
+        uint32_t reserved;
+    };
+
+    MappedIndex() = default;
+    ~MappedIndex();
+    MappedIndex(const MappedIndex&) = delete;
+    MappedIndex& operator=(const MappedIndex&) = delete;
+
+    static uint64_t padded_slots(uint64_t slot_count) {
+        return (slot_count + kSlotsPerChunk - 1) / kSlotsPerChunk * kSlotsPerChunk;
+    }
+
+    // Sets record_stride and the block offsets up to labels_offset from the
+    // other fields; file_size is known only once the labels are written
+    static void lay_out(Header& header);
+
+    // Maps the whole file; populate pre-faults it (MAP_POPULATE)
+    bool open(const std::string& path, bool populate);
+
+    const Header& header() const { return header_; }
+
+    template <typename T>
+    T* block(uint64_t offset) const {
+        return reinterpret_cast<T*>(base_ + offset);
+    }
+
+    const IdEntry* id_map() const { return block<IdEntry>(header_.id_map_offset); }
+
+private:
+    char* base_ = nullptr;
+    size_t size_ = 0;
+    Header header_{};
+};
+
+} // namespace vamana
+} // namespace anns
+} // namespace sage_db
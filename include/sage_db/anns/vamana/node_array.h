@@ -0,0 +1,205 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+namespace vamana {
+
+/**
+ * @brief Directory of fixed-length chunks that readers walk while one
+ * writer adds more.
+ *
+ * Chunks never move. When the directory itself fills up the writer
+ * publishes a copy twice as large and keeps the old one until clear(), so
+ * a reader that loaded any directory can keep using it. A chunk is either
+ * allocated here or adopted from memory someone else keeps alive, such as
+ * a mapped index file.
+ */
+template <typename T>
+class ChunkDirectory {
+public:
+    ChunkDirectory() = default;
+    ChunkDirectory(const ChunkDirectory&) = delete;
+    ChunkDirectory& operator=(const ChunkDirectory&) = delete;
+
+    // Chunk i must have been added before the caller learned of it
+    T* chunk(size_t i) const {
+        return current_.load(std::memory_order_acquire)->chunks[i].load(std::memory_order_acquire);
+    }
+
+    // Writer only
+    size_t chunk_count() const { return chunks_.size(); }
+
+    // Writer only; elements are value-initialized
+    void add_chunk(size_t length) {
+        owned_.push_back(std::make_unique<T[]>(length));
+        adopt_chunk(owned_.back().get());
+    }
+
+    // Writer only; the caller keeps the chunk alive until clear()
+    void adopt_chunk(T* chunk) {
+        Directory* dir = current_.load(std::memory_order_relaxed);
+        if (!dir || chunks_.size() == dir->capacity) {
+            const size_t capacity = dir ? dir->capacity * 2 : kInitialCapacity;
+            auto grown = std::make_unique<Directory>(capacity);
+            for (size_t i = 0; i < chunks_.size(); ++i) {
+                grown->chunks[i].store(chunks_[i], std::memory_order_relaxed);
+            }
+            dir = grown.get();
+            directories_.push_back(std::move(grown));
+            current_.store(dir, std::memory_order_release);
+        }
+        chunks_.push_back(chunk);
+        dir->chunks[chunks_.size() - 1].store(chunk, std::memory_order_release);
+    }
+
+    // Writer only, with no reader left holding an element
+    void clear() {
+        current_.store(nullptr, std::memory_order_relaxed);
+        chunks_.clear();
+        owned_.clear();
+        directories_.clear();
+    }
+
+    // Chunks allocated here, as opposed to adopted
+    size_t owned_chunk_count() const { return owned_.size(); }
+
+    size_t directory_bytes() const {
+        size_t total = 0;
+        for (const auto& dir : directories_) {
+            total += dir->capacity * sizeof(std::atomic<T*>);
+        }
+        return total;
+    }
+
+private:
+    static constexpr size_t kInitialCapacity = 16;
+
+    struct Directory {
+        explicit Directory(size_t size)
+            : capacity(size), chunks(std::make_unique<std::atomic<T*>[]>(size)) {}
+        size_t capacity;
+        std::unique_ptr<std::atomic<T*>[]> chunks;
+    };
+
+    std::atomic<Directory*> current_{nullptr};
+    std::vector<T*> chunks_;
+    std::vector<std::unique_ptr<T[]>> owned_;
+    std::vector<std::unique_ptr<Directory>> directories_;
+};
+
+/**
+ * @brief Per-slot array of the node table that grows without moving.
+ *
+ * A search may index any slot it reached through the graph while the
+ * writer appends; the writer fills a new slot before linking it, and the
+ * link publishes those writes. Growing, shrinking and clearing are
+ * writer-only.
+ */
+template <typename T>
+class NodeArray {
+public:
+    static constexpr size_t kChunkSize = 4096;
+
+    NodeArray() = default;
+    NodeArray(const NodeArray&) = delete;
+    NodeArray& operator=(const NodeArray&) = delete;
+
+    size_t size() const { return size_.load(std::memory_order_acquire); }
+    bool empty() const { return size() == 0; }
+
+    T& operator[](size_t i) const { return directory_.chunk(i / kChunkSize)[i % kChunkSize]; }
+
+    // Appends a value-initialized slot and returns its index
+    size_t append() {
+        const size_t index = size_.load(std::memory_order_relaxed);
+        if (index == directory_.chunk_count() * kChunkSize) {
+            directory_.add_chunk(kChunkSize);
+        }
+        size_.store(index + 1, std::memory_order_release);
+        return index;
+    }
+
+    // Grows to count value-initialized slots; never shrinks
+    void resize(size_t count) {
+        while (size() < count) {
+            append();
+        }
+    }
+
+    // Takes over count slots stored contiguously at data, which must span
+    // whole chunks and outlive clear(); only on an empty array
+    void adopt(T* data, size_t count) {
+        for (size_t first = 0; first < count; first += kChunkSize) {
+            directory_.adopt_chunk(data + first);
+        }
+        size_.store(count, std::memory_order_release);
+    }
+
+    void clear() {
+        directory_.clear();
+        size_.store(0, std::memory_order_release);
+    }
+
+    // Adopted chunks belong to whoever lent them and are not counted
+    size_t memory_usage() const {
+        return directory_.owned_chunk_count() * kChunkSize * sizeof(T) +
+               directory_.directory_bytes();
+    }
+
+private:
+    ChunkDirectory<T> directory_;
+    std::atomic<size_t> size_{0};
+};
+
+/**
+ * @brief Per-slot byte codes of one fixed size, grown like NodeArray.
+ *
+ * Codes sit back to back in chunks of kChunkSize that never move; the
+ * writer makes room for a slot and fills its code before linking it.
+ */
+class CodeArray {
+public:
+    static constexpr size_t kChunkSize = 4096;
+
+    CodeArray() = default;
+    CodeArray(const CodeArray&) = delete;
+    CodeArray& operator=(const CodeArray&) = delete;
+
+    size_t code_size() const { return code_size_; }
+
+    uint8_t* operator[](size_t i) const {
+        return directory_.chunk(i / kChunkSize) + (i % kChunkSize) * code_size_;
+    }
+
+    // Writer only; drops every code
+    void reset(size_t code_size) {
+        directory_.clear();
+        code_size_ = code_size;
+    }
+
+    // Writer only; makes room for the codes of slots below count
+    void reserve(size_t count) {
+        while (directory_.chunk_count() * kChunkSize < count) {
+            directory_.add_chunk(kChunkSize * code_size_);
+        }
+    }
+
+    size_t memory_usage() const {
+        return directory_.owned_chunk_count() * kChunkSize * code_size_ +
+               directory_.directory_bytes();
+    }
+
+private:
+    ChunkDirectory<uint8_t> directory_;
+    size_t code_size_ = 0;
+};
+
+} // namespace vamana
+} // namespace anns
+} // namespace sage_db
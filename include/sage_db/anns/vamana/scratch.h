@@ -0,0 +1,207 @@
+#pragma once
+
+#include "sage_db/anns/rabitq.h"
+#include "sage_db/anns/scalar_quantizer.h"
+#include "sage_db/anns/vamana/graph.h"
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace sage_db {
+namespace anns {
+namespace vamana {
+
+using DistAndId = std::pair<float, idx_t>;
+
+/**
+ * @brief Visited marks tagged with a search generation.
+ *
+ * prepare() starts a new search by bumping the generation, so clearing is
+ * O(1) except when the counter wraps. Nodes appended by a concurrent
+ * insert after prepare() grow the marks on first visit.
+ */
+class VisitedSet {
+public:
+    void prepare(size_t count) {
+        if (marks_.size() < count) {
+            marks_.resize(count, 0);
+        }
+        if (++epoch_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    // True the first time a node is seen in the current search
+    bool visit(idx_t node) {
+        if (node >= marks_.size()) {
+            marks_.resize(std::max<size_t>(node + 1, marks_.size() * 2), 0);
+        }
+        if (marks_[node] == epoch_) {
+            return false;
+        }
+        marks_[node] = epoch_;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> marks_;
+    uint32_t epoch_ = 0;
+};
+
+/**
+ * @brief Max-heap that keeps the `capacity` closest candidates.
+ *
+ * Storage is reused across searches; it only grows when a search asks for
+ * a larger capacity than any before it.
+ */
+class BoundedMaxHeap {
+public:
+    void reset(size_t capacity) {
+        capacity_ = std::max<size_t>(capacity, 1);
+        items_.clear();
+        items_.reserve(capacity_);
+    }
+
+    size_t size() const { return items_.size(); }
+    bool full() const { return items_.size() >= capacity_; }
+    const DistAndId& top() const { return items_.front(); }
+
+    // False when the candidate is no closer than the current worst of a full heap
+    bool push(float dist, idx_t id) {
+        if (!full()) {
+            items_.emplace_back(dist, id);
+            std::push_heap(items_.begin(), items_.end());
+            return true;
+        }
+        if (dist >= items_.front().first) {
+            return false;
+        }
+        std::pop_heap(items_.begin(), items_.end());
+        items_.back() = {dist, id};
+        std::push_heap(items_.begin(), items_.end());
+        return true;
+    }
+
+    // Empties the heap into out, closest first
+    void drain_sorted(std::vector<DistAndId>& out) {
+        std::sort_heap(items_.begin(), items_.end());
+        out.assign(items_.begin(), items_.end());
+        items_.clear();
+    }
+
+private:
+    std::vector<DistAndId> items_;
+    size_t capacity_ = 1;
+};
+
+/**
+ * @brief Min-heap of nodes still to expand during a beam search.
+ */
+class CandidateQueue {
+public:
+    void clear() { items_.clear(); }
+    bool empty() const { return items_.empty(); }
+
+    void push(float dist, idx_t id) {
+        items_.emplace_back(dist, id);
+        std::push_heap(items_.begin(), items_.end(), std::greater<>());
+    }
+
+    DistAndId pop() {
+        std::pop_heap(items_.begin(), items_.end(), std::greater<>());
+        DistAndId closest = items_.back();
+        items_.pop_back();
+        return closest;
+    }
+
+private:
+    std::vector<DistAndId> items_;
+};
+
+/**
+ * @brief Everything one graph search or insert needs, kept between calls.
+ */
+struct SearchScratch {
+    VisitedSet visited;
+    CandidateQueue frontier;
+    BoundedMaxHeap best;
+    std::vector<DistAndId> results;     // best, drained closest first
+    std::vector<DistAndId> candidates;  // pruning input
+    std::vector<idx_t> kept;            // pruning output
+    std::vector<idx_t> adjacency;       // copy of the record being expanded
+    std::vector<idx_t> pending;         // its unvisited neighbours, to be scored
+    std::vector<idx_t> starts;          // label entry points of a filtered search
+
+    // Quantized storage: the query prepared against the codes
+    ScalarQuantizer::Query coded;
+    RaBitQuantizer::Query rabitq;       // rabitq storage instead of coded
+    std::vector<float> target;          // rabitq L2: query minus the code center
+    float center_dot = 0.0f;            // rabitq inner products: <center, query>
+    float query_norm_sq = 0.0f;         // cosine only
+    size_t reranked = 0;                // rows the last search scored exactly
+
+    // Disk-resident search
+    std::vector<float> query;           // normalized copy for cosine
+    std::vector<float> table;           // PQ distance table
+    std::vector<idx_t> batch;           // nodes expanded in this hop
+    std::vector<idx_t> misses;          // the ones not in the cache
+    std::vector<char> io_buffer;        // records read for misses
+};
+
+/**
+ * @brief Hands out SearchScratch objects to concurrent searches.
+ *
+ * A lease returns its scratch on destruction; the pool grows to the peak
+ * number of simultaneous searches and then stops allocating.
+ */
+class ScratchPool {
+public:
+    class Lease {
+    public:
+        Lease(ScratchPool& pool, std::unique_ptr<SearchScratch> scratch)
+            : pool_(pool), scratch_(std::move(scratch)) {}
+        Lease(const Lease&) = delete;
+        Lease& operator=(const Lease&) = delete;
+        ~Lease() { pool_.release(std::move(scratch_)); }
+
+        SearchScratch& operator*() const { return *scratch_; }
+        SearchScratch* operator->() const { return scratch_.get(); }
+
+    private:
+        ScratchPool& pool_;
+        std::unique_ptr<SearchScratch> scratch_;
+    };
+
+    Lease acquire() {
+        std::unique_ptr<SearchScratch> scratch;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            if (!free_.empty()) {
+                scratch = std::move(free_.back());
+                free_.pop_back();
+            }
+        }
+        if (!scratch) {
+            scratch = std::make_unique<SearchScratch>();
+        }
+        return Lease(*this, std::move(scratch));
+    }
+
+private:
+    void release(std::unique_ptr<SearchScratch> scratch) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        free_.push_back(std::move(scratch));
+    }
+
+    std::mutex mutex_;
+    std::vector<std::unique_ptr<SearchScratch>> free_;
+};
+
+} // namespace vamana
+} // namespace anns
+} // namespace sage_db
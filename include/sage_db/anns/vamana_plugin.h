@@ -2,6 +2,9 @@
 
 #include "sage_db/anns/anns_interface.h"
 
+#include <istream>
+#include <ostream>
+
 namespace sage_db {
 namespace anns {
 
@@ -11,6 +14,40 @@ namespace anns {
  * Ported from the legacy sage-db implementation and refactored to remove
  * LibTorch dependencies. Provides greedy graph search with robust pruning
  * and supports incremental insert/delete operations.
+ *
+ * Vertices are dense slots: adjacency is a fixed-degree (Mmax) padded
+ * array and rows are reached through a per-slot pointer table, so a hop
+ * costs no hashing. Deletes only tombstone a slot; once tombstones reach 5%
+ * of the slots a background thread unlinks them (FreshDiskANN
+ * consolidation) in bounded chunks and recycles the slots, so removals
+ * never stall the caller behind a whole-graph repair.
+ *
+ * Inserts, deletes and queries may run on different threads at once.
+ * Queries read each adjacency record through its seqlock and the node
+ * table grows in fixed chunks that never move, so a query does not wait
+ * for inserts; writers are serialized among themselves.
+ *
+ * With the "disk_path" build param the graph is built in memory and then
+ * moved to a sector-aligned file (vamana/disk_graph.h). Memory keeps only
+ * PQ codes to steer the search and the records cached around the entry
+ * point; each hop fetches up to "beam_width" records and ranks results on
+ * full-precision rows. Such an index accepts deletes but not inserts.
+ *
+ * The "reorder" build param renumbers the slots in BFS order once the
+ * graph is built (graph_reorder.h), so the neighbours a search scores sit
+ * on adjacent pages; rows are then copied into the index in that order.
+ * The saved file and the disk-resident graph keep the new order.
+ *
+ * save() writes an mmap-able file (vamana/mapped_index.h) and load()
+ * maps it: searches run straight from the mapping, so loading costs about
+ * as much as opening the file, not as much as reading it.
+ *
+ * Rows passed with filter labels build a Filtered-DiskANN graph: each
+ * label gets an entry point (the medoid of its members), inserts also
+ * search within their own labels, and pruning keeps an edge unless the
+ * shadowing neighbour carries the labels it serves. Queries with
+ * QueryConfig::filter_labels start at those entry points and only walk
+ * matching nodes.
  */
 class VamanaANNS : public ANNSAlgorithm {
 public:
@@ -25,13 +62,16 @@ public:
     // Capabilities
     std::vector<DistanceMetric> supported_distances() const override;
     bool supports_distance(DistanceMetric metric) const override;
-    bool supports_updates() const override { return true; }
+    bool supports_updates() const override;
+    bool supports_concurrent_updates() const override;
     bool supports_deletions() const override { return true; }
     bool supports_range_search() const override { return false; }
+    bool supports_filtered_search() const override { return true; }
 
     // Lifecycle
     void fit(const std::vector<VectorEntry>& dataset,
              const AlgorithmParams& params = {}) override;
+    void fit(const DatasetView& dataset, const AlgorithmParams& params = {}) override;
     bool save(const std::string& path) const override;
     bool load(const std::string& path) override;
     bool is_built() const override { return built_; }
@@ -42,13 +82,29 @@ public:
     std::vector<ANNSResult> batch_query(
         const std::vector<Vector>& query_vectors,
         const QueryConfig& config = {}) const override;
+    void batch_query(const QueryMatrix& queries,
+                     const QueryConfig& config,
+                     const QueryOutput& output) const override;
 
     // Mutations
     void add_vector(const VectorEntry& entry) override;
     void add_vectors(const std::vector<VectorEntry>& entries) override;
+    void add_vectors(const DatasetView& entries) override;
     void remove_vector(VectorId id) override;
     void remove_vectors(const std::vector<VectorId>& ids) override;
 
+    // Unlinks and frees the current tombstones on the calling thread,
+    // after any background round in flight
+    void consolidate_deletes();
+
+    // Applies the "reorder" renumbering now, e.g. after many inserts have
+    // scattered the new slots; a disk-resident index is left as built
+    void reorder_graph();
+
+    // Pre-fault the whole file on later loads of a mapped index
+    // (MAP_POPULATE) instead of paging it in as searches touch it
+    void set_populate_on_load(bool populate);
+
     // Stats
     size_t get_index_size() const override;
     size_t get_memory_usage() const override;
@@ -61,12 +117,21 @@ public:
     QueryConfig get_default_query_config() const override;
 
 private:
+    bool save_mapped(const std::string& path) const;
+    bool save_disk(std::ostream& out) const;
+    bool load_mapped(const std::string& path);
+    bool load_streamed(std::istream& in, uint32_t version_tag);
+    bool load_disk(std::istream& in);
+    bool load_slots(std::istream& in);
+    bool load_legacy(std::istream& in);
+
     class Impl;
     std::unique_ptr<Impl> impl_;
 
     bool built_;
     AlgorithmParams build_params_;
-    mutable ANNSMetrics metrics_;
+    ANNSMetrics metrics_;
+    mutable QueryCounters query_counters_;
 };
 
 class VamanaANNSFactory : public ANNSFactory {
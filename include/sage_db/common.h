@@ -21,6 +21,9 @@ using Vector = std::vector<float>;
 using MetadataValue = std::string;
 using Metadata = std::map<std::string, MetadataValue>;
 
+// Interned (metadata key, value) pair used by label-aware indexes
+using FilterLabel = uint32_t;
+
 // Query result
 struct QueryResult {
     VectorId id;
@@ -40,6 +43,7 @@ struct SearchParams {
     uint32_t nprobe = 1;          // Number of clusters to search (for IVF)
     float radius = -1.0f;         // Radius search (if > 0)
     bool include_metadata = true;  // Whether to include metadata in results
+    std::vector<FilterLabel> filter_labels;  // Only points carrying one of these (if set)
     
     SearchParams() = default;
     SearchParams(uint32_t k_) : k(k_) {}
@@ -50,7 +54,7 @@ enum class IndexType {
     FLAT,           // Brute force (exact search)
     IVF_FLAT,       // Inverted file with flat quantizer
     IVF_PQ,         // Inverted file with product quantizer
-    HNSW,           // Hierarchical NSW (if available)
+    HNSW,           // Hierarchical NSW (native hnsw plugin)
     AUTO            // Automatically choose based on data size
 };
 
@@ -67,8 +71,9 @@ struct DatabaseConfig {
     DistanceMetric metric = DistanceMetric::L2;
     Dimension dimension = 0;
 
-    // ANNS algorithm selection (default maps AUTO -> brute_force)
-    std::string anns_algorithm = "brute_force";
+    // ANNS algorithm selection; "auto" picks the plugin for index_type
+    // (HNSW -> hnsw, IVF_FLAT and IVF_PQ -> ivf, everything else -> brute_force)
+    std::string anns_algorithm = "auto";
     std::unordered_map<std::string, std::string> anns_build_params;
     std::unordered_map<std::string, std::string> anns_query_params;
     
@@ -80,6 +85,15 @@ struct DatabaseConfig {
     // HNSW specific parameters
     uint32_t M = 16;              // Number of connections for HNSW
     uint32_t efConstruction = 200; // Size of dynamic candidate list for HNSW
+
+    // Metadata keys whose values become filter labels. Label-aware indexes
+    // (Vamana) build with them so equality filters on these keys are
+    // searched in the graph instead of post-filtered.
+    std::vector<std::string> filter_label_keys;
+
+    // Size of the library-wide query thread pool; 0 keeps the current
+    // setting (hardware concurrency unless configured otherwise)
+    uint32_t num_threads = 0;
     
     DatabaseConfig() = default;
     DatabaseConfig(Dimension dim) : dimension(dim) {}
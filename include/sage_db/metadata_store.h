@@ -34,6 +34,15 @@ public:
     std::vector<VectorId> filter_ids(const std::vector<VectorId>& ids,
                                     const std::function<bool(const Metadata&)>& filter) const;
     
+    // Filter labels: every distinct (key, value) pair under one of `keys`
+    // gets a dense id, assigned on first sight. Returns the sorted labels.
+    std::vector<FilterLabel> intern_labels(const Metadata& metadata,
+                                           const std::vector<std::string>& keys);
+    bool find_label(const std::string& key, const MetadataValue& value,
+                    FilterLabel& label) const;
+    void save_labels(const std::string& filepath) const;
+    void load_labels(const std::string& filepath);
+    
     // Statistics
     size_t size() const;
     std::vector<std::string> get_all_keys() const;
@@ -47,6 +56,7 @@ public:
     
 private:
     std::unordered_map<VectorId, Metadata> metadata_map_;
+    std::map<std::pair<std::string, MetadataValue>, FilterLabel> labels_;
     mutable std::shared_mutex mutex_;
     
     // Helper methods
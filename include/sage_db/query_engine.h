@@ -3,7 +3,9 @@
 #include "common.h"
 #include "vector_store.h"
 #include "metadata_store.h"
+#include <chrono>
 #include <functional>
+#include <mutex>
 
 namespace sage_db {
 
@@ -22,7 +24,8 @@ public:
         const SearchParams& params,
         const std::function<bool(const Metadata&)>& filter) const;
     
-    // Search with metadata constraints
+    // Search with metadata constraints; keys listed in
+    // DatabaseConfig::filter_label_keys are filtered by label
     std::vector<QueryResult> search_with_metadata(
         const Vector& query,
         const SearchParams& params,
@@ -32,6 +35,10 @@ public:
     // Batch search operations
     std::vector<std::vector<QueryResult>> batch_search(
         const std::vector<Vector>& queries, const SearchParams& params) const;
+    // Row-major query block read in place: row i starts at queries + i * stride
+    std::vector<std::vector<QueryResult>> batch_search(
+        const float* queries, size_t num_queries, size_t stride,
+        const SearchParams& params) const;
     
     std::vector<std::vector<QueryResult>> batch_filtered_search(
         const std::vector<Vector>& queries,
@@ -69,24 +76,44 @@ public:
         double total_time_ms;
     };
     
-    SearchStats get_last_search_stats() const { return last_stats_; }
+    SearchStats get_last_search_stats() const {
+        std::lock_guard<std::mutex> lock(stats_mutex_);
+        return last_stats_;
+    }
     
 private:
     std::shared_ptr<VectorStore> vector_store_;
     std::shared_ptr<MetadataStore> metadata_store_;
     mutable SearchStats last_stats_;
+    mutable std::mutex stats_mutex_;  // searches run concurrently
     
     // Helper methods
     std::vector<QueryResult> apply_metadata_filter(
         const std::vector<QueryResult>& results,
         const std::function<bool(const Metadata&)>& filter) const;
     
+    // Re-runs a filtered search with a growing over-fetch, starting above
+    // `fetched` whose filtered_results fell short of k; adds every
+    // candidate examined to total_candidates
+    std::vector<QueryResult> widen_filtered_search(
+        const Vector& query,
+        const SearchParams& params,
+        const std::function<bool(const Metadata&)>& filter,
+        uint32_t fetched,
+        std::vector<QueryResult> filtered_results,
+        size_t& total_candidates) const;
+    
     std::vector<QueryResult> merge_and_rerank(
         const std::vector<QueryResult>& vector_results,
         const std::vector<VectorId>& text_results,
         float vector_weight,
         float text_weight) const;
     
+    std::vector<std::vector<QueryResult>> finish_batch(
+        std::vector<std::vector<QueryResult>> results,
+        const SearchParams& params,
+        std::chrono::high_resolution_clock::time_point start_time) const;
+    
     void update_stats(const SearchStats& stats) const;
 };
 
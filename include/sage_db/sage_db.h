@@ -15,6 +15,9 @@ public:
     VectorId add(const Vector& vector, const Metadata& metadata = {});
     std::vector<VectorId> add_batch(const std::vector<Vector>& vectors,
                                    const std::vector<Metadata>& metadata = {});
+    // Row-major block: row i starts at data + i * stride (stride >= dimension)
+    std::vector<VectorId> add_batch(const float* data, size_t num_vectors, size_t stride,
+                                   const std::vector<Metadata>& metadata = {});
     
     bool remove(VectorId id);
     bool update(VectorId id, const Vector& vector, const Metadata& metadata = {});
@@ -34,11 +37,16 @@ public:
     // Batch operations
     std::vector<std::vector<QueryResult>> batch_search(
         const std::vector<Vector>& queries, const SearchParams& params) const;
+    std::vector<std::vector<QueryResult>> batch_search(
+        const float* queries, size_t num_queries, size_t stride,
+        const SearchParams& params) const;
     
     // Index management
     void build_index();
     void train_index(const std::vector<Vector>& training_data = {});
     bool is_trained() const;
+    // Why the last background index build failed; empty if none did
+    std::string last_build_error() const;
     
     // Metadata operations
     bool set_metadata(VectorId id, const Metadata& metadata);
@@ -76,6 +84,9 @@ private:
     void validate_dimension(const Vector& vector) const;
     void ensure_consistent_metadata(const std::vector<Vector>& vectors,
                                    const std::vector<Metadata>& metadata) const;
+    // Filter labels for config_.filter_label_keys; empty when none are set
+    std::vector<FilterLabel> labels_for(const Metadata& metadata) const;
+    std::vector<std::vector<FilterLabel>> labels_for(const std::vector<Metadata>& metadata) const;
 };
 
 // Factory functions
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <vector>
+
+namespace sage_db {
+namespace simd {
+
+// Cache line size assumed for row padding and arena alignment
+constexpr size_t kCacheLineBytes = 64;
+constexpr size_t kFloatsPerCacheLine = kCacheLineBytes / sizeof(float);
+
+/**
+ * @brief Minimal std::allocator replacement returning over-aligned storage.
+ *
+ * Used for vector arenas so that every row (when padded to a multiple of
+ * a cache line) starts on a cache-line boundary and SIMD loads never split.
+ */
+template<typename T, size_t Alignment = kCacheLineBytes>
+class AlignedAllocator {
+public:
+    using value_type = T;
+
+    static_assert(Alignment >= alignof(T), "Alignment must not weaken the natural alignment of T");
+
+    template<typename U>
+    struct rebind {
+        using other = AlignedAllocator<U, Alignment>;
+    };
+
+    AlignedAllocator() noexcept = default;
+
+    template<typename U>
+    AlignedAllocator(const AlignedAllocator<U, Alignment>&) noexcept {}
+
+    T* allocate(size_t n) {
+        if (n > std::numeric_limits<size_t>::max() / sizeof(T)) {
+            throw std::bad_array_new_length();
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T), std::align_val_t(Alignment)));
+    }
+
+    void deallocate(T* ptr, size_t) noexcept {
+        ::operator delete(ptr, std::align_val_t(Alignment));
+    }
+
+    template<typename U>
+    bool operator==(const AlignedAllocator<U, Alignment>&) const noexcept { return true; }
+
+    template<typename U>
+    bool operator!=(const AlignedAllocator<U, Alignment>&) const noexcept { return false; }
+};
+
+using AlignedFloatVector = std::vector<float, AlignedAllocator<float>>;
+
+// Row stride (in floats) that keeps every row of a row-major arena aligned
+inline size_t padded_row_stride(size_t dim) {
+    return (dim + kFloatsPerCacheLine - 1) / kFloatsPerCacheLine * kFloatsPerCacheLine;
+}
+
+} // namespace simd
+} // namespace sage_db
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <cstddef>
+
+namespace sage_db {
+namespace simd {
+
+// Whether this build links a BLAS sgemm that inner_product_block may use
+bool blas_available();
+
+/**
+ * @brief Dense query x database inner-product block.
+ *
+ * Writes out[i * out_stride + j] = <query_i, base_j> for every pair of the
+ * num_queries x num_base tile. Rows are read with their own strides, so
+ * padded arenas can be passed directly.
+ *
+ * Large tiles go through BLAS sgemm when available and allowed. Otherwise
+ * the database block is packed into column panels and multiplied by a
+ * register-blocked micro-kernel for the active instruction set. Each loaded
+ * database value is reused across several queries, which keeps batched scans
+ * compute-bound instead of streaming the dataset once per query.
+ */
+void inner_product_block(const float* queries, size_t num_queries, size_t query_stride,
+                         const float* base, size_t num_base, size_t base_stride,
+                         size_t dim, float* out, size_t out_stride,
+                         bool allow_blas = true);
+
+// Same as inner_product_block for database rows scattered in memory (e.g.
+// borrowed from a chunked arena). Always uses the packed micro-kernels.
+void inner_product_block_rows(const float* queries, size_t num_queries, size_t query_stride,
+                              const float* const* base_rows, size_t num_base,
+                              size_t dim, float* out, size_t out_stride);
+
+/**
+ * @brief out[i] = <matrix row i, x> for a row-major rows x cols matrix.
+ *
+ * The AVX2 / AVX-512 kernels score four rows per pass, so each load of x
+ * feeds four FMAs; used to apply one linear map (e.g. a rotation) to a
+ * single vector, where a matrix block would pack more than it computes.
+ */
+void matrix_vector(const float* matrix, size_t rows, size_t cols, const float* x, float* out);
+
+} // namespace simd
+} // namespace sage_db
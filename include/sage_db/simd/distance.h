@@ -0,0 +1,79 @@
+#pragma once
+
+#include <cmath>
+#include <cstddef>
+#include <string>
+
+namespace sage_db {
+namespace simd {
+
+/**
+ * @brief Instruction sets understood by the distance kernel dispatcher.
+ *
+ * The best variant supported by the running CPU is selected once on first
+ * use (CPUID on x86-64). Every ANNS plugin and the fusion utilities go
+ * through these entry points, so a faster kernel benefits all indexes.
+ */
+enum class InstructionSet {
+    SCALAR,
+    AVX2,
+    AVX512
+};
+
+// Instruction set currently used by the kernels below
+InstructionSet active_instruction_set();
+
+// Whether the running CPU (and this build) can execute the given variant
+bool is_supported(InstructionSet isa);
+
+// Override the dispatched variant (testing/benchmarking). Returns false and
+// leaves the current selection untouched if the variant is unsupported.
+bool set_instruction_set(InstructionSet isa);
+
+std::string instruction_set_name(InstructionSet isa);
+
+// Core kernels over raw float rows of length `dim`
+float l2_squared(const float* a, const float* b, size_t dim);
+float inner_product(const float* a, const float* b, size_t dim);
+float norm_squared(const float* a, size_t dim);
+
+// Single pass computing a·b, |a|² and |b|² (used by cosine distance)
+void dot_and_norms(const float* a, const float* b, size_t dim,
+                   float& dot, float& norm_a_sq, float& norm_b_sq);
+
+inline float l2_distance(const float* a, const float* b, size_t dim) {
+    return std::sqrt(l2_squared(a, b, dim));
+}
+
+// Asks the cache for every line of a row that is about to be scored, so
+// the loads of several rows overlap instead of stalling one after another
+inline void prefetch_bytes(const void* data, size_t bytes) {
+#if defined(__GNUC__) || defined(__clang__)
+    const char* begin = static_cast<const char*>(data);
+    for (size_t i = 0; i < bytes; i += 64) {
+        __builtin_prefetch(begin + i, 0, 3);
+    }
+#else
+    (void)data;
+    (void)bytes;
+#endif
+}
+
+inline void prefetch_row(const float* row, size_t dim) {
+    prefetch_bytes(row, dim * sizeof(float));
+}
+
+// 1 - cos(a, b); zero vectors are treated as maximally distant (1.0)
+inline float cosine_distance(const float* a, const float* b, size_t dim) {
+    float dot = 0.0f;
+    float norm_a = 0.0f;
+    float norm_b = 0.0f;
+    dot_and_norms(a, b, dim, dot, norm_a, norm_b);
+    if (norm_a == 0.0f || norm_b == 0.0f) {
+        return 1.0f;
+    }
+    return 1.0f - dot / (std::sqrt(norm_a) * std::sqrt(norm_b));
+}
+
+} // namespace simd
+} // namespace sage_db
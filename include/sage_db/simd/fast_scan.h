@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sage_db {
+namespace simd {
+
+// Codes are interleaved in blocks of this many vectors
+constexpr size_t kFastScanBlock = 32;
+
+// 4-bit codes of m sub-quantizers are stored in pairs, one byte per pair
+// and vector (sub-quantizer 2p in the low nibble, 2p + 1 in the high one);
+// an odd m gets a zero code in its last high nibble
+inline size_t fast_scan_pairs(size_t m) {
+    return (m + 1) / 2;
+}
+
+// Bytes per block: pair p holds byte i for vector i at p * 32 + i
+inline size_t fast_scan_block_bytes(size_t m) {
+    return fast_scan_pairs(m) * kFastScanBlock;
+}
+
+/**
+ * @brief PQ4 fast-scan: sums 16-entry uint8 lookup tables over packed codes.
+ *
+ * luts holds 2 * fast_scan_pairs(m) tables of 16 bytes, one per
+ * sub-quantizer (zeros for the padding one), and
+ * sums[b * 32 + i] = sum_j luts[j * 16 + code_j] for vector i of block b.
+ * The AVX2 variant keeps each table in a register and looks up 32 codes
+ * per VPSHUFB, widening the bytes into 16-bit lanes, so a block costs two
+ * shuffles per pair instead of 32 table loads per sub-quantizer. Callers
+ * scale the tables so that m * 255 stays within uint16. It runs whenever
+ * the distance dispatcher has picked AVX2 or AVX-512.
+ */
+void fast_scan_accumulate(const uint8_t* blocks, size_t block_count, size_t m,
+                          const uint8_t* luts, uint16_t* sums);
+
+} // namespace simd
+} // namespace sage_db
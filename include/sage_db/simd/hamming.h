@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sage_db {
+namespace simd {
+
+// 64-bit words of a sign code over dim dimensions
+inline size_t binary_code_words(size_t dim) {
+    return (dim + 63) / 64;
+}
+
+// One bit per dimension, set when the value is positive; dimension d is
+// bit d % 64 of word d / 64 and the unused high bits are zero
+void pack_signs(const float* row, size_t dim, uint64_t* code);
+
+/**
+ * @brief Hamming distances between packed bit codes.
+ *
+ * The AVX-512 variant counts bits with VPOPCNTQ on CPUs that have
+ * AVX512_VPOPCNTDQ; the AVX2 one uses a nibble lookup (PSHUFB) summed
+ * with PSADBW. Both follow the float kernels' instruction-set selection,
+ * so set_instruction_set(SCALAR) pins these to POPCNT-free scalar code.
+ */
+uint32_t hamming_distance(const uint64_t* a, const uint64_t* b, size_t words);
+
+// out[i] = hamming_distance(query, codes + i * words, words) for count
+// codes stored back to back
+void hamming_scan(const uint64_t* query, const uint64_t* codes, size_t count, size_t words,
+                  uint32_t* out);
+
+} // namespace simd
+} // namespace sage_db
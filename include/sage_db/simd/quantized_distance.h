@@ -0,0 +1,42 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+namespace sage_db {
+namespace simd {
+
+// IEEE binary16 and bfloat16 conversions, rounding to nearest even
+uint16_t float_to_half(float value);
+float half_to_float(uint16_t value);
+uint16_t float_to_bfloat16(float value);
+float bfloat16_to_float(uint16_t value);
+
+/**
+ * @brief Asymmetric kernels: a float query against a row stored compactly.
+ *
+ * The row is decoded in registers while the query stays in float, so a
+ * scan reads 2x (16-bit floats) to 8x (4-bit codes) fewer bytes than over
+ * float rows. Integer codes decode as min[d] + code[d] * step[d]; callers
+ * fold min into the query (residual = query - min, weight = query * step)
+ * once per query.
+ *
+ * The AVX2 variants (which also need F16C) run whenever the distance
+ * dispatcher has picked AVX2 or AVX-512; otherwise the scalar ones do.
+ */
+float l2_squared_fp16(const float* query, const uint16_t* code, size_t dim);
+float inner_product_fp16(const float* query, const uint16_t* code, size_t dim);
+float l2_squared_bf16(const float* query, const uint16_t* code, size_t dim);
+float inner_product_bf16(const float* query, const uint16_t* code, size_t dim);
+
+// sum_d (residual[d] - code[d] * step[d])^2 over one byte per dimension
+float l2_squared_u8(const float* residual, const float* step, const uint8_t* code, size_t dim);
+// sum_d weight[d] * code[d] over one byte per dimension
+float weighted_sum_u8(const float* weight, const uint8_t* code, size_t dim);
+
+// Same over two 4-bit codes per byte, the lower dimension in the low nibble
+float l2_squared_u4(const float* residual, const float* step, const uint8_t* code, size_t dim);
+float weighted_sum_u4(const float* weight, const uint8_t* code, size_t dim);
+
+} // namespace simd
+} // namespace sage_db
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace sage_db {
+
+/**
+ * @brief Work-stealing thread pool shared by the whole library.
+ *
+ * Every worker owns a deque: it pops its own tasks from the back and steals
+ * from the front of the others when it runs dry. parallel_for() splits a
+ * range into chunks, runs one on the calling thread and keeps executing
+ * queued tasks while waiting, so nested parallel_for calls (e.g. a batch
+ * query fanning out inside a batch search) never deadlock.
+ *
+ * The pool is sized by DatabaseConfig::num_threads through configure_global().
+ * A size of 1 runs everything inline on the caller.
+ */
+class ThreadPool {
+public:
+    // num_threads is the total concurrency including the calling thread;
+    // 0 means std::thread::hardware_concurrency().
+    explicit ThreadPool(size_t num_threads = 0);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // Total concurrency (workers + caller)
+    size_t size() const { return workers_.size() + 1; }
+
+    // Run fn(i) for every i in [begin, end). Iterations are grouped into
+    // chunks of at least `grain`; the first exception thrown is rethrown
+    // after all chunks have finished.
+    void parallel_for(size_t begin, size_t end,
+                      const std::function<void(size_t)>& fn,
+                      size_t grain = 1);
+
+    // Library-wide pool used by the ANNS plugins and the query engine
+    static std::shared_ptr<ThreadPool> global();
+
+    // Resize the library-wide pool. Calls already running keep the pool
+    // they started on; 0 selects the hardware concurrency.
+    static void configure_global(size_t num_threads);
+
+private:
+    using Task = std::function<void()>;
+
+    struct WorkQueue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    void submit(Task task);
+    bool run_one(size_t home);
+    bool pop_local(size_t index, Task& task);
+    bool steal(size_t thief, Task& task);
+    void worker_loop(size_t index);
+    size_t home_queue() const;
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    std::atomic<size_t> pending_{0};
+    std::atomic<size_t> next_queue_{0};
+    bool stop_ = false;
+};
+
+} // namespace sage_db
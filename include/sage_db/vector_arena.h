@@ -0,0 +1,62 @@
+#pragma once
+
+#include "common.h"
+#include "simd/aligned_allocator.h"
+
+#include <cstddef>
+#include <vector>
+
+namespace sage_db {
+
+/**
+ * @brief Append-only, chunked storage for the raw vectors of a collection.
+ *
+ * Rows live in fixed-size, cache-line aligned chunks and never move or
+ * change once appended, so plugins can keep raw row pointers for as long as
+ * they hold a reference to the arena (usually via DatasetView::storage()).
+ * Updates append a new row and release the old slot; released rows stay
+ * readable until the arena itself is dropped, which is what lets an index
+ * built from an older snapshot keep serving while a new one is built.
+ *
+ * The arena itself needs external synchronization; pointers returned by
+ * row() stay valid across later appends and releases.
+ */
+class VectorArena {
+public:
+    static constexpr size_t kRowsPerChunk = 1024;
+
+    explicit VectorArena(Dimension dimension);
+
+    VectorArena(const VectorArena&) = delete;
+    VectorArena& operator=(const VectorArena&) = delete;
+
+    // Copies dimension() floats and returns the new slot
+    size_t append(VectorId id, const float* values);
+
+    // Marks a slot dead; its row stays valid for existing borrowers
+    void release(size_t slot);
+
+    const float* row(size_t slot) const {
+        return chunks_[slot / kRowsPerChunk].data() + (slot % kRowsPerChunk) * stride_;
+    }
+    VectorId id(size_t slot) const { return ids_[slot]; }
+    bool is_live(size_t slot) const { return live_[slot] != 0; }
+
+    size_t slot_count() const { return ids_.size(); }
+    size_t live_count() const { return live_count_; }
+    size_t dead_count() const { return ids_.size() - live_count_; }
+
+    Dimension dimension() const { return dimension_; }
+    size_t stride() const { return stride_; }
+    size_t memory_usage() const;
+
+private:
+    Dimension dimension_;
+    size_t stride_;
+    std::vector<simd::AlignedFloatVector> chunks_;
+    std::vector<VectorId> ids_;
+    std::vector<uint8_t> live_;
+    size_t live_count_ = 0;
+};
+
+} // namespace sage_db
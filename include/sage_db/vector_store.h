@@ -2,6 +2,7 @@
 
 #include "common.h"
 #include "anns/anns_interface.h"
+#include <mutex>
 #include <shared_mutex>
 
 namespace sage_db {
@@ -12,22 +13,38 @@ public:
     ~VectorStore();
 
     // Basic operations
-    VectorId add_vector(const Vector& vector);
+    VectorId add_vector(const Vector& vector, std::vector<FilterLabel> labels = {});
     bool remove_vector(VectorId id);
     bool update_vector(VectorId id, const Vector& vector);
+    // Replaces the filter labels of a stored vector
+    bool set_labels(VectorId id, std::vector<FilterLabel> labels);
     
-    // Batch operations
-    std::vector<VectorId> add_vectors(const std::vector<Vector>& vectors);
+    // Batch operations; labels is empty or holds one set per vector
+    std::vector<VectorId> add_vectors(const std::vector<Vector>& vectors,
+                                      const std::vector<std::vector<FilterLabel>>& labels = {});
+    // Row-major block: row i starts at data + i * stride (stride >= dimension)
+    std::vector<VectorId> add_vectors(const float* data, size_t num_vectors, size_t stride,
+                                      const std::vector<std::vector<FilterLabel>>& labels = {});
     
-    // Search operations
+    // Search operations. SearchParams::filter_labels is searched in the
+    // index when it supports_filtered_search(), otherwise by an exact scan.
     std::vector<QueryResult> search(const Vector& query, const SearchParams& params) const;
     std::vector<std::vector<QueryResult>> batch_search(
         const std::vector<Vector>& queries, const SearchParams& params) const;
+    std::vector<std::vector<QueryResult>> batch_search(
+        const float* queries, size_t num_queries, size_t stride,
+        const SearchParams& params) const;
     
     // Index management
     void build_index();
     void train_index(const std::vector<Vector>& training_data);
     bool is_trained() const;
+    // Why the last background build failed; empty once a build succeeds.
+    // After a failure the store keeps serving its current index (or an
+    // exact scan) and fits again only on new training data, build_index(),
+    // a load, or after a rebuild's worth of adds, removes and updates
+    std::string last_build_error() const;
+    bool supports_filtered_search() const;
     
     // Statistics
     size_t size() const;
@@ -43,12 +60,16 @@ public:
     
 private:
     class Impl;
+    // Declared before impl_ so they outlive the background index builder
+    mutable std::shared_mutex mutex_;  // Allow concurrent reads!
+    std::mutex writer_mutex_;          // Serializes writers; taken before mutex_
     std::unique_ptr<Impl> impl_;
     DatabaseConfig config_;
-    mutable std::shared_mutex mutex_;  // Allow concurrent reads!
     
     // Helper methods
     void validate_vector(const Vector& vector) const;
+    void validate_matrix(size_t stride) const;
+    void validate_labels(size_t count, const std::vector<std::vector<FilterLabel>>& labels) const;
     void ensure_trained() const;
 };
 
@@ -7,6 +7,59 @@
 namespace py = pybind11;
 using namespace sage_db;
 
+namespace {
+
+// Row-major float32 view over a NumPy array. Arrays whose rows are already
+// float32 and contiguous (including row slices) are read in place; anything
+// else is converted once into the array kept in `holder`.
+struct RowMatrix {
+    py::array_t<float> holder;
+    const float* data = nullptr;
+    size_t rows = 0;
+    size_t dimension = 0;
+    size_t stride = 0;
+};
+
+RowMatrix as_row_matrix(const py::array& input, Dimension dimension) {
+    if (input.ndim() != 1 && input.ndim() != 2) {
+        throw std::runtime_error("Input array must be 1- or 2-dimensional");
+    }
+    const size_t cols = static_cast<size_t>(input.shape(input.ndim() - 1));
+    if (cols != dimension) {
+        throw std::runtime_error("Vector dimension mismatch");
+    }
+
+    RowMatrix matrix;
+    matrix.rows = input.ndim() == 2 ? static_cast<size_t>(input.shape(0)) : 1;
+    matrix.dimension = cols;
+
+    const bool in_place =
+        py::isinstance<py::array_t<float>>(input) &&
+        (input.flags() & py::detail::npy_api::NPY_ARRAY_ALIGNED_) &&
+        (cols <= 1 ||
+         input.strides(input.ndim() - 1) == static_cast<py::ssize_t>(sizeof(float))) &&
+        (input.ndim() == 1 || matrix.rows <= 1 ||
+         (input.strides(0) >= static_cast<py::ssize_t>(cols * sizeof(float)) &&
+          input.strides(0) % static_cast<py::ssize_t>(sizeof(float)) == 0));
+    if (in_place) {
+        matrix.holder = py::reinterpret_borrow<py::array_t<float>>(input);
+        matrix.stride = input.ndim() == 2 && matrix.rows > 1
+                            ? static_cast<size_t>(input.strides(0)) / sizeof(float)
+                            : cols;
+    } else {
+        matrix.holder =
+            py::array_t<float, py::array::c_style | py::array::forcecast>::ensure(input);
+        if (!matrix.holder) {
+            throw std::runtime_error("Input array must be convertible to float32");
+        }
+        matrix.stride = cols;
+    }
+    matrix.data = matrix.holder.data();
+    return matrix;
+}
+
+} // namespace
+
 PYBIND11_MODULE(_sage_db, m) {
     m.doc() = "SAGE Database - High-performance vector database with FAISS backend";
 
@@ -58,7 +111,8 @@ PYBIND11_MODULE(_sage_db, m) {
         .def_readwrite("m", &DatabaseConfig::m)
         .def_readwrite("nbits", &DatabaseConfig::nbits)
         .def_readwrite("M", &DatabaseConfig::M)
-        .def_readwrite("efConstruction", &DatabaseConfig::efConstruction);
+        .def_readwrite("efConstruction", &DatabaseConfig::efConstruction)
+        .def_readwrite("num_threads", &DatabaseConfig::num_threads);
 
     // VectorStore
     py::class_<VectorStore>(m, "VectorStore")
@@ -69,6 +123,7 @@ PYBIND11_MODULE(_sage_db, m) {
         .def("build_index", &VectorStore::build_index)
         .def("train_index", &VectorStore::train_index)
         .def("is_trained", &VectorStore::is_trained)
+        .def("last_build_error", &VectorStore::last_build_error)
         .def("size", &VectorStore::size)
         .def("dimension", &VectorStore::dimension)
         .def("index_type", &VectorStore::index_type)
@@ -247,6 +302,7 @@ PYBIND11_MODULE(_sage_db, m) {
            "Train the index (for algorithms that require training). GIL released.")
 
         .def("is_trained", &SageDB::is_trained)
+        .def("last_build_error", &SageDB::last_build_error)
         .def("set_metadata", &SageDB::set_metadata)
         .def("get_metadata", [](const SageDB& db, VectorId id) {
             Metadata metadata;
@@ -283,73 +339,52 @@ PYBIND11_MODULE(_sage_db, m) {
     m.def("string_to_distance_metric", &string_to_distance_metric);
 
     // NumPy array support with GIL release
-    m.def("add_numpy", [](SageDB& db, py::array_t<float> vectors, py::list metadata_list = py::list()) {
-        py::buffer_info buf = vectors.request();
-
-        if (buf.ndim != 2) {
-            throw std::runtime_error("Input array must be 2-dimensional");
-        }
-
-        size_t num_vectors = buf.shape[0];
-        size_t dimension = buf.shape[1];
-
-        if (dimension != db.dimension()) {
-            throw std::runtime_error("Vector dimension mismatch");
-        }
-
-        // Prepare data while holding GIL
-        std::vector<Vector> vec_list;
-        vec_list.reserve(num_vectors);
-
-        float* ptr = static_cast<float*>(buf.ptr);
-        for (size_t i = 0; i < num_vectors; ++i) {
-            Vector vec(dimension);
-            for (size_t j = 0; j < dimension; ++j) {
-                vec[j] = ptr[i * dimension + j];
-            }
-            vec_list.push_back(vec);
-        }
+    m.def("add_numpy", [](SageDB& db, py::array vectors, py::list metadata_list = py::list()) {
+        auto matrix = as_row_matrix(vectors, db.dimension());
 
         std::vector<Metadata> meta_list;
         if (py::len(metadata_list) > 0) {
-            if (py::len(metadata_list) != num_vectors) {
+            if (py::len(metadata_list) != matrix.rows) {
                 throw std::runtime_error("Metadata list size must match number of vectors");
             }
-            meta_list.reserve(num_vectors);
+            meta_list.reserve(matrix.rows);
             for (auto item : metadata_list) {
                 meta_list.push_back(item.cast<Metadata>());
             }
         }
 
-        // Release GIL for batch insertion
-        py::gil_scoped_release release;
-        auto ids = db.add_batch(vec_list, meta_list);
-        py::gil_scoped_acquire acquire;
-
+        // Rows are copied straight from the array buffer into the store
+        std::vector<VectorId> ids;
+        {
+            py::gil_scoped_release release;
+            ids = db.add_batch(matrix.data, matrix.rows, matrix.stride, meta_list);
+        }
         return ids;
     }, py::arg("db"), py::arg("vectors"), py::arg("metadata") = py::list(),
        "Add vectors from NumPy array. GIL released during insertion for parallelism.");
 
-    m.def("search_numpy", [](const SageDB& db, py::array_t<float> query, const SearchParams& params) {
-        py::buffer_info buf = query.request();
-
-        if (buf.ndim != 1 || buf.shape[0] != db.dimension()) {
-            throw std::runtime_error("Query vector dimension mismatch");
+    m.def("search_numpy", [](const SageDB& db, py::array query, const SearchParams& params)
+            -> py::object {
+        if (query.ndim() == 1) {
+            auto matrix = as_row_matrix(query, db.dimension());
+            Vector query_vec(matrix.data, matrix.data + matrix.dimension);
+            std::vector<QueryResult> results;
+            {
+                py::gil_scoped_release release;
+                results = db.search(query_vec, params);
+            }
+            return py::cast(results);
         }
 
-        // Prepare query vector while holding GIL
-        Vector query_vec(buf.shape[0]);
-        float* ptr = static_cast<float*>(buf.ptr);
-        for (size_t i = 0; i < buf.shape[0]; ++i) {
-            query_vec[i] = ptr[i];
+        // 2-D input: one batch over the array's own rows, no per-query copies
+        auto matrix = as_row_matrix(query, db.dimension());
+        std::vector<std::vector<QueryResult>> results;
+        {
+            py::gil_scoped_release release;
+            results = db.batch_search(matrix.data, matrix.rows, matrix.stride, params);
         }
-
-        // Release GIL for search
-        py::gil_scoped_release release;
-        auto results = db.search(query_vec, params);
-        py::gil_scoped_acquire acquire;
-
-        return results;
+        return py::cast(results);
     }, py::arg("db"), py::arg("query"), py::arg("params") = SearchParams(),
-       "Search with NumPy query vector. GIL released for true multi-threaded search.");
+       "Search with a NumPy query vector, or a 2-D array of queries (returns one list per row). "
+       "GIL released for true multi-threaded search.");
 }
@@ -4,6 +4,55 @@
 namespace sage_db {
 namespace anns {
 
+DatasetView DatasetView::from_entries(const std::vector<VectorEntry>& entries) {
+    DatasetView view(entries.empty() ? 0 : static_cast<Dimension>(entries.front().second.size()));
+    view.reserve(entries.size());
+    for (const auto& entry : entries) {
+        view.append(entry.first, entry.second.data());
+    }
+    return view;
+}
+
+std::vector<VectorEntry> DatasetView::to_entries() const {
+    std::vector<VectorEntry> entries;
+    entries.reserve(size());
+    for (size_t i = 0; i < size(); ++i) {
+        entries.emplace_back(ids_[i], Vector(rows_[i], rows_[i] + dimension_));
+    }
+    return entries;
+}
+
+void QueryOutput::finish(size_t query, size_t k, size_t filled) const {
+    std::fill(ids + query * k + filled, ids + (query + 1) * k, kInvalidVectorId);
+    if (counts) {
+        counts[query] = filled;
+    }
+}
+
+void QueryOutput::store(size_t query, size_t k, const ANNSResult& result) const {
+    const size_t filled = std::min(k, result.ids.size());
+    std::copy_n(result.ids.begin(), filled, ids + query * k);
+    if (distances) {
+        std::copy_n(result.distances.begin(), std::min(filled, result.distances.size()),
+                    distances + query * k);
+    }
+    finish(query, k, filled);
+}
+
+void ANNSAlgorithm::batch_query(const QueryMatrix& queries,
+                                const QueryConfig& config,
+                                const QueryOutput& output) const {
+    std::vector<Vector> query_vectors;
+    query_vectors.reserve(queries.rows);
+    for (size_t i = 0; i < queries.rows; ++i) {
+        query_vectors.emplace_back(queries.row(i), queries.row(i) + queries.dimension);
+    }
+    auto results = batch_query(query_vectors, config);
+    for (size_t i = 0; i < results.size(); ++i) {
+        output.store(i, config.k, results[i]);
+    }
+}
+
 // ANNSRegistry implementation
 ANNSRegistry& ANNSRegistry::instance() {
     static ANNSRegistry instance;
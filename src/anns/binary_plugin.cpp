@@ -0,0 +1,496 @@
+#include "sage_db/anns/binary_plugin.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/simd/hamming.h"
+#include "sage_db/thread_pool.h"
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+REGISTER_ANNS_ALGORITHM(BinaryANNSFactory);
+
+// owned_slots_ marker for rows borrowed from a DatasetView
+constexpr size_t kBorrowed = SIZE_MAX;
+constexpr float kDefaultOversample = 4.0f;
+}
+
+BinaryANNS::BinaryANNS()
+    : metric_(DistanceMetric::L2),
+      dimension_(0),
+      words_(0),
+      oversample_(kDefaultOversample),
+      built_(false) {
+    metrics_.reset();
+    query_counters_.reset();
+}
+
+std::string BinaryANNS::version() const {
+    return "1.0.0";
+}
+
+std::string BinaryANNS::description() const {
+    return "Sign-bit codes scanned by Hamming distance, re-ranked on float rows";
+}
+
+std::vector<DistanceMetric> BinaryANNS::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+bool BinaryANNS::supports_distance(DistanceMetric metric) const {
+    auto metrics = supported_distances();
+    return std::find(metrics.begin(), metrics.end(), metric) != metrics.end();
+}
+
+void BinaryANNS::configure(const AlgorithmParams& params) {
+    metric_ = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2))
+    );
+    oversample_ = params.get<float>("oversample", kDefaultOversample);
+}
+
+void BinaryANNS::fit(const std::vector<VectorEntry>& dataset,
+                     const AlgorithmParams& params) {
+    metrics_.reset();
+    query_counters_.reset();
+    configure(params);
+
+    const Dimension dimension =
+        dataset.empty() ? 0 : static_cast<Dimension>(dataset.front().second.size());
+    reset_rows(dimension, dataset.size());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    for (const auto& entry : dataset) {
+        if (entry.second.size() != dimension_) {
+            throw std::runtime_error("Vector dimension mismatch in BinaryANNS");
+        }
+        append_owned(entry.first, entry.second.data());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    metrics_.build_time_seconds = std::chrono::duration<double>(end - start).count();
+    metrics_.index_size_bytes = get_memory_usage();
+    built_ = true;
+}
+
+void BinaryANNS::fit(const DatasetView& dataset, const AlgorithmParams& params) {
+    metrics_.reset();
+    query_counters_.reset();
+    configure(params);
+    reset_rows(dataset.dimension(), dataset.size());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    append_borrowed(dataset);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    metrics_.build_time_seconds = std::chrono::duration<double>(end - start).count();
+    metrics_.index_size_bytes = get_memory_usage();
+    built_ = true;
+}
+
+// Rows are saved in float, as re-ranking needs them; codes are rebuilt
+// from them on load
+bool BinaryANNS::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&dimension_), sizeof(dimension_));
+    int metric = static_cast<int>(metric_);
+    out.write(reinterpret_cast<const char*>(&metric), sizeof(metric));
+    out.write(reinterpret_cast<const char*>(&oversample_), sizeof(oversample_));
+
+    uint64_t count = ids_.size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        out.write(reinterpret_cast<const char*>(&ids_[i]), sizeof(VectorId));
+        out.write(reinterpret_cast<const char*>(rows_[i]), dimension_ * sizeof(float));
+    }
+    return static_cast<bool>(out);
+}
+
+bool BinaryANNS::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    Dimension dimension = 0;
+    in.read(reinterpret_cast<char*>(&dimension), sizeof(dimension));
+    int metric = 0;
+    in.read(reinterpret_cast<char*>(&metric), sizeof(metric));
+    float oversample = 0.0f;
+    in.read(reinterpret_cast<char*>(&oversample), sizeof(oversample));
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in) {
+        return false;
+    }
+    metric_ = static_cast<DistanceMetric>(metric);
+    oversample_ = oversample;
+    reset_rows(dimension, count);
+
+    Vector buffer(dimension_);
+    for (uint64_t i = 0; i < count; ++i) {
+        VectorId id = 0;
+        in.read(reinterpret_cast<char*>(&id), sizeof(id));
+        in.read(reinterpret_cast<char*>(buffer.data()), dimension_ * sizeof(float));
+        if (!in) {
+            return false;
+        }
+        append_owned(id, buffer.data());
+    }
+
+    built_ = true;
+    metrics_.reset();
+    query_counters_.reset();
+    return true;
+}
+
+ANNSMetrics BinaryANNS::get_metrics() const {
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    return metrics;
+}
+
+ANNSResult BinaryANNS::query(const Vector& query_vector, const QueryConfig& config) const {
+    if (!built_) {
+        throw std::runtime_error("BinaryANNS index is not built");
+    }
+    if (!ids_.empty() && query_vector.size() != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in BinaryANNS");
+    }
+
+    thread_local std::vector<std::pair<float, VectorId>> hits;
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t reranked = search(query_vector.data(), config.k, oversample_for(config), hits);
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), reranked);
+
+    ANNSResult result;
+    result.ids.reserve(hits.size());
+    if (config.return_distances) {
+        result.distances.reserve(hits.size());
+    }
+    for (const auto& [distance, id] : hits) {
+        result.ids.push_back(id);
+        if (config.return_distances) {
+            result.distances.push_back(distance);
+        }
+    }
+    result.actual_k = hits.size();
+    return result;
+}
+
+std::vector<ANNSResult> BinaryANNS::batch_query(const std::vector<Vector>& query_vectors,
+                                                const QueryConfig& config) const {
+    std::vector<ANNSResult> results(query_vectors.size());
+    ThreadPool::global()->parallel_for(0, query_vectors.size(), [&](size_t i) {
+        results[i] = query(query_vectors[i], config);
+    });
+    return results;
+}
+
+void BinaryANNS::batch_query(const QueryMatrix& queries,
+                             const QueryConfig& config,
+                             const QueryOutput& output) const {
+    if (!built_) {
+        throw std::runtime_error("BinaryANNS index is not built");
+    }
+    if (!ids_.empty() && queries.dimension != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in BinaryANNS");
+    }
+
+    const size_t k = config.k;
+    const float oversample = oversample_for(config);
+    std::atomic<size_t> reranked{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, queries.rows, [&](size_t i) {
+        thread_local std::vector<std::pair<float, VectorId>> hits;
+        reranked.fetch_add(search(queries.row(i), k, oversample, hits), std::memory_order_relaxed);
+        for (size_t j = 0; j < hits.size(); ++j) {
+            output.ids[i * k + j] = hits[j].second;
+            if (output.distances) {
+                output.distances[i * k + j] = hits[j].first;
+            }
+        }
+        output.finish(i, k, hits.size());
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), reranked.load());
+}
+
+void BinaryANNS::add_vector(const VectorEntry& entry) {
+    check_dimension(static_cast<Dimension>(entry.second.size()));
+    append_owned(entry.first, entry.second.data());
+    built_ = true;
+}
+
+void BinaryANNS::add_vectors(const std::vector<VectorEntry>& entries) {
+    rows_.reserve(rows_.size() + entries.size());
+    ids_.reserve(ids_.size() + entries.size());
+    for (const auto& entry : entries) {
+        add_vector(entry);
+    }
+}
+
+void BinaryANNS::add_vectors(const DatasetView& entries) {
+    if (entries.empty()) {
+        return;
+    }
+    check_dimension(entries.dimension());
+    append_borrowed(entries);
+    built_ = true;
+}
+
+void BinaryANNS::remove_vector(VectorId id) {
+    auto it = id_to_index_.find(id);
+    if (it == id_to_index_.end()) {
+        return;
+    }
+
+    // Swap-with-last keeps the code table dense so scans never see holes
+    const size_t index = it->second;
+    const size_t last_index = ids_.size() - 1;
+    if (owned_slots_[index] != kBorrowed) {
+        owned_->release(owned_slots_[index]);
+    }
+    if (index != last_index) {
+        rows_[index] = rows_[last_index];
+        ids_[index] = ids_[last_index];
+        owned_slots_[index] = owned_slots_[last_index];
+        std::copy_n(code(last_index), words_, codes_.data() + index * words_);
+        id_to_index_[ids_[index]] = index;
+    }
+    codes_.resize(last_index * words_);
+    rows_.pop_back();
+    ids_.pop_back();
+    owned_slots_.pop_back();
+    id_to_index_.erase(it);
+
+    if (owned_ && owned_->dead_count() > VectorArena::kRowsPerChunk &&
+        owned_->dead_count() > owned_->live_count()) {
+        compact_owned();
+    }
+}
+
+void BinaryANNS::remove_vectors(const std::vector<VectorId>& ids) {
+    for (auto id : ids) {
+        remove_vector(id);
+    }
+}
+
+size_t BinaryANNS::get_index_size() const {
+    return ids_.size();
+}
+
+size_t BinaryANNS::get_memory_usage() const {
+    // Borrowed rows belong to whoever shared them and are not counted
+    const size_t node_bytes = sizeof(std::pair<const VectorId, size_t>) + 2 * sizeof(void*);
+    return (owned_ ? owned_->memory_usage() : 0) +
+           codes_.capacity() * sizeof(uint64_t) +
+           rows_.capacity() * sizeof(const float*) +
+           owned_slots_.capacity() * sizeof(size_t) +
+           ids_.capacity() * sizeof(VectorId) +
+           id_to_index_.bucket_count() * sizeof(void*) +
+           id_to_index_.size() * node_bytes;
+}
+
+std::unordered_map<std::string, std::string> BinaryANNS::get_build_params() const {
+    return {{"metric", std::to_string(static_cast<int>(metric_))},
+            {"oversample", std::to_string(oversample_)}};
+}
+
+bool BinaryANNS::validate_params(const AlgorithmParams& params) const {
+    const auto metric = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+    return params.get<float>("oversample", kDefaultOversample) >= 1.0f &&
+           supports_distance(metric);
+}
+
+AlgorithmParams BinaryANNS::get_default_params() const {
+    AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    params.set("oversample", kDefaultOversample);
+    return params;
+}
+
+QueryConfig BinaryANNS::get_default_query_config() const {
+    QueryConfig config;
+    config.k = 10;
+    config.return_distances = true;
+    return config;
+}
+
+float BinaryANNS::compute_distance(const float* a, const float* b) const {
+    switch (metric_) {
+        case DistanceMetric::L2:
+            return simd::l2_distance(a, b, dimension_);
+        case DistanceMetric::INNER_PRODUCT:
+            return simd::inner_product(a, b, dimension_); // higher is better
+        case DistanceMetric::COSINE:
+            return simd::cosine_distance(a, b, dimension_);
+    }
+    return 0.0f;
+}
+
+bool BinaryANNS::better(const std::pair<float, VectorId>& a,
+                        const std::pair<float, VectorId>& b) const {
+    if (a.first != b.first) {
+        return metric_ == DistanceMetric::INNER_PRODUCT ? a.first > b.first : a.first < b.first;
+    }
+    return a.second < b.second;
+}
+
+float BinaryANNS::oversample_for(const QueryConfig& config) const {
+    return std::max(1.0f, config.algorithm_params.get<float>("oversample", oversample_));
+}
+
+size_t BinaryANNS::search(const float* query, size_t k, float oversample,
+                          std::vector<std::pair<float, VectorId>>& hits) const {
+    hits.clear();
+    const size_t count = ids_.size();
+    k = std::min(k, count);
+    if (k == 0) {
+        return 0;
+    }
+
+    thread_local std::vector<uint64_t> query_code;
+    thread_local std::vector<uint32_t> hamming;
+    thread_local std::vector<uint32_t> histogram;
+    query_code.resize(words_);
+    simd::pack_signs(query, dimension_, query_code.data());
+    hamming.resize(count);
+    simd::hamming_scan(query_code.data(), codes_.data(), count, words_, hamming.data());
+
+    // Hamming distances are bounded by the dimension, so a histogram finds
+    // the pool's cutoff without sorting the scan
+    const size_t pool = std::min(
+        count, std::max(k, static_cast<size_t>(std::ceil(static_cast<double>(k) * oversample))));
+    histogram.assign(dimension_ + 1, 0);
+    for (size_t i = 0; i < count; ++i) {
+        ++histogram[hamming[i]];
+    }
+    uint32_t cutoff = 0;
+    size_t below = 0;  // codes closer than cutoff
+    while (below + histogram[cutoff] < pool) {
+        below += histogram[cutoff++];
+    }
+    size_t at_cutoff = pool - below;
+
+    hits.reserve(pool);
+    for (size_t i = 0; i < count; ++i) {
+        if (hamming[i] < cutoff || (hamming[i] == cutoff && at_cutoff > 0 && at_cutoff--)) {
+            hits.emplace_back(compute_distance(query, rows_[i]), ids_[i]);
+        }
+    }
+    auto order = [this](const auto& a, const auto& b) { return better(a, b); };
+    std::partial_sort(hits.begin(), hits.begin() + k, hits.end(), order);
+    hits.resize(k);
+    return pool;
+}
+
+void BinaryANNS::reset_rows(Dimension dimension, size_t expected) {
+    dimension_ = dimension;
+    words_ = simd::binary_code_words(dimension);
+    codes_.clear();
+    rows_.clear();
+    ids_.clear();
+    owned_slots_.clear();
+    id_to_index_.clear();
+    owned_.reset();
+    borrowed_.clear();
+
+    codes_.reserve(expected * words_);
+    rows_.reserve(expected);
+    ids_.reserve(expected);
+    owned_slots_.reserve(expected);
+    id_to_index_.reserve(expected);
+}
+
+void BinaryANNS::check_dimension(Dimension dimension) {
+    if (ids_.empty() && dimension_ == 0) {
+        dimension_ = dimension;
+        words_ = simd::binary_code_words(dimension);
+    }
+    if (dimension != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in BinaryANNS");
+    }
+}
+
+void BinaryANNS::append_row(VectorId id, const float* values, size_t owned_slot) {
+    const size_t index = ids_.size();
+    codes_.resize((index + 1) * words_);
+    simd::pack_signs(values, dimension_, codes_.data() + index * words_);
+    rows_.push_back(values);
+    ids_.push_back(id);
+    owned_slots_.push_back(owned_slot);
+    id_to_index_[id] = index;
+}
+
+void BinaryANNS::append_owned(VectorId id, const float* values) {
+    if (!owned_ || owned_->dimension() != dimension_) {
+        owned_ = std::make_unique<VectorArena>(dimension_);
+    }
+    const size_t slot = owned_->append(id, values);
+    append_row(id, owned_->row(slot), slot);
+}
+
+void BinaryANNS::append_borrowed(const DatasetView& view) {
+    if (!view.storage()) {
+        // Nobody vouches for these rows beyond this call, so copy them
+        for (size_t i = 0; i < view.size(); ++i) {
+            append_owned(view.id(i), view.row(i));
+        }
+        return;
+    }
+    if (std::find(borrowed_.begin(), borrowed_.end(), view.storage()) == borrowed_.end()) {
+        borrowed_.push_back(view.storage());
+    }
+    codes_.reserve(codes_.size() + view.size() * words_);
+    rows_.reserve(rows_.size() + view.size());
+    for (size_t i = 0; i < view.size(); ++i) {
+        append_row(view.id(i), view.row(i), kBorrowed);
+    }
+}
+
+void BinaryANNS::compact_owned() {
+    auto compacted = std::make_unique<VectorArena>(dimension_);
+    for (size_t i = 0; i < rows_.size(); ++i) {
+        if (owned_slots_[i] == kBorrowed) {
+            continue;
+        }
+        owned_slots_[i] = compacted->append(ids_[i], rows_[i]);
+        rows_[i] = compacted->row(owned_slots_[i]);
+    }
+    owned_ = std::move(compacted);
+}
+
+std::unique_ptr<ANNSAlgorithm> BinaryANNSFactory::create() const {
+    return std::make_unique<BinaryANNS>();
+}
+
+std::string BinaryANNSFactory::algorithm_description() const {
+    return "Binary sign codes with popcount Hamming pre-filter and float re-rank";
+}
+
+std::vector<DistanceMetric> BinaryANNSFactory::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+AlgorithmParams BinaryANNSFactory::default_build_params() const {
+    return BinaryANNS().get_default_params();
+}
+
+QueryConfig BinaryANNSFactory::default_query_config() const {
+    return BinaryANNS().get_default_query_config();
+}
+
+} // namespace anns
+} // namespace sage_db
@@ -0,0 +1,198 @@
+#include "sage_db/anns/blocked_scan.h"
+#include "sage_db/simd/batch_distance.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+
+using Candidate = std::pair<float, VectorId>;
+
+constexpr size_t kMinParallelQueryBlock = 8;
+
+// Heap entries carry a key where lower is better; the front is the worst
+// of the current top-k, so most candidates are rejected by one comparison.
+inline void push_candidate(std::vector<Candidate>& heap, size_t k, float key, VectorId id) {
+    if (heap.size() < k) {
+        heap.emplace_back(key, id);
+        std::push_heap(heap.begin(), heap.end());
+    } else if (key < heap.front().first) {
+        std::pop_heap(heap.begin(), heap.end());
+        heap.back() = {key, id};
+        std::push_heap(heap.begin(), heap.end());
+    }
+}
+
+inline float key_to_distance(DistanceMetric metric, float key) {
+    switch (metric) {
+        case DistanceMetric::L2:
+            return std::sqrt(key);
+        case DistanceMetric::INNER_PRODUCT:
+            return -key;
+        case DistanceMetric::COSINE:
+            return key;
+    }
+    return key;
+}
+
+// Runs the blocked scan and hands each query's sorted (key, id) heap to
+// emit(query_index, heap); emit is called concurrently for distinct queries.
+template <typename Emit>
+void blocked_scan(const FlatScanView& view,
+                  const float* queries,
+                  size_t num_queries,
+                  size_t query_stride,
+                  size_t k,
+                  const BlockedScanOptions& options,
+                  Emit&& emit) {
+    k = std::min(k, view.count);
+    if (num_queries == 0) {
+        return;
+    }
+    if (k == 0) {
+        const std::vector<Candidate> none;
+        for (size_t i = 0; i < num_queries; ++i) {
+            emit(i, none);
+        }
+        return;
+    }
+
+    const DistanceMetric metric = view.metric;
+    const size_t dim = view.dimension;
+    const size_t base_block = std::max<size_t>(options.base_block, 1);
+
+    // Shrink query blocks so every thread gets work, but keep enough queries
+    // per block to amortize packing each database tile.
+    auto pool = ThreadPool::global();
+    size_t query_block = std::max<size_t>(options.query_block, 1);
+    const size_t per_thread = (num_queries + pool->size() - 1) / pool->size();
+    query_block = std::min(query_block, std::max(per_thread, kMinParallelQueryBlock));
+    const size_t num_blocks = (num_queries + query_block - 1) / query_block;
+
+    pool->parallel_for(0, num_blocks, [&](size_t block) {
+        const size_t q0 = block * query_block;
+        const size_t nq = std::min(query_block, num_queries - q0);
+        const float* q_rows = queries + q0 * query_stride;
+
+        std::vector<float> tile(nq * base_block);
+        std::vector<float> query_norms(nq);
+        std::vector<float> base_norms(base_block);
+        std::vector<std::vector<Candidate>> heaps(nq);
+
+        for (size_t i = 0; i < nq; ++i) {
+            heaps[i].reserve(k);
+            const float norm_sq = simd::norm_squared(q_rows + i * query_stride, dim);
+            query_norms[i] = metric == DistanceMetric::COSINE ? std::sqrt(norm_sq) : norm_sq;
+        }
+
+        // The whole dataset streams through cache once per query block
+        for (size_t b0 = 0; b0 < view.count; b0 += base_block) {
+            const size_t nb = std::min(base_block, view.count - b0);
+            if (view.rows) {
+                simd::inner_product_block_rows(q_rows, nq, query_stride, view.rows + b0, nb,
+                                               dim, tile.data(), nb);
+            } else {
+                simd::inner_product_block(q_rows, nq, query_stride,
+                                          view.data + b0 * view.stride, nb, view.stride,
+                                          dim, tile.data(), nb, options.use_blas);
+            }
+
+            if (metric == DistanceMetric::COSINE) {
+                for (size_t j = 0; j < nb; ++j) {
+                    base_norms[j] = std::sqrt(view.norms_sq[b0 + j]);
+                }
+            }
+
+            const VectorId* ids = view.ids + b0;
+            for (size_t i = 0; i < nq; ++i) {
+                const float* dots = tile.data() + i * nb;
+                auto& heap = heaps[i];
+                switch (metric) {
+                    case DistanceMetric::L2: {
+                        const float* norms = view.norms_sq + b0;
+                        const float qn = query_norms[i];
+                        for (size_t j = 0; j < nb; ++j) {
+                            const float key = std::max(0.0f, norms[j] + qn - 2.0f * dots[j]);
+                            push_candidate(heap, k, key, ids[j]);
+                        }
+                        break;
+                    }
+                    case DistanceMetric::INNER_PRODUCT:
+                        for (size_t j = 0; j < nb; ++j) {
+                            push_candidate(heap, k, -dots[j], ids[j]);
+                        }
+                        break;
+                    case DistanceMetric::COSINE: {
+                        const float qn = query_norms[i];
+                        for (size_t j = 0; j < nb; ++j) {
+                            const float denom = qn * base_norms[j];
+                            const float key = denom == 0.0f ? 1.0f : 1.0f - dots[j] / denom;
+                            push_candidate(heap, k, key, ids[j]);
+                        }
+                        break;
+                    }
+                }
+            }
+        }
+
+        for (size_t i = 0; i < nq; ++i) {
+            std::sort_heap(heaps[i].begin(), heaps[i].end());
+            emit(q0 + i, heaps[i]);
+        }
+    });
+}
+
+} // namespace
+
+std::vector<ANNSResult> blocked_knn_search(const FlatScanView& view,
+                                           const float* queries,
+                                           size_t num_queries,
+                                           size_t query_stride,
+                                           size_t k,
+                                           bool return_distances,
+                                           const BlockedScanOptions& options) {
+    std::vector<ANNSResult> results(num_queries);
+    blocked_scan(view, queries, num_queries, query_stride, k, options,
+                 [&](size_t query, const std::vector<Candidate>& heap) {
+        ANNSResult& result = results[query];
+        result.ids.reserve(heap.size());
+        if (return_distances) {
+            result.distances.reserve(heap.size());
+        }
+        for (const auto& [key, id] : heap) {
+            result.ids.push_back(id);
+            if (return_distances) {
+                result.distances.push_back(key_to_distance(view.metric, key));
+            }
+        }
+        result.actual_k = heap.size();
+    });
+    return results;
+}
+
+void blocked_knn_search(const FlatScanView& view,
+                        const QueryMatrix& queries,
+                        size_t k,
+                        const QueryOutput& output,
+                        const BlockedScanOptions& options) {
+    blocked_scan(view, queries.data, queries.rows, queries.stride, k, options,
+                 [&](size_t query, const std::vector<Candidate>& heap) {
+        VectorId* ids = output.ids + query * k;
+        float* distances = output.distances ? output.distances + query * k : nullptr;
+        for (size_t j = 0; j < heap.size(); ++j) {
+            ids[j] = heap[j].second;
+            if (distances) {
+                distances[j] = key_to_distance(view.metric, heap[j].first);
+            }
+        }
+        output.finish(query, k, heap.size());
+    });
+}
+
+} // namespace anns
+} // namespace sage_db
@@ -1,8 +1,13 @@
 #include "sage_db/anns/brute_force_plugin.h"
+#include "sage_db/anns/blocked_scan.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/thread_pool.h"
 #include <fstream>
 #include <algorithm>
 #include <cmath>
 #include <chrono>
+#include <cstdint>
+#include <cstring>
 
 namespace sage_db {
 namespace anns {
@@ -12,8 +17,15 @@ REGISTER_ANNS_ALGORITHM(BruteForceANNSFactory);
 }
 
 BruteForceANNS::BruteForceANNS()
-    : metric_(DistanceMetric::L2), dimension_(0), built_(false) {
+    : metric_(DistanceMetric::L2),
+      dimension_(0),
+      stride_(0),
+      precision_(StoragePrecision::FP32),
+      rerank_(0),
+      quantizer_from_train_(false),
+      built_(false) {
     metrics_.reset();
+    query_counters_.reset();
 }
 
 std::string BruteForceANNS::version() const {
@@ -36,35 +48,67 @@ bool BruteForceANNS::supports_distance(DistanceMetric metric) const {
 void BruteForceANNS::fit(const std::vector<VectorEntry>& dataset,
                          const AlgorithmParams& params) {
     metrics_.reset();
+    query_counters_.reset();
     metric_ = static_cast<DistanceMetric>(
         params.get<int>("metric", static_cast<int>(DistanceMetric::L2))
     );
+    configure_storage(params);
 
-    dataset_.clear();
-    id_to_index_.clear();
+    const Dimension dimension =
+        dataset.empty() ? 0 : static_cast<Dimension>(dataset.front().second.size());
+    reset_rows(dimension, dataset.size());
 
-    if (dataset.empty()) {
-        built_ = true;
-        dimension_ = 0;
-        return;
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<const float*> rows;
+    rows.reserve(dataset.size());
+    for (const auto& entry : dataset) {
+        if (entry.second.size() != dimension_) {
+            throw std::runtime_error("Vector dimension mismatch in BruteForceANNS");
+        }
+        rows.push_back(entry.second.data());
+    }
+    train_quantizer(rows.data(), rows.size());
+    for (const auto& entry : dataset) {
+        append_row(entry.first, entry.second.data());
     }
+    auto end = std::chrono::high_resolution_clock::now();
 
-    dimension_ = dataset.front().second.size();
-    dataset_.reserve(dataset.size());
+    metrics_.build_time_seconds = std::chrono::duration<double>(end - start).count();
+    metrics_.index_size_bytes = get_memory_usage();
+    built_ = true;
+}
+
+void BruteForceANNS::fit(const DatasetView& dataset, const AlgorithmParams& params) {
+    metrics_.reset();
+    query_counters_.reset();
+    metric_ = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2))
+    );
+    configure_storage(params);
+    reset_rows(dataset.dimension(), dataset.size());
 
     auto start = std::chrono::high_resolution_clock::now();
+    train_quantizer(dataset.rows(), dataset.size());
     for (size_t i = 0; i < dataset.size(); ++i) {
-        const auto& entry = dataset[i];
-        dataset_.push_back({entry.first, entry.second});
-        id_to_index_[entry.first] = i;
+        append_row(dataset.id(i), dataset.row(i));
     }
     auto end = std::chrono::high_resolution_clock::now();
 
     metrics_.build_time_seconds = std::chrono::duration<double>(end - start).count();
-    metrics_.index_size_bytes = dataset_.size() * dimension_ * sizeof(float);
+    metrics_.index_size_bytes = get_memory_usage();
     built_ = true;
 }
 
+void BruteForceANNS::train(const DatasetView& training, const AlgorithmParams& params) {
+    configure_storage(params);
+    if (!quantized() || training.empty()) {
+        return;
+    }
+    quantizer_ = ScalarQuantizer(training.dimension(), precision_);
+    quantizer_.train(training.rows(), training.size());
+    quantizer_from_train_ = true;
+}
+
 bool BruteForceANNS::save(const std::string& path) const {
     std::ofstream out(path, std::ios::binary);
     if (!out.is_open()) {
@@ -75,16 +119,33 @@ bool BruteForceANNS::save(const std::string& path) const {
     int metric = static_cast<int>(metric_);
     out.write(reinterpret_cast<const char*>(&metric), sizeof(metric));
 
-    uint64_t count = dataset_.size();
+    uint64_t count = ids_.size();
     out.write(reinterpret_cast<const char*>(&count), sizeof(count));
-    for (const auto& entry : dataset_) {
-        out.write(reinterpret_cast<const char*>(&entry.id), sizeof(entry.id));
-        uint32_t dim = static_cast<uint32_t>(entry.vector.size());
+    const uint32_t dim = dimension_;
+    Vector decoded(dimension_);
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        const float* values = row(i);
+        if (!values) {
+            quantizer_.decode(code(i), decoded.data());
+            values = decoded.data();
+        }
+        out.write(reinterpret_cast<const char*>(&ids_[i]), sizeof(VectorId));
         out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
-        out.write(reinterpret_cast<const char*>(entry.vector.data()), dim * sizeof(float));
+        out.write(reinterpret_cast<const char*>(values), dim * sizeof(float));
     }
 
-    return true;
+    // Quantized storage follows the rows, so older readers still load the
+    // file as float rows; the codes are re-encoded from those on load
+    if (quantized()) {
+        const uint32_t precision = static_cast<uint32_t>(precision_);
+        out.write(reinterpret_cast<const char*>(&precision), sizeof(precision));
+        out.write(reinterpret_cast<const char*>(&rerank_), sizeof(rerank_));
+        out.write(reinterpret_cast<const char*>(quantizer_.mins().data()),
+                  quantizer_.mins().size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(quantizer_.steps().data()),
+                  quantizer_.steps().size() * sizeof(float));
+    }
+    return static_cast<bool>(out);
 }
 
 bool BruteForceANNS::load(const std::string& path) {
@@ -93,7 +154,8 @@ bool BruteForceANNS::load(const std::string& path) {
         return false;
     }
 
-    in.read(reinterpret_cast<char*>(&dimension_), sizeof(dimension_));
+    Dimension dimension = 0;
+    in.read(reinterpret_cast<char*>(&dimension), sizeof(dimension));
     int metric;
     in.read(reinterpret_cast<char*>(&metric), sizeof(metric));
     metric_ = static_cast<DistanceMetric>(metric);
@@ -101,26 +163,61 @@ bool BruteForceANNS::load(const std::string& path) {
     uint64_t count = 0;
     in.read(reinterpret_cast<char*>(&count), sizeof(count));
 
-    dataset_.clear();
-    id_to_index_.clear();
-    dataset_.reserve(count);
+    precision_ = StoragePrecision::FP32;
+    rerank_ = 0;
+    quantizer_ = ScalarQuantizer();
+    quantizer_from_train_ = false;
+    reset_rows(dimension, count);
 
+    Vector buffer(dimension_);
     for (uint64_t i = 0; i < count; ++i) {
-        Entry entry{};
-        in.read(reinterpret_cast<char*>(&entry.id), sizeof(entry.id));
+        VectorId id = 0;
+        in.read(reinterpret_cast<char*>(&id), sizeof(id));
         uint32_t dim = 0;
         in.read(reinterpret_cast<char*>(&dim), sizeof(dim));
-        entry.vector.resize(dim);
-        in.read(reinterpret_cast<char*>(entry.vector.data()), dim * sizeof(float));
-        dataset_.push_back(entry);
-        id_to_index_[entry.id] = dataset_.size() - 1;
+        if (!in || dim != dimension_) {
+            return false;
+        }
+        in.read(reinterpret_cast<char*>(buffer.data()), dim * sizeof(float));
+        append_row(id, buffer.data());
+    }
+    if (!in) {
+        return false;
+    }
+
+    uint32_t precision = 0;
+    if (in.read(reinterpret_cast<char*>(&precision), sizeof(precision))) {
+        in.read(reinterpret_cast<char*>(&rerank_), sizeof(rerank_));
+        if (precision == 0 || precision > static_cast<uint32_t>(StoragePrecision::INT4)) {
+            return false;
+        }
+        precision_ = static_cast<StoragePrecision>(precision);
+        quantizer_ = ScalarQuantizer(dimension_, precision_);
+        if (!quantizer_.mins().empty()) {
+            std::vector<float> mins(dimension_);
+            std::vector<float> steps(dimension_);
+            in.read(reinterpret_cast<char*>(mins.data()), dimension_ * sizeof(float));
+            in.read(reinterpret_cast<char*>(steps.data()), dimension_ * sizeof(float));
+            quantizer_.set_range(std::move(mins), std::move(steps));
+        }
+        if (!in) {
+            return false;
+        }
+        requantize();
     }
 
     built_ = true;
     metrics_.reset();
+    query_counters_.reset();
     return true;
 }
 
+ANNSMetrics BruteForceANNS::get_metrics() const {
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    return metrics;
+}
+
 ANNSResult BruteForceANNS::query(const Vector& query_vector,
                                  const QueryConfig& config) const {
     return perform_query(query_vector, config);
@@ -129,16 +226,117 @@ ANNSResult BruteForceANNS::query(const Vector& query_vector,
 std::vector<ANNSResult> BruteForceANNS::batch_query(
     const std::vector<Vector>& query_vectors,
     const QueryConfig& config) const {
-    std::vector<ANNSResult> results;
-    results.reserve(query_vectors.size());
+    if (query_vectors.size() <= 1 || ids_.empty()) {
+        std::vector<ANNSResult> results;
+        results.reserve(query_vectors.size());
+        for (const auto& query : query_vectors) {
+            results.push_back(perform_query(query, config));
+        }
+        return results;
+    }
+
+    if (!built_) {
+        throw std::runtime_error("BruteForceANNS index is not built");
+    }
 
-    for (const auto& query : query_vectors) {
-        results.push_back(perform_query(query, config));
+    // Codes are scanned one query at a time; the tiled kernel reads floats
+    if (quantized()) {
+        std::vector<ANNSResult> results(query_vectors.size());
+        ThreadPool::global()->parallel_for(0, query_vectors.size(), [&](size_t i) {
+            results[i] = perform_query(query_vectors[i], config);
+        });
+        return results;
     }
 
+    // Pack the queries into one aligned block for the tiled kernel
+    const size_t query_stride = simd::padded_row_stride(dimension_);
+    simd::AlignedFloatVector queries(query_vectors.size() * query_stride, 0.0f);
+    for (size_t i = 0; i < query_vectors.size(); ++i) {
+        if (query_vectors[i].size() != dimension_) {
+            throw std::runtime_error("Vector dimension mismatch in BruteForceANNS");
+        }
+        std::copy(query_vectors[i].begin(), query_vectors[i].end(),
+                  queries.begin() + i * query_stride);
+    }
+
+    FlatScanView view;
+    view.data = data_.data();
+    view.count = ids_.size();
+    view.stride = stride_;
+    view.norms_sq = norms_sq_.data();
+    view.ids = ids_.data();
+    view.dimension = dimension_;
+    view.metric = metric_;
+
+    BlockedScanOptions options;
+    options.query_block = config.get_param<size_t>("query_block", options.query_block);
+    options.base_block = config.get_param<size_t>("base_block", options.base_block);
+    options.use_blas = config.get_param<bool>("use_blas", options.use_blas);
+
+    auto start = std::chrono::high_resolution_clock::now();
+    auto results = blocked_knn_search(view, queries.data(), query_vectors.size(), query_stride,
+                                      config.k, config.return_distances, options);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           query_vectors.size() * ids_.size());
     return results;
 }
 
+void BruteForceANNS::batch_query(const QueryMatrix& queries,
+                                 const QueryConfig& config,
+                                 const QueryOutput& output) const {
+    if (!built_) {
+        throw std::runtime_error("BruteForceANNS index is not built");
+    }
+    if (!ids_.empty() && queries.dimension != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in BruteForceANNS");
+    }
+
+    const size_t k = config.k;
+    const size_t rerank = rerank_for(config);
+    auto start = std::chrono::high_resolution_clock::now();
+
+    auto scan_row = [&](size_t i) {
+        // Reused across calls so small-k serving does not allocate
+        thread_local std::vector<std::pair<float, VectorId>> heap;
+        scan_top_k(queries.row(i), std::min(k, ids_.size()), rerank, heap);
+        for (size_t j = 0; j < heap.size(); ++j) {
+            output.ids[i * k + j] = heap[j].second;
+            if (output.distances) {
+                output.distances[i * k + j] = heap[j].first;
+            }
+        }
+        output.finish(i, k, heap.size());
+    };
+    if (queries.rows <= 1 || ids_.empty()) {
+        for (size_t i = 0; i < queries.rows; ++i) {
+            scan_row(i);
+        }
+    } else if (quantized()) {
+        ThreadPool::global()->parallel_for(0, queries.rows, scan_row);
+    } else {
+        FlatScanView view;
+        view.data = data_.data();
+        view.count = ids_.size();
+        view.stride = stride_;
+        view.norms_sq = norms_sq_.data();
+        view.ids = ids_.data();
+        view.dimension = dimension_;
+        view.metric = metric_;
+
+        BlockedScanOptions options;
+        options.query_block = config.get_param<size_t>("query_block", options.query_block);
+        options.base_block = config.get_param<size_t>("base_block", options.base_block);
+        options.use_blas = config.get_param<bool>("use_blas", options.use_blas);
+        blocked_knn_search(view, queries, k, output, options);
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           k > 0 ? queries.rows * ids_.size() : 0);
+}
+
 ANNSResult BruteForceANNS::range_query(const Vector& query_vector,
                                        float radius,
                                        const QueryConfig& config) const {
@@ -151,11 +349,25 @@ ANNSResult BruteForceANNS::range_query(const Vector& query_vector,
 
     auto start = std::chrono::high_resolution_clock::now();
 
-    for (const auto& entry : dataset_) {
-        float distance = compute_distance(query_vector, entry.vector);
-        metrics_.distance_computations++;
+    if (query_vector.size() != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in BruteForceANNS");
+    }
+
+    // Quantized storage compares code estimates unless re-ranking asks for
+    // float rows and the row is kept
+    const bool rescore = rerank_for(config) > 0;
+    ScalarQuantizer::Query prepared;
+    float query_norm_sq = 0.0f;
+    if (quantized()) {
+        quantizer_.prepare(query_vector.data(), prepared);
+        query_norm_sq = simd::norm_squared(query_vector.data(), dimension_);
+    }
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        const float distance = !quantized() || (rescore && row(i))
+                                   ? compute_distance(query_vector.data(), row(i))
+                                   : quantized_distance(prepared, query_norm_sq, i);
         if (distance <= radius) {
-            result.ids.push_back(entry.id);
+            result.ids.push_back(ids_[i]);
             if (config.return_distances) {
                 result.distances.push_back(distance);
             }
@@ -164,36 +376,82 @@ ANNSResult BruteForceANNS::range_query(const Vector& query_vector,
     }
 
     auto end = std::chrono::high_resolution_clock::now();
-    metrics_.search_time_seconds = std::chrono::duration<double>(end - start).count();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), ids_.size());
 
     return result;
 }
 
 void BruteForceANNS::add_vector(const VectorEntry& entry) {
-    dataset_.push_back({entry.first, entry.second});
-    id_to_index_[entry.first] = dataset_.size() - 1;
+    check_dimension(static_cast<Dimension>(entry.second.size()));
+    const float* values = entry.second.data();
+    train_quantizer(&values, 1);
+    append_row(entry.first, values);
     built_ = true;
 }
 
 void BruteForceANNS::add_vectors(const std::vector<VectorEntry>& entries) {
+    if (entries.empty()) {
+        return;
+    }
+    // The whole batch trains a quantizer that has not seen rows yet
+    std::vector<const float*> rows;
+    rows.reserve(entries.size());
+    for (const auto& entry : entries) {
+        check_dimension(static_cast<Dimension>(entry.second.size()));
+        rows.push_back(entry.second.data());
+    }
+    train_quantizer(rows.data(), rows.size());
+    if (keeps_rows()) {
+        data_.reserve((ids_.size() + entries.size()) * stride_);
+    }
+    ids_.reserve(ids_.size() + entries.size());
     for (const auto& entry : entries) {
         add_vector(entry);
     }
 }
 
+void BruteForceANNS::add_vectors(const DatasetView& entries) {
+    if (entries.empty()) {
+        return;
+    }
+    check_dimension(entries.dimension());
+    train_quantizer(entries.rows(), entries.size());
+    if (keeps_rows()) {
+        data_.reserve((ids_.size() + entries.size()) * stride_);
+    }
+    for (size_t i = 0; i < entries.size(); ++i) {
+        append_row(entries.id(i), entries.row(i));
+    }
+    built_ = true;
+}
+
 void BruteForceANNS::remove_vector(VectorId id) {
     auto it = id_to_index_.find(id);
     if (it == id_to_index_.end()) {
         return;
     }
 
+    // Swap-with-last keeps the arena dense so scans never see holes
     size_t index = it->second;
-    size_t last_index = dataset_.size() - 1;
+    size_t last_index = ids_.size() - 1;
+    const size_t code_size = quantized() ? quantizer_.code_size() : 0;
     if (index != last_index) {
-        std::swap(dataset_[index], dataset_[last_index]);
-        id_to_index_[dataset_[index].id] = index;
+        if (!data_.empty()) {
+            std::memcpy(data_.data() + index * stride_, row(last_index),
+                        stride_ * sizeof(float));
+        }
+        ids_[index] = ids_[last_index];
+        norms_sq_[index] = norms_sq_[last_index];
+        std::copy_n(codes_.data() + last_index * code_size, code_size,
+                    codes_.data() + index * code_size);
+        id_to_index_[ids_[index]] = index;
+    }
+    codes_.resize(last_index * code_size);
+    if (!data_.empty()) {
+        data_.resize(last_index * stride_);
     }
-    dataset_.pop_back();
+    ids_.pop_back();
+    norms_sq_.pop_back();
     id_to_index_.erase(it);
 }
 
@@ -204,26 +462,41 @@ void BruteForceANNS::remove_vectors(const std::vector<VectorId>& ids) {
 }
 
 size_t BruteForceANNS::get_index_size() const {
-    return dataset_.size();
+    return ids_.size();
 }
 
 size_t BruteForceANNS::get_memory_usage() const {
-    return dataset_.size() * dimension_ * sizeof(float) +
-           id_to_index_.size() * (sizeof(VectorId) + sizeof(size_t));
+    // Allocated capacity, not just live rows; hash nodes carry the key/value
+    // pair plus a next pointer and cached hash.
+    const size_t node_bytes = sizeof(std::pair<const VectorId, size_t>) + 2 * sizeof(void*);
+    return data_.capacity() * sizeof(float) +
+           ids_.capacity() * sizeof(VectorId) +
+           norms_sq_.capacity() * sizeof(float) +
+           codes_.capacity() +
+           (quantizer_.mins().capacity() + quantizer_.steps().capacity()) * sizeof(float) +
+           id_to_index_.bucket_count() * sizeof(void*) +
+           id_to_index_.size() * node_bytes;
 }
 
 std::unordered_map<std::string, std::string> BruteForceANNS::get_build_params() const {
-    return {};
+    return {{"storage_precision", storage_precision_name(precision_)},
+            {"rerank", std::to_string(rerank_)}};
 }
 
 bool BruteForceANNS::validate_params(const AlgorithmParams& params) const {
-    (void)params;
-    return true;
+    try {
+        return parse_storage_precision(params.get<std::string>("storage_precision", "fp32")) !=
+               StoragePrecision::RABITQ;
+    } catch (const std::runtime_error&) {
+        return false;
+    }
 }
 
 AlgorithmParams BruteForceANNS::get_default_params() const {
     AlgorithmParams params;
     params.set("metric", static_cast<int>(DistanceMetric::L2));
+    params.set("storage_precision", std::string("fp32"));
+    params.set("rerank", 0u);
     return params;
 }
 
@@ -234,90 +507,217 @@ QueryConfig BruteForceANNS::get_default_query_config() const {
     return config;
 }
 
-float BruteForceANNS::compute_distance(const Vector& a, const Vector& b) const {
-    if (a.size() != b.size()) {
+void BruteForceANNS::reset_rows(Dimension dimension, size_t expected) {
+    dimension_ = dimension;
+    stride_ = simd::padded_row_stride(dimension);
+    data_.clear();
+    ids_.clear();
+    norms_sq_.clear();
+    codes_.clear();
+    id_to_index_.clear();
+
+    if (keeps_rows()) {
+        data_.reserve(expected * stride_);
+    }
+    ids_.reserve(expected);
+    norms_sq_.reserve(expected);
+    id_to_index_.reserve(expected);
+}
+
+void BruteForceANNS::check_dimension(Dimension dimension) {
+    if (ids_.empty() && dimension_ == 0) {
+        dimension_ = dimension;
+        stride_ = simd::padded_row_stride(dimension);
+    }
+    if (dimension != dimension_) {
         throw std::runtime_error("Vector dimension mismatch in BruteForceANNS");
     }
+}
 
+void BruteForceANNS::append_row(VectorId id, const float* values) {
+    const size_t index = ids_.size();
+    if (keeps_rows()) {
+        // Padding lanes are zero-filled by resize and never read by the kernels
+        data_.resize((index + 1) * stride_);
+        std::memcpy(data_.data() + index * stride_, values, dimension_ * sizeof(float));
+    }
+    ids_.push_back(id);
+    if (quantized()) {
+        thread_local Vector decoded;
+        decoded.resize(dimension_);
+        codes_.resize((index + 1) * quantizer_.code_size());
+        uint8_t* row_code = codes_.data() + index * quantizer_.code_size();
+        quantizer_.encode(values, row_code);
+        quantizer_.decode(row_code, decoded.data());
+        norms_sq_.push_back(simd::norm_squared(decoded.data(), dimension_));
+    } else {
+        norms_sq_.push_back(simd::norm_squared(values, dimension_));
+    }
+    id_to_index_[id] = index;
+}
+
+float BruteForceANNS::compute_distance(const float* a, const float* b) const {
     switch (metric_) {
-        case DistanceMetric::L2: {
-            float distance = 0.0f;
-            for (size_t i = 0; i < a.size(); ++i) {
-                float diff = a[i] - b[i];
-                distance += diff * diff;
-            }
-            return std::sqrt(distance);
-        }
-        case DistanceMetric::INNER_PRODUCT: {
-            float dot = 0.0f;
-            for (size_t i = 0; i < a.size(); ++i) {
-                dot += a[i] * b[i];
-            }
-            return dot; // higher is better
-        }
-        case DistanceMetric::COSINE: {
-            float dot = 0.0f;
-            float norm_a = 0.0f;
-            float norm_b = 0.0f;
-            for (size_t i = 0; i < a.size(); ++i) {
-                dot += a[i] * b[i];
-                norm_a += a[i] * a[i];
-                norm_b += b[i] * b[i];
-            }
-            float denom = std::sqrt(norm_a) * std::sqrt(norm_b);
-            if (denom == 0.0f) {
-                return 1.0f;
-            }
-            return 1.0f - (dot / denom);
-        }
+        case DistanceMetric::L2:
+            return simd::l2_distance(a, b, dimension_);
+        case DistanceMetric::INNER_PRODUCT:
+            return simd::inner_product(a, b, dimension_); // higher is better
+        case DistanceMetric::COSINE:
+            return simd::cosine_distance(a, b, dimension_);
     }
     return 0.0f;
 }
 
-ANNSResult BruteForceANNS::perform_query(const Vector& query_vector,
-                                         const QueryConfig& config) const {
-    if (!built_) {
-        throw std::runtime_error("BruteForceANNS index is not built");
+void BruteForceANNS::configure_storage(const AlgorithmParams& params) {
+    precision_ = parse_storage_precision(params.get<std::string>("storage_precision", "fp32"));
+    if (precision_ == StoragePrecision::RABITQ) {
+        throw std::runtime_error("BruteForceANNS: rabitq storage is offered by vamana and ivf");
+    }
+    rerank_ = params.get<uint32_t>("rerank", 0);
+    if (!quantizer_from_train_) {
+        quantizer_ = ScalarQuantizer();  // retrained on the rows fit() is given
+    }
+}
+
+// Sets the quantizer up for the current dimension; a quantizer that has not
+// seen rows yet (from train() or an earlier batch) learns its range here
+void BruteForceANNS::train_quantizer(const float* const* rows, size_t n) {
+    if (!quantized()) {
+        return;
+    }
+    if (quantizer_.precision() != precision_ || quantizer_.dimension() != dimension_) {
+        quantizer_ = ScalarQuantizer(dimension_, precision_);
+    }
+    if (!quantizer_.trained()) {
+        quantizer_.train(rows, n);
     }
+}
 
-    std::vector<std::pair<float, VectorId>> scored_results;
-    scored_results.reserve(dataset_.size());
+// Encodes every stored row after a load, then drops the float rows the
+// storage mode does not keep
+void BruteForceANNS::requantize() {
+    const size_t code_size = quantizer_.code_size();
+    codes_.assign(ids_.size() * code_size, 0);
+    Vector decoded(dimension_);
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        uint8_t* row_code = codes_.data() + i * code_size;
+        quantizer_.encode(row(i), row_code);
+        quantizer_.decode(row_code, decoded.data());
+        norms_sq_[i] = simd::norm_squared(decoded.data(), dimension_);
+    }
+    if (!keeps_rows()) {
+        simd::AlignedFloatVector().swap(data_);
+    }
+}
 
-    auto start = std::chrono::high_resolution_clock::now();
+size_t BruteForceANNS::rerank_for(const QueryConfig& config) const {
+    return quantized() ? config.algorithm_params.get<uint32_t>("rerank", rerank_) : 0;
+}
 
-    for (const auto& entry : dataset_) {
-        float distance = compute_distance(query_vector, entry.vector);
-        metrics_.distance_computations++;
-        scored_results.emplace_back(distance, entry.id);
+// Same conventions as compute_distance, from the row's code
+float BruteForceANNS::quantized_distance(const ScalarQuantizer::Query& query,
+                                         float query_norm_sq, size_t index) const {
+    switch (metric_) {
+        case DistanceMetric::L2:
+            return std::sqrt(std::max(0.0f, quantizer_.l2_squared(query, code(index))));
+        case DistanceMetric::INNER_PRODUCT:
+            return quantizer_.inner_product(query, code(index));
+        case DistanceMetric::COSINE: {
+            const float norms = query_norm_sq * norms_sq_[index];
+            return norms == 0.0f
+                       ? 1.0f
+                       : 1.0f - quantizer_.inner_product(query, code(index)) / std::sqrt(norms);
+        }
     }
+    return 0.0f;
+}
 
-    auto comparator = [this](const auto& a, const auto& b) {
+void BruteForceANNS::scan_top_k(const float* query, size_t k, size_t rerank,
+                                std::vector<std::pair<float, VectorId>>& heap) const {
+    // Bounded heap whose front is the worst of the current top-k
+    auto better = [this](const std::pair<float, VectorId>& a,
+                         const std::pair<float, VectorId>& b) {
         if (metric_ == DistanceMetric::INNER_PRODUCT) {
             return a.first > b.first; // higher is better
         }
         return a.first < b.first; // lower is better
     };
+    heap.clear();
+    if (k == 0) {
+        return;
+    }
+    // Re-ranking keeps a wider pool of code estimates, then re-scores it
+    const size_t pool = rerank > 0 ? std::min(std::max(k, rerank), ids_.size()) : k;
+    heap.reserve(pool + 1);
+    auto offer = [&](float distance, VectorId id) {
+        if (heap.size() < pool) {
+            heap.emplace_back(distance, id);
+            std::push_heap(heap.begin(), heap.end(), better);
+        } else if (better({distance, id}, heap.front())) {
+            std::pop_heap(heap.begin(), heap.end(), better);
+            heap.back() = {distance, id};
+            std::push_heap(heap.begin(), heap.end(), better);
+        }
+    };
 
-    uint32_t k = std::min(static_cast<uint32_t>(scored_results.size()), config.k);
-    std::partial_sort(scored_results.begin(), scored_results.begin() + k,
-                      scored_results.end(), comparator);
+    if (!quantized()) {
+        for (size_t i = 0; i < ids_.size(); ++i) {
+            offer(compute_distance(query, row(i)), ids_[i]);
+        }
+        std::sort_heap(heap.begin(), heap.end(), better);
+        return;
+    }
+
+    thread_local ScalarQuantizer::Query prepared;
+    quantizer_.prepare(query, prepared);
+    const float query_norm_sq =
+        metric_ == DistanceMetric::COSINE ? simd::norm_squared(query, dimension_) : 0.0f;
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        offer(quantized_distance(prepared, query_norm_sq, i), ids_[i]);
+    }
+    if (rerank > 0) {
+        for (auto& [distance, id] : heap) {
+            const float* values = row(id_to_index_.at(id));
+            if (values) {
+                distance = compute_distance(query, values);
+            }
+        }
+    }
+    std::sort(heap.begin(), heap.end(), better);
+    heap.resize(std::min(heap.size(), k));
+}
+
+ANNSResult BruteForceANNS::perform_query(const Vector& query_vector,
+                                         const QueryConfig& config) const {
+    if (!built_) {
+        throw std::runtime_error("BruteForceANNS index is not built");
+    }
+    if (!ids_.empty() && query_vector.size() != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in BruteForceANNS");
+    }
 
+    const size_t k = std::min(static_cast<size_t>(config.k), ids_.size());
+    std::vector<std::pair<float, VectorId>> heap;
+
+    auto start = std::chrono::high_resolution_clock::now();
+    scan_top_k(query_vector.data(), k, rerank_for(config), heap);
     auto end = std::chrono::high_resolution_clock::now();
-    metrics_.search_time_seconds = std::chrono::duration<double>(end - start).count();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           k > 0 ? ids_.size() : 0);
 
     ANNSResult result;
-    result.ids.reserve(k);
+    result.ids.reserve(heap.size());
     if (config.return_distances) {
-        result.distances.reserve(k);
+        result.distances.reserve(heap.size());
     }
 
-    for (uint32_t i = 0; i < k; ++i) {
-        result.ids.push_back(scored_results[i].second);
+    for (const auto& [distance, id] : heap) {
+        result.ids.push_back(id);
         if (config.return_distances) {
-            result.distances.push_back(scored_results[i].first);
+            result.distances.push_back(distance);
         }
     }
-    result.actual_k = k;
+    result.actual_k = heap.size();
 
     return result;
 }
@@ -338,6 +738,8 @@ std::vector<DistanceMetric> BruteForceANNSFactory::supported_distances() const {
 AlgorithmParams BruteForceANNSFactory::default_build_params() const {
     AlgorithmParams params;
     params.set("metric", static_cast<int>(DistanceMetric::L2));
+    params.set("storage_precision", std::string("fp32"));
+    params.set("rerank", 0u);
     return params;
 }
 
@@ -37,6 +37,7 @@ FaissANNS::FaissANNS()
             last_index_size_bytes_(0),
             is_built_(false) {
     metrics_.reset();
+    query_counters_.reset();
 }
 
 FaissANNS::~FaissANNS() = default;
@@ -75,6 +76,7 @@ void FaissANNS::fit(const std::vector<VectorEntry>& dataset,
     throw std::runtime_error("FAISS support not enabled in this build");
 #else
     metrics_.reset();
+    query_counters_.reset();
 
     if (dataset.empty()) {
         index_.reset();
@@ -273,6 +275,7 @@ bool FaissANNS::load(const std::string& path) {
     build_params_.set_raw("resolved_index_type", index_type_to_string(index_type_));
 
     metrics_.reset();
+    query_counters_.reset();
     last_index_size_bytes_ = static_cast<size_t>(index_->ntotal) * static_cast<size_t>(dimension_) * sizeof(float);
     metrics_.index_size_bytes = last_index_size_bytes_;
         return true;
@@ -316,13 +319,12 @@ ANNSResult FaissANNS::query(const Vector& query_vector,
         normalize_vector(query);
     }
 
+    auto search_params = make_search_params(config);
     auto start = std::chrono::high_resolution_clock::now();
-    apply_query_params(config);
-    index_->search(1, query.data(), k, distances.data(), labels.data());
+    index_->search(1, query.data(), k, distances.data(), labels.data(), search_params.get());
     auto end = std::chrono::high_resolution_clock::now();
 
-    metrics_.search_time_seconds = std::chrono::duration<double>(end - start).count();
-    metrics_.distance_computations = k;
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), k);
 
     auto result = convert_faiss_results(labels.data(), distances.data(), k);
     if (!config.return_distances) {
@@ -370,13 +372,12 @@ std::vector<ANNSResult> FaissANNS::batch_query(
     std::vector<float> distances(nq * k);
     std::vector<faiss::idx_t> labels(nq * k);
 
+    auto search_params = make_search_params(config);
     auto start = std::chrono::high_resolution_clock::now();
-    apply_query_params(config);
-    index_->search(nq, queries.data(), k, distances.data(), labels.data());
+    index_->search(nq, queries.data(), k, distances.data(), labels.data(), search_params.get());
     auto end = std::chrono::high_resolution_clock::now();
 
-    metrics_.search_time_seconds = std::chrono::duration<double>(end - start).count();
-    metrics_.distance_computations = nq * k;
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), nq * k);
 
     std::vector<ANNSResult> results;
     results.reserve(nq);
@@ -393,6 +394,103 @@ std::vector<ANNSResult> FaissANNS::batch_query(
 #endif
 }
 
+void FaissANNS::batch_query(const QueryMatrix& queries,
+                            const QueryConfig& config,
+                            const QueryOutput& output) const {
+#ifndef ENABLE_FAISS
+    (void)queries;
+    (void)config;
+    (void)output;
+    throw std::runtime_error("FAISS support not enabled in this build");
+#else
+    if (!index_ || !is_built_) {
+        throw std::runtime_error("FaissANNS index is not built");
+    }
+    if (queries.dimension != static_cast<Dimension>(dimension_)) {
+        throw std::runtime_error("FaissANNS: query dimension mismatch");
+    }
+
+    const size_t nq = queries.rows;
+    const size_t k_out = config.k;
+    const size_t k = std::min<size_t>(config.k, static_cast<size_t>(index_->ntotal));
+    if (k == 0) {
+        for (size_t i = 0; i < nq; ++i) {
+            output.finish(i, k_out, 0);
+        }
+        return;
+    }
+
+    // FAISS reads packed rows; only padded or cosine queries need a copy
+    const size_t dim = static_cast<size_t>(dimension_);
+    const float* data = queries.data;
+    std::vector<float> packed;
+    if (queries.stride != dim || distance_metric_ == DistanceMetric::COSINE) {
+        packed.resize(nq * dim);
+        for (size_t i = 0; i < nq; ++i) {
+            float* row = packed.data() + i * dim;
+            std::copy(queries.row(i), queries.row(i) + dim, row);
+            if (distance_metric_ == DistanceMetric::COSINE) {
+                float norm = 0.0f;
+                for (size_t d = 0; d < dim; ++d) {
+                    norm += row[d] * row[d];
+                }
+                norm = std::sqrt(norm);
+                if (norm > 0.0f) {
+                    for (size_t d = 0; d < dim; ++d) {
+                        row[d] /= norm;
+                    }
+                }
+            }
+        }
+        data = packed.data();
+    }
+
+    // When the caller's rows are exactly k wide FAISS writes into them
+    // directly; labels and ids share a 64-bit layout.
+    static_assert(sizeof(faiss::idx_t) == sizeof(VectorId));
+    std::vector<faiss::idx_t> label_buffer;
+    std::vector<float> distance_buffer;
+    faiss::idx_t* labels = reinterpret_cast<faiss::idx_t*>(output.ids);
+    float* distances = output.distances;
+    if (k != k_out) {
+        label_buffer.resize(nq * k);
+        labels = label_buffer.data();
+        distances = nullptr;
+    }
+    if (!distances) {
+        distance_buffer.resize(nq * k);
+        distances = distance_buffer.data();
+    }
+
+    auto search_params = make_search_params(config);
+    auto start = std::chrono::high_resolution_clock::now();
+    index_->search(nq, data, k, distances, labels, search_params.get());
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), nq * k);
+
+    // Compact each row in place: slot filled <= j, so nothing unread is overwritten
+    for (size_t i = 0; i < nq; ++i) {
+        size_t filled = 0;
+        for (size_t j = 0; j < k; ++j) {
+            const faiss::idx_t label = labels[i * k + j];
+            if (label < 0) {
+                continue;
+            }
+            float dist = distances[i * k + j];
+            if (distance_metric_ == DistanceMetric::COSINE) {
+                dist = 1.0f - dist;
+            }
+            output.ids[i * k_out + filled] = static_cast<VectorId>(label);
+            if (output.distances) {
+                output.distances[i * k_out + filled] = dist;
+            }
+            ++filled;
+        }
+        output.finish(i, k_out, filled);
+    }
+#endif
+}
+
 ANNSResult FaissANNS::range_query(const Vector& query_vector,
                                   float radius,
                                   const QueryConfig& config) const {
@@ -412,13 +510,13 @@ ANNSResult FaissANNS::range_query(const Vector& query_vector,
     }
 
     faiss::RangeSearchResult result_container(1);
+    auto search_params = make_search_params(config);
     auto start = std::chrono::high_resolution_clock::now();
-    apply_query_params(config);
-    index_->range_search(1, query.data(), radius, &result_container);
+    index_->range_search(1, query.data(), radius, &result_container, search_params.get());
     auto end = std::chrono::high_resolution_clock::now();
 
-    metrics_.search_time_seconds = std::chrono::duration<double>(end - start).count();
-    metrics_.distance_computations = result_container.lims[1] - result_container.lims[0];
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           result_container.lims[1] - result_container.lims[0]);
 
     size_t from = result_container.lims[0];
     size_t to = result_container.lims[1];
@@ -515,7 +613,9 @@ std::unordered_map<std::string, std::string> FaissANNS::get_build_params() const
 }
 
 ANNSMetrics FaissANNS::get_metrics() const {
-    return metrics_;
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    return metrics;
 }
 
 bool FaissANNS::validate_params(const AlgorithmParams& params) const {
@@ -763,30 +863,36 @@ std::string FaissANNS::metadata_path(const std::string& base_path) const {
     return base_path + ".meta";
 }
 
-void FaissANNS::apply_query_params(const QueryConfig& config) const {
+std::unique_ptr<faiss::SearchParameters> FaissANNS::make_search_params(
+    const QueryConfig& config) const {
 #ifdef ENABLE_FAISS
+    // Per-call parameters leave the shared index untouched, so concurrent
+    // queries with different nprobe/efSearch values do not race.
     if (!index_) {
-        return;
+        return nullptr;
     }
 
-    if (config.algorithm_params.has("nprobe")) {
+    if (dynamic_cast<const faiss::IndexIVF*>(index_.get())) {
         int nprobe = config.algorithm_params.get<int>("nprobe", 0);
         if (nprobe > 0) {
-            if (auto* ivf = dynamic_cast<faiss::IndexIVF*>(index_.get())) {
-                ivf->nprobe = nprobe;
-            }
+            auto params = std::make_unique<faiss::SearchParametersIVF>();
+            params->nprobe = static_cast<size_t>(nprobe);
+            return params;
         }
     }
 
-    if (config.algorithm_params.has("efSearch")) {
+    if (dynamic_cast<const faiss::IndexHNSW*>(index_.get())) {
         int ef = config.algorithm_params.get<int>("efSearch", 0);
         if (ef > 0) {
-            if (auto* hnsw = dynamic_cast<faiss::IndexHNSW*>(index_.get())) {
-                hnsw->hnsw.efSearch = ef;
-            }
+            auto params = std::make_unique<faiss::SearchParametersHNSW>();
+            params->efSearch = ef;
+            return params;
         }
     }
+#else
+    (void)config;
 #endif
+    return nullptr;
 }
 
 } // namespace anns
@@ -1,11 +1,13 @@
 #include "sage_db/anns/flat_gpu_plugin.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
 #include <cmath>
 #include <exception>
 #include <fstream>
 #include <cctype>
+#include <mutex>
 #include <numeric>
 #include <queue>
 #include <string>
@@ -17,7 +19,9 @@
 #include "LibAMM.h"
 #endif
 
+#include "sage_db/anns/blocked_scan.h"
 #include "sage_db/anns/flat_gpu/cuda_helpers.h"
+#include "sage_db/simd/distance.h"
 
 namespace sage_db {
 namespace anns {
@@ -94,6 +98,7 @@ public:
     void reset() {
         data_.clear();
         ids_.clear();
+        norms_sq_.clear();
         id_to_index_.clear();
         capacity_ = 0;
         memory_read_cnt_total_ = 0;
@@ -125,6 +130,7 @@ public:
         capacity_ = reserve_count;
         data_.reserve(static_cast<size_t>(dimension) * reserve_count);
         ids_.reserve(reserve_count);
+        norms_sq_.reserve(reserve_count);
     }
 
     size_t size() const { return ids_.size(); }
@@ -148,6 +154,7 @@ public:
             data_.resize(offset + dimension_);
         }
         std::copy(vec.begin(), vec.end(), data_.begin() + offset);
+        norms_sq_.push_back(simd::norm_squared(vec.data(), dimension_));
     }
 
     void append_bulk(const std::vector<VectorEntry>& entries) {
@@ -158,6 +165,7 @@ public:
         const size_t total_needed = old_size + entries.size();
         ensure_capacity(total_needed);
         ids_.resize(total_needed);
+        norms_sq_.resize(total_needed);
         data_.resize(static_cast<size_t>(dimension_) * total_needed);
 
         size_t batch = mem_buffer_size_ == 0 ? entries.size() : mem_buffer_size_;
@@ -180,6 +188,7 @@ public:
                 ids_[dest_index] = entry.first;
                 id_to_index_[entry.first] = dest_index;
                 std::copy(entry.second.begin(), entry.second.end(), data_.begin() + dest_offset);
+                norms_sq_[dest_index] = simd::norm_squared(entry.second.data(), dimension_);
                 memory_write_cnt_total_++;
                 ++dest_index;
                 dest_offset += dimension_;
@@ -200,9 +209,11 @@ public:
         if (idx != last_idx) {
             std::copy_n(row_ptr(last_idx), dimension_, row_ptr(idx));
             ids_[idx] = ids_[last_idx];
+            norms_sq_[idx] = norms_sq_[last_idx];
             id_to_index_[ids_[idx]] = idx;
         }
         ids_.pop_back();
+        norms_sq_.pop_back();
         id_to_index_.erase(it);
         data_.resize(static_cast<size_t>(ids_.size()) * dimension_);
         return true;
@@ -238,6 +249,7 @@ public:
 
     size_t memory_usage_bytes() const {
         return data_.size() * sizeof(float) + ids_.size() * sizeof(VectorId) +
+               norms_sq_.size() * sizeof(float) +
                id_to_index_.bucket_count() * sizeof(void*);
     }
 
@@ -245,6 +257,11 @@ public:
 
     const std::vector<float>& raw_data() const { return data_; }
 
+    const std::vector<float>& norms_sq() const { return norms_sq_; }
+
+    // Bulk scans bypass row_ptr but still count as host reads
+    void record_bulk_reads(size_t rows) const { memory_read_cnt_total_ += rows; }
+
     uint64_t memory_read_cnt_total() const { return memory_read_cnt_total_; }
     uint64_t memory_read_cnt_miss() const { return memory_read_cnt_miss_; }
     uint64_t memory_write_cnt_total() const { return memory_write_cnt_total_; }
@@ -297,6 +314,7 @@ public:
 
     flat_gpu::DeviceBuffers& device_buffers() { return device_buffers_; }
     flat_gpu::QueryScratch& query_scratch() { return query_scratch_; }
+    std::mutex& gpu_mutex() { return gpu_mutex_; }
     flat_gpu::CUDABackend* cuda_backend() { return cuda_backend_.get(); }
 
     void set_last_query_stats(const flat_gpu::DeviceStats& stats) {
@@ -338,18 +356,25 @@ private:
         }
         data_.reserve(static_cast<size_t>(dimension_) * capacity_);
         ids_.reserve(capacity_);
+        norms_sq_.reserve(capacity_);
     }
 
     uint32_t dimension_ = 0;
     size_t capacity_ = 0;
     std::vector<float> data_;
     std::vector<VectorId> ids_;
+    std::vector<float> norms_sq_;
     std::unordered_map<VectorId, size_t> id_to_index_;
 
-    mutable uint64_t memory_read_cnt_total_ = 0;
-    mutable uint64_t memory_read_cnt_miss_ = 0;
-    mutable uint64_t memory_write_cnt_total_ = 0;
-    mutable uint64_t memory_write_cnt_miss_ = 0;
+    // Bumped from concurrent const queries, hence atomic
+    mutable std::atomic<uint64_t> memory_read_cnt_total_{0};
+    mutable std::atomic<uint64_t> memory_read_cnt_miss_{0};
+    std::atomic<uint64_t> memory_write_cnt_total_{0};
+    std::atomic<uint64_t> memory_write_cnt_miss_{0};
+
+    // Device scratch and query stats are shared state; concurrent readers
+    // take turns on the GPU path.
+    std::mutex gpu_mutex_;
 
     flat_gpu::DeviceBuffers device_buffers_;
     flat_gpu::QueryScratch query_scratch_;
@@ -372,6 +397,7 @@ FlatGPUANNS::FlatGPUANNS()
       metric_(DistanceMetric::L2),
       dimension_(0) {
     metrics_.reset();
+    query_counters_.reset();
 }
 
 FlatGPUANNS::~FlatGPUANNS() = default;
@@ -399,43 +425,20 @@ static float compute_distance(DistanceMetric metric,
                               uint32_t dim,
                               float norm_a_cached = -1.0f) {
     switch (metric) {
-        case DistanceMetric::L2: {
-            float dist = 0.0f;
-            for (uint32_t i = 0; i < dim; ++i) {
-                float diff = a[i] - b[i];
-                dist += diff * diff;
-            }
-            return std::sqrt(dist);
-        }
-        case DistanceMetric::INNER_PRODUCT: {
-            float result = 0.0f;
-            for (uint32_t i = 0; i < dim; ++i) {
-                result += a[i] * b[i];
-            }
-            return result; // higher is better
-        }
+        case DistanceMetric::L2:
+            return simd::l2_distance(a, b.data(), dim);
+        case DistanceMetric::INNER_PRODUCT:
+            return simd::inner_product(a, b.data(), dim); // higher is better
         case DistanceMetric::COSINE: {
-            float dot = 0.0f;
-            float norm_a = 0.0f;
-            float norm_b = 0.0f;
-            if (norm_a_cached >= 0.0f) {
-                norm_a = norm_a_cached;
-            }
-            for (uint32_t i = 0; i < dim; ++i) {
-                dot += a[i] * b[i];
-                if (norm_a_cached < 0.0f) {
-                    norm_a += a[i] * a[i];
-                }
-                norm_b += b[i] * b[i];
-            }
             if (norm_a_cached < 0.0f) {
-                norm_a = std::sqrt(norm_a);
+                return simd::cosine_distance(a, b.data(), dim);
             }
-            norm_b = std::sqrt(norm_b);
-            if (norm_a == 0.0f || norm_b == 0.0f) {
+            const float dot = simd::inner_product(a, b.data(), dim);
+            const float norm_b = std::sqrt(simd::norm_squared(b.data(), dim));
+            if (norm_a_cached == 0.0f || norm_b == 0.0f) {
                 return 1.0f; // maximal distance when zero vector present
             }
-            return 1.0f - (dot / (norm_a * norm_b));
+            return 1.0f - (dot / (norm_a_cached * norm_b));
         }
     }
     return 0.0f;
@@ -444,6 +447,7 @@ static float compute_distance(DistanceMetric metric,
 void FlatGPUANNS::fit(const std::vector<VectorEntry>& dataset,
                       const AlgorithmParams& params) {
     metrics_.reset();
+    query_counters_.reset();
     auto start = std::chrono::high_resolution_clock::now();
 
     build_params_ = params;
@@ -607,6 +611,7 @@ bool FlatGPUANNS::load(const std::string& path) {
 
     built_ = true;
     metrics_.reset();
+    query_counters_.reset();
     metrics_.index_size_bytes = impl_->memory_usage_bytes();
 
     impl_->configure_cuda(dimension_, build_params_);
@@ -637,6 +642,7 @@ struct LibAMMEngine {
                    const at::Tensor& B,
                    uint64_t sketch_size,
                    bool use_cuda) {
+        std::lock_guard<std::mutex> lock(mutex_);
         auto ptr = algo(tag);
         if (!ptr) {
             throw std::runtime_error("LibAMMEngine: requested algorithm not found: " + tag);
@@ -649,6 +655,7 @@ struct LibAMMEngine {
     }
 
 private:
+    std::mutex mutex_; // setConfig() mutates the shared algorithm instance
     std::unique_ptr<LibAMM::CPPAlgoTable> table_;
 };
 
@@ -712,6 +719,7 @@ ANNSResult FlatGPUANNS::query(const Vector& query_vector,
 
     if (want_gpu) {
         try {
+            std::lock_guard<std::mutex> gpu_lock(impl_->gpu_mutex());
             impl_->sync_cuda();
 
             auto& buffers = impl_->device_buffers();
@@ -746,8 +754,7 @@ ANNSResult FlatGPUANNS::query(const Vector& query_vector,
             result.actual_k = k;
 
             auto end = std::chrono::high_resolution_clock::now();
-            metrics_.search_time_seconds += std::chrono::duration<double>(end - start).count();
-            metrics_.distance_computations += n;
+            query_counters_.record(std::chrono::duration<double>(end - start).count(), n);
 
             return result;
         } catch (const std::exception&) {
@@ -895,8 +902,7 @@ ANNSResult FlatGPUANNS::query(const Vector& query_vector,
     result.actual_k = scored.size();
 
     auto end = std::chrono::high_resolution_clock::now();
-    metrics_.search_time_seconds += std::chrono::duration<double>(end - start).count();
-    metrics_.distance_computations += n;
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), n);
 
     return result;
 }
@@ -904,14 +910,118 @@ ANNSResult FlatGPUANNS::query(const Vector& query_vector,
 std::vector<ANNSResult> FlatGPUANNS::batch_query(
     const std::vector<Vector>& query_vectors,
     const QueryConfig& config) const {
-    std::vector<ANNSResult> results;
-    results.reserve(query_vectors.size());
-    for (const auto& query : query_vectors) {
-        results.push_back(this->query(query, config));
+    bool prefer_libamm = false;
+#ifdef ENABLE_LIBAMM
+    prefer_libamm = (impl_->amm_algo() == "crs" || impl_->amm_algo() == "smp-pca") &&
+                    impl_->sketch_size() > 0;
+#endif
+    const bool want_gpu = impl_->using_cuda() &&
+        config.algorithm_params.get<bool>("useGPU", true);
+
+    // GPU, sketching and single-query batches keep the per-query path
+    if (!built_ || want_gpu || prefer_libamm || query_vectors.size() <= 1 || impl_->size() == 0) {
+        std::vector<ANNSResult> results;
+        results.reserve(query_vectors.size());
+        for (const auto& query : query_vectors) {
+            results.push_back(this->query(query, config));
+        }
+        return results;
+    }
+
+    std::vector<float> queries(query_vectors.size() * dimension_);
+    for (size_t i = 0; i < query_vectors.size(); ++i) {
+        if (query_vectors[i].size() != dimension_) {
+            throw std::runtime_error("FlatGPUANNS: query dimension mismatch");
+        }
+        std::copy(query_vectors[i].begin(), query_vectors[i].end(),
+                  queries.begin() + i * dimension_);
     }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const size_t n = impl_->size();
+    FlatScanView view;
+    view.data = impl_->raw_data().data();
+    view.count = n;
+    view.stride = dimension_;
+    view.norms_sq = impl_->norms_sq().data();
+    view.ids = impl_->ids().data();
+    view.dimension = dimension_;
+    view.metric = metric_;
+
+    BlockedScanOptions options;
+    if (impl_->dco_batch_size() > 0) {
+        options.base_block = std::min(options.base_block, impl_->dco_batch_size());
+    }
+    options.query_block = config.get_param<size_t>("query_block", options.query_block);
+    options.base_block = config.get_param<size_t>("base_block", options.base_block);
+    options.use_blas = config.get_param<bool>("use_blas", options.use_blas);
+
+    auto results = blocked_knn_search(view, queries.data(), query_vectors.size(), dimension_,
+                                      config.k, config.return_distances, options);
+    impl_->record_bulk_reads(n * query_vectors.size());
+
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           n * query_vectors.size());
     return results;
 }
 
+void FlatGPUANNS::batch_query(const QueryMatrix& queries,
+                              const QueryConfig& config,
+                              const QueryOutput& output) const {
+    if (!built_) {
+        throw std::runtime_error("FlatGPUANNS: index not built");
+    }
+    if (queries.dimension != dimension_) {
+        throw std::runtime_error("FlatGPUANNS: query dimension mismatch");
+    }
+    bool prefer_libamm = false;
+#ifdef ENABLE_LIBAMM
+    prefer_libamm = (impl_->amm_algo() == "crs" || impl_->amm_algo() == "smp-pca") &&
+                    impl_->sketch_size() > 0;
+#endif
+    const bool want_gpu = impl_->using_cuda() &&
+        config.algorithm_params.get<bool>("useGPU", true);
+
+    // GPU and sketching stage each query themselves; only they need a copy
+    if (want_gpu || prefer_libamm || impl_->size() == 0) {
+        Vector query(dimension_);
+        for (size_t i = 0; i < queries.rows; ++i) {
+            std::copy(queries.row(i), queries.row(i) + dimension_, query.begin());
+            output.store(i, config.k, this->query(query, config));
+        }
+        return;
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    const size_t n = impl_->size();
+    FlatScanView view;
+    view.data = impl_->raw_data().data();
+    view.count = n;
+    view.stride = dimension_;
+    view.norms_sq = impl_->norms_sq().data();
+    view.ids = impl_->ids().data();
+    view.dimension = dimension_;
+    view.metric = metric_;
+
+    BlockedScanOptions options;
+    if (impl_->dco_batch_size() > 0) {
+        options.base_block = std::min(options.base_block, impl_->dco_batch_size());
+    }
+    options.query_block = config.get_param<size_t>("query_block", options.query_block);
+    options.base_block = config.get_param<size_t>("base_block", options.base_block);
+    options.use_blas = config.get_param<bool>("use_blas", options.use_blas);
+
+    blocked_knn_search(view, queries, config.k, output, options);
+    impl_->record_bulk_reads(n * queries.rows);
+
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           n * queries.rows);
+}
+
 void FlatGPUANNS::add_vector(const VectorEntry& entry) {
     if (!built_) {
         throw std::runtime_error("FlatGPUANNS: index not built");
@@ -959,6 +1069,7 @@ std::unordered_map<std::string, std::string> FlatGPUANNS::get_build_params() con
 
 ANNSMetrics FlatGPUANNS::get_metrics() const {
     ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
     metrics.additional_metrics["host_memory_bytes"] = static_cast<double>(impl_->memory_usage_bytes());
     metrics.additional_metrics["memory_read_cnt_total"] = static_cast<double>(impl_->memory_read_cnt_total());
     metrics.additional_metrics["memory_read_cnt_miss"] = static_cast<double>(impl_->memory_read_cnt_miss());
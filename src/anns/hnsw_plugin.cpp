@@ -0,0 +1,962 @@
+#include "sage_db/anns/hnsw_plugin.h"
+
+#include "sage_db/anns/graph_reorder.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/thread_pool.h"
+#include "sage_db/vector_arena.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <deque>
+#include <fstream>
+#include <limits>
+#include <mutex>
+#include <queue>
+#include <random>
+#include <stdexcept>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+REGISTER_ANNS_ALGORITHM(HnswANNSFactory);
+
+using node_t = uint32_t;
+
+constexpr node_t kNoNode = std::numeric_limits<node_t>::max();
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint32_t kDefaultM = 16;
+constexpr uint32_t kDefaultEfConstruction = 200;
+constexpr uint32_t kDefaultEfSearch = 64;
+constexpr uint32_t kDefaultSeed = 100;
+constexpr uint32_t kMaxLevel = 16;
+
+// Generation-stamped visited marks, reused by every search on a thread
+class VisitedTable {
+public:
+    void prepare(size_t count) {
+        if (marks_.size() < count) {
+            marks_.resize(count, 0);
+        }
+        if (++epoch_ == 0) {
+            std::fill(marks_.begin(), marks_.end(), 0);
+            epoch_ = 1;
+        }
+    }
+
+    bool visit(node_t node) {
+        if (marks_[node] == epoch_) {
+            return false;
+        }
+        marks_[node] = epoch_;
+        return true;
+    }
+
+private:
+    std::vector<uint32_t> marks_;
+    uint32_t epoch_ = 0;
+};
+
+VisitedTable& visited_table() {
+    thread_local VisitedTable table;
+    return table;
+}
+}  // namespace
+
+class HnswANNS::Impl {
+public:
+    using KeyAndNode = std::pair<float, node_t>;
+    using MaxHeap = std::priority_queue<KeyAndNode>;
+    using MinHeap = std::priority_queue<KeyAndNode, std::vector<KeyAndNode>, std::greater<>>;
+
+    struct Node {
+        std::vector<std::vector<node_t>> links;  // links[l] for layers 0..level
+    };
+
+    void reset() {
+        nodes.clear();
+        locks.clear();
+        rows.clear();
+        inv_norms.clear();
+        labels.clear();
+        deleted.clear();
+        lookup.clear();
+        deleted_count = 0;
+        entry_point = kNoNode;
+        max_level = 0;
+        owned_rows.reset();
+        borrowed.clear();
+    }
+
+    void configure(uint32_t m, uint32_t seed) {
+        M = std::max<uint32_t>(m, 2);
+        level_mult = 1.0 / std::log(static_cast<double>(M));
+        level_rng.seed(seed);
+    }
+
+    // Lower is better for every metric: squared L2, negated inner product
+    // and cosine distance. inv_norm is only read for cosine.
+    float key(const float* query, float inv_norm, node_t node) const {
+        const float* row = rows[node];
+        switch (metric) {
+            case DistanceMetric::L2:
+                return simd::l2_squared(query, row, dimension);
+            case DistanceMetric::INNER_PRODUCT:
+                return -simd::inner_product(query, row, dimension);
+            case DistanceMetric::COSINE: {
+                const float scale = inv_norm * inv_norms[node];
+                return scale == 0.0f
+                           ? 1.0f
+                           : 1.0f - simd::inner_product(query, row, dimension) * scale;
+            }
+        }
+        return 0.0f;
+    }
+
+    float key_between(node_t a, node_t b) const {
+        return key(rows[a], metric == DistanceMetric::COSINE ? inv_norms[a] : 0.0f, b);
+    }
+
+    float inverse_norm(const float* row) const {
+        if (metric != DistanceMetric::COSINE) {
+            return 0.0f;
+        }
+        const float norm_sq = simd::norm_squared(row, dimension);
+        return norm_sq > 0.0f ? 1.0f / std::sqrt(norm_sq) : 0.0f;
+    }
+
+    // Same conventions as brute_force: L2 distance, raw dot, cosine distance
+    float key_to_distance(float key) const {
+        switch (metric) {
+            case DistanceMetric::L2:
+                return std::sqrt(std::max(0.0f, key));
+            case DistanceMetric::INNER_PRODUCT:
+                return -key;
+            case DistanceMetric::COSINE:
+                return key;
+        }
+        return key;
+    }
+
+    uint32_t max_links(uint32_t level) const {
+        return level == 0 ? 2 * M : M;
+    }
+
+    uint32_t level_of(node_t node) const {
+        return static_cast<uint32_t>(nodes[node].links.size() - 1);
+    }
+
+    uint32_t random_level() {
+        std::uniform_real_distribution<double> uniform(0.0, 1.0);
+        const double u = std::max(uniform(level_rng), std::numeric_limits<double>::min());
+        return std::min(static_cast<uint32_t>(-std::log(u) * level_mult), kMaxLevel);
+    }
+
+    // Appends an unlinked node; the row must outlive the index
+    node_t stage(VectorId id, const float* row, uint32_t level) {
+        auto existing = lookup.find(id);
+        if (existing != lookup.end()) {
+            mark_deleted(existing->second);  // the old row stops answering
+        }
+        const node_t node = append_node(id, row, level);
+        lookup[id] = node;
+        return node;
+    }
+
+    // stage() without the id lookup, for nodes that never answer for their id
+    node_t append_node(VectorId id, const float* row, uint32_t level) {
+        if (nodes.size() >= kNoNode) {
+            throw std::runtime_error("HNSW: index is full");
+        }
+        const node_t node = static_cast<node_t>(nodes.size());
+        nodes.emplace_back();
+        nodes.back().links.resize(level + 1);
+        locks.emplace_back();
+        rows.push_back(row);
+        if (metric == DistanceMetric::COSINE) {
+            inv_norms.push_back(inverse_norm(row));
+        }
+        labels.push_back(id);
+        deleted.push_back(0);
+        return node;
+    }
+
+    node_t stage_owned(VectorId id, const float* values) {
+        if (!owned_rows) {
+            owned_rows = std::make_unique<VectorArena>(dimension);
+        }
+        const size_t slot = owned_rows->append(id, values);
+        return stage(id, owned_rows->row(slot), random_level());
+    }
+
+    // Stages the view's rows, borrowing them when its storage keeps them alive
+    void stage_view(const DatasetView& view) {
+        if (view.storage() &&
+            std::find(borrowed.begin(), borrowed.end(), view.storage()) == borrowed.end()) {
+            borrowed.push_back(view.storage());
+        }
+        nodes.reserve(nodes.size() + view.size());
+        rows.reserve(rows.size() + view.size());
+        labels.reserve(labels.size() + view.size());
+        for (size_t i = 0; i < view.size(); ++i) {
+            if (view.storage()) {
+                stage(view.id(i), view.row(i), random_level());
+            } else {
+                stage_owned(view.id(i), view.row(i));
+            }
+        }
+    }
+
+    // Links the staged nodes [first, end) into the graph in parallel
+    void link(node_t first, node_t end) {
+        if (first >= end) {
+            return;
+        }
+        if (entry_point == kNoNode) {
+            entry_point = first;
+            max_level = level_of(first);
+            ++first;
+        }
+        ThreadPool::global()->parallel_for(first, end, [this](size_t node) {
+            insert(static_cast<node_t>(node));
+        });
+    }
+
+    void insert(node_t node) {
+        const uint32_t level = level_of(node);
+        // A node that raises the top layer holds the entry lock throughout
+        std::unique_lock<std::mutex> entry_guard(entry_mutex);
+        node_t current = entry_point;
+        const uint32_t top = max_level;
+        if (level <= top) {
+            entry_guard.unlock();
+        }
+
+        const float* row = rows[node];
+        const float inv_norm = metric == DistanceMetric::COSINE ? inv_norms[node] : 0.0f;
+        float current_key = key(row, inv_norm, current);
+        size_t computed = 0;
+        for (uint32_t l = top; l > level; --l) {
+            current = greedy_closest<true>(row, inv_norm, current, current_key, l, computed);
+        }
+
+        for (uint32_t l = std::min(level, top) + 1; l-- > 0;) {
+            MaxHeap found = search_layer<true>(row, inv_norm, current, current_key, l,
+                                               ef_construction, false, kDefaultPrefetchDepth,
+                                               computed);
+            const auto selected = prune(sorted(found), M);
+            connect(node, selected, l);
+            current = selected.front();
+            current_key = key(row, inv_norm, current);
+        }
+
+        if (level > top) {
+            entry_point = node;
+            max_level = level;
+        }
+    }
+
+    // Own links first, then back-links, so a node is never reachable on a
+    // layer before its own list for that layer is in place.
+    void connect(node_t node, const std::vector<node_t>& selected, uint32_t level) {
+        {
+            std::lock_guard<std::mutex> guard(locks[node]);
+            nodes[node].links[level] = selected;
+        }
+        const uint32_t cap = max_links(level);
+        for (node_t other : selected) {
+            std::lock_guard<std::mutex> guard(locks[other]);
+            auto& links = nodes[other].links[level];
+            if (std::find(links.begin(), links.end(), node) != links.end()) {
+                continue;
+            }
+            if (links.size() < cap) {
+                links.push_back(node);
+                continue;
+            }
+            std::vector<KeyAndNode> pool;
+            pool.reserve(links.size() + 1);
+            pool.emplace_back(key_between(other, node), node);
+            for (node_t neighbor : links) {
+                pool.emplace_back(key_between(other, neighbor), neighbor);
+            }
+            std::sort(pool.begin(), pool.end());
+            links = prune(pool, cap);
+        }
+    }
+
+    static std::vector<KeyAndNode> sorted(MaxHeap& heap) {
+        std::vector<KeyAndNode> ascending(heap.size());
+        for (size_t i = ascending.size(); i-- > 0;) {
+            ascending[i] = heap.top();
+            heap.pop();
+        }
+        return ascending;
+    }
+
+    // Neighbour-selection heuristic: keep a candidate only if it is closer
+    // to the base than to every neighbour already kept.
+    std::vector<node_t> prune(const std::vector<KeyAndNode>& ascending, uint32_t limit) const {
+        std::vector<node_t> selected;
+        selected.reserve(std::min<size_t>(ascending.size(), limit));
+        if (ascending.size() <= limit) {
+            for (const auto& candidate : ascending) {
+                selected.push_back(candidate.second);
+            }
+            return selected;
+        }
+        for (const auto& [candidate_key, candidate] : ascending) {
+            if (selected.size() >= limit) {
+                break;
+            }
+            bool keep = true;
+            for (node_t kept : selected) {
+                if (key_between(candidate, kept) < candidate_key) {
+                    keep = false;
+                    break;
+                }
+            }
+            if (keep) {
+                selected.push_back(candidate);
+            }
+        }
+        return selected;
+    }
+
+    // Builds read neighbour lists under the node lock; queries never race
+    // with writers and read them directly.
+    template <bool kLocked>
+    const std::vector<node_t>& links_of(node_t node, uint32_t level,
+                                        std::vector<node_t>& scratch) const {
+        if constexpr (kLocked) {
+            std::lock_guard<std::mutex> guard(locks[node]);
+            scratch = nodes[node].links[level];
+            return scratch;
+        } else {
+            return nodes[node].links[level];
+        }
+    }
+
+    template <bool kLocked>
+    node_t greedy_closest(const float* query, float inv_norm, node_t current,
+                          float& current_key, uint32_t level, size_t& computed) const {
+        std::vector<node_t> scratch;
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            for (node_t neighbor : links_of<kLocked>(current, level, scratch)) {
+                const float k = key(query, inv_norm, neighbor);
+                ++computed;
+                if (k < current_key) {
+                    current_key = k;
+                    current = neighbor;
+                    improved = true;
+                }
+            }
+        }
+        return current;
+    }
+
+    // Best-first search of one layer; returns up to ef results, worst on
+    // top. Deleted nodes still route the search when skip_deleted is set.
+    // A node's unvisited neighbours are collected before any is scored, and
+    // their rows prefetched prefetch_depth ahead of the one being scored.
+    template <bool kLocked>
+    MaxHeap search_layer(const float* query, float inv_norm, node_t entry, float entry_key,
+                         uint32_t level, size_t ef, bool skip_deleted,
+                         uint32_t prefetch_depth, size_t& computed) const {
+        auto& visited = visited_table();
+        visited.prepare(nodes.size());
+        visited.visit(entry);
+
+        MinHeap candidates;
+        MaxHeap top;
+        candidates.emplace(entry_key, entry);
+        if (!skip_deleted || !deleted[entry]) {
+            top.emplace(entry_key, entry);
+        }
+        float bound = top.empty() ? std::numeric_limits<float>::max() : top.top().first;
+
+        std::vector<node_t> scratch;
+        std::vector<node_t> pending;
+        while (!candidates.empty()) {
+            const auto [current_key, current] = candidates.top();
+            if (current_key > bound && top.size() >= ef) {
+                break;
+            }
+            candidates.pop();
+            pending.clear();
+            for (node_t neighbor : links_of<kLocked>(current, level, scratch)) {
+                if (visited.visit(neighbor)) {
+                    pending.push_back(neighbor);
+                }
+            }
+            const size_t ahead = std::min<size_t>(prefetch_depth, pending.size());
+            for (size_t i = 0; i < ahead; ++i) {
+                simd::prefetch_row(rows[pending[i]], dimension);
+            }
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (ahead > 0 && i + ahead < pending.size()) {
+                    simd::prefetch_row(rows[pending[i + ahead]], dimension);
+                }
+                const node_t neighbor = pending[i];
+                const float k = key(query, inv_norm, neighbor);
+                ++computed;
+                if (top.size() < ef || k < bound) {
+                    candidates.emplace(k, neighbor);
+                    if (!skip_deleted || !deleted[neighbor]) {
+                        top.emplace(k, neighbor);
+                        if (top.size() > ef) {
+                            top.pop();
+                        }
+                    }
+                    if (!top.empty()) {
+                        bound = top.top().first;
+                    }
+                }
+            }
+        }
+        return top;
+    }
+
+    // Best-first hits, nearest first
+    std::vector<KeyAndNode> search(const float* query, uint32_t k, uint32_t ef,
+                                   uint32_t prefetch_depth, size_t& computed) const {
+        if (entry_point == kNoNode || k == 0) {
+            return {};
+        }
+        const float inv_norm = inverse_norm(query);
+        node_t current = entry_point;
+        float current_key = key(query, inv_norm, current);
+        for (uint32_t l = max_level; l > 0; --l) {
+            current = greedy_closest<false>(query, inv_norm, current, current_key, l, computed);
+        }
+        MaxHeap top = search_layer<false>(query, inv_norm, current, current_key, 0,
+                                          std::max(ef, k), deleted_count > 0, prefetch_depth,
+                                          computed);
+        while (top.size() > k) {
+            top.pop();
+        }
+        return sorted(top);
+    }
+
+    ANNSResult search_single(const float* query, uint32_t k, uint32_t ef,
+                             uint32_t prefetch_depth, bool return_distances,
+                             size_t& computed) const {
+        ANNSResult result;
+        const auto hits = search(query, k, ef, prefetch_depth, computed);
+        result.ids.reserve(hits.size());
+        if (return_distances) {
+            result.distances.reserve(hits.size());
+        }
+        for (const auto& [hit_key, node] : hits) {
+            result.ids.push_back(labels[node]);
+            if (return_distances) {
+                result.distances.push_back(key_to_distance(hit_key));
+            }
+        }
+        result.actual_k = result.ids.size();
+        return result;
+    }
+
+    void mark_deleted(node_t node) {
+        if (!deleted[node]) {
+            deleted[node] = 1;
+            ++deleted_count;
+        }
+    }
+
+    // Renumbers the nodes in BFS order over layer 0 from the entry point
+    // (graph_reorder.h) and copies the rows into owned_rows in that order,
+    // so the neighbours a search scores sit on adjacent pages. Runs with no
+    // query or insert in flight.
+    void reorder() {
+        const size_t count = nodes.size();
+        if (count == 0 || entry_point == kNoNode) {
+            return;
+        }
+        const auto new_of = bfs_order<node_t>(count, entry_point, [this](node_t node, auto&& visit) {
+            for (node_t neighbor : nodes[node].links[0]) {
+                visit(neighbor);
+            }
+        });
+        std::vector<node_t> old_of(count);
+        for (node_t old = 0; old < count; ++old) {
+            old_of[new_of[old]] = old;
+        }
+
+        std::vector<Node> reordered(count);
+        std::vector<const float*> new_rows(count);
+        std::vector<float> new_inv_norms(inv_norms.size());
+        std::vector<VectorId> new_labels(count);
+        std::vector<uint8_t> new_deleted(count);
+        auto arena = std::make_unique<VectorArena>(dimension);
+        for (node_t node = 0; node < count; ++node) {
+            const node_t old = old_of[node];
+            reordered[node].links = std::move(nodes[old].links);
+            for (auto& layer : reordered[node].links) {
+                for (auto& neighbor : layer) {
+                    neighbor = new_of[neighbor];
+                }
+            }
+            new_rows[node] = arena->row(arena->append(labels[old], rows[old]));
+            if (!inv_norms.empty()) {
+                new_inv_norms[node] = inv_norms[old];
+            }
+            new_labels[node] = labels[old];
+            new_deleted[node] = deleted[old];
+        }
+        nodes = std::move(reordered);
+        rows = std::move(new_rows);
+        inv_norms = std::move(new_inv_norms);
+        labels = std::move(new_labels);
+        deleted = std::move(new_deleted);
+        owned_rows = std::move(arena);
+        borrowed.clear();
+        for (auto& [id, node] : lookup) {
+            node = new_of[node];
+        }
+        entry_point = new_of[entry_point];
+    }
+
+    DistanceMetric metric = DistanceMetric::L2;
+    uint32_t dimension = 0;
+    uint32_t M = kDefaultM;
+    uint32_t ef_construction = kDefaultEfConstruction;
+    uint32_t ef_search = kDefaultEfSearch;
+    double level_mult = 1.0 / std::log(static_cast<double>(kDefaultM));
+    std::mt19937 level_rng{kDefaultSeed};
+
+    std::vector<Node> nodes;
+    mutable std::deque<std::mutex> locks;  // one per node, stable addresses
+    std::vector<const float*> rows;
+    std::vector<float> inv_norms;          // cosine only
+    std::vector<VectorId> labels;
+    std::vector<uint8_t> deleted;
+    std::unordered_map<VectorId, node_t> lookup;
+    size_t deleted_count = 0;
+
+    std::mutex entry_mutex;
+    node_t entry_point = kNoNode;
+    uint32_t max_level = 0;
+
+    // Rows not shared with us; borrowed keeps shared storage alive
+    std::unique_ptr<VectorArena> owned_rows;
+    std::vector<std::shared_ptr<const void>> borrowed;
+};
+
+HnswANNS::HnswANNS() : impl_(std::make_unique<Impl>()), built_(false) {
+    metrics_.reset();
+    query_counters_.reset();
+}
+
+HnswANNS::~HnswANNS() = default;
+
+std::string HnswANNS::version() const {
+    return "1.0.0";
+}
+
+std::string HnswANNS::description() const {
+    return "Hierarchical Navigable Small World graph with parallel construction and soft deletes";
+}
+
+std::vector<DistanceMetric> HnswANNS::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+bool HnswANNS::supports_distance(DistanceMetric metric) const {
+    auto supported = supported_distances();
+    return std::find(supported.begin(), supported.end(), metric) != supported.end();
+}
+
+void HnswANNS::fit(const std::vector<VectorEntry>& dataset, const AlgorithmParams& params) {
+    for (const auto& entry : dataset) {
+        if (entry.second.size() != dataset.front().second.size()) {
+            throw std::runtime_error("HNSW: inconsistent vector dimensions");
+        }
+    }
+    fit(DatasetView::from_entries(dataset), params);
+}
+
+void HnswANNS::fit(const DatasetView& dataset, const AlgorithmParams& params) {
+    if (!validate_params(params)) {
+        throw std::runtime_error("HNSW: invalid build parameters");
+    }
+    metrics_.reset();
+    query_counters_.reset();
+    build_params_ = params;
+    impl_->reset();
+
+    auto build_start = std::chrono::high_resolution_clock::now();
+
+    impl_->metric = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+    impl_->configure(params.get<uint32_t>("M", kDefaultM),
+                     params.get<uint32_t>("seed", kDefaultSeed));
+    impl_->ef_construction = params.get<uint32_t>("efConstruction", kDefaultEfConstruction);
+    impl_->ef_search = params.get<uint32_t>("efSearch", kDefaultEfSearch);
+    const bool reorder = params.get<bool>("reorder", false);
+    impl_->dimension = dataset.empty()
+                           ? params.get<uint32_t>("dimension", 0u)
+                           : static_cast<uint32_t>(dataset.dimension());
+
+    build_params_.set("M", impl_->M);
+    build_params_.set("efConstruction", impl_->ef_construction);
+    build_params_.set("efSearch", impl_->ef_search);
+    build_params_.set("reorder", reorder);
+    build_params_.set("metric", static_cast<int>(impl_->metric));
+    build_params_.set("dimension", impl_->dimension);
+
+    impl_->stage_view(dataset);
+    impl_->link(0, static_cast<node_t>(impl_->nodes.size()));
+    if (reorder) {
+        impl_->reorder();
+    }
+    built_ = true;
+
+    auto build_end = std::chrono::high_resolution_clock::now();
+    metrics_.build_time_seconds = std::chrono::duration<double>(build_end - build_start).count();
+    metrics_.index_size_bytes = get_memory_usage();
+}
+
+bool HnswANNS::save(const std::string& path) const {
+    if (!built_) {
+        return false;
+    }
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    auto write = [&out](const auto& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    write(kFormatVersion);
+    write(impl_->dimension);
+    write(static_cast<uint32_t>(impl_->metric));
+    write(impl_->M);
+    write(impl_->ef_construction);
+    write(impl_->ef_search);
+    write(impl_->entry_point);
+    write(impl_->max_level);
+
+    const uint64_t node_count = impl_->nodes.size();
+    write(node_count);
+    for (node_t node = 0; node < node_count; ++node) {
+        write(impl_->labels[node]);
+        write(impl_->deleted[node]);
+        out.write(reinterpret_cast<const char*>(impl_->rows[node]),
+                  impl_->dimension * sizeof(float));
+        write(impl_->level_of(node));
+        for (const auto& links : impl_->nodes[node].links) {
+            write(static_cast<uint32_t>(links.size()));
+            out.write(reinterpret_cast<const char*>(links.data()), links.size() * sizeof(node_t));
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool HnswANNS::load(const std::string& path) {
+    metrics_.reset();
+    query_counters_.reset();
+    impl_->reset();
+    built_ = false;
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    auto read = [&in](auto& value) {
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return static_cast<bool>(in);
+    };
+
+    uint32_t version_tag = 0;
+    uint32_t metric = 0;
+    uint32_t m = 0;
+    uint64_t node_count = 0;
+    if (!read(version_tag) || version_tag != kFormatVersion ||
+        !read(impl_->dimension) || !read(metric) || !read(m) ||
+        !read(impl_->ef_construction) || !read(impl_->ef_search) ||
+        !read(impl_->entry_point) || !read(impl_->max_level) || !read(node_count) ||
+        node_count >= kNoNode) {
+        impl_->reset();
+        return false;
+    }
+    impl_->metric = static_cast<DistanceMetric>(metric);
+    impl_->configure(m, kDefaultSeed);
+    impl_->owned_rows = std::make_unique<VectorArena>(impl_->dimension);
+
+    Vector row(impl_->dimension);
+    for (uint64_t i = 0; i < node_count; ++i) {
+        VectorId label = 0;
+        uint8_t is_deleted = 0;
+        uint32_t level = 0;
+        if (!read(label) || !read(is_deleted)) {
+            impl_->reset();
+            return false;
+        }
+        in.read(reinterpret_cast<char*>(row.data()), row.size() * sizeof(float));
+        if (!read(level) || level > kMaxLevel) {
+            impl_->reset();
+            return false;
+        }
+        // A deleted record may follow the live one with its id (reordering
+        // puts them in BFS order), so it must not touch the lookup
+        const size_t slot = impl_->owned_rows->append(label, row.data());
+        const float* stored = impl_->owned_rows->row(slot);
+        const node_t node = is_deleted ? impl_->append_node(label, stored, level)
+                                       : impl_->stage(label, stored, level);
+        if (is_deleted) {
+            impl_->mark_deleted(node);
+        }
+        for (auto& links : impl_->nodes[node].links) {
+            uint32_t count = 0;
+            if (!read(count) || count > impl_->max_links(0)) {
+                impl_->reset();
+                return false;
+            }
+            links.resize(count);
+            in.read(reinterpret_cast<char*>(links.data()), count * sizeof(node_t));
+        }
+    }
+
+    // Reject links or an entry point that fall outside the graph
+    bool valid = static_cast<bool>(in) &&
+                 (node_count == 0 ? impl_->entry_point == kNoNode
+                                  : impl_->entry_point < node_count &&
+                                        impl_->level_of(impl_->entry_point) == impl_->max_level);
+    for (node_t node = 0; valid && node < node_count; ++node) {
+        const auto& layers = impl_->nodes[node].links;
+        for (uint32_t l = 0; valid && l < layers.size(); ++l) {
+            for (node_t neighbor : layers[l]) {
+                if (neighbor >= node_count || impl_->level_of(neighbor) < l) {
+                    valid = false;
+                    break;
+                }
+            }
+        }
+    }
+    if (!valid) {
+        impl_->reset();
+        return false;
+    }
+
+    build_params_ = AlgorithmParams{};
+    build_params_.set("M", impl_->M);
+    build_params_.set("efConstruction", impl_->ef_construction);
+    build_params_.set("efSearch", impl_->ef_search);
+    build_params_.set("metric", static_cast<int>(impl_->metric));
+    build_params_.set("dimension", impl_->dimension);
+    built_ = true;
+    return true;
+}
+
+ANNSResult HnswANNS::query(const Vector& query_vector, const QueryConfig& config) const {
+    if (!built_ || impl_->dimension == 0) {
+        return {};
+    }
+    if (query_vector.size() != impl_->dimension) {
+        throw std::runtime_error("HNSW: query dimension mismatch");
+    }
+    const uint32_t ef = config.algorithm_params.get<uint32_t>("efSearch", impl_->ef_search);
+
+    size_t computed = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    auto result = impl_->search_single(query_vector.data(), config.k, ef,
+                                       config.prefetch_depth, config.return_distances,
+                                       computed);
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed);
+    return result;
+}
+
+std::vector<ANNSResult> HnswANNS::batch_query(const std::vector<Vector>& query_vectors,
+                                              const QueryConfig& config) const {
+    if (!built_ || impl_->dimension == 0) {
+        return std::vector<ANNSResult>(query_vectors.size());
+    }
+    for (const auto& query : query_vectors) {
+        if (query.size() != impl_->dimension) {
+            throw std::runtime_error("HNSW: query dimension mismatch");
+        }
+    }
+    const uint32_t ef = config.algorithm_params.get<uint32_t>("efSearch", impl_->ef_search);
+
+    std::vector<ANNSResult> results(query_vectors.size());
+    std::atomic<size_t> computed{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, query_vectors.size(), [&](size_t i) {
+        size_t local = 0;
+        results[i] = impl_->search_single(query_vectors[i].data(), config.k, ef,
+                                          config.prefetch_depth, config.return_distances,
+                                          local);
+        computed.fetch_add(local, std::memory_order_relaxed);
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed.load());
+    return results;
+}
+
+void HnswANNS::batch_query(const QueryMatrix& queries,
+                           const QueryConfig& config,
+                           const QueryOutput& output) const {
+    if (!built_ || impl_->dimension == 0) {
+        for (size_t i = 0; i < queries.rows; ++i) {
+            output.finish(i, config.k, 0);
+        }
+        return;
+    }
+    if (queries.dimension != impl_->dimension) {
+        throw std::runtime_error("HNSW: query dimension mismatch");
+    }
+    const uint32_t ef = config.algorithm_params.get<uint32_t>("efSearch", impl_->ef_search);
+
+    std::atomic<size_t> computed{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, queries.rows, [&](size_t i) {
+        size_t local = 0;
+        const auto hits = impl_->search(queries.row(i), config.k, ef, config.prefetch_depth,
+                                        local);
+        VectorId* ids = output.ids + i * config.k;
+        float* distances = output.distances ? output.distances + i * config.k : nullptr;
+        for (size_t j = 0; j < hits.size(); ++j) {
+            ids[j] = impl_->labels[hits[j].second];
+            if (distances) {
+                distances[j] = impl_->key_to_distance(hits[j].first);
+            }
+        }
+        output.finish(i, config.k, hits.size());
+        computed.fetch_add(local, std::memory_order_relaxed);
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed.load());
+}
+
+void HnswANNS::add_vector(const VectorEntry& entry) {
+    add_vectors(std::vector<VectorEntry>{entry});
+}
+
+void HnswANNS::add_vectors(const std::vector<VectorEntry>& entries) {
+    for (const auto& entry : entries) {
+        if (entry.second.size() != impl_->dimension) {
+            throw std::runtime_error("HNSW: vector dimension mismatch");
+        }
+    }
+    add_vectors(DatasetView::from_entries(entries));
+}
+
+void HnswANNS::add_vectors(const DatasetView& entries) {
+    if (!built_) {
+        throw std::runtime_error("HNSW: index not built");
+    }
+    if (entries.empty()) {
+        return;
+    }
+    if (entries.dimension() != impl_->dimension) {
+        throw std::runtime_error("HNSW: vector dimension mismatch");
+    }
+    const auto first = static_cast<node_t>(impl_->nodes.size());
+    impl_->stage_view(entries);
+    impl_->link(first, static_cast<node_t>(impl_->nodes.size()));
+}
+
+void HnswANNS::remove_vector(VectorId id) {
+    auto it = impl_->lookup.find(id);
+    if (it == impl_->lookup.end()) {
+        return;
+    }
+    impl_->mark_deleted(it->second);
+    impl_->lookup.erase(it);
+}
+
+void HnswANNS::remove_vectors(const std::vector<VectorId>& ids) {
+    for (auto id : ids) {
+        remove_vector(id);
+    }
+}
+
+size_t HnswANNS::get_index_size() const {
+    return impl_->nodes.size() - impl_->deleted_count;
+}
+
+size_t HnswANNS::get_memory_usage() const {
+    // Borrowed rows belong to whoever shared them and are not counted
+    size_t total = impl_->owned_rows ? impl_->owned_rows->memory_usage() : 0;
+    for (const auto& node : impl_->nodes) {
+        for (const auto& links : node.links) {
+            total += links.capacity() * sizeof(node_t);
+        }
+    }
+    total += impl_->nodes.size() *
+             (sizeof(Impl::Node) + sizeof(std::mutex) + sizeof(const float*) +
+              sizeof(VectorId) + sizeof(uint8_t));
+    total += impl_->inv_norms.size() * sizeof(float);
+    total += impl_->lookup.size() * (sizeof(VectorId) + sizeof(node_t));
+    return total;
+}
+
+std::unordered_map<std::string, std::string> HnswANNS::get_build_params() const {
+    return build_params_.params;
+}
+
+ANNSMetrics HnswANNS::get_metrics() const {
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    metrics.additional_metrics["deleted_nodes"] = static_cast<double>(impl_->deleted_count);
+    metrics.additional_metrics["max_level"] = static_cast<double>(impl_->max_level);
+    return metrics;
+}
+
+bool HnswANNS::validate_params(const AlgorithmParams& params) const {
+    const auto M = params.get<uint32_t>("M", kDefaultM);
+    const auto efC = params.get<uint32_t>("efConstruction", kDefaultEfConstruction);
+    const auto efS = params.get<uint32_t>("efSearch", kDefaultEfSearch);
+    const auto metric = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+    return M >= 2 && efC > 0 && efS > 0 && supports_distance(metric);
+}
+
+AlgorithmParams HnswANNS::get_default_params() const {
+    AlgorithmParams defaults;
+    defaults.set("M", kDefaultM);
+    defaults.set("efConstruction", kDefaultEfConstruction);
+    defaults.set("efSearch", kDefaultEfSearch);
+    defaults.set("seed", kDefaultSeed);
+    defaults.set("reorder", false);
+    defaults.set("metric", static_cast<int>(DistanceMetric::L2));
+    return defaults;
+}
+
+QueryConfig HnswANNS::get_default_query_config() const {
+    QueryConfig config;
+    config.k = 10;
+    config.return_distances = true;
+    config.algorithm_params = AlgorithmParams{};
+    return config;
+}
+
+std::unique_ptr<ANNSAlgorithm> HnswANNSFactory::create() const {
+    return std::make_unique<HnswANNS>();
+}
+
+std::string HnswANNSFactory::algorithm_description() const {
+    return "Native HNSW graph index (no FAISS dependency)";
+}
+
+std::vector<DistanceMetric> HnswANNSFactory::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+AlgorithmParams HnswANNSFactory::default_build_params() const {
+    return HnswANNS().get_default_params();
+}
+
+QueryConfig HnswANNSFactory::default_query_config() const {
+    return HnswANNS().get_default_query_config();
+}
+
+}  // namespace anns
+}  // namespace sage_db
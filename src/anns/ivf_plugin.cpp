@@ -0,0 +1,1074 @@
+#include "sage_db/anns/ivf_plugin.h"
+
+#include "sage_db/anns/kmeans.h"
+#include "sage_db/anns/pq_fast_scan.h"
+#include "sage_db/anns/pre_transform.h"
+#include "sage_db/anns/product_quantizer.h"
+#include "sage_db/anns/rabitq.h"
+#include "sage_db/anns/scalar_quantizer.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/thread_pool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <numeric>
+#include <queue>
+#include <random>
+#include <stdexcept>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+REGISTER_ANNS_ALGORITHM(IvfANNSFactory);
+
+// 2 added fast_scan and rerank, 3 rabitq storage, 4 the pre-transform
+constexpr uint32_t kFormatVersion = 4;
+constexpr uint32_t kDefaultNlist = 100;
+constexpr uint32_t kDefaultNbits = 8;
+constexpr uint32_t kDefaultIterations = 20;
+constexpr uint32_t kDefaultBatch = 8192;
+constexpr uint32_t kDefaultPointsPerCentroid = 256;
+constexpr uint32_t kDefaultSeed = 1234;
+constexpr uint32_t kDefaultNprobe = 8;
+constexpr uint32_t kDefaultRerank = 0;
+constexpr uint32_t kDefaultRabitqBits = 1;
+constexpr size_t kAddBlock = 4096;  // vectors packed and encoded per step
+
+void normalize(float* row, size_t dim) {
+    const float norm_sq = simd::norm_squared(row, dim);
+    if (norm_sq > 0.0f) {
+        const float inv = 1.0f / std::sqrt(norm_sq);
+        for (size_t d = 0; d < dim; ++d) {
+            row[d] *= inv;
+        }
+    }
+}
+}  // namespace
+
+class IvfANNS::Impl {
+public:
+    using KeyAndId = std::pair<float, VectorId>;
+
+    struct InvertedList {
+        std::vector<VectorId> ids;
+        std::vector<float> vectors;   // IVF-Flat, or IVF-PQ re-ranking: dimension floats per entry
+        std::vector<uint8_t> codes;   // IVF-PQ: m bytes per entry; RaBitQ: code_size() bytes
+        FastScanCodes packed;         // IVF-PQ fast scan: m 4-bit codes per entry
+    };
+
+    struct Location {
+        uint32_t list;
+        uint32_t offset;
+    };
+
+    void configure(const AlgorithmParams& params, uint32_t dim) {
+        metric = static_cast<DistanceMetric>(
+            params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+        dimension = dim;
+        requested_nlist = params.get<uint32_t>("nlist", kDefaultNlist);
+        m = params.get<uint32_t>("m", 0u);
+        nbits = params.get<uint32_t>("nbits", kDefaultNbits);
+        kmeans.iterations = params.get<uint32_t>("kmeans_iters", kDefaultIterations);
+        kmeans.batch_size = params.get<uint32_t>("kmeans_batch", kDefaultBatch);
+        kmeans.seed = params.get<uint32_t>("seed", kDefaultSeed);
+        points_per_centroid =
+            params.get<uint32_t>("max_points_per_centroid", kDefaultPointsPerCentroid);
+        fast_scan = params.get<bool>("fast_scan", false);
+        rerank = params.get<uint32_t>("rerank", kDefaultRerank);
+        storage = parse_storage_precision(params.get<std::string>("storage_precision", "fp32"));
+        rabitq_bits = params.get<uint32_t>("rabitq_bits", kDefaultRabitqBits);
+        if (storage != StoragePrecision::FP32 && storage != StoragePrecision::RABITQ) {
+            throw std::runtime_error("IVF: storage_precision must be fp32 or rabitq");
+        }
+        if (rabitq() && m > 0) {
+            throw std::runtime_error("IVF: rabitq storage replaces product quantization (m = 0)");
+        }
+        if (m > 0 && dimension % m != 0) {
+            throw std::runtime_error("IVF: dimension " + std::to_string(dimension) +
+                                     " is not divisible by m = " + std::to_string(m));
+        }
+        if (fast_scan && (m == 0 || nbits != 4)) {
+            throw std::runtime_error("IVF: fast_scan needs product quantization with nbits = 4");
+        }
+        pre_transform = PreTransform::from_params(params, dimension);
+        if (!pre_transform.identity() && m == 0) {
+            throw std::runtime_error("IVF: pre_transform needs product quantization (m > 0)");
+        }
+        quantizer = m > 0 ? ProductQuantizer(dimension, m, nbits) : ProductQuantizer();
+        rabitq_quantizer =
+            rabitq() ? RaBitQuantizer(dimension, rabitq_bits, kmeans.seed) : RaBitQuantizer();
+        trained = false;
+        nlist = 0;
+        centroids.clear();
+        centroid_norms.clear();
+        rotated_centroids.clear();
+        clear_lists();
+    }
+
+    bool same_structure(const AlgorithmParams& params, uint32_t dim) const {
+        return dim == dimension &&
+               static_cast<DistanceMetric>(params.get<int>(
+                   "metric", static_cast<int>(DistanceMetric::L2))) == metric &&
+               params.get<uint32_t>("nlist", kDefaultNlist) == requested_nlist &&
+               params.get<uint32_t>("m", 0u) == m &&
+               params.get<uint32_t>("nbits", kDefaultNbits) == nbits &&
+               params.get<bool>("fast_scan", false) == fast_scan &&
+               params.get<uint32_t>("rerank", kDefaultRerank) == rerank &&
+               params.get<std::string>("storage_precision", "fp32") ==
+                   storage_precision_name(storage) &&
+               params.get<uint32_t>("rabitq_bits", kDefaultRabitqBits) == rabitq_bits &&
+               same_pre_transform(params, dim);
+    }
+
+    bool same_pre_transform(const AlgorithmParams& params, uint32_t dim) const {
+        const PreTransform requested = PreTransform::from_params(params, dim);
+        return requested.kind() == pre_transform.kind() &&
+               (requested.identity() || requested.iterations() == pre_transform.iterations());
+    }
+
+    void clear_lists() {
+        lists.assign(nlist, InvertedList{});
+        if (fast()) {
+            for (auto& list : lists) {
+                list.packed = FastScanCodes(m);
+            }
+        }
+        locations.clear();
+    }
+
+    bool pq() const { return m > 0; }
+    bool fast() const { return pq() && fast_scan; }
+    bool rabitq() const { return storage == StoragePrecision::RABITQ; }
+    bool quantized() const { return pq() || rabitq(); }
+    // Bytes per entry in InvertedList::codes
+    size_t code_bytes() const {
+        return fast() ? 0 : pq() ? m : rabitq() ? rabitq_quantizer.code_size() : 0;
+    }
+    // Quantized lists keep float rows only when they re-rank
+    bool keeps_rows() const { return !quantized() || rerank > 0; }
+
+    // P c for every list, so an L2 query rotates once: P (q - c) = P q - P c
+    void rotate_centroids() {
+        rotated_centroids.resize(static_cast<size_t>(nlist) * dimension);
+        for (uint32_t c = 0; c < nlist; ++c) {
+            rabitq_quantizer.rotate(centroids.data() + static_cast<size_t>(c) * dimension,
+                                    rotated_centroids.data() + static_cast<size_t>(c) * dimension);
+        }
+    }
+
+    // Copies rows [first, first + count) of the view into dst, normalizing
+    // them for cosine so every metric reduces to L2 or inner product.
+    void pack(const DatasetView& view, const size_t* indices, size_t count, float* dst) const {
+        for (size_t i = 0; i < count; ++i) {
+            const float* row = view.row(indices[i]);
+            std::copy(row, row + dimension, dst + i * dimension);
+            if (metric == DistanceMetric::COSINE) {
+                normalize(dst + i * dimension, dimension);
+            }
+        }
+    }
+
+    // Learns the pre-transform, the coarse quantizer and, for IVF-PQ, the
+    // residual codebooks; all but the pre-transform see transformed rows
+    void train_on(const DatasetView& view) {
+        const size_t limit = static_cast<size_t>(points_per_centroid) *
+                             std::max<uint32_t>(requested_nlist, 1);
+        std::vector<size_t> indices(view.size());
+        std::iota(indices.begin(), indices.end(), 0);
+        if (indices.size() > limit) {
+            std::mt19937 rng(kmeans.seed);
+            std::shuffle(indices.begin(), indices.end(), rng);
+            indices.resize(limit);
+        }
+        const size_t n = indices.size();
+        std::vector<float> sample(n * dimension);
+        pack(view, indices.data(), n, sample.data());
+        if (!pre_transform.identity()) {
+            pre_transform.train(sample.data(), n, m, nbits, kmeans);
+            pre_transform.apply(sample.data(), n);
+        }
+
+        nlist = static_cast<uint32_t>(std::max<size_t>(1, std::min<size_t>(requested_nlist, n)));
+        centroids = train_kmeans(sample.data(), n, dimension, nlist, kmeans);
+        if (metric == DistanceMetric::COSINE) {
+            for (uint32_t c = 0; c < nlist; ++c) {
+                normalize(centroids.data() + c * dimension, dimension);
+            }
+        }
+        centroid_norms.resize(nlist);
+        for (uint32_t c = 0; c < nlist; ++c) {
+            centroid_norms[c] = simd::norm_squared(centroids.data() + c * dimension, dimension);
+        }
+
+        if (pq()) {
+            std::vector<uint32_t> labels(n);
+            assign(sample.data(), n, labels.data());
+            for (size_t i = 0; i < n; ++i) {
+                const float* centroid = centroids.data() + labels[i] * dimension;
+                float* row = sample.data() + i * dimension;
+                for (size_t d = 0; d < dimension; ++d) {
+                    row[d] -= centroid[d];
+                }
+            }
+            quantizer.train(sample.data(), n, kmeans);
+        }
+        if (rabitq()) {
+            rotate_centroids();
+        }
+        trained = true;
+        clear_lists();
+    }
+
+    // L2 lists by nearest centroid, inner product and cosine by largest dot
+    void assign(const float* points, size_t n, uint32_t* labels) const {
+        assign_nearest(points, n, dimension, centroids.data(), centroid_norms.data(), nlist,
+                       metric != DistanceMetric::L2, labels);
+    }
+
+    void encode(const float* row, uint32_t list, uint8_t* code) const {
+        const float* centroid = centroids.data() + static_cast<size_t>(list) * dimension;
+        std::vector<float> residual(dimension);
+        for (size_t d = 0; d < dimension; ++d) {
+            residual[d] = row[d] - centroid[d];
+        }
+        if (rabitq()) {
+            rabitq_quantizer.encode(residual.data(), code);
+        } else {
+            quantizer.encode(residual.data(), code);
+        }
+    }
+
+    void add(const DatasetView& view) {
+        if (!trained) {
+            train_on(view);
+        }
+        std::vector<size_t> indices(kAddBlock);
+        std::vector<float> block(kAddBlock * dimension);
+        std::vector<uint32_t> labels(kAddBlock);
+        const size_t stride = quantized() ? std::max<size_t>(code_bytes(), m) : 0;
+        std::vector<uint8_t> codes(kAddBlock * stride);
+        for (size_t first = 0; first < view.size(); first += kAddBlock) {
+            const size_t count = std::min(kAddBlock, view.size() - first);
+            std::iota(indices.begin(), indices.begin() + count, first);
+            pack(view, indices.data(), count, block.data());
+            pre_transform.apply(block.data(), count);
+            assign(block.data(), count, labels.data());
+            if (quantized()) {
+                ThreadPool::global()->parallel_for(0, count, [&](size_t i) {
+                    encode(block.data() + i * dimension, labels[i], codes.data() + i * stride);
+                });
+            }
+            for (size_t i = 0; i < count; ++i) {
+                const VectorId id = view.id(first + i);
+                remove(id);  // re-adding an id replaces its entry
+                auto& list = lists[labels[i]];
+                locations[id] = {labels[i], static_cast<uint32_t>(list.ids.size())};
+                list.ids.push_back(id);
+                if (fast()) {
+                    list.packed.push_back(codes.data() + i * stride);
+                } else if (quantized()) {
+                    list.codes.insert(list.codes.end(), codes.begin() + i * stride,
+                                      codes.begin() + i * stride + code_bytes());
+                }
+                if (keeps_rows()) {
+                    list.vectors.insert(list.vectors.end(), block.begin() + i * dimension,
+                                        block.begin() + (i + 1) * dimension);
+                }
+            }
+        }
+    }
+
+    // Swaps the last entry of the list into the hole
+    bool remove(VectorId id) {
+        auto it = locations.find(id);
+        if (it == locations.end()) {
+            return false;
+        }
+        auto& list = lists[it->second.list];
+        const size_t offset = it->second.offset;
+        const size_t last = list.ids.size() - 1;
+        if (offset != last) {
+            list.ids[offset] = list.ids[last];
+            const size_t bytes = code_bytes();
+            std::copy_n(list.codes.begin() + last * bytes, bytes,
+                        list.codes.begin() + offset * bytes);
+            if (keeps_rows()) {
+                std::copy_n(list.vectors.begin() + last * dimension, dimension,
+                            list.vectors.begin() + offset * dimension);
+            }
+            locations[list.ids[offset]].offset = static_cast<uint32_t>(offset);
+        }
+        list.ids.pop_back();
+        if (fast()) {
+            list.packed.remove(offset);
+        } else {
+            list.codes.resize(last * code_bytes());
+        }
+        if (keeps_rows()) {
+            list.vectors.resize(last * dimension);
+        }
+        locations.erase(it);
+        return true;
+    }
+
+    // Lower is better: squared L2, or negated dot for inner product/cosine
+    float coarse_key(const float* query, uint32_t list) const {
+        const float* centroid = centroids.data() + static_cast<size_t>(list) * dimension;
+        return metric == DistanceMetric::L2 ? simd::l2_squared(query, centroid, dimension)
+                                            : -simd::inner_product(query, centroid, dimension);
+    }
+
+    float key_to_distance(float key) const {
+        switch (metric) {
+            case DistanceMetric::L2:
+                return std::sqrt(std::max(0.0f, key));
+            case DistanceMetric::INNER_PRODUCT:
+                return -key;
+            case DistanceMetric::COSINE:
+                return 1.0f + key;
+        }
+        return key;
+    }
+
+    // Lower is better, as coarse_key
+    float exact_key(const float* query, const float* row) const {
+        return metric == DistanceMetric::L2 ? simd::l2_squared(query, row, dimension)
+                                            : -simd::inner_product(query, row, dimension);
+    }
+
+    // Best hits nearest first. Quantized lists with stored rows re-score
+    // their best max(k, rerank) estimates on them when rerank > 0; RaBitQ
+    // ranks that pool by lower bound and stops once no bound can beat the
+    // k-th exact distance. reranked counts the rows scored exactly.
+    std::vector<KeyAndId> search(const float* query_in, uint32_t k, uint32_t nprobe,
+                                 uint32_t rerank_count, size_t& computed,
+                                 size_t& reranked) const {
+        if (!trained || k == 0 || locations.empty()) {
+            return {};
+        }
+        std::vector<float> normalized;
+        const float* query = query_in;
+        if (metric == DistanceMetric::COSINE) {
+            normalized.assign(query_in, query_in + dimension);
+            normalize(normalized.data(), dimension);
+            query = normalized.data();
+        }
+        std::vector<float> transformed;
+        if (!pre_transform.identity()) {
+            transformed.resize(dimension);
+            pre_transform.apply(query, transformed.data());
+            query = transformed.data();
+        }
+
+        std::vector<std::pair<float, uint32_t>> probes(nlist);
+        for (uint32_t c = 0; c < nlist; ++c) {
+            probes[c] = {coarse_key(query, c), c};
+        }
+        computed += nlist;
+        const size_t probe_count = std::clamp<size_t>(nprobe, 1, nlist);
+        std::partial_sort(probes.begin(), probes.begin() + probe_count, probes.end());
+
+        const bool reranking = quantized() && keeps_rows() && rerank_count > 0;
+        const size_t pool = reranking ? std::max(k, rerank_count) : k;
+        std::priority_queue<KeyAndId> top;
+        auto push = [&top, pool](float key, VectorId id) {
+            if (top.size() < pool) {
+                top.emplace(key, id);
+            } else if (key < top.top().first) {
+                top.pop();
+                top.emplace(key, id);
+            }
+        };
+
+        // Inner-product tables and RaBitQ targets do not depend on the
+        // list, so build them once
+        std::vector<float> table;
+        std::vector<float> residual;
+        FastScanTable fast_table;
+        std::vector<uint16_t> sums;
+        RaBitQuantizer::Query target;
+        if (pq()) {
+            table.resize(quantizer.table_size());
+            if (metric != DistanceMetric::L2) {
+                quantizer.compute_table(query, true, table.data());
+                if (fast()) {
+                    fast_table.quantize(table.data(), m);
+                }
+            } else {
+                residual.resize(dimension);
+            }
+        }
+        std::vector<float> rotated_query(rabitq() ? dimension : 0);
+        std::vector<float> rotated_target(rabitq() ? dimension : 0);
+        if (rabitq()) {
+            rabitq_quantizer.rotate(query, rotated_query.data());
+            if (metric != DistanceMetric::L2) {
+                rabitq_quantizer.prepare_rotated(rotated_query.data(), target);
+            }
+        }
+
+        for (size_t p = 0; p < probe_count; ++p) {
+            const uint32_t list_id = probes[p].second;
+            const auto& list = lists[list_id];
+            const size_t size = list.ids.size();
+            if (size == 0) {
+                continue;
+            }
+            computed += size;
+            if (!quantized()) {
+                for (size_t i = 0; i < size; ++i) {
+                    push(exact_key(query, list.vectors.data() + i * dimension), list.ids[i]);
+                }
+                continue;
+            }
+
+            // ADC: ||q - c - r||^2 = sum_j ||(q - c)_j - r_j||^2 and
+            // -<q, c + r> = -<q, c> - sum_j <q_j, r_j>
+            float base = 0.0f;
+            if (metric != DistanceMetric::L2) {
+                base = probes[p].first;
+            } else if (pq()) {
+                const float* centroid = centroids.data() + static_cast<size_t>(list_id) * dimension;
+                for (size_t d = 0; d < dimension; ++d) {
+                    residual[d] = query[d] - centroid[d];
+                }
+                quantizer.compute_table(residual.data(), false, table.data());
+                if (fast()) {
+                    fast_table.quantize(table.data(), m);
+                }
+            } else {
+                const float* rotated_centroid =
+                    rotated_centroids.data() + static_cast<size_t>(list_id) * dimension;
+                for (size_t d = 0; d < dimension; ++d) {
+                    rotated_target[d] = rotated_query[d] - rotated_centroid[d];
+                }
+                rabitq_quantizer.prepare_rotated(rotated_target.data(), target);
+            }
+            if (rabitq()) {
+                // ||r - t||^2 = |r|^2 + |t|^2 - 2 <r, t> with t = q - c, and
+                // -<q, c + r> = -<q, c> - <r, q>; the pool ranks lower bounds
+                const size_t bytes = code_bytes();
+                const uint8_t* code = list.codes.data();
+                for (size_t i = 0; i < size; ++i, code += bytes) {
+                    const auto estimate = rabitq_quantizer.estimate(target, code);
+                    float key = base - estimate.dot;
+                    float error = estimate.error;
+                    if (metric == DistanceMetric::L2) {
+                        const float norm = rabitq_quantizer.residual_norm(code);
+                        key = norm * norm + target.norm * target.norm - 2.0f * estimate.dot;
+                        error *= 2.0f;
+                    }
+                    push(reranking ? key - error : key, list.ids[i]);
+                }
+                continue;
+            }
+            if (fast()) {
+                // Keys from differently scaled tables still compare as floats
+                sums.resize(list.packed.block_count() * simd::kFastScanBlock);
+                list.packed.scan(fast_table, sums.data());
+                for (size_t i = 0; i < size; ++i) {
+                    push(base + fast_table.key(sums[i]), list.ids[i]);
+                }
+                continue;
+            }
+            const uint8_t* code = list.codes.data();
+            for (size_t i = 0; i < size; ++i, code += m) {
+                push(base + quantizer.table_distance(table.data(), code), list.ids[i]);
+            }
+        }
+
+        std::vector<KeyAndId> hits(top.size());
+        for (size_t i = hits.size(); i-- > 0;) {
+            hits[i] = top.top();
+            top.pop();
+        }
+        if (!reranking) {
+            return hits;
+        }
+        auto exact_for = [&](VectorId id) {
+            const Location& at = locations.at(id);
+            return exact_key(query, lists[at.list].vectors.data() +
+                                        static_cast<size_t>(at.offset) * dimension);
+        };
+        size_t exact = 0;
+        if (!rabitq()) {
+            for (auto& [key, id] : hits) {
+                key = exact_for(id);
+            }
+            exact = hits.size();
+        } else {
+            // Hits come sorted by lower bound: once one reaches the k-th
+            // exact key, so do all after it
+            std::priority_queue<KeyAndId> best;
+            for (const auto& [bound, id] : hits) {
+                if (best.size() >= k && bound >= best.top().first) {
+                    break;
+                }
+                best.emplace(exact_for(id), id);
+                ++exact;
+                if (best.size() > k) {
+                    best.pop();
+                }
+            }
+            hits.resize(best.size());
+            for (size_t i = best.size(); i-- > 0;) {
+                hits[i] = best.top();
+                best.pop();
+            }
+        }
+        computed += exact;
+        reranked += exact;
+        std::sort(hits.begin(), hits.end());
+        hits.resize(std::min<size_t>(hits.size(), k));
+        return hits;
+    }
+
+    size_t memory_usage() const {
+        size_t total = (centroids.capacity() + centroid_norms.capacity() +
+                        rotated_centroids.capacity() + quantizer.codebooks().capacity()) *
+                           sizeof(float) +
+                       pre_transform.memory_usage();
+        for (const auto& list : lists) {
+            total += list.ids.capacity() * sizeof(VectorId) +
+                     list.vectors.capacity() * sizeof(float) + list.codes.capacity() +
+                     list.packed.memory_usage();
+        }
+        total += locations.size() * (sizeof(VectorId) + sizeof(Location));
+        return total;
+    }
+
+    void record_params(AlgorithmParams& params) const {
+        params.set("metric", static_cast<int>(metric));
+        params.set("dimension", dimension);
+        params.set("nlist", requested_nlist);
+        params.set("trained_nlist", nlist);
+        params.set("m", m);
+        params.set("nbits", nbits);
+        params.set("fast_scan", fast_scan);
+        params.set("rerank", rerank);
+        params.set("storage_precision", storage_precision_name(storage));
+        params.set("rabitq_bits", rabitq_bits);
+        pre_transform.record_params(params);
+    }
+
+    DistanceMetric metric = DistanceMetric::L2;
+    uint32_t dimension = 0;
+    uint32_t requested_nlist = kDefaultNlist;
+    uint32_t nlist = 0;       // trained lists; below requested_nlist for small samples
+    uint32_t m = 0;
+    uint32_t nbits = kDefaultNbits;
+    uint32_t points_per_centroid = kDefaultPointsPerCentroid;
+    bool fast_scan = false;   // IVF-PQ lists in the 4-bit fast-scan layout
+    uint32_t rerank = kDefaultRerank;  // default for queries; nonzero keeps quantized lists' rows
+    StoragePrecision storage = StoragePrecision::FP32;  // RABITQ: RaBitQ residual codes
+    uint32_t rabitq_bits = kDefaultRabitqBits;
+    KMeansOptions kmeans;
+    PreTransform pre_transform;  // applied to rows and queries ahead of everything else
+
+    bool trained = false;
+    std::vector<float> centroids;       // nlist x dimension
+    std::vector<float> centroid_norms;  // |c|^2
+    ProductQuantizer quantizer;         // IVF-PQ residual codebooks
+    RaBitQuantizer rabitq_quantizer;    // RaBitQ rotation, seeded by kmeans.seed
+    std::vector<float> rotated_centroids;  // RaBitQ: P c per list
+    std::vector<InvertedList> lists;
+    std::unordered_map<VectorId, Location> locations;
+};
+
+IvfANNS::IvfANNS() : impl_(std::make_unique<Impl>()), built_(false) {
+    metrics_.reset();
+    query_counters_.reset();
+}
+
+IvfANNS::~IvfANNS() = default;
+
+std::string IvfANNS::version() const {
+    return "1.0.0";
+}
+
+std::string IvfANNS::description() const {
+    return "Inverted-file index with k-means coarse quantizer and optional product quantization";
+}
+
+std::vector<DistanceMetric> IvfANNS::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+bool IvfANNS::supports_distance(DistanceMetric metric) const {
+    auto supported = supported_distances();
+    return std::find(supported.begin(), supported.end(), metric) != supported.end();
+}
+
+void IvfANNS::train(const DatasetView& training, const AlgorithmParams& params) {
+    if (!validate_params(params)) {
+        throw std::runtime_error("IVF: invalid build parameters");
+    }
+    if (training.empty()) {
+        return;
+    }
+    auto start = std::chrono::high_resolution_clock::now();
+    impl_->configure(params, static_cast<uint32_t>(training.dimension()));
+    impl_->train_on(training);
+    auto end = std::chrono::high_resolution_clock::now();
+    metrics_.additional_metrics["train_time_seconds"] =
+        std::chrono::duration<double>(end - start).count();
+}
+
+void IvfANNS::fit(const std::vector<VectorEntry>& dataset, const AlgorithmParams& params) {
+    for (const auto& entry : dataset) {
+        if (entry.second.size() != dataset.front().second.size()) {
+            throw std::runtime_error("IVF: inconsistent vector dimensions");
+        }
+    }
+    fit(DatasetView::from_entries(dataset), params);
+}
+
+void IvfANNS::fit(const DatasetView& dataset, const AlgorithmParams& params) {
+    if (!validate_params(params)) {
+        throw std::runtime_error("IVF: invalid build parameters");
+    }
+    query_counters_.reset();
+    const double train_time = metrics_.additional_metrics["train_time_seconds"];
+    metrics_.reset();
+
+    auto build_start = std::chrono::high_resolution_clock::now();
+    const uint32_t dim = dataset.empty() ? params.get<uint32_t>("dimension", 0u)
+                                         : static_cast<uint32_t>(dataset.dimension());
+    // Quantizers from train() are kept when they match; otherwise the
+    // dataset trains them itself
+    if (impl_->trained && impl_->same_structure(params, dim)) {
+        impl_->clear_lists();
+        metrics_.additional_metrics["train_time_seconds"] = train_time;
+    } else {
+        impl_->configure(params, dim);
+    }
+    if (!dataset.empty()) {
+        impl_->add(dataset);
+    }
+
+    build_params_ = params;
+    impl_->record_params(build_params_);
+    built_ = true;
+
+    auto build_end = std::chrono::high_resolution_clock::now();
+    metrics_.build_time_seconds = std::chrono::duration<double>(build_end - build_start).count();
+    metrics_.index_size_bytes = get_memory_usage();
+}
+
+bool IvfANNS::save(const std::string& path) const {
+    if (!built_) {
+        return false;
+    }
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        return false;
+    }
+    auto write = [&out](const auto& value) {
+        out.write(reinterpret_cast<const char*>(&value), sizeof(value));
+    };
+    auto write_floats = [&out](const std::vector<float>& values) {
+        out.write(reinterpret_cast<const char*>(values.data()), values.size() * sizeof(float));
+    };
+
+    write(kFormatVersion);
+    write(static_cast<uint32_t>(impl_->metric));
+    write(impl_->dimension);
+    write(impl_->requested_nlist);
+    write(impl_->nlist);
+    write(impl_->m);
+    write(impl_->nbits);
+    write(static_cast<uint8_t>(impl_->fast_scan));
+    write(impl_->rerank);
+    write(static_cast<uint32_t>(impl_->storage));
+    write(impl_->rabitq_bits);
+    write(impl_->kmeans.seed);
+    impl_->pre_transform.write(out);
+    write(static_cast<uint8_t>(impl_->trained));
+    write_floats(impl_->centroids);
+    write_floats(impl_->quantizer.codebooks());
+    for (const auto& list : impl_->lists) {
+        const uint64_t count = list.ids.size();
+        write(count);
+        out.write(reinterpret_cast<const char*>(list.ids.data()), count * sizeof(VectorId));
+        if (impl_->fast()) {
+            const auto& blocks = list.packed.data();
+            out.write(reinterpret_cast<const char*>(blocks.data()), blocks.size());
+        } else if (impl_->quantized()) {
+            out.write(reinterpret_cast<const char*>(list.codes.data()), list.codes.size());
+        }
+        if (impl_->keeps_rows()) {
+            write_floats(list.vectors);
+        }
+    }
+    return static_cast<bool>(out);
+}
+
+bool IvfANNS::load(const std::string& path) {
+    metrics_.reset();
+    query_counters_.reset();
+    built_ = false;
+
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+    auto read = [&in](auto& value) {
+        in.read(reinterpret_cast<char*>(&value), sizeof(value));
+        return static_cast<bool>(in);
+    };
+    auto read_floats = [&in](std::vector<float>& values, size_t count) {
+        values.resize(count);
+        in.read(reinterpret_cast<char*>(values.data()), count * sizeof(float));
+        return static_cast<bool>(in);
+    };
+
+    uint32_t version_tag = 0;
+    uint32_t metric = 0;
+    uint32_t dimension = 0;
+    uint32_t requested_nlist = 0;
+    uint32_t nlist = 0;
+    uint32_t m = 0;
+    uint32_t nbits = 0;
+    uint8_t fast_scan = 0;
+    uint32_t rerank = 0;
+    uint32_t storage = 0;
+    uint32_t rabitq_bits = kDefaultRabitqBits;
+    uint32_t seed = kDefaultSeed;
+    uint8_t trained = 0;
+    if (!read(version_tag) || version_tag == 0 || version_tag > kFormatVersion ||
+        !read(metric) || !read(dimension) || !read(requested_nlist) || !read(nlist) ||
+        !read(m) || !read(nbits)) {
+        return false;
+    }
+    // Version 1 files predate fast scan and re-ranking
+    if (version_tag >= 2 && (!read(fast_scan) || !read(rerank))) {
+        return false;
+    }
+    if (version_tag >= 3 && (!read(storage) || !read(rabitq_bits) || !read(seed))) {
+        return false;
+    }
+    PreTransform pre_transform(PreTransformKind::NONE, dimension, 0);
+    if (version_tag >= 4 && !pre_transform.read(in, dimension)) {
+        return false;
+    }
+    const bool rabitq = storage == static_cast<uint32_t>(StoragePrecision::RABITQ);
+    if (!read(trained) || nbits == 0 || nbits > 8 || (!pre_transform.identity() && m == 0) ||
+        (m > 0 && (dimension == 0 || dimension % m != 0)) ||
+        (fast_scan && (m == 0 || nbits != 4)) || (storage != 0 && !rabitq) ||
+        (rabitq && (m > 0 || rabitq_bits == 0 || rabitq_bits > 8))) {
+        return false;
+    }
+
+    AlgorithmParams params;
+    params.set("metric", static_cast<int>(metric));
+    params.set("nlist", requested_nlist);
+    params.set("m", m);
+    params.set("nbits", nbits);
+    params.set("fast_scan", fast_scan != 0);
+    params.set("rerank", rerank);
+    params.set("storage_precision", storage_precision_name(static_cast<StoragePrecision>(storage)));
+    params.set("rabitq_bits", rabitq_bits);
+    params.set("seed", seed);
+    pre_transform.record_params(params);
+    impl_->configure(params, dimension);
+    impl_->pre_transform = std::move(pre_transform);
+    impl_->nlist = trained ? nlist : 0;
+    impl_->trained = trained != 0;
+    if (impl_->trained) {
+        std::vector<float> codebooks;
+        if (!read_floats(impl_->centroids, static_cast<size_t>(nlist) * dimension) ||
+            !read_floats(codebooks, impl_->quantizer.codebooks().size())) {
+            impl_->configure(params, dimension);
+            return false;
+        }
+        impl_->quantizer.set_codebooks(std::move(codebooks));
+        impl_->centroid_norms.resize(nlist);
+        for (uint32_t c = 0; c < nlist; ++c) {
+            impl_->centroid_norms[c] =
+                simd::norm_squared(impl_->centroids.data() + c * dimension, dimension);
+        }
+        if (impl_->rabitq()) {
+            impl_->rotate_centroids();
+        }
+    }
+    impl_->clear_lists();
+
+    for (uint32_t l = 0; l < impl_->nlist; ++l) {
+        auto& list = impl_->lists[l];
+        uint64_t count = 0;
+        if (!read(count) || count > std::numeric_limits<uint32_t>::max()) {
+            impl_->configure(params, dimension);
+            return false;
+        }
+        list.ids.resize(count);
+        in.read(reinterpret_cast<char*>(list.ids.data()), count * sizeof(VectorId));
+        if (impl_->fast()) {
+            const size_t blocks = (count + simd::kFastScanBlock - 1) / simd::kFastScanBlock;
+            std::vector<uint8_t> packed(blocks * simd::fast_scan_block_bytes(m));
+            in.read(reinterpret_cast<char*>(packed.data()), packed.size());
+            list.packed.assign(std::move(packed), count);
+        } else if (impl_->quantized()) {
+            list.codes.resize(count * impl_->code_bytes());
+            in.read(reinterpret_cast<char*>(list.codes.data()), list.codes.size());
+        }
+        if (impl_->keeps_rows() && !read_floats(list.vectors, count * dimension)) {
+            impl_->configure(params, dimension);
+            return false;
+        }
+        for (uint32_t i = 0; i < count; ++i) {
+            impl_->locations[list.ids[i]] = {l, i};
+        }
+    }
+    if (!in) {
+        impl_->configure(params, dimension);
+        return false;
+    }
+
+    build_params_ = params;
+    impl_->record_params(build_params_);
+    built_ = true;
+    return true;
+}
+
+ANNSResult IvfANNS::query(const Vector& query_vector, const QueryConfig& config) const {
+    ANNSResult result;
+    if (!built_) {
+        return result;
+    }
+    if (query_vector.size() != impl_->dimension) {
+        throw std::runtime_error("IVF: query dimension mismatch");
+    }
+    const uint32_t nprobe = config.algorithm_params.get<uint32_t>("nprobe", kDefaultNprobe);
+    const uint32_t rerank = config.algorithm_params.get<uint32_t>("rerank", impl_->rerank);
+
+    size_t computed = 0;
+    size_t reranked = 0;
+    auto start = std::chrono::high_resolution_clock::now();
+    const auto hits =
+        impl_->search(query_vector.data(), config.k, nprobe, rerank, computed, reranked);
+    for (const auto& [key, id] : hits) {
+        result.ids.push_back(id);
+        if (config.return_distances) {
+            result.distances.push_back(impl_->key_to_distance(key));
+        }
+    }
+    result.actual_k = result.ids.size();
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed,
+                           reranked);
+    return result;
+}
+
+std::vector<ANNSResult> IvfANNS::batch_query(const std::vector<Vector>& query_vectors,
+                                             const QueryConfig& config) const {
+    std::vector<ANNSResult> results(query_vectors.size());
+    if (!built_) {
+        return results;
+    }
+    for (const auto& query : query_vectors) {
+        if (query.size() != impl_->dimension) {
+            throw std::runtime_error("IVF: query dimension mismatch");
+        }
+    }
+    const uint32_t nprobe = config.algorithm_params.get<uint32_t>("nprobe", kDefaultNprobe);
+    const uint32_t rerank = config.algorithm_params.get<uint32_t>("rerank", impl_->rerank);
+
+    std::atomic<size_t> computed{0};
+    std::atomic<size_t> reranked{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, query_vectors.size(), [&](size_t i) {
+        size_t local = 0;
+        size_t local_reranked = 0;
+        const auto hits = impl_->search(query_vectors[i].data(), config.k, nprobe, rerank, local,
+                                        local_reranked);
+        auto& result = results[i];
+        result.ids.reserve(hits.size());
+        for (const auto& [key, id] : hits) {
+            result.ids.push_back(id);
+            if (config.return_distances) {
+                result.distances.push_back(impl_->key_to_distance(key));
+            }
+        }
+        result.actual_k = result.ids.size();
+        computed.fetch_add(local, std::memory_order_relaxed);
+        reranked.fetch_add(local_reranked, std::memory_order_relaxed);
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed.load(),
+                           reranked.load());
+    return results;
+}
+
+void IvfANNS::batch_query(const QueryMatrix& queries,
+                          const QueryConfig& config,
+                          const QueryOutput& output) const {
+    if (!built_) {
+        for (size_t i = 0; i < queries.rows; ++i) {
+            output.finish(i, config.k, 0);
+        }
+        return;
+    }
+    if (queries.dimension != impl_->dimension) {
+        throw std::runtime_error("IVF: query dimension mismatch");
+    }
+    const uint32_t nprobe = config.algorithm_params.get<uint32_t>("nprobe", kDefaultNprobe);
+    const uint32_t rerank = config.algorithm_params.get<uint32_t>("rerank", impl_->rerank);
+
+    std::atomic<size_t> computed{0};
+    std::atomic<size_t> reranked{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, queries.rows, [&](size_t i) {
+        size_t local = 0;
+        size_t local_reranked = 0;
+        const auto hits =
+            impl_->search(queries.row(i), config.k, nprobe, rerank, local, local_reranked);
+        VectorId* ids = output.ids + i * config.k;
+        float* distances = output.distances ? output.distances + i * config.k : nullptr;
+        for (size_t j = 0; j < hits.size(); ++j) {
+            ids[j] = hits[j].second;
+            if (distances) {
+                distances[j] = impl_->key_to_distance(hits[j].first);
+            }
+        }
+        output.finish(i, config.k, hits.size());
+        computed.fetch_add(local, std::memory_order_relaxed);
+        reranked.fetch_add(local_reranked, std::memory_order_relaxed);
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed.load(),
+                           reranked.load());
+}
+
+void IvfANNS::add_vector(const VectorEntry& entry) {
+    add_vectors(std::vector<VectorEntry>{entry});
+}
+
+void IvfANNS::add_vectors(const std::vector<VectorEntry>& entries) {
+    for (const auto& entry : entries) {
+        if (entry.second.size() != impl_->dimension) {
+            throw std::runtime_error("IVF: vector dimension mismatch");
+        }
+    }
+    add_vectors(DatasetView::from_entries(entries));
+}
+
+void IvfANNS::add_vectors(const DatasetView& entries) {
+    if (!built_) {
+        throw std::runtime_error("IVF: index not built");
+    }
+    if (entries.empty()) {
+        return;
+    }
+    if (entries.dimension() != impl_->dimension) {
+        throw std::runtime_error("IVF: vector dimension mismatch");
+    }
+    impl_->add(entries);
+}
+
+void IvfANNS::remove_vector(VectorId id) {
+    impl_->remove(id);
+}
+
+void IvfANNS::remove_vectors(const std::vector<VectorId>& ids) {
+    for (auto id : ids) {
+        impl_->remove(id);
+    }
+}
+
+size_t IvfANNS::get_index_size() const {
+    return impl_->locations.size();
+}
+
+size_t IvfANNS::get_memory_usage() const {
+    return impl_->memory_usage();
+}
+
+std::unordered_map<std::string, std::string> IvfANNS::get_build_params() const {
+    return build_params_.params;
+}
+
+ANNSMetrics IvfANNS::get_metrics() const {
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    metrics.additional_metrics["trained_nlist"] = static_cast<double>(impl_->nlist);
+    return metrics;
+}
+
+bool IvfANNS::validate_params(const AlgorithmParams& params) const {
+    const auto nlist = params.get<uint32_t>("nlist", kDefaultNlist);
+    const auto m = params.get<uint32_t>("m", 0u);
+    const auto nbits = params.get<uint32_t>("nbits", kDefaultNbits);
+    const auto metric = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+    const bool fast_scan = params.get<bool>("fast_scan", false);
+    const auto rabitq_bits = params.get<uint32_t>("rabitq_bits", kDefaultRabitqBits);
+    StoragePrecision storage;
+    try {
+        storage = parse_storage_precision(params.get<std::string>("storage_precision", "fp32"));
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    const bool storage_ok =
+        storage == StoragePrecision::FP32 ||
+        (storage == StoragePrecision::RABITQ && m == 0 && rabitq_bits >= 1 && rabitq_bits <= 8);
+    const bool transform_ok =
+        PreTransform::valid_params(params) &&
+        (m > 0 || params.get<std::string>("pre_transform", "none") == "none");
+    return nlist > 0 && (m == 0 || (nbits >= 1 && nbits <= 8)) &&
+           (!fast_scan || (m > 0 && nbits == 4)) && storage_ok && transform_ok &&
+           supports_distance(metric);
+}
+
+AlgorithmParams IvfANNS::get_default_params() const {
+    AlgorithmParams defaults;
+    defaults.set("nlist", kDefaultNlist);
+    defaults.set("m", 0u);
+    defaults.set("nbits", kDefaultNbits);
+    defaults.set("fast_scan", false);
+    defaults.set("rerank", kDefaultRerank);
+    defaults.set("storage_precision", std::string("fp32"));
+    defaults.set("rabitq_bits", kDefaultRabitqBits);
+    PreTransform().record_params(defaults);
+    defaults.set("kmeans_iters", kDefaultIterations);
+    defaults.set("kmeans_batch", kDefaultBatch);
+    defaults.set("max_points_per_centroid", kDefaultPointsPerCentroid);
+    defaults.set("seed", kDefaultSeed);
+    defaults.set("metric", static_cast<int>(DistanceMetric::L2));
+    return defaults;
+}
+
+QueryConfig IvfANNS::get_default_query_config() const {
+    QueryConfig config;
+    config.k = 10;
+    config.return_distances = true;
+    config.algorithm_params.set("nprobe", kDefaultNprobe);
+    return config;
+}
+
+std::unique_ptr<ANNSAlgorithm> IvfANNSFactory::create() const {
+    return std::make_unique<IvfANNS>();
+}
+
+std::string IvfANNSFactory::algorithm_description() const {
+    return "Native IVF-Flat / IVF-PQ index with mini-batch k-means training";
+}
+
+std::vector<DistanceMetric> IvfANNSFactory::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+AlgorithmParams IvfANNSFactory::default_build_params() const {
+    return IvfANNS().get_default_params();
+}
+
+QueryConfig IvfANNSFactory::default_query_config() const {
+    return IvfANNS().get_default_query_config();
+}
+
+}  // namespace anns
+}  // namespace sage_db
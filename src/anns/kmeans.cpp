@@ -0,0 +1,177 @@
+#include "sage_db/anns/kmeans.h"
+
+#include "sage_db/simd/batch_distance.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/thread_pool.h"
+
+#include <algorithm>
+#include <limits>
+#include <numeric>
+#include <random>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+
+constexpr size_t kPointBlock = 64;
+constexpr size_t kCentroidBlock = 1024;
+constexpr float kSplitEpsilon = 1.0f / 1024.0f;
+
+std::vector<float> squared_norms(const float* rows, size_t count, size_t dim) {
+    std::vector<float> norms(count);
+    for (size_t i = 0; i < count; ++i) {
+        norms[i] = simd::norm_squared(rows + i * dim, dim);
+    }
+    return norms;
+}
+
+// Moves empty centroids next to the most populated one, splitting it in two
+void split_empty(std::vector<float>& centroids, std::vector<size_t>& counts, size_t dim) {
+    const size_t k = counts.size();
+    for (size_t c = 0; c < k; ++c) {
+        if (counts[c] != 0) {
+            continue;
+        }
+        const size_t big = static_cast<size_t>(
+            std::max_element(counts.begin(), counts.end()) - counts.begin());
+        if (counts[big] < 2) {
+            return;
+        }
+        float* target = centroids.data() + c * dim;
+        float* source = centroids.data() + big * dim;
+        for (size_t d = 0; d < dim; ++d) {
+            const float sign = d % 2 == 0 ? 1.0f : -1.0f;
+            target[d] = source[d] * (1.0f + sign * kSplitEpsilon);
+            source[d] = source[d] * (1.0f - sign * kSplitEpsilon);
+        }
+        counts[c] = counts[big] / 2;
+        counts[big] -= counts[c];
+    }
+}
+
+}  // namespace
+
+void assign_nearest(const float* points, size_t n, size_t dim,
+                    const float* centroids, const float* centroid_norms_sq, size_t k,
+                    bool by_inner_product, uint32_t* labels) {
+    const size_t blocks = (n + kPointBlock - 1) / kPointBlock;
+    ThreadPool::global()->parallel_for(0, blocks, [&](size_t block) {
+        const size_t p0 = block * kPointBlock;
+        const size_t np = std::min(kPointBlock, n - p0);
+        const size_t tile_width = std::min(kCentroidBlock, k);
+        std::vector<float> tile(np * tile_width);
+        std::vector<float> best(np, std::numeric_limits<float>::max());
+
+        for (size_t c0 = 0; c0 < k; c0 += kCentroidBlock) {
+            const size_t nc = std::min(kCentroidBlock, k - c0);
+            simd::inner_product_block(points + p0 * dim, np, dim,
+                                      centroids + c0 * dim, nc, dim,
+                                      dim, tile.data(), nc, false);
+            for (size_t i = 0; i < np; ++i) {
+                const float* dots = tile.data() + i * nc;
+                for (size_t j = 0; j < nc; ++j) {
+                    // |x|^2 is the same for every centroid and is left out
+                    const float score = by_inner_product
+                                            ? -dots[j]
+                                            : centroid_norms_sq[c0 + j] - 2.0f * dots[j];
+                    if (score < best[i]) {
+                        best[i] = score;
+                        labels[p0 + i] = static_cast<uint32_t>(c0 + j);
+                    }
+                }
+            }
+        }
+    });
+}
+
+std::vector<float> train_kmeans(const float* points, size_t n, size_t dim, size_t k,
+                                const KMeansOptions& options) {
+    std::vector<float> centroids(k * dim, 0.0f);
+    if (n == 0 || k == 0) {
+        return centroids;
+    }
+
+    std::mt19937 rng(options.seed);
+    std::vector<size_t> order(n);
+    std::iota(order.begin(), order.end(), 0);
+    std::shuffle(order.begin(), order.end(), rng);
+    for (size_t c = 0; c < k; ++c) {
+        const float* src = points + order[c % n] * dim;
+        std::copy(src, src + dim, centroids.begin() + c * dim);
+    }
+    if (n <= k) {
+        return centroids;
+    }
+
+    const size_t batch = std::max<size_t>(options.batch_size, k);
+    const bool full_batch = n <= batch;
+    std::vector<float> packed;
+    std::vector<uint32_t> labels(full_batch ? n : batch);
+    std::vector<float> sums(k * dim);
+    std::vector<size_t> batch_counts(k);
+    std::vector<size_t> seen(k, 0);  // mini-batch learning-rate denominators
+
+    for (size_t iter = 0; iter < options.iterations; ++iter) {
+        const float* sample = points;
+        if (!full_batch) {
+            packed.resize(batch * dim);
+            std::uniform_int_distribution<size_t> pick(0, n - 1);
+            for (size_t i = 0; i < batch; ++i) {
+                const float* src = points + pick(rng) * dim;
+                std::copy(src, src + dim, packed.begin() + i * dim);
+            }
+            sample = packed.data();
+        }
+        const size_t count = labels.size();
+
+        const auto norms = squared_norms(centroids.data(), k, dim);
+        assign_nearest(sample, count, dim, centroids.data(), norms.data(), k, false,
+                       labels.data());
+
+        std::fill(sums.begin(), sums.end(), 0.0f);
+        std::fill(batch_counts.begin(), batch_counts.end(), 0);
+        for (size_t i = 0; i < count; ++i) {
+            float* sum = sums.data() + labels[i] * dim;
+            const float* row = sample + i * dim;
+            for (size_t d = 0; d < dim; ++d) {
+                sum[d] += row[d];
+            }
+            ++batch_counts[labels[i]];
+        }
+
+        ThreadPool::global()->parallel_for(0, k, [&](size_t c) {
+            const size_t members = batch_counts[c];
+            if (members == 0) {
+                return;
+            }
+            float* centroid = centroids.data() + c * dim;
+            const float* sum = sums.data() + c * dim;
+            if (full_batch) {
+                const float inv = 1.0f / static_cast<float>(members);
+                for (size_t d = 0; d < dim; ++d) {
+                    centroid[d] = sum[d] * inv;
+                }
+                return;
+            }
+            // c += (sum - members * c) / seen, i.e. a running mean of every
+            // point this centroid has absorbed so far
+            seen[c] += members;
+            const float rate = 1.0f / static_cast<float>(seen[c]);
+            for (size_t d = 0; d < dim; ++d) {
+                centroid[d] += rate * (sum[d] - static_cast<float>(members) * centroid[d]);
+            }
+        });
+
+        if (full_batch) {
+            split_empty(centroids, batch_counts, dim);
+        }
+    }
+    if (!full_batch) {
+        split_empty(centroids, seen, dim);
+    }
+    return centroids;
+}
+
+} // namespace anns
+} // namespace sage_db
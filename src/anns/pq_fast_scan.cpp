@@ -0,0 +1,104 @@
+#include "sage_db/anns/pq_fast_scan.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+namespace sage_db {
+namespace anns {
+
+void FastScanTable::quantize(const float* table, size_t m) {
+    luts.assign(simd::fast_scan_pairs(m) * 2 * 16, 0);
+    bias = 0.0f;
+    float span = 0.0f;
+    for (size_t j = 0; j < m; ++j) {
+        const auto [low, high] = std::minmax_element(table + j * 16, table + (j + 1) * 16);
+        bias += *low;
+        span = std::max(span, *high - *low);
+    }
+    // m * top must fit the uint16 accumulators
+    const float top = static_cast<float>(
+        std::min<size_t>(255, std::numeric_limits<uint16_t>::max() / std::max<size_t>(m, 1)));
+    if (span <= 0.0f) {
+        inv_scale = 0.0f;
+        return;
+    }
+    const float scale = top / span;
+    inv_scale = span / top;
+    for (size_t j = 0; j < m; ++j) {
+        const float* row = table + j * 16;
+        const float low = *std::min_element(row, row + 16);
+        for (size_t c = 0; c < 16; ++c) {
+            luts[j * 16 + c] = static_cast<uint8_t>(
+                std::clamp(std::round((row[c] - low) * scale), 0.0f, top));
+        }
+    }
+}
+
+void FastScanCodes::push_back(const uint8_t* code) {
+    if (size_ % simd::kFastScanBlock == 0) {
+        data_.resize(data_.size() + simd::fast_scan_block_bytes(m_), 0);
+    }
+    ++size_;
+    set(size_ - 1, code);
+}
+
+void FastScanCodes::set(size_t index, const uint8_t* code) {
+    uint8_t* block = data_.data() + (index / simd::kFastScanBlock) * simd::fast_scan_block_bytes(m_);
+    const size_t lane = index % simd::kFastScanBlock;
+    for (size_t p = 0; p < simd::fast_scan_pairs(m_); ++p) {
+        const uint8_t low = code[2 * p] & 0x0F;
+        const uint8_t high = 2 * p + 1 < m_ ? code[2 * p + 1] & 0x0F : 0;
+        block[p * simd::kFastScanBlock + lane] = static_cast<uint8_t>(low | (high << 4));
+    }
+}
+
+void FastScanCodes::get(size_t index, uint8_t* code) const {
+    const uint8_t* block =
+        data_.data() + (index / simd::kFastScanBlock) * simd::fast_scan_block_bytes(m_);
+    const size_t lane = index % simd::kFastScanBlock;
+    for (size_t j = 0; j < m_; ++j) {
+        const uint8_t byte = block[(j / 2) * simd::kFastScanBlock + lane];
+        code[j] = j % 2 == 0 ? byte & 0x0F : byte >> 4;
+    }
+}
+
+void FastScanCodes::remove(size_t index) {
+    const size_t last = size_ - 1;
+    std::vector<uint8_t> code(m_);
+    if (index != last) {
+        get(last, code.data());
+        set(index, code.data());
+    }
+    std::fill(code.begin(), code.end(), uint8_t{0});
+    set(last, code.data());  // padding lanes stay zero
+    --size_;
+    data_.resize(block_count() * simd::fast_scan_block_bytes(m_));
+}
+
+void FastScanCodes::clear() {
+    size_ = 0;
+    data_.clear();
+}
+
+void FastScanCodes::reserve(size_t count) {
+    const size_t blocks = (count + simd::kFastScanBlock - 1) / simd::kFastScanBlock;
+    data_.reserve(blocks * simd::fast_scan_block_bytes(m_));
+}
+
+void FastScanCodes::scan(const FastScanTable& table, uint16_t* sums) const {
+    simd::fast_scan_accumulate(data_.data(), block_count(), m_, table.luts.data(), sums);
+}
+
+bool FastScanCodes::assign(std::vector<uint8_t> data, size_t size) {
+    const size_t blocks = (size + simd::kFastScanBlock - 1) / simd::kFastScanBlock;
+    if (data.size() != blocks * simd::fast_scan_block_bytes(m_)) {
+        return false;
+    }
+    data_ = std::move(data);
+    size_ = size;
+    return true;
+}
+
+}  // namespace anns
+}  // namespace sage_db
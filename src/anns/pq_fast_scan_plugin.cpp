@@ -0,0 +1,666 @@
+#include "sage_db/anns/pq_fast_scan_plugin.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/thread_pool.h"
+#include <fstream>
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <chrono>
+#include <cstdint>
+#include <numeric>
+#include <random>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+REGISTER_ANNS_ALGORITHM(PQFastScanANNSFactory);
+
+// owned_slots_ marker for rows borrowed from a DatasetView
+constexpr size_t kBorrowed = SIZE_MAX;
+constexpr uint32_t kDefaultRerank = 100;
+constexpr uint32_t kDefaultTrainPoints = 65536;
+constexpr uint32_t kDefaultIterations = 20;
+constexpr uint32_t kDefaultSeed = 1234;
+constexpr size_t kNbits = 4;
+
+void normalize(float* row, size_t dim) {
+    const float norm_sq = simd::norm_squared(row, dim);
+    if (norm_sq > 0.0f) {
+        const float inv = 1.0f / std::sqrt(norm_sq);
+        for (size_t d = 0; d < dim; ++d) {
+            row[d] *= inv;
+        }
+    }
+}
+}
+
+PQFastScanANNS::PQFastScanANNS()
+    : metric_(DistanceMetric::L2),
+      dimension_(0),
+      requested_m_(0),
+      rerank_(kDefaultRerank),
+      max_train_points_(kDefaultTrainPoints),
+      trained_(false),
+      built_(false) {
+    metrics_.reset();
+    query_counters_.reset();
+}
+
+std::string PQFastScanANNS::version() const {
+    return "1.0.0";
+}
+
+std::string PQFastScanANNS::description() const {
+    return "4-bit product quantization scanned with in-register lookup tables, re-ranked on float rows";
+}
+
+std::vector<DistanceMetric> PQFastScanANNS::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+bool PQFastScanANNS::supports_distance(DistanceMetric metric) const {
+    auto metrics = supported_distances();
+    return std::find(metrics.begin(), metrics.end(), metric) != metrics.end();
+}
+
+void PQFastScanANNS::configure(const AlgorithmParams& params) {
+    if (!validate_params(params)) {
+        throw std::runtime_error("PQFastScanANNS: invalid build parameters");
+    }
+    metric_ = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2))
+    );
+    requested_m_ = params.get<uint32_t>("m", 0u);
+    rerank_ = params.get<uint32_t>("rerank", kDefaultRerank);
+    max_train_points_ = params.get<uint32_t>("max_train_points", kDefaultTrainPoints);
+    kmeans_.iterations = params.get<uint32_t>("kmeans_iters", kDefaultIterations);
+    kmeans_.seed = params.get<uint32_t>("seed", kDefaultSeed);
+    pre_transform_ = PreTransform::from_params(params, 0);
+    trained_ = false;
+}
+
+void PQFastScanANNS::fit(const std::vector<VectorEntry>& dataset,
+                         const AlgorithmParams& params) {
+    metrics_.reset();
+    query_counters_.reset();
+    configure(params);
+
+    const Dimension dimension =
+        dataset.empty() ? 0 : static_cast<Dimension>(dataset.front().second.size());
+    reset_rows(dimension, dataset.size());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    std::vector<const float*> rows;
+    rows.reserve(dataset.size());
+    for (const auto& entry : dataset) {
+        if (entry.second.size() != dimension_) {
+            throw std::runtime_error("Vector dimension mismatch in PQFastScanANNS");
+        }
+        rows.push_back(entry.second.data());
+    }
+    train(rows);
+    for (const auto& entry : dataset) {
+        append_owned(entry.first, entry.second.data());
+    }
+    auto end = std::chrono::high_resolution_clock::now();
+
+    metrics_.build_time_seconds = std::chrono::duration<double>(end - start).count();
+    metrics_.index_size_bytes = get_memory_usage();
+    built_ = true;
+}
+
+void PQFastScanANNS::fit(const DatasetView& dataset, const AlgorithmParams& params) {
+    metrics_.reset();
+    query_counters_.reset();
+    configure(params);
+    reset_rows(dataset.dimension(), dataset.size());
+
+    auto start = std::chrono::high_resolution_clock::now();
+    append_borrowed(dataset);
+    auto end = std::chrono::high_resolution_clock::now();
+
+    metrics_.build_time_seconds = std::chrono::duration<double>(end - start).count();
+    metrics_.index_size_bytes = get_memory_usage();
+    built_ = true;
+}
+
+// Rows are saved in float, as re-ranking needs them, with the codebooks
+// and pre-transform; codes are re-encoded from them on load
+bool PQFastScanANNS::save(const std::string& path) const {
+    std::ofstream out(path, std::ios::binary);
+    if (!out.is_open()) {
+        return false;
+    }
+
+    out.write(reinterpret_cast<const char*>(&dimension_), sizeof(dimension_));
+    int metric = static_cast<int>(metric_);
+    out.write(reinterpret_cast<const char*>(&metric), sizeof(metric));
+    out.write(reinterpret_cast<const char*>(&requested_m_), sizeof(requested_m_));
+    out.write(reinterpret_cast<const char*>(&rerank_), sizeof(rerank_));
+    const uint32_t m = trained_ ? static_cast<uint32_t>(quantizer_.m()) : 0u;
+    out.write(reinterpret_cast<const char*>(&m), sizeof(m));
+    if (trained_) {
+        const auto& books = quantizer_.codebooks();
+        out.write(reinterpret_cast<const char*>(books.data()), books.size() * sizeof(float));
+        pre_transform_.write(out);
+    } else {
+        PreTransform(pre_transform_.kind(), dimension_, pre_transform_.iterations()).write(out);
+    }
+
+    uint64_t count = ids_.size();
+    out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (size_t i = 0; i < ids_.size(); ++i) {
+        out.write(reinterpret_cast<const char*>(&ids_[i]), sizeof(VectorId));
+        out.write(reinterpret_cast<const char*>(rows_[i]), dimension_ * sizeof(float));
+    }
+    return static_cast<bool>(out);
+}
+
+bool PQFastScanANNS::load(const std::string& path) {
+    std::ifstream in(path, std::ios::binary);
+    if (!in.is_open()) {
+        return false;
+    }
+
+    Dimension dimension = 0;
+    in.read(reinterpret_cast<char*>(&dimension), sizeof(dimension));
+    int metric = 0;
+    in.read(reinterpret_cast<char*>(&metric), sizeof(metric));
+    uint32_t requested_m = 0;
+    in.read(reinterpret_cast<char*>(&requested_m), sizeof(requested_m));
+    uint32_t rerank = 0;
+    in.read(reinterpret_cast<char*>(&rerank), sizeof(rerank));
+    uint32_t m = 0;
+    in.read(reinterpret_cast<char*>(&m), sizeof(m));
+    if (!in || (m > 0 && (dimension == 0 || dimension % m != 0))) {
+        return false;
+    }
+    metric_ = static_cast<DistanceMetric>(metric);
+    requested_m_ = requested_m;
+    rerank_ = rerank;
+    trained_ = m > 0;
+    if (trained_) {
+        quantizer_ = ProductQuantizer(dimension, m, kNbits);
+        std::vector<float> books(quantizer_.codebooks().size());
+        in.read(reinterpret_cast<char*>(books.data()), books.size() * sizeof(float));
+        quantizer_.set_codebooks(std::move(books));
+    }
+    if (!pre_transform_.read(in, dimension)) {
+        return false;
+    }
+    uint64_t count = 0;
+    in.read(reinterpret_cast<char*>(&count), sizeof(count));
+    if (!in || (count > 0 && !trained_)) {
+        return false;
+    }
+    reset_rows(dimension, count);
+
+    Vector buffer(dimension_);
+    for (uint64_t i = 0; i < count; ++i) {
+        VectorId id = 0;
+        in.read(reinterpret_cast<char*>(&id), sizeof(id));
+        in.read(reinterpret_cast<char*>(buffer.data()), dimension_ * sizeof(float));
+        if (!in) {
+            return false;
+        }
+        append_owned(id, buffer.data());
+    }
+
+    built_ = true;
+    metrics_.reset();
+    query_counters_.reset();
+    return true;
+}
+
+ANNSMetrics PQFastScanANNS::get_metrics() const {
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    metrics.additional_metrics["m"] = trained_ ? static_cast<double>(quantizer_.m()) : 0.0;
+    return metrics;
+}
+
+ANNSResult PQFastScanANNS::query(const Vector& query_vector, const QueryConfig& config) const {
+    if (!built_) {
+        throw std::runtime_error("PQFastScanANNS index is not built");
+    }
+    if (!ids_.empty() && query_vector.size() != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in PQFastScanANNS");
+    }
+
+    thread_local std::vector<std::pair<float, VectorId>> hits;
+    auto start = std::chrono::high_resolution_clock::now();
+    const size_t computed = search(query_vector.data(), config.k, rerank_for(config), hits);
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed);
+
+    ANNSResult result;
+    result.ids.reserve(hits.size());
+    if (config.return_distances) {
+        result.distances.reserve(hits.size());
+    }
+    for (const auto& [distance, id] : hits) {
+        result.ids.push_back(id);
+        if (config.return_distances) {
+            result.distances.push_back(distance);
+        }
+    }
+    result.actual_k = hits.size();
+    return result;
+}
+
+std::vector<ANNSResult> PQFastScanANNS::batch_query(const std::vector<Vector>& query_vectors,
+                                                    const QueryConfig& config) const {
+    std::vector<ANNSResult> results(query_vectors.size());
+    ThreadPool::global()->parallel_for(0, query_vectors.size(), [&](size_t i) {
+        results[i] = query(query_vectors[i], config);
+    });
+    return results;
+}
+
+void PQFastScanANNS::batch_query(const QueryMatrix& queries,
+                                 const QueryConfig& config,
+                                 const QueryOutput& output) const {
+    if (!built_) {
+        throw std::runtime_error("PQFastScanANNS index is not built");
+    }
+    if (!ids_.empty() && queries.dimension != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in PQFastScanANNS");
+    }
+
+    const size_t k = config.k;
+    const size_t rerank = rerank_for(config);
+    std::atomic<size_t> computed{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, queries.rows, [&](size_t i) {
+        thread_local std::vector<std::pair<float, VectorId>> hits;
+        computed.fetch_add(search(queries.row(i), k, rerank, hits), std::memory_order_relaxed);
+        for (size_t j = 0; j < hits.size(); ++j) {
+            output.ids[i * k + j] = hits[j].second;
+            if (output.distances) {
+                output.distances[i * k + j] = hits[j].first;
+            }
+        }
+        output.finish(i, k, hits.size());
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(), computed.load());
+}
+
+void PQFastScanANNS::add_vector(const VectorEntry& entry) {
+    check_dimension(static_cast<Dimension>(entry.second.size()));
+    if (!trained_) {
+        train({entry.second.data()});
+    }
+    append_owned(entry.first, entry.second.data());
+    built_ = true;
+}
+
+void PQFastScanANNS::add_vectors(const std::vector<VectorEntry>& entries) {
+    if (entries.empty()) {
+        return;
+    }
+    check_dimension(static_cast<Dimension>(entries.front().second.size()));
+    if (!trained_) {
+        std::vector<const float*> rows;
+        rows.reserve(entries.size());
+        for (const auto& entry : entries) {
+            if (entry.second.size() != dimension_) {
+                throw std::runtime_error("Vector dimension mismatch in PQFastScanANNS");
+            }
+            rows.push_back(entry.second.data());
+        }
+        train(rows);
+    }
+    rows_.reserve(rows_.size() + entries.size());
+    ids_.reserve(ids_.size() + entries.size());
+    for (const auto& entry : entries) {
+        add_vector(entry);
+    }
+}
+
+void PQFastScanANNS::add_vectors(const DatasetView& entries) {
+    if (entries.empty()) {
+        return;
+    }
+    check_dimension(entries.dimension());
+    append_borrowed(entries);
+    built_ = true;
+}
+
+void PQFastScanANNS::remove_vector(VectorId id) {
+    auto it = id_to_index_.find(id);
+    if (it == id_to_index_.end()) {
+        return;
+    }
+
+    // Swap-with-last keeps the code blocks dense so scans never see holes
+    const size_t index = it->second;
+    const size_t last_index = ids_.size() - 1;
+    if (owned_slots_[index] != kBorrowed) {
+        owned_->release(owned_slots_[index]);
+    }
+    if (index != last_index) {
+        rows_[index] = rows_[last_index];
+        ids_[index] = ids_[last_index];
+        owned_slots_[index] = owned_slots_[last_index];
+        id_to_index_[ids_[index]] = index;
+    }
+    codes_.remove(index);
+    rows_.pop_back();
+    ids_.pop_back();
+    owned_slots_.pop_back();
+    id_to_index_.erase(it);
+
+    if (owned_ && owned_->dead_count() > VectorArena::kRowsPerChunk &&
+        owned_->dead_count() > owned_->live_count()) {
+        compact_owned();
+    }
+}
+
+void PQFastScanANNS::remove_vectors(const std::vector<VectorId>& ids) {
+    for (auto id : ids) {
+        remove_vector(id);
+    }
+}
+
+size_t PQFastScanANNS::get_index_size() const {
+    return ids_.size();
+}
+
+size_t PQFastScanANNS::get_memory_usage() const {
+    // Borrowed rows belong to whoever shared them and are not counted
+    const size_t node_bytes = sizeof(std::pair<const VectorId, size_t>) + 2 * sizeof(void*);
+    return (owned_ ? owned_->memory_usage() : 0) +
+           codes_.memory_usage() +
+           quantizer_.codebooks().capacity() * sizeof(float) +
+           pre_transform_.memory_usage() +
+           rows_.capacity() * sizeof(const float*) +
+           owned_slots_.capacity() * sizeof(size_t) +
+           ids_.capacity() * sizeof(VectorId) +
+           id_to_index_.bucket_count() * sizeof(void*) +
+           id_to_index_.size() * node_bytes;
+}
+
+std::unordered_map<std::string, std::string> PQFastScanANNS::get_build_params() const {
+    AlgorithmParams transform;
+    pre_transform_.record_params(transform);
+    return {{"metric", std::to_string(static_cast<int>(metric_))},
+            {"m", std::to_string(trained_ ? quantizer_.m() : requested_m_)},
+            {"rerank", std::to_string(rerank_)},
+            {"pre_transform", transform.params.at("pre_transform")},
+            {"opq_iters", transform.params.at("opq_iters")}};
+}
+
+bool PQFastScanANNS::validate_params(const AlgorithmParams& params) const {
+    const auto metric = static_cast<DistanceMetric>(
+        params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+    return params.get<uint32_t>("max_train_points", kDefaultTrainPoints) > 0 &&
+           PreTransform::valid_params(params) && supports_distance(metric);
+}
+
+AlgorithmParams PQFastScanANNS::get_default_params() const {
+    AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    params.set("m", 0u);
+    params.set("rerank", kDefaultRerank);
+    params.set("max_train_points", kDefaultTrainPoints);
+    params.set("kmeans_iters", kDefaultIterations);
+    params.set("seed", kDefaultSeed);
+    PreTransform().record_params(params);
+    return params;
+}
+
+QueryConfig PQFastScanANNS::get_default_query_config() const {
+    QueryConfig config;
+    config.k = 10;
+    config.return_distances = true;
+    return config;
+}
+
+float PQFastScanANNS::compute_distance(const float* a, const float* b) const {
+    switch (metric_) {
+        case DistanceMetric::L2:
+            return simd::l2_distance(a, b, dimension_);
+        case DistanceMetric::INNER_PRODUCT:
+            return simd::inner_product(a, b, dimension_); // higher is better
+        case DistanceMetric::COSINE:
+            return simd::cosine_distance(a, b, dimension_);
+    }
+    return 0.0f;
+}
+
+bool PQFastScanANNS::better(const std::pair<float, VectorId>& a,
+                            const std::pair<float, VectorId>& b) const {
+    if (a.first != b.first) {
+        return metric_ == DistanceMetric::INNER_PRODUCT ? a.first > b.first : a.first < b.first;
+    }
+    return a.second < b.second;
+}
+
+// Table keys are lower-is-better: squared L2, or the negated dot product
+// of (for cosine, normalized) rows
+float PQFastScanANNS::key_to_distance(float key) const {
+    switch (metric_) {
+        case DistanceMetric::L2:
+            return std::sqrt(std::max(0.0f, key));
+        case DistanceMetric::INNER_PRODUCT:
+            return -key;
+        case DistanceMetric::COSINE:
+            return 1.0f + key;
+    }
+    return key;
+}
+
+size_t PQFastScanANNS::rerank_for(const QueryConfig& config) const {
+    return config.algorithm_params.get<uint32_t>("rerank", rerank_);
+}
+
+size_t PQFastScanANNS::search(const float* query, size_t k, size_t rerank,
+                              std::vector<std::pair<float, VectorId>>& hits) const {
+    hits.clear();
+    const size_t count = ids_.size();
+    k = std::min(k, count);
+    if (k == 0) {
+        return 0;
+    }
+
+    thread_local std::vector<float> normalized;
+    thread_local std::vector<float> transformed;
+    thread_local std::vector<float> table;
+    thread_local FastScanTable quantized;
+    thread_local std::vector<uint16_t> sums;
+    thread_local std::vector<uint64_t> order;
+    const float* prepared = query;
+    if (metric_ == DistanceMetric::COSINE) {
+        normalized.assign(query, query + dimension_);
+        normalize(normalized.data(), dimension_);
+        prepared = normalized.data();
+    }
+    if (!pre_transform_.identity()) {
+        transformed.resize(dimension_);
+        pre_transform_.apply(prepared, transformed.data());
+        prepared = transformed.data();
+    }
+    table.resize(quantizer_.table_size());
+    quantizer_.compute_table(prepared, metric_ != DistanceMetric::L2, table.data());
+    quantized.quantize(table.data(), quantizer_.m());
+    sums.resize(codes_.block_count() * simd::kFastScanBlock);
+    codes_.scan(quantized, sums.data());
+
+    // (sum, index) packed in one word sorts by estimate, then by row
+    const size_t pool = std::min(count, std::max(k, rerank));
+    order.resize(count);
+    for (size_t i = 0; i < count; ++i) {
+        order[i] = (static_cast<uint64_t>(sums[i]) << 32) | i;
+    }
+    if (pool < count) {
+        std::nth_element(order.begin(), order.begin() + pool, order.end());
+    }
+
+    hits.reserve(pool);
+    if (rerank == 0) {
+        std::sort(order.begin(), order.begin() + pool);
+        for (size_t i = 0; i < k; ++i) {
+            const auto sum = static_cast<uint16_t>(order[i] >> 32);
+            hits.emplace_back(key_to_distance(quantized.key(sum)), ids_[order[i] & 0xFFFFFFFFu]);
+        }
+        return count;
+    }
+    for (size_t i = 0; i < pool; ++i) {
+        const size_t index = order[i] & 0xFFFFFFFFu;
+        hits.emplace_back(compute_distance(query, rows_[index]), ids_[index]);
+    }
+    auto by_distance = [this](const auto& a, const auto& b) { return better(a, b); };
+    std::partial_sort(hits.begin(), hits.begin() + k, hits.end(), by_distance);
+    hits.resize(k);
+    return count + pool;
+}
+
+void PQFastScanANNS::reset_rows(Dimension dimension, size_t expected) {
+    dimension_ = dimension;
+    codes_ = FastScanCodes(trained_ ? quantizer_.m() : 0);
+    rows_.clear();
+    ids_.clear();
+    owned_slots_.clear();
+    id_to_index_.clear();
+    owned_.reset();
+    borrowed_.clear();
+
+    codes_.reserve(expected);
+    rows_.reserve(expected);
+    ids_.reserve(expected);
+    owned_slots_.reserve(expected);
+    id_to_index_.reserve(expected);
+}
+
+void PQFastScanANNS::check_dimension(Dimension dimension) {
+    if (ids_.empty() && dimension_ == 0) {
+        dimension_ = dimension;
+    }
+    if (dimension != dimension_) {
+        throw std::runtime_error("Vector dimension mismatch in PQFastScanANNS");
+    }
+}
+
+void PQFastScanANNS::train(const std::vector<const float*>& rows) {
+    if (rows.empty() || dimension_ == 0) {
+        return;
+    }
+    const size_t m = requested_m_ > 0       ? requested_m_
+                     : dimension_ % 2 == 0 ? dimension_ / 2
+                                           : ProductQuantizer::default_m(dimension_);
+    quantizer_ = ProductQuantizer(dimension_, m, kNbits);
+
+    std::vector<size_t> indices(rows.size());
+    std::iota(indices.begin(), indices.end(), 0);
+    if (indices.size() > max_train_points_) {
+        std::mt19937 rng(kmeans_.seed);
+        std::shuffle(indices.begin(), indices.end(), rng);
+        indices.resize(max_train_points_);
+    }
+    std::vector<float> sample(indices.size() * dimension_);
+    for (size_t i = 0; i < indices.size(); ++i) {
+        float* dst = sample.data() + i * dimension_;
+        std::copy_n(rows[indices[i]], dimension_, dst);
+        if (metric_ == DistanceMetric::COSINE) {
+            normalize(dst, dimension_);
+        }
+    }
+    pre_transform_ = PreTransform(pre_transform_.kind(), dimension_, pre_transform_.iterations());
+    pre_transform_.train(sample.data(), indices.size(), m, kNbits, kmeans_);
+    pre_transform_.apply(sample.data(), indices.size());
+    quantizer_.train(sample.data(), indices.size(), kmeans_);
+    trained_ = true;
+    codes_ = FastScanCodes(m);
+    codes_.reserve(ids_.capacity());
+}
+
+void PQFastScanANNS::encode(const float* values, uint8_t* code) const {
+    if (metric_ != DistanceMetric::COSINE && pre_transform_.identity()) {
+        quantizer_.encode(values, code);
+        return;
+    }
+    thread_local std::vector<float> prepared;
+    prepared.assign(values, values + dimension_);
+    if (metric_ == DistanceMetric::COSINE) {
+        normalize(prepared.data(), dimension_);
+    }
+    pre_transform_.apply(prepared.data(), 1);
+    quantizer_.encode(prepared.data(), code);
+}
+
+void PQFastScanANNS::append_row(VectorId id, const float* values, size_t owned_slot) {
+    thread_local std::vector<uint8_t> code;
+    code.resize(quantizer_.m());
+    encode(values, code.data());
+    codes_.push_back(code.data());
+    rows_.push_back(values);
+    ids_.push_back(id);
+    owned_slots_.push_back(owned_slot);
+    id_to_index_[id] = ids_.size() - 1;
+}
+
+void PQFastScanANNS::append_owned(VectorId id, const float* values) {
+    if (!owned_ || owned_->dimension() != dimension_) {
+        owned_ = std::make_unique<VectorArena>(dimension_);
+    }
+    const size_t slot = owned_->append(id, values);
+    append_row(id, owned_->row(slot), slot);
+}
+
+void PQFastScanANNS::append_borrowed(const DatasetView& view) {
+    if (!trained_) {
+        train(std::vector<const float*>(view.rows(), view.rows() + view.size()));
+    }
+    if (!view.storage()) {
+        // Nobody vouches for these rows beyond this call, so copy them
+        for (size_t i = 0; i < view.size(); ++i) {
+            append_owned(view.id(i), view.row(i));
+        }
+        return;
+    }
+    if (std::find(borrowed_.begin(), borrowed_.end(), view.storage()) == borrowed_.end()) {
+        borrowed_.push_back(view.storage());
+    }
+    codes_.reserve(codes_.size() + view.size());
+    rows_.reserve(rows_.size() + view.size());
+    for (size_t i = 0; i < view.size(); ++i) {
+        append_row(view.id(i), view.row(i), kBorrowed);
+    }
+}
+
+void PQFastScanANNS::compact_owned() {
+    auto compacted = std::make_unique<VectorArena>(dimension_);
+    for (size_t i = 0; i < rows_.size(); ++i) {
+        if (owned_slots_[i] == kBorrowed) {
+            continue;
+        }
+        owned_slots_[i] = compacted->append(ids_[i], rows_[i]);
+        rows_[i] = compacted->row(owned_slots_[i]);
+    }
+    owned_ = std::move(compacted);
+}
+
+std::unique_ptr<ANNSAlgorithm> PQFastScanANNSFactory::create() const {
+    return std::make_unique<PQFastScanANNS>();
+}
+
+std::string PQFastScanANNSFactory::algorithm_description() const {
+    return "Flat 4-bit PQ fast scan with uint8 lookup tables and float re-rank";
+}
+
+std::vector<DistanceMetric> PQFastScanANNSFactory::supported_distances() const {
+    return {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE};
+}
+
+AlgorithmParams PQFastScanANNSFactory::default_build_params() const {
+    return PQFastScanANNS().get_default_params();
+}
+
+QueryConfig PQFastScanANNSFactory::default_query_config() const {
+    return PQFastScanANNS().get_default_query_config();
+}
+
+} // namespace anns
+} // namespace sage_db
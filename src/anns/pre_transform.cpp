@@ -0,0 +1,297 @@
+#include "sage_db/anns/pre_transform.h"
+
+#include "sage_db/anns/product_quantizer.h"
+#include "sage_db/simd/batch_distance.h"
+#include "sage_db/thread_pool.h"
+
+#include <algorithm>
+#include <cmath>
+#include <stdexcept>
+
+#ifdef SAGE_DB_HAVE_LAPACK
+extern "C" void sgesvd_(const char* jobu, const char* jobvt, const int* m, const int* n,
+                        float* a, const int* lda, float* s, float* u, const int* ldu,
+                        float* vt, const int* ldvt, float* work, const int* lwork, int* info);
+#endif
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+constexpr uint32_t kDefaultOpqIterations = 8;
+constexpr size_t kRoundKMeansIterations = 4;  // per-round PQ training stays cheap
+constexpr size_t kJacobiSweeps = 30;
+
+std::vector<float> identity_matrix(size_t dimension) {
+    std::vector<float> matrix(dimension * dimension, 0.0f);
+    for (size_t d = 0; d < dimension; ++d) {
+        matrix[d * dimension + d] = 1.0f;
+    }
+    return matrix;
+}
+
+void transpose(const float* in, size_t rows, size_t cols, float* out) {
+    for (size_t r = 0; r < rows; ++r) {
+        for (size_t c = 0; c < cols; ++c) {
+            out[c * rows + r] = in[r * cols + c];
+        }
+    }
+}
+
+#ifdef SAGE_DB_HAVE_LAPACK
+// LAPACK reads the row-major m as its transpose V S U^T, so it returns
+// u = V and vt = U^T; the column-major product u vt is then U V^T in
+// row-major order
+bool procrustes_lapack(const std::vector<float>& m, size_t dim, std::vector<float>& rotation) {
+    const int n = static_cast<int>(dim);
+    std::vector<float> a = m;
+    std::vector<float> s(dim), u(dim * dim), vt(dim * dim);
+    const char job = 'A';
+    int info = 0;
+    int lwork = -1;
+    float query = 0.0f;
+    sgesvd_(&job, &job, &n, &n, a.data(), &n, s.data(), u.data(), &n, vt.data(), &n, &query,
+            &lwork, &info);
+    lwork = std::max(1, static_cast<int>(query));
+    std::vector<float> work(static_cast<size_t>(lwork));
+    sgesvd_(&job, &job, &n, &n, a.data(), &n, s.data(), u.data(), &n, vt.data(), &n,
+            work.data(), &lwork, &info);
+    if (info != 0) {
+        return false;
+    }
+    rotation.assign(dim * dim, 0.0f);
+    for (size_t j = 0; j < dim; ++j) {
+        for (size_t k = 0; k < dim; ++k) {
+            const float scale = vt[k + j * dim];
+            const float* column = u.data() + k * dim;
+            float* out = rotation.data() + j * dim;
+            for (size_t i = 0; i < dim; ++i) {
+                out[i] += column[i] * scale;
+            }
+        }
+    }
+    return true;
+}
+#endif
+
+// One-sided Jacobi: rotates pairs of columns of m until they are
+// orthogonal, m V = W, so m = U S V^T with U the normalized columns of W
+bool procrustes_jacobi(const std::vector<float>& m, size_t dim, std::vector<float>& rotation) {
+    std::vector<double> w(dim * dim);  // row k: column k of m V
+    std::vector<double> v(dim * dim, 0.0);  // row k: column k of V
+    for (size_t r = 0; r < dim; ++r) {
+        for (size_t c = 0; c < dim; ++c) {
+            w[c * dim + r] = m[r * dim + c];
+        }
+        v[r * dim + r] = 1.0;
+    }
+    auto dot = [dim](const double* a, const double* b) {
+        double sum = 0.0;
+        for (size_t d = 0; d < dim; ++d) {
+            sum += a[d] * b[d];
+        }
+        return sum;
+    };
+    auto rotate = [dim](double* a, double* b, double c, double s) {
+        for (size_t d = 0; d < dim; ++d) {
+            const double x = a[d];
+            const double y = b[d];
+            a[d] = c * x - s * y;
+            b[d] = s * x + c * y;
+        }
+    };
+    for (size_t sweep = 0; sweep < kJacobiSweeps; ++sweep) {
+        bool rotated = false;
+        for (size_t p = 0; p + 1 < dim; ++p) {
+            for (size_t q = p + 1; q < dim; ++q) {
+                double* wp = w.data() + p * dim;
+                double* wq = w.data() + q * dim;
+                const double alpha = dot(wp, wp);
+                const double beta = dot(wq, wq);
+                const double gamma = dot(wp, wq);
+                if (std::fabs(gamma) <= 1e-12 * std::sqrt(alpha * beta) || gamma == 0.0) {
+                    continue;
+                }
+                rotated = true;
+                const double zeta = (beta - alpha) / (2.0 * gamma);
+                const double t = (zeta >= 0.0 ? 1.0 : -1.0) /
+                                 (std::fabs(zeta) + std::sqrt(1.0 + zeta * zeta));
+                const double c = 1.0 / std::sqrt(1.0 + t * t);
+                const double s = c * t;
+                rotate(wp, wq, c, s);
+                rotate(v.data() + p * dim, v.data() + q * dim, c, s);
+            }
+        }
+        if (!rotated) {
+            break;
+        }
+    }
+    rotation.assign(dim * dim, 0.0f);
+    for (size_t k = 0; k < dim; ++k) {
+        const double* wk = w.data() + k * dim;
+        const double norm = std::sqrt(dot(wk, wk));
+        if (norm == 0.0) {
+            return false;  // rank deficient: U is not determined
+        }
+        const double* vk = v.data() + k * dim;
+        for (size_t i = 0; i < dim; ++i) {
+            const double u = wk[i] / norm;
+            float* out = rotation.data() + i * dim;
+            for (size_t j = 0; j < dim; ++j) {
+                out[j] += static_cast<float>(u * vk[j]);
+            }
+        }
+    }
+    return true;
+}
+
+// The orthogonal R maximizing tr(R^T m), i.e. U V^T for m = U S V^T
+bool procrustes(const std::vector<float>& m, size_t dim, std::vector<float>& rotation) {
+#ifdef SAGE_DB_HAVE_LAPACK
+    if (procrustes_lapack(m, dim, rotation)) {
+        return true;
+    }
+#endif
+    return procrustes_jacobi(m, dim, rotation);
+}
+}  // namespace
+
+PreTransformKind parse_pre_transform(const std::string& name) {
+    for (auto kind : {PreTransformKind::NONE, PreTransformKind::OPQ}) {
+        if (name == pre_transform_name(kind)) {
+            return kind;
+        }
+    }
+    throw std::runtime_error("Unknown pre_transform: " + name);
+}
+
+std::string pre_transform_name(PreTransformKind kind) {
+    switch (kind) {
+        case PreTransformKind::NONE: return "none";
+        case PreTransformKind::OPQ: return "opq";
+    }
+    return "unknown";
+}
+
+PreTransform::PreTransform(PreTransformKind kind, size_t dimension, uint32_t iterations)
+    : kind_(kind), dimension_(dimension), iterations_(iterations) {
+    if (kind != PreTransformKind::NONE) {
+        matrix_ = identity_matrix(dimension);
+    }
+}
+
+PreTransform PreTransform::from_params(const AlgorithmParams& params, size_t dimension) {
+    return PreTransform(parse_pre_transform(params.get<std::string>("pre_transform", "none")),
+                        dimension, params.get<uint32_t>("opq_iters", kDefaultOpqIterations));
+}
+
+bool PreTransform::valid_params(const AlgorithmParams& params) {
+    try {
+        parse_pre_transform(params.get<std::string>("pre_transform", "none"));
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    return params.get<uint32_t>("opq_iters", kDefaultOpqIterations) > 0;
+}
+
+void PreTransform::record_params(AlgorithmParams& params) const {
+    params.set("pre_transform", pre_transform_name(kind_));
+    params.set("opq_iters", identity() ? kDefaultOpqIterations : iterations_);
+}
+
+void PreTransform::train(const float* points, size_t n, size_t m, size_t nbits,
+                         const KMeansOptions& options) {
+    if (identity() || n == 0) {
+        return;
+    }
+    const size_t dim = dimension_;
+    matrix_ = identity_matrix(dim);
+    ProductQuantizer quantizer(dim, m, nbits);
+    KMeansOptions round_options = options;
+    round_options.iterations = std::min(options.iterations, kRoundKMeansIterations);
+
+    std::vector<float> rotated(n * dim);
+    std::vector<float> reconstructed(n * dim);
+    std::vector<float> points_t(dim * n);
+    std::vector<float> reconstructed_t(dim * n);
+    std::vector<float> correlation(dim * dim);
+    std::vector<float> rotation;
+    transpose(points, n, dim, points_t.data());
+    for (uint32_t round = 0; round < iterations_; ++round) {
+        std::copy(points, points + n * dim, rotated.begin());
+        apply(rotated.data(), n);
+        quantizer.train(rotated.data(), n, round_options);
+        ThreadPool::global()->parallel_for(0, n, [&](size_t i) {
+            thread_local std::vector<uint8_t> code;
+            code.resize(m);
+            quantizer.encode(rotated.data() + i * dim, code.data());
+            quantizer.decode(code.data(), reconstructed.data() + i * dim);
+        });
+        // correlation[a][b] = sum_i y_i[a] x_i[b] = Y^T X
+        transpose(reconstructed.data(), n, dim, reconstructed_t.data());
+        simd::inner_product_block(reconstructed_t.data(), dim, n, points_t.data(), dim, n, n,
+                                  correlation.data(), dim);
+        if (!procrustes(correlation, dim, rotation)) {
+            break;  // keep the last rotation
+        }
+        matrix_.swap(rotation);
+    }
+}
+
+void PreTransform::apply(const float* in, float* out) const {
+    if (identity()) {
+        std::copy(in, in + dimension_, out);
+        return;
+    }
+    simd::matrix_vector(matrix_.data(), dimension_, dimension_, in, out);
+}
+
+void PreTransform::apply(float* rows, size_t n) const {
+    if (identity() || n == 0) {
+        return;
+    }
+    thread_local std::vector<float> copy;
+    if (n == 1) {
+        copy.assign(rows, rows + dimension_);
+        apply(copy.data(), rows);
+        return;
+    }
+    copy.assign(rows, rows + n * dimension_);
+    simd::inner_product_block(copy.data(), n, dimension_, matrix_.data(), dimension_, dimension_,
+                              dimension_, rows, dimension_);
+}
+
+void PreTransform::write(std::ostream& out) const {
+    const auto kind = static_cast<uint32_t>(kind_);
+    out.write(reinterpret_cast<const char*>(&kind), sizeof(kind));
+    if (identity()) {
+        return;
+    }
+    out.write(reinterpret_cast<const char*>(&iterations_), sizeof(iterations_));
+    out.write(reinterpret_cast<const char*>(matrix_.data()), matrix_.size() * sizeof(float));
+}
+
+bool PreTransform::read(std::istream& in, size_t dimension) {
+    uint32_t kind = 0;
+    if (!in.read(reinterpret_cast<char*>(&kind), sizeof(kind)) ||
+        kind > static_cast<uint32_t>(PreTransformKind::OPQ)) {
+        return false;
+    }
+    *this = PreTransform(PreTransformKind::NONE, dimension, 0);
+    if (kind == static_cast<uint32_t>(PreTransformKind::NONE)) {
+        return true;
+    }
+    uint32_t iterations = 0;
+    in.read(reinterpret_cast<char*>(&iterations), sizeof(iterations));
+    PreTransform loaded(static_cast<PreTransformKind>(kind), dimension, iterations);
+    in.read(reinterpret_cast<char*>(loaded.matrix_.data()),
+            loaded.matrix_.size() * sizeof(float));
+    if (!in) {
+        return false;
+    }
+    *this = std::move(loaded);
+    return true;
+}
+
+}  // namespace anns
+}  // namespace sage_db
@@ -0,0 +1,87 @@
+#include "sage_db/anns/product_quantizer.h"
+
+#include "sage_db/simd/distance.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+#include <string>
+
+namespace sage_db {
+namespace anns {
+
+ProductQuantizer::ProductQuantizer(size_t dimension, size_t m, size_t nbits)
+    : dimension_(dimension), m_(m), nbits_(nbits) {
+    if (m == 0 || dimension % m != 0) {
+        throw std::runtime_error("ProductQuantizer: dimension " + std::to_string(dimension) +
+                                 " is not divisible by m = " + std::to_string(m));
+    }
+    if (nbits == 0 || nbits > 8) {
+        throw std::runtime_error("ProductQuantizer: nbits must be in [1, 8]");
+    }
+    ksub_ = size_t{1} << nbits;
+    dsub_ = dimension / m;
+    codebooks_.assign(m_ * ksub_ * dsub_, 0.0f);
+}
+
+void ProductQuantizer::train(const float* points, size_t n, const KMeansOptions& options) {
+    std::vector<float> sub(n * dsub_);
+    for (size_t j = 0; j < m_; ++j) {
+        for (size_t i = 0; i < n; ++i) {
+            const float* src = points + i * dimension_ + j * dsub_;
+            std::copy(src, src + dsub_, sub.begin() + i * dsub_);
+        }
+        KMeansOptions sub_options = options;
+        sub_options.seed += static_cast<uint32_t>(j + 1);
+        auto book = train_kmeans(sub.data(), n, dsub_, ksub_, sub_options);
+        std::copy(book.begin(), book.end(), codebooks_.begin() + j * ksub_ * dsub_);
+    }
+}
+
+void ProductQuantizer::encode(const float* row, uint8_t* code) const {
+    for (size_t j = 0; j < m_; ++j) {
+        const float* sub = row + j * dsub_;
+        const float* book = codebooks_.data() + j * ksub_ * dsub_;
+        float best = std::numeric_limits<float>::max();
+        size_t best_code = 0;
+        for (size_t c = 0; c < ksub_; ++c) {
+            const float dist = simd::l2_squared(sub, book + c * dsub_, dsub_);
+            if (dist < best) {
+                best = dist;
+                best_code = c;
+            }
+        }
+        code[j] = static_cast<uint8_t>(best_code);
+    }
+}
+
+void ProductQuantizer::decode(const uint8_t* code, float* row) const {
+    for (size_t j = 0; j < m_; ++j) {
+        const float* word = codebooks_.data() + (j * ksub_ + code[j]) * dsub_;
+        std::copy(word, word + dsub_, row + j * dsub_);
+    }
+}
+
+void ProductQuantizer::compute_table(const float* query, bool inner_product, float* table) const {
+    for (size_t j = 0; j < m_; ++j) {
+        const float* sub = query + j * dsub_;
+        const float* book = codebooks_.data() + j * ksub_ * dsub_;
+        float* row = table + j * ksub_;
+        for (size_t c = 0; c < ksub_; ++c) {
+            row[c] = inner_product ? -simd::inner_product(sub, book + c * dsub_, dsub_)
+                                   : simd::l2_squared(sub, book + c * dsub_, dsub_);
+        }
+    }
+}
+
+size_t ProductQuantizer::default_m(size_t dimension) {
+    for (size_t m = std::max<size_t>(dimension / 4, 1); m > 1; --m) {
+        if (dimension % m == 0) {
+            return m;
+        }
+    }
+    return 1;
+}
+
+}  // namespace anns
+}  // namespace sage_db
@@ -0,0 +1,210 @@
+#include "sage_db/anns/rabitq.h"
+
+#include "sage_db/simd/distance.h"
+#include "sage_db/simd/quantized_distance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <random>
+#include <stdexcept>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+constexpr float kEpsilon0 = 1.9f;
+constexpr size_t kScaleCandidates = 32;  // grid scales tried per multi-bit code
+
+// Code header: |r|, <x, u'> and the scale normalizing the grid point
+constexpr size_t kHeaderFloats = 3;
+
+float header(const uint8_t* code, size_t index) {
+    float value;
+    std::memcpy(&value, code + index * sizeof(float), sizeof(value));
+    return value;
+}
+
+size_t payload_bytes(size_t dimension, size_t bits) {
+    if (bits == 1) {
+        return (dimension + 7) / 8;
+    }
+    return bits <= 4 ? (dimension + 1) / 2 : dimension;
+}
+}  // namespace
+
+RaBitQuantizer::RaBitQuantizer(size_t dimension, size_t bits, uint32_t seed)
+    : dimension_(dimension), bits_(bits), seed_(seed) {
+    if (bits == 0 || bits > 8) {
+        throw std::runtime_error("RaBitQuantizer: bits must be in [1, 8]");
+    }
+    code_size_ = kHeaderFloats * sizeof(float) + payload_bytes(dimension, bits);
+
+    // Gram-Schmidt over Gaussian rows gives a uniformly random rotation
+    rotation_.resize(dimension * dimension);
+    std::mt19937 rng(seed);
+    std::normal_distribution<float> gaussian(0.0f, 1.0f);
+    for (auto& value : rotation_) {
+        value = gaussian(rng);
+    }
+    for (size_t i = 0; i < dimension; ++i) {
+        float* row = rotation_.data() + i * dimension;
+        for (size_t j = 0; j < i; ++j) {
+            const float* prior = rotation_.data() + j * dimension;
+            const float dot = simd::inner_product(row, prior, dimension);
+            for (size_t d = 0; d < dimension; ++d) {
+                row[d] -= dot * prior[d];
+            }
+        }
+        const float inv = 1.0f / std::sqrt(simd::norm_squared(row, dimension));
+        for (size_t d = 0; d < dimension; ++d) {
+            row[d] *= inv;
+        }
+    }
+}
+
+void RaBitQuantizer::rotate(const float* in, float* out) const {
+    for (size_t i = 0; i < dimension_; ++i) {
+        out[i] = simd::inner_product(rotation_.data() + i * dimension_, in, dimension_);
+    }
+}
+
+void RaBitQuantizer::encode(const float* residual, uint8_t* code) const {
+    std::fill_n(code, code_size_, uint8_t{0});
+    const float norm = std::sqrt(simd::norm_squared(residual, dimension_));
+    float fields[kHeaderFloats] = {norm, 1.0f, 0.0f};
+    if (norm == 0.0f) {
+        std::memcpy(code, fields, sizeof(fields));
+        return;
+    }
+    thread_local std::vector<float> unit;
+    thread_local std::vector<uint8_t> levels;
+    unit.resize(dimension_);
+    levels.resize(dimension_);
+    rotate(residual, unit.data());
+    for (auto& value : unit) {
+        value /= norm;
+    }
+
+    // Grid point g = level - half; x = g / |g|
+    const float half = static_cast<float>((1u << bits_) - 1) * 0.5f;
+    const float top = static_cast<float>((1u << bits_) - 1);
+    auto quantize = [&](float scale, bool store) {
+        float dot = 0.0f;
+        float norm_sq = 0.0f;
+        for (size_t d = 0; d < dimension_; ++d) {
+            const float level = bits_ == 1
+                                    ? (unit[d] > 0.0f ? 1.0f : 0.0f)
+                                    : std::clamp(std::round(unit[d] * scale + half), 0.0f, top);
+            if (store) {
+                levels[d] = static_cast<uint8_t>(level);
+            }
+            const float g = level - half;
+            dot += g * unit[d];
+            norm_sq += g * g;
+        }
+        return std::make_pair(dot, norm_sq);
+    };
+
+    // More bits: the grid scale that best aligns x with u'; the largest
+    // coordinate reaches the outermost level at scale 1
+    float best_scale = 0.0f;
+    if (bits_ > 1) {
+        float largest = 0.0f;
+        for (float value : unit) {
+            largest = std::max(largest, std::fabs(value));
+        }
+        const float full = (half + 0.5f) / largest;
+        float best_cosine = -1.0f;
+        for (size_t i = 1; i <= kScaleCandidates; ++i) {
+            const float scale = full * static_cast<float>(i) / kScaleCandidates;
+            const auto [dot, norm_sq] = quantize(scale, false);
+            const float cosine = dot / std::sqrt(norm_sq);
+            if (cosine > best_cosine) {
+                best_cosine = cosine;
+                best_scale = scale;
+            }
+        }
+    }
+    const auto [dot, norm_sq] = quantize(best_scale, true);
+    const float inv = 1.0f / std::sqrt(norm_sq);
+    fields[1] = dot * inv;
+    fields[2] = inv;
+    std::memcpy(code, fields, sizeof(fields));
+
+    uint8_t* payload = code + kHeaderFloats * sizeof(float);
+    for (size_t d = 0; d < dimension_; ++d) {
+        if (bits_ == 1) {
+            payload[d / 8] |= static_cast<uint8_t>(levels[d] << (d % 8));
+        } else if (bits_ <= 4) {
+            payload[d / 2] |= static_cast<uint8_t>(levels[d] << ((d & 1) * 4));
+        } else {
+            payload[d] = levels[d];
+        }
+    }
+}
+
+void RaBitQuantizer::prepare(const float* target, Query& query) const {
+    thread_local std::vector<float> rotated;
+    rotated.resize(dimension_);
+    rotate(target, rotated.data());
+    prepare_rotated(rotated.data(), query);
+}
+
+void RaBitQuantizer::prepare_rotated(const float* rotated, Query& query) const {
+    const size_t bytes = (dimension_ + 7) / 8;
+    query.rotated.assign(bytes * 8, 0.0f);
+    std::copy_n(rotated, dimension_, query.rotated.begin());
+    query.norm = std::sqrt(simd::norm_squared(rotated, dimension_));
+    query.sum = 0.0f;
+    for (size_t d = 0; d < dimension_; ++d) {
+        query.sum += rotated[d];
+    }
+    if (bits_ != 1) {
+        return;
+    }
+    // Each byte's sum extends the one without its lowest set bit
+    query.byte_sums.resize(bytes * 256);
+    for (size_t j = 0; j < bytes; ++j) {
+        float* sums = query.byte_sums.data() + j * 256;
+        const float* values = query.rotated.data() + j * 8;
+        sums[0] = 0.0f;
+        for (uint32_t b = 1; b < 256; ++b) {
+            sums[b] = sums[b & (b - 1)] + values[__builtin_ctz(b)];
+        }
+    }
+}
+
+RaBitQuantizer::Estimate RaBitQuantizer::estimate(const Query& query, const uint8_t* code) const {
+    const float norm = header(code, 0);
+    const float alignment = header(code, 1);
+    if (norm == 0.0f) {
+        return {0.0f, 0.0f};
+    }
+    const uint8_t* payload = code + kHeaderFloats * sizeof(float);
+    float weighted;
+    if (bits_ == 1) {
+        weighted = 0.0f;
+        const float* sums = query.byte_sums.data();
+        for (size_t j = 0, bytes = (dimension_ + 7) / 8; j < bytes; ++j, sums += 256) {
+            weighted += sums[payload[j]];
+        }
+    } else if (bits_ <= 4) {
+        weighted = simd::weighted_sum_u4(query.rotated.data(), payload, dimension_);
+    } else {
+        weighted = simd::weighted_sum_u8(query.rotated.data(), payload, dimension_);
+    }
+    const float half = static_cast<float>((1u << bits_) - 1) * 0.5f;
+    const float projected = header(code, 2) * (weighted - half * query.sum);  // <x, P t>
+    const float spread = std::sqrt(std::max(0.0f, 1.0f - alignment * alignment)) / alignment;
+    const float dims = static_cast<float>(std::max<size_t>(dimension_, 2) - 1);
+    return {norm * projected / alignment,
+            norm * query.norm * kEpsilon0 * spread / std::sqrt(dims)};
+}
+
+float RaBitQuantizer::residual_norm(const uint8_t* code) const {
+    return header(code, 0);
+}
+
+}  // namespace anns
+}  // namespace sage_db
@@ -0,0 +1,207 @@
+#include "sage_db/anns/scalar_quantizer.h"
+
+#include "sage_db/simd/distance.h"
+#include "sage_db/simd/quantized_distance.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+
+namespace sage_db {
+namespace anns {
+
+namespace {
+uint32_t levels(StoragePrecision precision) {
+    return precision == StoragePrecision::INT8 ? 255u : 15u;
+}
+
+bool integer_codes(StoragePrecision precision) {
+    return precision == StoragePrecision::INT8 || precision == StoragePrecision::INT4;
+}
+
+const uint16_t* halves(const uint8_t* code) {
+    return reinterpret_cast<const uint16_t*>(code);
+}
+}  // namespace
+
+StoragePrecision parse_storage_precision(const std::string& name) {
+    for (auto precision : {StoragePrecision::FP32, StoragePrecision::FP16, StoragePrecision::BF16,
+                           StoragePrecision::INT8, StoragePrecision::INT4,
+                           StoragePrecision::RABITQ}) {
+        if (name == storage_precision_name(precision)) {
+            return precision;
+        }
+    }
+    throw std::runtime_error("Unknown storage_precision: " + name);
+}
+
+std::string storage_precision_name(StoragePrecision precision) {
+    switch (precision) {
+        case StoragePrecision::FP32: return "fp32";
+        case StoragePrecision::FP16: return "fp16";
+        case StoragePrecision::BF16: return "bf16";
+        case StoragePrecision::INT8: return "int8";
+        case StoragePrecision::INT4: return "int4";
+        case StoragePrecision::RABITQ: return "rabitq";
+    }
+    return "unknown";
+}
+
+ScalarQuantizer::ScalarQuantizer(size_t dimension, StoragePrecision precision)
+    : dimension_(dimension), precision_(precision) {
+    switch (precision) {
+        case StoragePrecision::FP16:
+        case StoragePrecision::BF16:
+            code_size_ = dimension * sizeof(uint16_t);
+            trained_ = true;
+            break;
+        case StoragePrecision::INT8:
+            code_size_ = dimension;
+            break;
+        case StoragePrecision::INT4:
+            code_size_ = (dimension + 1) / 2;
+            break;
+        case StoragePrecision::RABITQ:
+            throw std::runtime_error("ScalarQuantizer: rabitq codes come from RaBitQuantizer");
+        default:
+            throw std::runtime_error("ScalarQuantizer: fp32 rows are stored unquantized");
+    }
+    if (integer_codes(precision)) {
+        mins_.assign(dimension, 0.0f);
+        steps_.assign(dimension, 0.0f);
+    }
+}
+
+void ScalarQuantizer::train(const float* const* rows, size_t n) {
+    if (!integer_codes(precision_) || n == 0) {
+        return;
+    }
+    std::vector<float> highs(dimension_, std::numeric_limits<float>::lowest());
+    std::fill(mins_.begin(), mins_.end(), std::numeric_limits<float>::max());
+    for (size_t i = 0; i < n; ++i) {
+        for (size_t d = 0; d < dimension_; ++d) {
+            mins_[d] = std::min(mins_[d], rows[i][d]);
+            highs[d] = std::max(highs[d], rows[i][d]);
+        }
+    }
+    const float scale = 1.0f / static_cast<float>(levels(precision_));
+    for (size_t d = 0; d < dimension_; ++d) {
+        steps_[d] = (highs[d] - mins_[d]) * scale;
+    }
+    trained_ = true;
+}
+
+void ScalarQuantizer::set_range(std::vector<float> mins, std::vector<float> steps) {
+    mins_ = std::move(mins);
+    steps_ = std::move(steps);
+    trained_ = true;
+}
+
+void ScalarQuantizer::encode(const float* row, uint8_t* code) const {
+    switch (precision_) {
+        case StoragePrecision::FP16: {
+            auto* out = reinterpret_cast<uint16_t*>(code);
+            for (size_t d = 0; d < dimension_; ++d) {
+                out[d] = simd::float_to_half(row[d]);
+            }
+            return;
+        }
+        case StoragePrecision::BF16: {
+            auto* out = reinterpret_cast<uint16_t*>(code);
+            for (size_t d = 0; d < dimension_; ++d) {
+                out[d] = simd::float_to_bfloat16(row[d]);
+            }
+            return;
+        }
+        default:
+            break;
+    }
+    const float top = static_cast<float>(levels(precision_));
+    auto level = [&](size_t d) {
+        if (steps_[d] <= 0.0f) {
+            return 0u;
+        }
+        const float scaled = std::round((row[d] - mins_[d]) / steps_[d]);
+        return static_cast<uint32_t>(std::clamp(scaled, 0.0f, top));
+    };
+    if (precision_ == StoragePrecision::INT8) {
+        for (size_t d = 0; d < dimension_; ++d) {
+            code[d] = static_cast<uint8_t>(level(d));
+        }
+        return;
+    }
+    std::fill_n(code, code_size_, uint8_t{0});
+    for (size_t d = 0; d < dimension_; ++d) {
+        code[d / 2] |= static_cast<uint8_t>(level(d) << ((d & 1) * 4));
+    }
+}
+
+void ScalarQuantizer::decode(const uint8_t* code, float* row) const {
+    switch (precision_) {
+        case StoragePrecision::FP16:
+            for (size_t d = 0; d < dimension_; ++d) {
+                row[d] = simd::half_to_float(halves(code)[d]);
+            }
+            return;
+        case StoragePrecision::BF16:
+            for (size_t d = 0; d < dimension_; ++d) {
+                row[d] = simd::bfloat16_to_float(halves(code)[d]);
+            }
+            return;
+        case StoragePrecision::INT8:
+            for (size_t d = 0; d < dimension_; ++d) {
+                row[d] = mins_[d] + static_cast<float>(code[d]) * steps_[d];
+            }
+            return;
+        default:
+            for (size_t d = 0; d < dimension_; ++d) {
+                const uint32_t level = (code[d / 2] >> ((d & 1) * 4)) & 0x0Fu;
+                row[d] = mins_[d] + static_cast<float>(level) * steps_[d];
+            }
+            return;
+    }
+}
+
+void ScalarQuantizer::prepare(const float* query, Query& prepared) const {
+    prepared.residual.resize(dimension_);
+    if (!integer_codes(precision_)) {
+        std::copy_n(query, dimension_, prepared.residual.begin());
+        return;
+    }
+    prepared.weight.resize(dimension_);
+    for (size_t d = 0; d < dimension_; ++d) {
+        prepared.residual[d] = query[d] - mins_[d];
+        prepared.weight[d] = query[d] * steps_[d];
+    }
+    prepared.bias = simd::inner_product(query, mins_.data(), dimension_);
+}
+
+float ScalarQuantizer::l2_squared(const Query& query, const uint8_t* code) const {
+    switch (precision_) {
+        case StoragePrecision::FP16:
+            return simd::l2_squared_fp16(query.residual.data(), halves(code), dimension_);
+        case StoragePrecision::BF16:
+            return simd::l2_squared_bf16(query.residual.data(), halves(code), dimension_);
+        case StoragePrecision::INT8:
+            return simd::l2_squared_u8(query.residual.data(), steps_.data(), code, dimension_);
+        default:
+            return simd::l2_squared_u4(query.residual.data(), steps_.data(), code, dimension_);
+    }
+}
+
+float ScalarQuantizer::inner_product(const Query& query, const uint8_t* code) const {
+    switch (precision_) {
+        case StoragePrecision::FP16:
+            return simd::inner_product_fp16(query.residual.data(), halves(code), dimension_);
+        case StoragePrecision::BF16:
+            return simd::inner_product_bf16(query.residual.data(), halves(code), dimension_);
+        case StoragePrecision::INT8:
+            return query.bias + simd::weighted_sum_u8(query.weight.data(), code, dimension_);
+        default:
+            return query.bias + simd::weighted_sum_u4(query.weight.data(), code, dimension_);
+    }
+}
+
+}  // namespace anns
+}  // namespace sage_db
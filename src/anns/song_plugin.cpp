@@ -10,6 +10,7 @@
 #include <chrono>
 #include <cstdio>
 #include <memory>
+#include <mutex>
 #include <stdexcept>
 #include <string>
 #include <unordered_map>
@@ -44,6 +45,7 @@ public:
     std::unordered_map<song_kernel::idx_t, VectorId> reverse_id_map_;
     song_kernel::idx_t next_internal_idx_ = 0;
     bool built_ = false;
+    std::mutex search_mutex_; // the kernel graph owns per-search device buffers
 };
 
 SongANNS::SongANNS()
@@ -53,6 +55,7 @@ SongANNS::SongANNS()
       max_vectors_(0),
       is_built_(false) {
     metrics_.reset();
+    query_counters_.reset();
 }
 
 SongANNS::~SongANNS() = default;
@@ -71,16 +74,20 @@ bool SongANNS::supports_distance(DistanceMetric metric) const {
 }
 
 namespace {
-// Helper: convert dense Vector to sparse representation for SONG kernels
-std::vector<std::pair<int, song_kernel::value_t>> to_sparse_vector(const Vector& vec) {
+// Helper: convert a dense row to sparse representation for SONG kernels
+std::vector<std::pair<int, song_kernel::value_t>> to_sparse_vector(const float* data, size_t dim) {
     std::vector<std::pair<int, song_kernel::value_t>> sparse;
-    sparse.reserve(vec.size());
-    for (size_t i = 0; i < vec.size(); ++i) {
-        sparse.emplace_back(static_cast<int>(i), static_cast<song_kernel::value_t>(vec[i]));
+    sparse.reserve(dim);
+    for (size_t i = 0; i < dim; ++i) {
+        sparse.emplace_back(static_cast<int>(i), static_cast<song_kernel::value_t>(data[i]));
     }
     return sparse;
 }
 
+std::vector<std::pair<int, song_kernel::value_t>> to_sparse_vector(const Vector& vec) {
+    return to_sparse_vector(vec.data(), vec.size());
+}
+
 int distance_metric_to_kernel_type(DistanceMetric metric) {
     switch (metric) {
         case DistanceMetric::L2: return 0;
@@ -97,6 +104,7 @@ void SongANNS::fit(const std::vector<VectorEntry>& dataset, const AlgorithmParam
     
     impl_->reset();
     metrics_.reset();
+    query_counters_.reset();
 
     if (dataset.empty()) {
         dimension_ = 0;
@@ -274,7 +282,10 @@ ANNSResult SongANNS::query(const Vector& query_vector, const QueryConfig& config
     auto sparse_query = to_sparse_vector(query_vector);
     std::vector<song_kernel::idx_t> internal_results;
     
-    impl_->graph_->search_top_k(sparse_query, config.k, internal_results);
+    {
+        std::lock_guard<std::mutex> lock(impl_->search_mutex_);
+        impl_->graph_->search_top_k(sparse_query, config.k, internal_results);
+    }
     
     ANNSResult result;
     result.ids.reserve(internal_results.size());
@@ -312,8 +323,7 @@ ANNSResult SongANNS::query(const Vector& query_vector, const QueryConfig& config
     
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    metrics_.search_time_seconds += duration.count() / 1000000.0;
-    metrics_.distance_computations += result.actual_k;
+    query_counters_.record(duration.count() / 1000000.0, result.actual_k);
     
     return result;
 }
@@ -337,7 +347,10 @@ std::vector<ANNSResult> SongANNS::batch_query(const std::vector<Vector>& query_v
     }
     
     std::vector<std::vector<song_kernel::idx_t>> internal_results;
-    impl_->graph_->search_top_k_batch(sparse_queries, config.k, internal_results);
+    {
+        std::lock_guard<std::mutex> lock(impl_->search_mutex_);
+        impl_->graph_->search_top_k_batch(sparse_queries, config.k, internal_results);
+    }
     
     std::vector<ANNSResult> results;
     results.reserve(query_vectors.size());
@@ -380,15 +393,78 @@ std::vector<ANNSResult> SongANNS::batch_query(const std::vector<Vector>& query_v
     
     auto end = std::chrono::high_resolution_clock::now();
     auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
-    metrics_.search_time_seconds += duration.count() / 1000000.0;
-    
+    size_t total_neighbors = 0;
     for (const auto& res : results) {
-        metrics_.distance_computations += res.actual_k;
+        total_neighbors += res.actual_k;
     }
+    query_counters_.record(duration.count() / 1000000.0, total_neighbors);
     
     return results;
 }
 
+void SongANNS::batch_query(const QueryMatrix& queries,
+                           const QueryConfig& config,
+                           const QueryOutput& output) const {
+    if (!is_built_ || !impl_->graph_) {
+        throw std::runtime_error("SONG: index not built");
+    }
+    if (queries.dimension != static_cast<Dimension>(dimension_)) {
+        throw std::runtime_error("SONG: query dimension mismatch");
+    }
+
+    auto start = std::chrono::high_resolution_clock::now();
+
+    // The kernels take sparse rows, built straight from the caller's matrix
+    std::vector<std::vector<std::pair<int, song_kernel::value_t>>> sparse_queries;
+    sparse_queries.reserve(queries.rows);
+    for (size_t i = 0; i < queries.rows; ++i) {
+        sparse_queries.push_back(to_sparse_vector(queries.row(i), queries.dimension));
+    }
+
+    std::vector<std::vector<song_kernel::idx_t>> internal_results;
+    {
+        std::lock_guard<std::mutex> lock(impl_->search_mutex_);
+        impl_->graph_->search_top_k_batch(sparse_queries, config.k, internal_results);
+    }
+
+    const int kernel_type = distance_metric_to_kernel_type(metric_);
+    size_t total_neighbors = 0;
+    for (size_t i = 0; i < queries.rows; ++i) {
+        size_t filled = 0;
+        const size_t found = i < internal_results.size() ? internal_results[i].size() : 0;
+        for (size_t j = 0; j < found && filled < config.k; ++j) {
+            const auto internal_idx = internal_results[i][j];
+            auto it = impl_->reverse_id_map_.find(internal_idx);
+            if (it == impl_->reverse_id_map_.end()) {
+                continue;
+            }
+            output.ids[i * config.k + filled] = it->second;
+            if (output.distances) {
+                song_kernel::dist_t dist = 0.0;
+                switch (kernel_type) {
+                    case 0:
+                        dist = impl_->data_->l2_distance(internal_idx, sparse_queries[i]);
+                        break;
+                    case 1:
+                        dist = -impl_->data_->negative_inner_prod_distance(internal_idx, sparse_queries[i]);
+                        break;
+                    case 2:
+                        dist = -impl_->data_->negative_cosine_distance(internal_idx, sparse_queries[i]);
+                        break;
+                }
+                output.distances[i * config.k + filled] = static_cast<float>(dist);
+            }
+            ++filled;
+        }
+        output.finish(i, config.k, filled);
+        total_neighbors += filled;
+    }
+
+    auto end = std::chrono::high_resolution_clock::now();
+    auto duration = std::chrono::duration_cast<std::chrono::microseconds>(end - start);
+    query_counters_.record(duration.count() / 1000000.0, total_neighbors);
+}
+
 void SongANNS::add_vector(const VectorEntry& entry) {
     if (!is_built_ || !impl_->graph_ || !impl_->data_) {
         throw std::runtime_error("SONG: cannot add vector before index is built");
@@ -453,7 +529,9 @@ std::unordered_map<std::string, std::string> SongANNS::get_build_params() const
 }
 
 ANNSMetrics SongANNS::get_metrics() const {
-    return metrics_;
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    return metrics;
 }
 
 bool SongANNS::validate_params(const AlgorithmParams& params) const {
@@ -0,0 +1,150 @@
+#include "sage_db/anns/vamana/disk_graph.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace sage_db {
+namespace anns {
+namespace vamana {
+
+namespace {
+constexpr char kMagic[8] = {'S', 'A', 'G', 'E', 'V', 'D', 'S', 'K'};
+}  // namespace
+
+DiskGraph::~DiskGraph() {
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+}
+
+void DiskGraph::encode_record(const float* row, uint32_t dimension, const idx_t* neighbors,
+                              uint32_t degree, uint32_t max_degree, char* out) {
+    std::memset(out, 0, record_bytes(dimension, max_degree));
+    if (row) {
+        std::memcpy(out, row, dimension * sizeof(float));
+    }
+    out += dimension * sizeof(float);
+    std::memcpy(out, &degree, sizeof(degree));
+    std::memcpy(out + sizeof(degree), neighbors, degree * sizeof(idx_t));
+}
+
+DiskGraph::NodeView DiskGraph::view(const char* record) const {
+    NodeView node;
+    node.vector = reinterpret_cast<const float*>(record);
+    record += header_.dimension * sizeof(float);
+    std::memcpy(&node.degree, record, sizeof(node.degree));
+    node.neighbors = reinterpret_cast<const idx_t*>(record + sizeof(node.degree));
+    return node;
+}
+
+bool DiskGraph::write(const std::string& path, const FixedDegreeGraph& graph,
+                      const std::vector<const float*>& rows, uint32_t dimension,
+                      uint32_t metric, idx_t entry_point) {
+    Header header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.dimension = dimension;
+    header.max_degree = graph.max_degree();
+    header.metric = metric;
+    header.node_count = graph.size();
+    header.entry_point = entry_point;
+    header.record_bytes = static_cast<uint32_t>(record_bytes(dimension, graph.max_degree()));
+    header.nodes_per_sector = static_cast<uint32_t>(kSectorSize / header.record_bytes);
+    header.sectors_per_node =
+        header.nodes_per_sector > 0
+            ? 1
+            : static_cast<uint32_t>((header.record_bytes + kSectorSize - 1) / kSectorSize);
+
+    const std::string staging = path + ".tmp";
+    {
+        std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        std::vector<char> sector(kSectorSize, 0);
+        std::memcpy(sector.data(), &header, sizeof(header));
+        out.write(sector.data(), kSectorSize);
+
+        // One sector (or one multi-sector span) at a time
+        const size_t per_write = header.nodes_per_sector > 0 ? header.nodes_per_sector : 1;
+        std::vector<char> span(static_cast<size_t>(header.sectors_per_node) * kSectorSize);
+        for (size_t first = 0; first < graph.size(); first += per_write) {
+            std::fill(span.begin(), span.end(), 0);
+            const size_t last = std::min(graph.size(), first + per_write);
+            for (size_t node = first; node < last; ++node) {
+                const auto id = static_cast<idx_t>(node);
+                encode_record(rows[node], dimension, graph.neighbors(id), graph.degree(id),
+                              graph.max_degree(),
+                              span.data() + (node - first) * header.record_bytes);
+            }
+            out.write(span.data(), span.size());
+        }
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(staging.c_str(), path.c_str()) == 0;
+}
+
+bool DiskGraph::open(const std::string& path) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    Header header{};
+    if (::pread(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)) ||
+        std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion ||
+        header.record_bytes != record_bytes(header.dimension, header.max_degree) ||
+        header.sectors_per_node == 0) {
+        ::close(fd);
+        return false;
+    }
+    if (fd_ >= 0) {
+        ::close(fd_);
+    }
+    fd_ = fd;
+    path_ = path;
+    header_ = header;
+    return true;
+}
+
+uint64_t DiskGraph::offset_of(idx_t node) const {
+    if (header_.nodes_per_sector > 0) {
+        const uint64_t sector = 1 + node / header_.nodes_per_sector;
+        return sector * kSectorSize +
+               static_cast<uint64_t>(node % header_.nodes_per_sector) * header_.record_bytes;
+    }
+    return (1 + static_cast<uint64_t>(node) * header_.sectors_per_node) * kSectorSize;
+}
+
+bool DiskGraph::read(const idx_t* nodes, size_t count, std::vector<char>& buffer) const {
+    const size_t bytes = header_.record_bytes;
+    if (buffer.size() < count * bytes) {
+        buffer.resize(count * bytes);
+    }
+    for (size_t i = 0; i < count; ++i) {
+        if (nodes[i] >= header_.node_count) {
+            return false;
+        }
+        char* dst = buffer.data() + i * bytes;
+        size_t done = 0;
+        while (done < bytes) {
+            const ssize_t got = ::pread(fd_, dst + done, bytes - done,
+                                        static_cast<off_t>(offset_of(nodes[i]) + done));
+            if (got <= 0) {
+                return false;
+            }
+            done += static_cast<size_t>(got);
+        }
+    }
+    return true;
+}
+
+} // namespace vamana
+} // namespace anns
+} // namespace sage_db
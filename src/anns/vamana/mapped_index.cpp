@@ -0,0 +1,92 @@
+#include "sage_db/anns/vamana/mapped_index.h"
+
+#include <cstddef>
+#include <cstring>
+#include <limits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace sage_db {
+namespace anns {
+namespace vamana {
+
+namespace {
+uint64_t page_aligned(uint64_t offset) {
+    return (offset + MappedIndex::kPageSize - 1) / MappedIndex::kPageSize * MappedIndex::kPageSize;
+}
+}  // namespace
+
+MappedIndex::~MappedIndex() {
+    if (base_) {
+        ::munmap(base_, size_);
+    }
+}
+
+void MappedIndex::lay_out(Header& header) {
+    const uint64_t slots = padded_slots(header.slot_count);
+    header.record_stride = header.max_degree + 2;
+    header.states_offset = kPageSize;
+    header.ids_offset = page_aligned(header.states_offset + slots);
+    header.vectors_offset = page_aligned(header.ids_offset + slots * sizeof(VectorId));
+    header.adjacency_offset = page_aligned(
+        header.vectors_offset + header.slot_count * header.dimension * sizeof(float));
+    header.id_map_offset = page_aligned(
+        header.adjacency_offset + slots * header.record_stride * sizeof(idx_t));
+    header.labels_offset = header.id_map_offset + header.live_count * sizeof(IdEntry);
+}
+
+bool MappedIndex::open(const std::string& path, bool populate) {
+    const int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info {};
+    if (::fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < kPageSize) {
+        ::close(fd);
+        return false;
+    }
+    const size_t size = static_cast<size_t>(info.st_size);
+    int flags = MAP_PRIVATE;
+#ifdef MAP_POPULATE
+    if (populate) {
+        flags |= MAP_POPULATE;
+    }
+#endif
+    void* base = ::mmap(nullptr, size, PROT_READ | PROT_WRITE, flags, fd, 0);
+    ::close(fd);  // the mapping keeps the file alive
+    if (base == MAP_FAILED) {
+        return false;
+    }
+
+    // The offsets must be the ones lay_out() derives from the header
+    Header header{};
+    std::memcpy(&header, base, sizeof(header));
+    Header expected = header;
+    lay_out(expected);
+    const bool valid =
+        header.version == kVersion && header.dimension > 0 &&
+        header.slot_count < std::numeric_limits<idx_t>::max() &&
+        header.live_count <= header.slot_count &&
+        (header.entry_point == std::numeric_limits<idx_t>::max() ||
+         header.entry_point < header.slot_count) &&
+        std::memcmp(&header, &expected, offsetof(Header, file_size)) == 0 &&
+        header.file_size == size && header.labels_offset <= size;
+    if (!valid) {
+        ::munmap(base, size);
+        return false;
+    }
+    if (base_) {
+        ::munmap(base_, size_);
+    }
+    base_ = static_cast<char*>(base);
+    size_ = size;
+    header_ = header;
+    return true;
+}
+
+} // namespace vamana
+} // namespace anns
+} // namespace sage_db
@@ -1,17 +1,32 @@
 #include "sage_db/anns/vamana_plugin.h"
 
-#include "sage_db/anns/vamana/vertex.h"
+#include "sage_db/anns/graph_reorder.h"
+#include "sage_db/anns/product_quantizer.h"
+#include "sage_db/anns/rabitq.h"
+#include "sage_db/anns/scalar_quantizer.h"
+#include "sage_db/anns/vamana/disk_graph.h"
 #include "sage_db/anns/vamana/distance.h"
+#include "sage_db/anns/vamana/graph.h"
+#include "sage_db/anns/vamana/mapped_index.h"
+#include "sage_db/anns/vamana/scratch.h"
+#include "sage_db/thread_pool.h"
+#include "sage_db/vector_arena.h"
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <cstdio>
 #include <fstream>
 #include <future>
 #include <limits>
-#include <queue>
+#include <mutex>
 #include <random>
+#include <shared_mutex>
+#include <span>
+#include <thread>
 #include <unordered_map>
-#include <unordered_set>
 
 namespace sage_db {
 namespace anns {
@@ -19,356 +34,1676 @@ namespace anns {
 namespace {
 REGISTER_ANNS_ALGORITHM(VamanaANNSFactory);
 constexpr float kDefaultAlpha = 1.2f;
+constexpr uint32_t kDefaultSeed = 1234;
+constexpr uint32_t kDefaultRabitqBits = 1;
 constexpr uint32_t kDeleteBatchThresholdPercent = 5;
+constexpr size_t kConsolidateChunk = 1024;  // slots scanned per exclusive lock hold
+constexpr uint32_t kFormatVersion = 2;
+constexpr uint32_t kDiskFormatVersion = 3;
+constexpr uint32_t kMappedFormatVersion = vamana::MappedIndex::kVersion;
+constexpr uint32_t kDefaultCacheNodes = 256;
+constexpr uint32_t kDefaultBeamWidth = 4;
+constexpr size_t kMaxNavigatorTrainingRows = 65536;
 }  // namespace
 
 class VamanaANNS::Impl {
 public:
-    using DistAndId = std::pair<float, vamana::idx_t>;
-    using MaxHeap = std::priority_queue<DistAndId, std::vector<DistAndId>, std::less<>>;
-    using MinHeap = std::priority_queue<DistAndId, std::vector<DistAndId>, std::greater<>>;
+    using DistAndId = vamana::DistAndId;
+
+    static constexpr vamana::idx_t kNoNode = std::numeric_limits<vamana::idx_t>::max();
+    static constexpr size_t kNotOwned = std::numeric_limits<size_t>::max();
+
+    // Slots are dense internal ids. Deleted slots stay in the graph as
+    // tombstones until compaction frees them for reuse.
+    enum class SlotState : uint8_t { kLive, kDeleted, kFree };
 
     Impl()
         : metric(DistanceMetric::L2),
           dimension(0),
-          entry_point(std::numeric_limits<vamana::idx_t>::max()),
-          next_internal_id(0),
+          entry_point(kNoNode),
           M(8),
           Mmax(16),
           ef_construction(50),
           ef_search(200),
           alpha(kDefaultAlpha) {}
 
+    ~Impl() { stop_consolidation(); }
+
     void reset() {
-        nodes.clear();
-        delete_list.clear();
+        graph.reset(Mmax);
+        rows.clear();
+        labels.clear();
+        states.clear();
+        owned_slots.clear();
+        free_slots.clear();
         id_map.clear();
-        reverse_id_map.clear();
+        owned_rows.reset();
+        borrowed.clear();
+        locks.clear();
+        deleted_count = 0;
         dimension = 0;
-        entry_point = std::numeric_limits<vamana::idx_t>::max();
-        next_internal_id = 0;
+        entry_point = kNoNode;
+        disk.reset();
+        navigator = ProductQuantizer();
+        pq_codes.clear();
+        cache_index.clear();
+        cache_records.clear();
+        slot_labels.clear();
+        label_entries.clear();
+        id_map_deferred = false;
+        precision = StoragePrecision::FP32;
+        rerank = 0;
+        quantizer = ScalarQuantizer();
+        rabitq_bits = kDefaultRabitqBits;
+        rabitq_quantizer = RaBitQuantizer();
+        center.clear();
+        codes.reset(0);
+        code_norms.clear();
+        mapping.reset();
+    }
+
+    // A mapped load leaves id_map empty; the first write that needs it
+    // builds it from the file's id block
+    void ensure_id_map() {
+        if (!id_map_deferred) {
+            return;
+        }
+        const auto* entries = mapping->id_map();
+        id_map.reserve(mapping->header().live_count);
+        for (uint64_t i = 0; i < mapping->header().live_count; ++i) {
+            id_map.emplace(entries[i].id, entries[i].slot);
+        }
+        id_map_deferred = false;
+    }
+
+    size_t live_count() const {
+        return id_map_deferred ? mapping->header().live_count : id_map.size();
     }
 
-    float compute_distance(const Vector& a, const Vector& b) const {
+    float compute_distance(const float* a, const float* b) const {
         switch (metric) {
             case DistanceMetric::L2:
-                return vamana::Distance::l2(a, b);
+                return vamana::Distance::l2(a, b, dimension);
             case DistanceMetric::INNER_PRODUCT:
-                return vamana::Distance::inner_product(a, b);
+                return vamana::Distance::inner_product(a, b, dimension);
             case DistanceMetric::COSINE:
-                return vamana::Distance::cosine(a, b);
+                return vamana::Distance::cosine(a, b, dimension);
+            default:
+                throw std::runtime_error("Vamana: unsupported distance metric");
+        }
+    }
+
+    size_t slots_in_use() const { return graph.size() - free_slots.size(); }
+
+    bool quantized() const { return precision != StoragePrecision::FP32; }
+    bool rabitq() const { return precision == StoragePrecision::RABITQ; }
+
+    // Switches to quantized storage for the given rows: learns the code
+    // range (RaBitQ: the center residuals are taken from) from them and
+    // sizes the code table. Before staging any row.
+    void configure_storage(StoragePrecision storage, const float* const* train_rows, size_t n) {
+        precision = storage;
+        if (!quantized()) {
+            return;
+        }
+        if (rabitq()) {
+            center.assign(dimension, 0.0f);
+            for (size_t i = 0; i < n; ++i) {
+                for (size_t d = 0; d < dimension; ++d) {
+                    center[d] += train_rows[i][d];
+                }
+            }
+            for (auto& value : center) {
+                value /= static_cast<float>(std::max<size_t>(n, 1));
+            }
+            rabitq_quantizer = RaBitQuantizer(dimension, rabitq_bits, seed);
+            codes.reset(rabitq_quantizer.code_size());
+            return;
+        }
+        quantizer = ScalarQuantizer(dimension, precision);
+        quantizer.train(train_rows, n);
+        codes.reset(quantizer.code_size());
+    }
+
+    // Writer only; the slot's row must be set
+    void encode(vamana::idx_t node) {
+        codes.reserve(static_cast<size_t>(node) + 1);
+        code_norms.resize(static_cast<size_t>(node) + 1);
+        uint8_t* code = codes[node];
+        if (rabitq()) {
+            thread_local std::vector<float> residual;
+            residual.resize(dimension);
+            for (size_t d = 0; d < dimension; ++d) {
+                residual[d] = rows[node][d] - center[d];
+            }
+            rabitq_quantizer.encode(residual.data(), code);
+            code_norms[node] = simd::norm_squared(rows[node], dimension);
+            return;
+        }
+        quantizer.encode(rows[node], code);
+        thread_local std::vector<float> decoded;
+        decoded.resize(dimension);
+        quantizer.decode(code, decoded.data());
+        code_norms[node] = simd::norm_squared(decoded.data(), dimension);
+    }
+
+    // Re-encodes every slot with a row, after a load or a renumbering
+    void encode_all() {
+        if (!quantized()) {
+            return;
+        }
+        for (vamana::idx_t node = 0; node < graph.size(); ++node) {
+            if (rows[node]) {
+                encode(node);
+            }
+        }
+    }
+
+    void prepare_query(const float* query, vamana::SearchScratch& scratch) const {
+        scratch.query_norm_sq =
+            metric == DistanceMetric::COSINE ? simd::norm_squared(query, dimension) : 0.0f;
+        if (!rabitq()) {
+            quantizer.prepare(query, scratch.coded);
+            return;
+        }
+        // L2 estimates |r - t| for t = q - center; inner products add
+        // <center, q> to <r, q>
+        if (metric == DistanceMetric::L2) {
+            scratch.target.resize(dimension);
+            for (size_t d = 0; d < dimension; ++d) {
+                scratch.target[d] = query[d] - center[d];
+            }
+            rabitq_quantizer.prepare(scratch.target.data(), scratch.rabitq);
+            scratch.center_dot = 0.0f;
+        } else {
+            rabitq_quantizer.prepare(query, scratch.rabitq);
+            scratch.center_dot = simd::inner_product(center.data(), query, dimension);
+        }
+    }
+
+    // RaBitQ estimate of compute_distance against the node's code, and a
+    // lower bound on the true distance that holds with high probability
+    std::pair<float, float> rabitq_distance(vamana::idx_t node,
+                                            const vamana::SearchScratch& scratch) const {
+        const uint8_t* code = codes[node];
+        const auto estimate = rabitq_quantizer.estimate(scratch.rabitq, code);
+        switch (metric) {
+            case DistanceMetric::L2: {
+                const float norm = rabitq_quantizer.residual_norm(code);
+                const float squared = norm * norm + scratch.rabitq.norm * scratch.rabitq.norm -
+                                      2.0f * estimate.dot;
+                return {std::sqrt(std::max(0.0f, squared)),
+                        std::sqrt(std::max(0.0f, squared - 2.0f * estimate.error))};
+            }
+            case DistanceMetric::INNER_PRODUCT: {
+                const float dist = 1.0f - (scratch.center_dot + estimate.dot);
+                return {dist, dist - estimate.error};
+            }
+            case DistanceMetric::COSINE: {
+                const float norms = std::sqrt(scratch.query_norm_sq * code_norms[node]);
+                if (norms == 0.0f) {
+                    return {1.0f, 1.0f};
+                }
+                const float dist = 1.0f - (scratch.center_dot + estimate.dot) / norms;
+                return {dist, dist - estimate.error / norms};
+            }
+            default:
+                throw std::runtime_error("Vamana: unsupported distance metric");
+        }
+    }
+
+    // compute_distance against the node's code, for a query prepared in
+    // scratch
+    float coded_distance(vamana::idx_t node, const vamana::SearchScratch& scratch) const {
+        if (rabitq()) {
+            return rabitq_distance(node, scratch).first;
+        }
+        const uint8_t* code = codes[node];
+        switch (metric) {
+            case DistanceMetric::L2:
+                return std::sqrt(std::max(0.0f, quantizer.l2_squared(scratch.coded, code)));
+            case DistanceMetric::INNER_PRODUCT:
+                return 1.0f - quantizer.inner_product(scratch.coded, code);
+            case DistanceMetric::COSINE: {
+                const float norms = scratch.query_norm_sq * code_norms[node];
+                return norms == 0.0f
+                           ? 1.0f
+                           : 1.0f - quantizer.inner_product(scratch.coded, code) / std::sqrt(norms);
+            }
             default:
                 throw std::runtime_error("Vamana: unsupported distance metric");
         }
     }
 
-    vamana::idx_t insert_node(VectorId external_id, const Vector& vector) {
-        const vamana::idx_t internal_id = next_internal_id++;
-        vamana::Vertex vertex(internal_id, vector);
-        nodes.emplace(internal_id, std::move(vertex));
-        id_map.emplace(external_id, internal_id);
-        reverse_id_map.emplace(internal_id, external_id);
+    // Distance a query search ranks nodes by: the code estimate under
+    // quantized storage, the row otherwise. Build searches use rows.
+    template <bool kBuild = false>
+    float query_distance(vamana::idx_t node, const float* query,
+                         const vamana::SearchScratch& scratch) const {
+        if (!kBuild && quantized()) {
+            return coded_distance(node, scratch);
+        }
+        return compute_distance(rows[node], query);
+    }
+
+    template <bool kBuild = false>
+    void prefetch_node(vamana::idx_t node) const {
+        if (!kBuild && quantized()) {
+            simd::prefetch_bytes(codes[node], codes.code_size());
+        } else {
+            simd::prefetch_row(rows[node], dimension);
+        }
+    }
+
+    // Copies the row into the index's own arena before linking it
+    void insert_owned(VectorId external_id, const float* values) {
+        link_batch({stage_owned(external_id, values, {})});
+    }
 
-        if (entry_point == std::numeric_limits<vamana::idx_t>::max()) {
-            entry_point = internal_id;
-            return internal_id;
+    // Links the view's rows in place when its storage keeps them alive
+    void insert_view(const DatasetView& view) {
+        std::vector<vamana::idx_t> nodes;
+        nodes.reserve(view.size());
+        if (!view.storage()) {
+            for (size_t i = 0; i < view.size(); ++i) {
+                nodes.push_back(stage_owned(view.id(i), view.row(i), view.labels(i)));
+            }
+        } else {
+            if (std::find(borrowed.begin(), borrowed.end(), view.storage()) == borrowed.end()) {
+                borrowed.push_back(view.storage());
+            }
+            for (size_t i = 0; i < view.size(); ++i) {
+                nodes.push_back(stage(view.id(i), view.row(i), view.labels(i)));
+            }
         }
+        link_batch(std::move(nodes));
+    }
 
-        float nearest_dist = compute_distance(nodes.at(entry_point).vector, vector);
-        vamana::idx_t nearest = entry_point;
-        greedy_update_nearest(nearest, nearest_dist, vector);
-        add_links_starting_from(internal_id, nearest);
-        return internal_id;
+    vamana::idx_t stage_owned(VectorId external_id, const float* values,
+                              std::span<const FilterLabel> filter_labels) {
+        if (!owned_rows) {
+            owned_rows = std::make_unique<VectorArena>(dimension);
+        }
+        const size_t slot = owned_rows->append(external_id, values);
+        const vamana::idx_t node = stage(external_id, owned_rows->row(slot), filter_labels);
+        owned_slots[node] = slot;
+        return node;
     }
 
-    void add_links_starting_from(vamana::idx_t start_id, vamana::idx_t nearest_id) {
-        MaxHeap link_targets;
-        greedy_search(nearest_id, nodes.at(start_id).vector, link_targets, ef_construction);
-        shrink_neighbor_list(link_targets, Mmax);
+    // Gives the row a live slot with no edges yet; re-staging an id
+    // replaces its old vertex
+    vamana::idx_t stage(VectorId external_id, const float* vector,
+                        std::span<const FilterLabel> filter_labels) {
+        ensure_id_map();
+        auto existing = id_map.find(external_id);
+        if (existing != id_map.end()) {
+            const vamana::idx_t old = existing->second;
+            id_map.erase(existing);
+            mark_deleted(old);
+        }
+        const vamana::idx_t node = allocate_slot(external_id, vector);
+        slot_labels[node].assign(filter_labels.begin(), filter_labels.end());
+        id_map.emplace(external_id, node);
+        return node;
+    }
 
-        std::vector<vamana::idx_t> neighbors;
-        neighbors.reserve(link_targets.size());
-        while (!link_targets.empty()) {
-            auto [dist, other] = link_targets.top();
-            link_targets.pop();
-            add_link(start_id, other);
-            neighbors.push_back(other);
+    vamana::idx_t allocate_slot(VectorId external_id, const float* vector) {
+        vamana::idx_t node;
+        if (!free_slots.empty()) {
+            node = free_slots.back();
+            free_slots.pop_back();
+            graph.clear(node);
+        } else {
+            node = graph.add_node();
+            rows.append();
+            labels.append();
+            states.append();
+            owned_slots.append();
+            slot_labels.append();
+            locks.append();
         }
-        for (auto other : neighbors) {
-            add_link(other, start_id);
+        rows[node] = vector;
+        labels[node] = external_id;
+        states[node] = SlotState::kLive;
+        owned_slots[node] = kNotOwned;
+        slot_labels[node].clear();
+        if (vector && quantized()) {
+            encode(node);
         }
+        return node;
     }
 
-    void add_link(vamana::idx_t src, vamana::idx_t dest) {
-        auto& src_neighbors = nodes.at(src).neighbors;
-        if (std::find(src_neighbors.begin(), src_neighbors.end(), dest) != src_neighbors.end()) {
+    // Builds the graph from scratch over an empty index, otherwise inserts
+    // the staged nodes into the existing graph in parallel
+    void link_batch(std::vector<vamana::idx_t> nodes) {
+        // A batch that repeats an id may have recycled a replaced slot
+        std::sort(nodes.begin(), nodes.end());
+        nodes.erase(std::unique(nodes.begin(), nodes.end()), nodes.end());
+        nodes.erase(std::remove_if(nodes.begin(), nodes.end(),
+                                   [this](vamana::idx_t node) {
+                                       return states[node] != SlotState::kLive;
+                                   }),
+                    nodes.end());
+        if (nodes.empty()) {
             return;
         }
-        if (src_neighbors.size() < Mmax) {
-            src_neighbors.push_back(dest);
+        // A tombstoned entry point still routes; consolidation moves it
+        // before freeing its slot
+        if (entry_point == kNoNode) {
+            build_graph(nodes);
             return;
         }
+        // The first node of a new label becomes its entry point
+        {
+            std::unique_lock<std::shared_mutex> lock(label_mutex);
+            for (auto node : nodes) {
+                for (auto label : slot_labels[node]) {
+                    label_entries.emplace(label, node);
+                }
+            }
+        }
+        ThreadPool::global()->parallel_for(0, nodes.size(), [&](size_t i) {
+            auto scratch = scratch_pool.acquire();
+            link(nodes[i], alpha, *scratch);
+        });
+    }
 
-        MaxHeap candidates;
-        candidates.emplace(compute_distance(nodes.at(src).vector, nodes.at(dest).vector), dest);
-        for (auto neighbor_id : src_neighbors) {
-            candidates.emplace(compute_distance(nodes.at(src).vector, nodes.at(neighbor_id).vector), neighbor_id);
+    // DiskANN batch build: medoid entry point, a random R-regular graph,
+    // then a pass with alpha = 1 and a pass with the configured alpha, each
+    // running GreedySearch + RobustPrune for every node in parallel. A
+    // labelled node draws half its random neighbours from its own labels,
+    // so the first pass's filtered searches start from a connected subgraph.
+    void build_graph(const std::vector<vamana::idx_t>& nodes) {
+        const auto members = label_members(nodes);
+        {
+            std::unique_lock<std::shared_mutex> lock(label_mutex);
+            for (const auto& [label, labelled] : members) {
+                label_entries[label] = medoid(labelled);
+            }
+        }
+        const size_t degree = std::min<size_t>(Mmax, nodes.size() - 1);
+        ThreadPool::global()->parallel_for(0, nodes.size(), [&](size_t i) {
+            std::mt19937 rng(seed + static_cast<uint32_t>(i));
+            std::vector<vamana::idx_t> neighbors;
+            neighbors.reserve(degree);
+            auto try_add = [&](vamana::idx_t other) {
+                if (other != nodes[i] &&
+                    std::find(neighbors.begin(), neighbors.end(), other) == neighbors.end()) {
+                    neighbors.push_back(other);
+                }
+            };
+            const auto& labels = slot_labels[nodes[i]];
+            for (size_t draw = 0; !labels.empty() && draw < degree && neighbors.size() < degree / 2;
+                 ++draw) {
+                const auto& labelled = members.at(labels[draw % labels.size()]);
+                try_add(labelled[std::uniform_int_distribution<size_t>(0, labelled.size() - 1)(rng)]);
+            }
+            std::uniform_int_distribution<size_t> pick(0, nodes.size() - 1);
+            while (neighbors.size() < degree) {
+                try_add(nodes[pick(rng)]);
+            }
+            graph.set_neighbors(nodes[i], neighbors.data(), neighbors.size());
+        });
+        // Published once the random graph is in place, so a concurrent
+        // search never starts from a node without edges
+        entry_point = medoid(nodes);
+
+        std::vector<vamana::idx_t> order = nodes;
+        std::mt19937 rng(seed);
+        for (const float pass_alpha : {1.0f, alpha}) {
+            std::shuffle(order.begin(), order.end(), rng);
+            ThreadPool::global()->parallel_for(0, order.size(), [&](size_t i) {
+                auto scratch = scratch_pool.acquire();
+                link(order[i], pass_alpha, *scratch);
+            });
         }
-        shrink_neighbor_list(candidates, Mmax);
-        src_neighbors.clear();
-        while (!candidates.empty()) {
-            src_neighbors.push_back(candidates.top().second);
-            candidates.pop();
+    }
+
+    // Members of each label among nodes; the medoid of each member list is
+    // the label's entry point (Filtered-DiskANN)
+    std::unordered_map<FilterLabel, std::vector<vamana::idx_t>> label_members(
+        const std::vector<vamana::idx_t>& nodes) const {
+        std::unordered_map<FilterLabel, std::vector<vamana::idx_t>> members;
+        for (auto node : nodes) {
+            for (auto label : slot_labels[node]) {
+                members[label].push_back(node);
+            }
         }
+        return members;
     }
 
-    void greedy_search(vamana::idx_t start,
-                       const Vector& query,
-                       MaxHeap& results,
-                       uint32_t search_width) const {
-        struct Candidate {
-            float dist;
-            vamana::idx_t id;
+    // The node closest (in L2) to the centroid of the batch
+    vamana::idx_t medoid(const std::vector<vamana::idx_t>& nodes) const {
+        std::vector<double> sum(dimension, 0.0);
+        for (auto node : nodes) {
+            const float* row = rows[node];
+            for (size_t d = 0; d < dimension; ++d) {
+                sum[d] += row[d];
+            }
+        }
+        Vector centroid(dimension);
+        for (size_t d = 0; d < dimension; ++d) {
+            centroid[d] = static_cast<float>(sum[d] / static_cast<double>(nodes.size()));
+        }
+
+        constexpr size_t kBlock = 1024;
+        const size_t blocks = (nodes.size() + kBlock - 1) / kBlock;
+        std::vector<DistAndId> block_best(blocks, {std::numeric_limits<float>::max(), kNoNode});
+        auto scan = [&](size_t block) {
+            const size_t end = std::min(nodes.size(), (block + 1) * kBlock);
+            for (size_t i = block * kBlock; i < end; ++i) {
+                const float dist = simd::l2_squared(rows[nodes[i]], centroid.data(), dimension);
+                block_best[block] = std::min(block_best[block], DistAndId{dist, nodes[i]});
+            }
         };
-        auto cmp = [](const Candidate& a, const Candidate& b) { return a.dist > b.dist; };
-        std::priority_queue<Candidate, std::vector<Candidate>, decltype(cmp)> candidates(cmp);
-
-        std::unordered_set<vamana::idx_t> visited;
-        const float start_dist = compute_distance(nodes.at(start).vector, query);
-        candidates.push({start_dist, start});
-        results.emplace(start_dist, start);
-        visited.insert(start);
-
-        const uint32_t beam_width = std::max<uint32_t>(search_width, 1);
-        while (!candidates.empty()) {
-            auto current = candidates.top();
-            candidates.pop();
-            const float best_result_dist = results.empty() ? std::numeric_limits<float>::max() : results.top().first;
-            if (current.dist > best_result_dist && results.size() >= beam_width) {
+        if (blocks == 1) {
+            scan(0);  // small label sets are not worth a pool round trip
+        } else {
+            ThreadPool::global()->parallel_for(0, blocks, scan);
+        }
+        return std::min_element(block_best.begin(), block_best.end())->second;
+    }
+
+    // GreedySearch from the entry point, RobustPrune over everything it
+    // expanded plus the current neighbours, then back-edges. Only one node
+    // lock is held at a time, and only to serialize rewrites of a record
+    // within the batch. A labelled node also searches within its own
+    // labels from their entry points (FilteredVamana), so every label's
+    // members stay connected among themselves.
+    void link(vamana::idx_t node, float prune_alpha, vamana::SearchScratch& scratch) {
+        const float* row = rows[node];
+        const uint32_t width = std::max(ef_construction, Mmax);
+        auto& candidates = scratch.candidates;
+        const auto& own_labels = slot_labels[node];
+        scratch.results.clear();
+        if (label_starts(own_labels, scratch.starts, node)) {
+            beam_search<true>(scratch.starts, row, width, kDefaultPrefetchDepth, scratch,
+                              own_labels);
+            scratch.results.swap(candidates);
+        }
+        scratch.starts.assign(1, entry_point.load());
+        beam_search<true>(scratch.starts, row, width, kDefaultPrefetchDepth, scratch);
+        candidates.insert(candidates.end(), scratch.results.begin(), scratch.results.end());
+
+        // Never link to tombstones, so consolidation can free them
+        std::erase_if(candidates, [this, node](const DistAndId& c) {
+            return c.second == node || states[c.second] != SlotState::kLive;
+        });
+        {
+            std::lock_guard<std::mutex> lock(locks[node]);
+            const vamana::idx_t* neighbors = graph.neighbors(node);
+            for (uint32_t i = 0; i < graph.degree(node); ++i) {
+                candidates.emplace_back(compute_distance(row, rows[neighbors[i]]), neighbors[i]);
+            }
+            sort_unique(candidates);
+            robust_prune(node, candidates, Mmax, prune_alpha, scratch.kept);
+            graph.set_neighbors(node, scratch.kept.data(), scratch.kept.size());
+        }
+
+        const std::vector<vamana::idx_t> added = scratch.kept;
+        for (auto other : added) {
+            std::lock_guard<std::mutex> lock(locks[other]);
+            if (graph.contains(other, node) || graph.try_append(other, node)) {
+                continue;
+            }
+            const float* other_row = rows[other];
+            candidates.clear();
+            candidates.emplace_back(compute_distance(other_row, row), node);
+            const vamana::idx_t* neighbors = graph.neighbors(other);
+            for (uint32_t i = 0; i < graph.degree(other); ++i) {
+                candidates.emplace_back(compute_distance(other_row, rows[neighbors[i]]),
+                                        neighbors[i]);
+            }
+            sort_unique(candidates);
+            robust_prune(other, candidates, Mmax, prune_alpha, scratch.kept);
+            graph.set_neighbors(other, scratch.kept.data(), scratch.kept.size());
+        }
+    }
+
+    static void sort_unique(std::vector<DistAndId>& candidates) {
+        std::sort(candidates.begin(), candidates.end());
+        candidates.erase(std::unique(candidates.begin(), candidates.end(),
+                                     [](const DistAndId& a, const DistAndId& b) {
+                                         return a.second == b.second;
+                                     }),
+                         candidates.end());
+    }
+
+    // Entry points of the given labels, skipping `self`; false when none
+    bool label_starts(std::span<const FilterLabel> filter,
+                      std::vector<vamana::idx_t>& starts,
+                      vamana::idx_t self = kNoNode) const {
+        starts.clear();
+        std::shared_lock<std::shared_mutex> lock(label_mutex);
+        for (auto label : filter) {
+            auto it = label_entries.find(label);
+            if (it != label_entries.end() && it->second != self &&
+                std::find(starts.begin(), starts.end(), it->second) == starts.end()) {
+                starts.push_back(it->second);
+            }
+        }
+        return !starts.empty();
+    }
+
+    bool has_any_label(vamana::idx_t node, std::span<const FilterLabel> filter) const {
+        const auto& own = slot_labels[node];
+        return std::any_of(filter.begin(), filter.end(), [&](FilterLabel label) {
+            return std::binary_search(own.begin(), own.end(), label);
+        });
+    }
+
+    // Best-first search from starts; leaves the `width` closest nodes seen
+    // in scratch.best. With a filter, only nodes carrying one of its labels
+    // are scored or expanded. Adjacency is copied through the record's
+    // seqlock, so a search never waits for a concurrent insert. Build
+    // searches (kBuild) record every expanded node in scratch.candidates.
+    // The unvisited neighbours of an expanded node are collected first and
+    // their rows prefetched prefetch_depth ahead of the one being scored.
+    // Query searches over quantized storage score and prefetch codes.
+    template <bool kBuild>
+    void beam_search(const std::vector<vamana::idx_t>& starts,
+                     const float* query,
+                     uint32_t width,
+                     uint32_t prefetch_depth,
+                     vamana::SearchScratch& scratch,
+                     std::span<const FilterLabel> filter = {}) const {
+        auto& visited = scratch.visited;
+        auto& frontier = scratch.frontier;
+        auto& best = scratch.best;
+        visited.prepare(graph.size());
+        frontier.clear();
+        best.reset(width);
+        if (kBuild) {
+            scratch.candidates.clear();
+        }
+
+        for (const auto start : starts) {
+            const float start_dist = query_distance<kBuild>(start, query, scratch);
+            visited.visit(start);
+            frontier.push(start_dist, start);
+            best.push(start_dist, start);
+        }
+
+        auto& adjacency = scratch.adjacency;
+        auto& pending = scratch.pending;
+        while (!frontier.empty()) {
+            const auto [current_dist, current] = frontier.pop();
+            if (best.full() && current_dist > best.top().first) {
                 break;
             }
+            if constexpr (kBuild) {
+                scratch.candidates.emplace_back(current_dist, current);
+            }
+            const uint32_t degree = graph.read(current, adjacency);
+            pending.clear();
+            for (uint32_t i = 0; i < degree; ++i) {
+                const vamana::idx_t neighbor_id = adjacency[i];
+                if (visited.visit(neighbor_id) &&
+                    (filter.empty() || has_any_label(neighbor_id, filter))) {
+                    pending.push_back(neighbor_id);
+                }
+            }
+            const size_t ahead = std::min<size_t>(prefetch_depth, pending.size());
+            for (size_t i = 0; i < ahead; ++i) {
+                prefetch_node<kBuild>(pending[i]);
+            }
+            for (size_t i = 0; i < pending.size(); ++i) {
+                if (ahead > 0 && i + ahead < pending.size()) {
+                    prefetch_node<kBuild>(pending[i + ahead]);
+                }
+                const vamana::idx_t neighbor_id = pending[i];
+                const float dist = query_distance<kBuild>(neighbor_id, query, scratch);
+                if (best.push(dist, neighbor_id)) {
+                    frontier.push(dist, neighbor_id);
+                }
+            }
+        }
+    }
+
+    void greedy_update_nearest(vamana::idx_t& nearest,
+                               float& nearest_dist,
+                               const float* query,
+                               vamana::SearchScratch& scratch) const {
+        auto& neighbors = scratch.adjacency;
+        bool improved = true;
+        while (improved) {
+            improved = false;
+            const uint32_t degree = graph.read(nearest, neighbors);
+            for (uint32_t i = 0; i < degree; ++i) {
+                const float dist = query_distance(neighbors[i], query, scratch);
+                if (dist < nearest_dist) {
+                    nearest_dist = dist;
+                    nearest = neighbors[i];
+                    improved = true;
+                }
+            }
+        }
+    }
+
+    // RobustPrune over candidates sorted closest first: a candidate is
+    // dropped when an already kept neighbour is prune_alpha times closer
+    // to it than the node being pruned, and (FilteredRobustPrune) carries
+    // every label the node and the candidate share. The node's labels are
+    // served first, rarest among the candidates first, each with up to
+    // half the degree: neither nearby unlabelled points nor a broad label
+    // can crowd out the edges that keep a selective label connected. A
+    // quarter of the degree is always left to the unrestricted pass.
+    void robust_prune(vamana::idx_t node,
+                      const std::vector<DistAndId>& candidates,
+                      uint32_t max_size,
+                      float prune_alpha,
+                      std::vector<vamana::idx_t>& kept) const {
+        kept.clear();
+        const auto& labels = slot_labels[node];
+        if (labels.size() == 1) {
+            prune_into(node, candidates, max_size / 2, prune_alpha, &labels[0], kept);
+        } else if (!labels.empty()) {
+            std::vector<std::pair<size_t, FilterLabel>> order;
+            order.reserve(labels.size());
+            for (const FilterLabel label : labels) {
+                order.emplace_back(std::count_if(candidates.begin(), candidates.end(),
+                                                 [&](const DistAndId& c) {
+                                                     return has_any_label(c.second, {&label, 1});
+                                                 }),
+                                   label);
+            }
+            std::sort(order.begin(), order.end());
+            const size_t labelled_cap = max_size - max_size / 4;
+            for (const auto& [count, label] : order) {
+                const size_t cap = std::min<size_t>(kept.size() + max_size / 2, labelled_cap);
+                prune_into(node, candidates, cap, prune_alpha, &label, kept);
+            }
+        }
+        prune_into(node, candidates, max_size, prune_alpha, nullptr, kept);
+    }
+
+    // Appends to kept, up to max_size, the candidates (only those carrying
+    // `label` when given) no kept neighbour dominates
+    void prune_into(vamana::idx_t node,
+                    const std::vector<DistAndId>& candidates,
+                    size_t max_size,
+                    float prune_alpha,
+                    const FilterLabel* label,
+                    std::vector<vamana::idx_t>& kept) const {
+        for (const auto& [candidate_dist, candidate] : candidates) {
+            if (kept.size() >= max_size) {
+                break;
+            }
+            if ((label && !has_any_label(candidate, {label, 1})) ||
+                std::find(kept.begin(), kept.end(), candidate) != kept.end()) {
+                continue;
+            }
+            bool keep = true;
+            for (auto chosen : kept) {
+                if (prune_alpha * compute_distance(rows[candidate], rows[chosen]) <=
+                        candidate_dist &&
+                    covers_shared_labels(node, candidate, chosen)) {
+                    keep = false;
+                    break;
+                }
+            }
+            if (keep) {
+                kept.push_back(candidate);
+            }
+        }
+    }
+
+    bool covers_shared_labels(vamana::idx_t node,
+                              vamana::idx_t candidate,
+                              vamana::idx_t chosen) const {
+        const auto& a = slot_labels[node];
+        const auto& b = slot_labels[candidate];
+        const auto& c = slot_labels[chosen];
+        auto i = a.begin();
+        auto j = b.begin();
+        while (i != a.end() && j != b.end()) {
+            if (*i < *j) {
+                ++i;
+            } else if (*j < *i) {
+                ++j;
+            } else {
+                if (!std::binary_search(c.begin(), c.end(), *i)) {
+                    return false;
+                }
+                ++i;
+                ++j;
+            }
+        }
+        return true;
+    }
+
+    void remove(VectorId id) {
+        ensure_id_map();
+        auto it = id_map.find(id);
+        if (it == id_map.end()) {
+            return;
+        }
+        const vamana::idx_t node = it->second;
+        id_map.erase(it);
+        mark_deleted(node);
+    }
+
+    // Deletes only tombstone: searches still route through the node but
+    // never return it. Once tombstones reach kDeleteBatchThresholdPercent
+    // of the slots, the consolidation worker unlinks and frees them.
+    void mark_deleted(vamana::idx_t node) {
+        states[node] = SlotState::kDeleted;
+        ++deleted_count;
+        // The on-disk graph is immutable; its tombstones stay until a refit
+        if (!disk && deleted_count * 100 >= slots_in_use() * kDeleteBatchThresholdPercent) {
+            request_consolidation();
+        }
+    }
+
+    void request_consolidation() {
+        std::lock_guard<std::mutex> lock(consolidate_mutex);
+        if (!consolidator.joinable()) {
+            consolidator = std::thread([this] { consolidator_loop(); });
+        }
+        consolidate_requested = true;
+        consolidate_cv.notify_all();
+    }
+
+    void consolidator_loop() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(consolidate_mutex);
+                consolidate_cv.wait(lock, [this] {
+                    return stop_consolidator || (consolidate_requested && !consolidating);
+                });
+                if (stop_consolidator) {
+                    return;
+                }
+                consolidate_requested = false;
+                consolidating = true;
+            }
+            consolidate();
+            finish_consolidation();
+        }
+    }
+
+    // Runs a round on the calling thread once any background round is done
+    void consolidate_now() {
+        {
+            std::unique_lock<std::mutex> lock(consolidate_mutex);
+            consolidate_cv.wait(lock, [this] { return !consolidating; });
+            consolidate_requested = false;
+            consolidating = true;
+        }
+        consolidate();
+        finish_consolidation();
+    }
+
+    void finish_consolidation() {
+        std::lock_guard<std::mutex> lock(consolidate_mutex);
+        consolidating = false;
+        consolidate_cv.notify_all();
+    }
+
+    // Joins the worker; a round in flight stops at its next chunk and
+    // leaves its remaining tombstones in place. Callers must not hold
+    // graph_mutex.
+    void stop_consolidation() {
+        {
+            std::lock_guard<std::mutex> lock(consolidate_mutex);
+            stop_consolidator = true;
+            consolidate_cv.notify_all();
+        }
+        if (consolidator.joinable()) {
+            consolidator.join();
+        }
+        std::lock_guard<std::mutex> lock(consolidate_mutex);
+        stop_consolidator = false;
+        consolidate_requested = false;
+    }
+
+    bool consolidation_stopping() {
+        std::lock_guard<std::mutex> lock(consolidate_mutex);
+        return stop_consolidator;
+    }
+
+    // FreshDiskANN delete consolidation over the tombstones present when
+    // the round starts. Slots are scanned kConsolidateChunk at a time, each
+    // chunk under write_mutex, so writers wait for at most one chunk and
+    // searches not at all. Only vertices pointing at a doomed node are
+    // re-pruned. Inserts between chunks never link to tombstones, so a
+    // scanned vertex stays clean. Once nothing links to the doomed nodes
+    // and no entry point is one of them, a momentary exclusive lock waits
+    // out the searches that may still hold one, and the slots are freed.
+    void consolidate() {
+        std::vector<uint8_t> doomed;
+        {
+            std::shared_lock<std::shared_mutex> graph_lock(graph_mutex);
+            std::lock_guard<std::mutex> write_lock(write_mutex);
+            if (disk || deleted_count == 0) {
+                return;
+            }
+            doomed.resize(graph.size());
+            for (vamana::idx_t node = 0; node < graph.size(); ++node) {
+                doomed[node] = states[node] == SlotState::kDeleted;
+            }
+        }
+        auto is_doomed = [&doomed](vamana::idx_t node) {
+            return node < doomed.size() && doomed[node];
+        };
+
+        std::vector<DistAndId> candidate_dists;
+        std::vector<vamana::idx_t> kept;
+        for (size_t begin = 0;; begin += kConsolidateChunk) {
+            if (consolidation_stopping()) {
+                return;
+            }
+            std::shared_lock<std::shared_mutex> graph_lock(graph_mutex);
+            std::lock_guard<std::mutex> write_lock(write_mutex);
+            const size_t end = std::min<size_t>(graph.size(), begin + kConsolidateChunk);
+            for (vamana::idx_t node = begin; node < end; ++node) {
+                if (states[node] != SlotState::kFree && !is_doomed(node)) {
+                    unlink_doomed(node, is_doomed, candidate_dists, kept);
+                }
+            }
+            if (end < graph.size()) {
+                continue;
+            }
+            move_doomed_entries(is_doomed);
+            break;
+        }
+
+        { std::unique_lock<std::shared_mutex> grace_period(graph_mutex); }
+        {
+            std::shared_lock<std::shared_mutex> graph_lock(graph_mutex);
+            std::lock_guard<std::mutex> write_lock(write_mutex);
+            for (vamana::idx_t node = 0; node < doomed.size(); ++node) {
+                if (doomed[node]) {
+                    free_slot(node);
+                }
+            }
+        }
+        std::unique_lock<std::shared_mutex> graph_lock(graph_mutex);
+        std::lock_guard<std::mutex> write_lock(write_mutex);
+        if (owned_rows && owned_rows->dead_count() > VectorArena::kRowsPerChunk &&
+            owned_rows->dead_count() > owned_rows->live_count()) {
+            compact_owned_rows();
+        }
+    }
+
+    // Points the global and label entry points that are about to be freed
+    // at the nearest live node, searched while the doomed node is still
+    // linked, or at any live node (label member) when none is reachable
+    template <typename Doomed>
+    void move_doomed_entries(const Doomed& is_doomed) {
+        auto scratch = scratch_pool.acquire();
+        const vamana::idx_t entry = entry_point;
+        if (entry != kNoNode && is_doomed(entry)) {
+            const vamana::idx_t replacement = nearest_live(entry, {}, *scratch);
+            entry_point = replacement == kNoNode ? first_live() : replacement;
+        }
+        std::vector<std::pair<FilterLabel, vamana::idx_t>> moved;
+        {
+            std::shared_lock<std::shared_mutex> lock(label_mutex);
+            for (const auto& [label, node] : label_entries) {
+                if (is_doomed(node)) {
+                    moved.emplace_back(label, node);
+                }
+            }
+        }
+        for (auto& [label, node] : moved) {
+            node = nearest_live(node, {&label, 1}, *scratch);
+            if (node == kNoNode) {
+                node = first_live(&label);
+            }
+        }
+        std::unique_lock<std::shared_mutex> lock(label_mutex);
+        for (const auto& [label, node] : moved) {
+            if (node == kNoNode) {
+                label_entries.erase(label);
+            } else {
+                label_entries[label] = node;
+            }
+        }
+    }
+
+    // Replaces edges to doomed nodes. A live vertex re-prunes its other
+    // neighbours plus the doomed neighbours' live neighbours; a newer
+    // tombstone just drops the edges, as it is freed by a later round.
+    template <typename Doomed>
+    void unlink_doomed(vamana::idx_t node, const Doomed& is_doomed,
+                       std::vector<DistAndId>& candidate_dists,
+                       std::vector<vamana::idx_t>& kept) {
+        const vamana::idx_t* neighbors = graph.neighbors(node);
+        const uint32_t degree = graph.degree(node);
+        if (std::none_of(neighbors, neighbors + degree, is_doomed)) {
+            return;
+        }
+        if (states[node] != SlotState::kLive) {
+            kept.assign(neighbors, neighbors + degree);
+            std::erase_if(kept, is_doomed);
+            graph.set_neighbors(node, kept.data(), kept.size());
+            return;
+        }
+        candidate_dists.clear();
+        for (uint32_t i = 0; i < degree; ++i) {
+            const vamana::idx_t neighbor_id = neighbors[i];
+            if (!is_doomed(neighbor_id)) {
+                candidate_dists.emplace_back(compute_distance(rows[node], rows[neighbor_id]),
+                                             neighbor_id);
+                continue;
+            }
+            const vamana::idx_t* nested = graph.neighbors(neighbor_id);
+            for (uint32_t j = 0; j < graph.degree(neighbor_id); ++j) {
+                if (states[nested[j]] == SlotState::kLive && nested[j] != node) {
+                    candidate_dists.emplace_back(
+                        compute_distance(rows[node], rows[nested[j]]), nested[j]);
+                }
+            }
+        }
+        sort_unique(candidate_dists);
+        if (candidate_dists.size() <= Mmax) {
+            kept.clear();
+            for (const auto& candidate : candidate_dists) {
+                kept.push_back(candidate.second);
+            }
+        } else {
+            robust_prune(node, candidate_dists, Mmax, alpha, kept);
+        }
+        graph.set_neighbors(node, kept.data(), kept.size());
+    }
+
+    // The live node (carrying one of filter's labels, if given) closest to
+    // a tombstone, found by searching for its row from the current entry
+    // points while it is still linked
+    vamana::idx_t nearest_live(vamana::idx_t node, std::span<const FilterLabel> filter,
+                               vamana::SearchScratch& scratch) const {
+        search(rows[node], 1, ef_search, 0, kDefaultPrefetchDepth, 0, filter, scratch);
+        return scratch.results.empty() ? kNoNode : scratch.results.front().second;
+    }
+
+    void free_slot(vamana::idx_t node) {
+        states[node] = SlotState::kFree;
+        graph.clear(node);
+        rows[node] = nullptr;
+        slot_labels[node].clear();
+        if (owned_slots[node] != kNotOwned) {
+            owned_rows->release(owned_slots[node]);
+            owned_slots[node] = kNotOwned;
+        }
+        free_slots.push_back(node);
+        --deleted_count;
+    }
+
+    // Optional trailing section of both save formats; files without it
+    // load as unlabelled
+    void write_labels(std::ostream& out) const {
+        uint64_t labelled = 0;
+        for (size_t node = 0; node < slot_labels.size(); ++node) {
+            labelled += slot_labels[node].empty() ? 0 : 1;
+        }
+        out.write(reinterpret_cast<const char*>(&labelled), sizeof(labelled));
+        for (vamana::idx_t node = 0; node < slot_labels.size(); ++node) {
+            const auto& own = slot_labels[node];
+            if (own.empty()) {
+                continue;
+            }
+            const uint32_t count = static_cast<uint32_t>(own.size());
+            out.write(reinterpret_cast<const char*>(&node), sizeof(node));
+            out.write(reinterpret_cast<const char*>(&count), sizeof(count));
+            out.write(reinterpret_cast<const char*>(own.data()), count * sizeof(FilterLabel));
+        }
+        const uint64_t entries = label_entries.size();
+        out.write(reinterpret_cast<const char*>(&entries), sizeof(entries));
+        for (const auto& [label, node] : label_entries) {
+            out.write(reinterpret_cast<const char*>(&label), sizeof(label));
+            out.write(reinterpret_cast<const char*>(&node), sizeof(node));
+        }
+    }
+
+    bool read_labels(std::istream& in) {
+        slot_labels.resize(states.size());
+        if (in.peek() == std::char_traits<char>::eof()) {
+            in.clear();
+            return true;
+        }
+        uint64_t labelled = 0;
+        in.read(reinterpret_cast<char*>(&labelled), sizeof(labelled));
+        if (!in || labelled > states.size()) {
+            return false;
+        }
+        for (uint64_t i = 0; i < labelled; ++i) {
+            vamana::idx_t node = 0;
+            uint32_t count = 0;
+            in.read(reinterpret_cast<char*>(&node), sizeof(node));
+            in.read(reinterpret_cast<char*>(&count), sizeof(count));
+            if (!in || node >= states.size() || count > (1u << 20)) {
+                return false;
+            }
+            slot_labels[node].resize(count);
+            in.read(reinterpret_cast<char*>(slot_labels[node].data()), count * sizeof(FilterLabel));
+        }
+        uint64_t entries = 0;
+        in.read(reinterpret_cast<char*>(&entries), sizeof(entries));
+        for (uint64_t i = 0; i < entries && in; ++i) {
+            FilterLabel label = 0;
+            vamana::idx_t node = 0;
+            in.read(reinterpret_cast<char*>(&label), sizeof(label));
+            in.read(reinterpret_cast<char*>(&node), sizeof(node));
+            if (node >= states.size() || states[node] == SlotState::kFree) {
+                return false;
+            }
+            label_entries[label] = node;
+        }
+        return static_cast<bool>(in);
+    }
+
+    // The lowest live slot, optionally among a label's members
+    vamana::idx_t first_live(const FilterLabel* label = nullptr) const {
+        for (vamana::idx_t node = 0; node < graph.size(); ++node) {
+            if (states[node] == SlotState::kLive && (!label || has_any_label(node, {label, 1}))) {
+                return node;
+            }
+        }
+        return kNoNode;
+    }
+
+    void compact_owned_rows() {
+        auto compacted = std::make_unique<VectorArena>(dimension);
+        for (vamana::idx_t node = 0; node < graph.size(); ++node) {
+            if (owned_slots[node] != kNotOwned) {
+                owned_slots[node] = compacted->append(labels[node], rows[node]);
+                rows[node] = compacted->row(owned_slots[node]);
+            }
+        }
+        owned_rows = std::move(compacted);
+    }
+
+    // Renumbers the slots in BFS order from the entry point, so the nodes a
+    // search expands together get neighbouring adjacency records, table
+    // entries and rows. Rows are copied into owned_rows in the new order;
+    // borrowed storage is let go. Callers hold graph_mutex exclusively with
+    // consolidation stopped, as the permutation invalidates every slot id.
+    void reorder() {
+        const size_t count = graph.size();
+        if (count == 0 || entry_point == kNoNode) {
+            return;
+        }
+        const auto new_of = bfs_order<vamana::idx_t>(
+            count, entry_point, [this](vamana::idx_t node, auto&& visit) {
+                const vamana::idx_t* neighbors = graph.neighbors(node);
+                for (uint32_t i = 0; i < graph.degree(node); ++i) {
+                    visit(neighbors[i]);
+                }
+            });
+        ensure_id_map();
+
+        // Old tables, read back while the slots are rewritten in place
+        std::vector<vamana::idx_t> old_of(count);
+        std::vector<vamana::idx_t> adjacency(count * Mmax);
+        std::vector<uint32_t> degrees(count);
+        std::vector<const float*> old_rows(count);
+        std::vector<VectorId> old_labels(count);
+        std::vector<SlotState> old_states(count);
+        std::vector<std::vector<FilterLabel>> old_slot_labels(count);
+        for (vamana::idx_t node = 0; node < count; ++node) {
+            old_of[new_of[node]] = node;
+            degrees[node] = graph.degree(node);
+            std::copy_n(graph.neighbors(node), degrees[node], adjacency.begin() + node * Mmax);
+            old_rows[node] = rows[node];
+            old_labels[node] = labels[node];
+            old_states[node] = states[node];
+            old_slot_labels[node] = std::move(slot_labels[node]);
+        }
+
+        auto arena = std::make_unique<VectorArena>(dimension);
+        std::vector<vamana::idx_t> neighbors(Mmax);
+        for (vamana::idx_t node = 0; node < count; ++node) {
+            const vamana::idx_t old = old_of[node];
+            for (uint32_t i = 0; i < degrees[old]; ++i) {
+                neighbors[i] = new_of[adjacency[old * Mmax + i]];
+            }
+            graph.set_neighbors(node, neighbors.data(), degrees[old]);
+            labels[node] = old_labels[old];
+            states[node] = old_states[old];
+            slot_labels[node] = std::move(old_slot_labels[old]);
+            if (old_rows[old]) {
+                owned_slots[node] = arena->append(labels[node], old_rows[old]);
+                rows[node] = arena->row(owned_slots[node]);
+            } else {
+                owned_slots[node] = kNotOwned;
+                rows[node] = nullptr;
+            }
+        }
+        owned_rows = std::move(arena);
+        borrowed.clear();
+
+        for (auto& [id, node] : id_map) {
+            node = new_of[node];
+        }
+        for (auto& node : free_slots) {
+            node = new_of[node];
+        }
+        for (auto& [label, node] : label_entries) {
+            node = new_of[node];
+        }
+        entry_point = new_of[entry_point];
+        encode_all();
+    }
+
+    // Writes the graph and rows to disk_path, keeps PQ codes and a cached
+    // neighbourhood of the entry point, then drops the in-memory copies
+    void move_to_disk() {
+        std::vector<const float*> row_table(graph.size());
+        for (size_t node = 0; node < row_table.size(); ++node) {
+            row_table[node] = rows[node];
+        }
+        if (!vamana::DiskGraph::write(disk_path, graph, row_table, dimension,
+                                      static_cast<uint32_t>(metric), entry_point)) {
+            throw std::runtime_error("Vamana: failed to write disk index " + disk_path);
+        }
+        train_navigator();
+        cache_neighborhood();
+
+        auto file = std::make_unique<vamana::DiskGraph>();
+        if (!file->open(disk_path)) {
+            throw std::runtime_error("Vamana: failed to open disk index " + disk_path);
+        }
+        disk = std::move(file);
+
+        graph.reset(Mmax);
+        rows.clear();
+        owned_slots.clear();
+        owned_rows.reset();
+        borrowed.clear();
+        locks.clear();
+    }
+
+    // Cosine navigates on unit vectors, so PQ training, codes and query
+    // tables all see normalized rows
+    void navigation_row(const float* row, std::vector<float>& out) const {
+        out.assign(row, row + dimension);
+        if (metric != DistanceMetric::COSINE) {
+            return;
+        }
+        const float norm = std::sqrt(simd::inner_product(row, row, dimension));
+        if (norm > 0.0f) {
+            for (float& v : out) {
+                v /= norm;
+            }
+        }
+    }
+
+    void train_navigator() {
+        const size_t m = pq_m > 0 ? pq_m : ProductQuantizer::default_m(dimension);
+        navigator = ProductQuantizer(dimension, m, 8);
+
+        std::vector<vamana::idx_t> sample;
+        for (vamana::idx_t node = 0; node < graph.size(); ++node) {
+            if (states[node] != SlotState::kFree) {
+                sample.push_back(node);
+            }
+        }
+        if (sample.size() > kMaxNavigatorTrainingRows) {
+            std::mt19937 rng(seed);
+            std::shuffle(sample.begin(), sample.end(), rng);
+            sample.resize(kMaxNavigatorTrainingRows);
+        }
+        std::vector<float> points(sample.size() * dimension);
+        std::vector<float> row;
+        for (size_t i = 0; i < sample.size(); ++i) {
+            navigation_row(rows[sample[i]], row);
+            std::copy(row.begin(), row.end(), points.begin() + i * dimension);
+        }
+        KMeansOptions options;
+        options.seed = seed;
+        navigator.train(points.data(), sample.size(), options);
+
+        pq_codes.assign(graph.size() * navigator.code_size(), 0);
+        constexpr size_t kBlock = 1024;
+        const size_t blocks = (graph.size() + kBlock - 1) / kBlock;
+        ThreadPool::global()->parallel_for(0, blocks, [&](size_t block) {
+            std::vector<float> normalized;
+            const size_t end = std::min(graph.size(), (block + 1) * kBlock);
+            for (size_t node = block * kBlock; node < end; ++node) {
+                if (rows[node]) {
+                    navigation_row(rows[node], normalized);
+                    navigator.encode(normalized.data(),
+                                     pq_codes.data() + node * navigator.code_size());
+                }
+            }
+        });
+    }
+
+    // Keeps the records of the first cache_nodes nodes reached breadth-first
+    // from the entry point, which every search starts from
+    void cache_neighborhood() {
+        std::vector<vamana::idx_t> order;
+        if (cache_nodes > 0) {
+            order.push_back(entry_point);
+            cache_index.emplace(entry_point.load(), 0);
+        }
+        for (size_t head = 0; head < order.size() && order.size() < cache_nodes; ++head) {
+            const vamana::idx_t* neighbors = graph.neighbors(order[head]);
+            for (uint32_t i = 0; i < graph.degree(order[head]) && order.size() < cache_nodes; ++i) {
+                if (cache_index.emplace(neighbors[i], static_cast<uint32_t>(order.size())).second) {
+                    order.push_back(neighbors[i]);
+                }
+            }
+        }
+        const size_t bytes = vamana::DiskGraph::record_bytes(dimension, Mmax);
+        cache_records.assign(order.size() * bytes, 0);
+        for (size_t i = 0; i < order.size(); ++i) {
+            vamana::DiskGraph::encode_record(rows[order[i]], dimension, graph.neighbors(order[i]),
+                                             graph.degree(order[i]), Mmax,
+                                             cache_records.data() + i * bytes);
+        }
+    }
+
+    // Cached node ids in cache slot order
+    std::vector<vamana::idx_t> cached_nodes() const {
+        std::vector<vamana::idx_t> order(cache_index.size());
+        for (const auto& [node, slot] : cache_index) {
+            order[slot] = node;
+        }
+        return order;
+    }
+
+    // DiskANN beam search: the list is ranked by PQ distance, up to
+    // beam_width of its closest unexpanded nodes are fetched per hop (cache
+    // first, then one round of preads), and every fetched node is scored
+    // exactly from its full-precision row for the final ranking. Starts
+    // from scratch.starts; the filter is checked against in-memory labels
+    // before a node is queued, so unmatched records are never read.
+    void search_disk(const float* query, uint32_t k, uint32_t width, uint32_t beam_width,
+                     std::span<const FilterLabel> filter,
+                     vamana::SearchScratch& scratch) const {
+        navigation_row(query, scratch.query);
+        scratch.table.resize(navigator.table_size());
+        navigator.compute_table(scratch.query.data(), metric != DistanceMetric::L2,
+                                scratch.table.data());
+        const size_t code_size = navigator.code_size();
+        auto estimate = [&](vamana::idx_t node) {
+            return navigator.table_distance(scratch.table.data(),
+                                            pq_codes.data() + node * code_size);
+        };
+
+        auto& visited = scratch.visited;
+        auto& frontier = scratch.frontier;
+        auto& best = scratch.best;
+        auto& exact = scratch.candidates;
+        visited.prepare(states.size());
+        frontier.clear();
+        best.reset(width);
+        exact.clear();
+
+        for (const auto start : scratch.starts) {
+            const float start_dist = estimate(start);
+            visited.visit(start);
+            frontier.push(start_dist, start);
+            best.push(start_dist, start);
+        }
+
+        const size_t bytes = disk->record_size();
+        auto& batch = scratch.batch;
+        auto& misses = scratch.misses;
+        while (!frontier.empty()) {
+            batch.clear();
+            while (!frontier.empty() && batch.size() < beam_width) {
+                const auto [dist, node] = frontier.pop();
+                if (best.full() && dist > best.top().first) {
+                    frontier.clear();
+                    break;
+                }
+                batch.push_back(node);
+            }
+
+            misses.clear();
+            for (const auto node : batch) {
+                if (cache_index.find(node) == cache_index.end()) {
+                    misses.push_back(node);
+                }
+            }
+            if (!misses.empty() && !disk->read(misses.data(), misses.size(), scratch.io_buffer)) {
+                throw std::runtime_error("Vamana: failed to read disk index " + disk->path());
+            }
 
-            const auto& neighbors = nodes.at(current.id).neighbors;
-            for (auto neighbor_id : neighbors) {
-                if (visited.insert(neighbor_id).second) {
-                    const float dist = compute_distance(nodes.at(neighbor_id).vector, query);
-                    if (results.size() < beam_width || dist < results.top().first) {
-                        candidates.push({dist, neighbor_id});
-                        results.emplace(dist, neighbor_id);
-                        if (results.size() > beam_width) {
-                            results.pop();
-                        }
+            size_t miss = 0;
+            for (const auto node : batch) {
+                auto cached = cache_index.find(node);
+                const char* record = cached != cache_index.end()
+                                         ? cache_records.data() + cached->second * bytes
+                                         : scratch.io_buffer.data() + miss++ * bytes;
+                const auto view = disk->view(record);
+                exact.emplace_back(compute_distance(view.vector, query), node);
+                for (uint32_t i = 0; i < view.degree; ++i) {
+                    const vamana::idx_t neighbor_id = view.neighbors[i];
+                    if (!visited.visit(neighbor_id) ||
+                        (!filter.empty() && !has_any_label(neighbor_id, filter))) {
+                        continue;
+                    }
+                    const float dist = estimate(neighbor_id);
+                    if (best.push(dist, neighbor_id)) {
+                        frontier.push(dist, neighbor_id);
                     }
                 }
             }
         }
-    }
-
-    MaxHeap search_base_layer(vamana::idx_t start,
-                              const Vector& query,
-                              uint32_t ef) const {
-        MaxHeap top_candidates;
-        struct Candidate {
-            float dist;
-            vamana::idx_t id;
-        };
-        auto cmp = [](const Candidate& a, const Candidate& b) { return a.dist > b.dist; };
-        std::priority_queue<Candidate, std::vector<Candidate>, decltype(cmp)> candidates(cmp);
 
-        float lower_bound = compute_distance(nodes.at(start).vector, query);
-        candidates.push({lower_bound, start});
-        top_candidates.emplace(lower_bound, start);
-
-        std::unordered_set<vamana::idx_t> visited;
-        visited.insert(start);
-
-        while (!candidates.empty()) {
-            auto current = candidates.top();
-            if (current.dist > lower_bound && top_candidates.size() >= ef) {
+        auto& hits = scratch.results;
+        std::sort(exact.begin(), exact.end());
+        hits.clear();
+        for (const auto& hit : exact) {
+            if (hits.size() >= k) {
                 break;
             }
-            candidates.pop();
-
-            for (auto neighbor_id : nodes.at(current.id).neighbors) {
-                if (visited.insert(neighbor_id).second) {
-                    const float dist = compute_distance(nodes.at(neighbor_id).vector, query);
-                    if (top_candidates.size() < ef || dist < lower_bound) {
-                        candidates.push({dist, neighbor_id});
-                        top_candidates.emplace(dist, neighbor_id);
-                        if (top_candidates.size() > ef) {
-                            top_candidates.pop();
-                        }
-                        if (!top_candidates.empty()) {
-                            lower_bound = top_candidates.top().first;
-                        }
-                    }
-                }
+            if (states[hit.second] == SlotState::kLive) {
+                hits.push_back(hit);
             }
         }
-        return top_candidates;
     }
 
-    void greedy_update_nearest(vamana::idx_t& nearest,
-                               float& nearest_dist,
-                               const Vector& query) const {
-        bool improved = true;
-        while (improved) {
-            improved = false;
-            for (auto neighbor : nodes.at(nearest).neighbors) {
-                const float dist = compute_distance(nodes.at(neighbor).vector, query);
-                if (dist < nearest_dist) {
-                    nearest_dist = dist;
-                    nearest = neighbor;
-                    improved = true;
-                }
-            }
+    // Leaves up to k live hits in scratch.results, closest first. A
+    // filtered search starts from the entry points of the filter's labels
+    // and only walks nodes carrying one of them. Over quantized storage
+    // the closest max(k, rerank) code estimates are re-scored on the float
+    // rows when rerank > 0; otherwise hits carry the estimates. RaBitQ
+    // re-scores them in order of lower bound and stops once no bound can
+    // beat the k-th exact distance. scratch.reranked counts rows re-scored.
+    void search(const float* query, uint32_t k, uint32_t ef, uint32_t beam_width,
+                uint32_t prefetch_depth, uint32_t rerank, std::span<const FilterLabel> filter,
+                vamana::SearchScratch& scratch) const {
+        auto& hits = scratch.results;
+        hits.clear();
+        scratch.reranked = 0;
+        const vamana::idx_t entry = entry_point;
+        if (entry == kNoNode) {
+            return;
         }
-    }
-
-    void shrink_neighbor_list(MaxHeap& results, uint32_t max_size) const {
-        if (results.size() <= max_size) {
+        auto& starts = scratch.starts;
+        if (filter.empty()) {
+            starts.assign(1, entry);
+        } else if (!label_starts(filter, starts)) {
+            return;  // no point carries any of the labels
+        }
+        if (!quantized()) {
+            rerank = 0;
+        }
+        const uint32_t effective_ef = std::max<uint32_t>({ef, ef_search, k, rerank});
+        if (disk) {
+            search_disk(query, k, effective_ef, std::max<uint32_t>(beam_width, 1), filter,
+                        scratch);
             return;
         }
-        MinHeap inverted;
-        while (!results.empty()) {
-            inverted.emplace(results.top());
-            results.pop();
+        if (quantized()) {
+            prepare_query(query, scratch);
         }
-        std::vector<DistAndId> output;
-        shrink_neighbor_list_robust(inverted, output, max_size);
-        for (const auto& item : output) {
-            results.emplace(item);
+        if (filter.empty()) {
+            float nearest_dist = query_distance(entry, query, scratch);
+            greedy_update_nearest(starts[0], nearest_dist, query, scratch);
         }
-    }
 
-    void shrink_neighbor_list_robust(MinHeap& input,
-                                     std::vector<DistAndId>& output,
-                                     uint32_t max_size) const {
-        while (!input.empty() && output.size() < max_size) {
-            auto candidate = input.top();
-            input.pop();
-            bool keep = true;
-            for (const auto& chosen : output) {
-                const float dist = compute_distance(nodes.at(candidate.second).vector,
-                                                     nodes.at(chosen.second).vector);
-                if (alpha * dist <= candidate.first) {
-                    keep = false;
-                    break;
+        beam_search<false>(starts, query, effective_ef, prefetch_depth, scratch, filter);
+        scratch.best.drain_sorted(hits);
+        hits.erase(std::remove_if(hits.begin(), hits.end(),
+                                  [this](const DistAndId& hit) {
+                                      return states[hit.second] != SlotState::kLive;
+                                  }),
+                   hits.end());
+        if (rerank > 0) {
+            hits.resize(std::min<size_t>(hits.size(), std::max(k, rerank)));
+            if (rabitq()) {
+                rerank_bounded(query, k, scratch);
+            } else {
+                for (auto& hit : hits) {
+                    hit.first = compute_distance(rows[hit.second], query);
                 }
-            }
-            if (keep) {
-                output.push_back(candidate);
+                std::sort(hits.begin(), hits.end());
+                scratch.reranked = hits.size();
             }
         }
-    }
-
-    void mark_deleted(vamana::idx_t internal_id) {
-        delete_list.insert(internal_id);
-        if (delete_list.size() * 100 >= nodes.size() * kDeleteBatchThresholdPercent) {
-            compact_graph();
+        if (hits.size() > k) {
+            hits.resize(k);
         }
     }
 
-    void compact_graph() {
-        for (auto& [id, vertex] : nodes) {
-            std::vector<DistAndId> candidate_dists;
-            candidate_dists.reserve(vertex.neighbors.size());
-            for (auto neighbor_id : vertex.neighbors) {
-                if (!delete_list.contains(neighbor_id)) {
-                    candidate_dists.emplace_back(
-                        compute_distance(vertex.vector, nodes.at(neighbor_id).vector), neighbor_id);
-                    continue;
-                }
-                for (auto nested : nodes.at(neighbor_id).neighbors) {
-                    if (!delete_list.contains(nested)) {
-                        candidate_dists.emplace_back(
-                            compute_distance(vertex.vector, nodes.at(nested).vector), nested);
-                    }
-                }
-            }
-            MaxHeap heap(candidate_dists.begin(), candidate_dists.end());
-            shrink_neighbor_list(heap, Mmax);
-            vertex.neighbors.clear();
-            while (!heap.empty()) {
-                vertex.neighbors.push_back(heap.top().second);
-                heap.pop();
-            }
-        }
-        for (auto id : delete_list) {
-            nodes.erase(id);
-            reverse_id_map.erase(id);
+    // Replaces scratch.results with the k nearest by exact distance,
+    // scoring candidates in order of lower bound: once a bound reaches the
+    // k-th exact distance, so does every bound after it
+    void rerank_bounded(const float* query, uint32_t k, vamana::SearchScratch& scratch) const {
+        auto& hits = scratch.results;
+        for (auto& hit : hits) {
+            hit.first = rabitq_distance(hit.second, scratch).second;
         }
-        delete_list.clear();
-        if (!nodes.empty()) {
-            entry_point = nodes.begin()->first;
-        } else {
-            entry_point = std::numeric_limits<vamana::idx_t>::max();
+        std::sort(hits.begin(), hits.end());
+        auto& best = scratch.best;
+        best.reset(k);
+        for (const auto& [bound, node] : hits) {
+            if (best.full() && bound >= best.top().first) {
+                break;
+            }
+            best.push(compute_distance(rows[node], query), node);
+            ++scratch.reranked;
         }
+        best.drain_sorted(hits);
     }
 
-    ANNSResult search_single(const Vector& query,
+    ANNSResult search_single(const float* query,
                              uint32_t k,
                              uint32_t ef,
-                             bool return_distances) const {
-        ANNSResult result;
-        if (nodes.empty()) {
-            return result;
-        }
-        vamana::idx_t nearest = entry_point;
-        float nearest_dist = compute_distance(nodes.at(nearest).vector, query);
-        greedy_update_nearest(nearest, nearest_dist, query);
+                             uint32_t beam_width,
+                             uint32_t prefetch_depth,
+                             uint32_t rerank_count,
+                             std::span<const FilterLabel> filter,
+                             bool return_distances,
+                             size_t& reranked) const {
+        auto scratch = scratch_pool.acquire();
+        search(query, k, ef, beam_width, prefetch_depth, rerank_count, filter, *scratch);
+        reranked = scratch->reranked;
 
-        const uint32_t effective_ef = std::max<uint32_t>({ef, ef_search, k});
-        MaxHeap top = search_base_layer(nearest, query, effective_ef);
-        while (top.size() > k) {
-            top.pop();
-        }
-        result.ids.reserve(top.size());
+        ANNSResult result;
+        result.ids.reserve(scratch->results.size());
         if (return_distances) {
-            result.distances.reserve(top.size());
+            result.distances.reserve(scratch->results.size());
         }
-        while (!top.empty()) {
-            auto [dist, internal_id] = top.top();
-            top.pop();
-            if (delete_list.contains(internal_id)) {
-                continue;
-            }
-            auto it = reverse_id_map.find(internal_id);
-            if (it == reverse_id_map.end()) {
-                continue;
-            }
-            result.ids.push_back(it->second);
+        for (const auto& [dist, node] : scratch->results) {
+            result.ids.push_back(labels[node]);
             if (return_distances) {
                 result.distances.push_back(dist);
             }
         }
-        std::reverse(result.ids.begin(), result.ids.end());
-        if (return_distances) {
-            std::reverse(result.distances.begin(), result.distances.end());
-        }
         result.actual_k = result.ids.size();
         return result;
     }
 
+    // Entry point, then the per-slot states and external ids, as both save
+    // formats lay them out
+    void write_slot_table(std::ostream& out, uint64_t slot_count) const {
+        const vamana::idx_t entry = entry_point;
+        out.write(reinterpret_cast<const char*>(&entry), sizeof(entry));
+        std::vector<SlotState> state_copy(slot_count);
+        std::vector<VectorId> label_copy(slot_count);
+        for (size_t node = 0; node < slot_count; ++node) {
+            state_copy[node] = states[node];
+            label_copy[node] = labels[node];
+        }
+        out.write(reinterpret_cast<const char*>(state_copy.data()), slot_count * sizeof(SlotState));
+        out.write(reinterpret_cast<const char*>(label_copy.data()), slot_count * sizeof(VectorId));
+    }
+
+    // Optional trailing section after the labels in the mapped format:
+    // the storage precision, default rerank and code range (RaBitQ: bits,
+    // rotation seed and center). Codes are not saved; load re-encodes them
+    // from the rows.
+    void write_storage(std::ostream& out) const {
+        if (!quantized()) {
+            return;
+        }
+        const uint32_t stored = static_cast<uint32_t>(precision);
+        out.write(reinterpret_cast<const char*>(&stored), sizeof(stored));
+        out.write(reinterpret_cast<const char*>(&rerank), sizeof(rerank));
+        if (rabitq()) {
+            const uint32_t rotation_seed = rabitq_quantizer.seed();
+            out.write(reinterpret_cast<const char*>(&rabitq_bits), sizeof(rabitq_bits));
+            out.write(reinterpret_cast<const char*>(&rotation_seed), sizeof(rotation_seed));
+            out.write(reinterpret_cast<const char*>(center.data()), center.size() * sizeof(float));
+            return;
+        }
+        out.write(reinterpret_cast<const char*>(quantizer.mins().data()),
+                  quantizer.mins().size() * sizeof(float));
+        out.write(reinterpret_cast<const char*>(quantizer.steps().data()),
+                  quantizer.steps().size() * sizeof(float));
+    }
+
+    bool read_storage(std::istream& in) {
+        uint32_t stored = 0;
+        if (!in.read(reinterpret_cast<char*>(&stored), sizeof(stored))) {
+            in.clear();
+            return true;  // fp32 rows
+        }
+        in.read(reinterpret_cast<char*>(&rerank), sizeof(rerank));
+        if (!in || stored == 0 || stored > static_cast<uint32_t>(StoragePrecision::RABITQ)) {
+            return false;
+        }
+        precision = static_cast<StoragePrecision>(stored);
+        if (rabitq()) {
+            uint32_t rotation_seed = 0;
+            in.read(reinterpret_cast<char*>(&rabitq_bits), sizeof(rabitq_bits));
+            in.read(reinterpret_cast<char*>(&rotation_seed), sizeof(rotation_seed));
+            center.resize(dimension);
+            in.read(reinterpret_cast<char*>(center.data()), dimension * sizeof(float));
+            if (!in || rabitq_bits == 0 || rabitq_bits > 8) {
+                return false;
+            }
+            rabitq_quantizer = RaBitQuantizer(dimension, rabitq_bits, rotation_seed);
+            codes.reset(rabitq_quantizer.code_size());
+            encode_all();
+            return true;
+        }
+        quantizer = ScalarQuantizer(dimension, precision);
+        if (!quantizer.mins().empty()) {
+            std::vector<float> mins(dimension);
+            std::vector<float> steps(dimension);
+            in.read(reinterpret_cast<char*>(mins.data()), dimension * sizeof(float));
+            in.read(reinterpret_cast<char*>(steps.data()), dimension * sizeof(float));
+            quantizer.set_range(std::move(mins), std::move(steps));
+        }
+        if (!in) {
+            return false;
+        }
+        codes.reset(quantizer.code_size());
+        encode_all();
+        return true;
+    }
+
+    size_t memory_usage() const {
+        // Borrowed rows belong to whoever shared them and are not counted
+        size_t total = owned_rows ? owned_rows->memory_usage() : 0;
+        total += graph.memory_usage();
+        total += codes.memory_usage() + code_norms.memory_usage();
+        total += (center.capacity() + rabitq_quantizer.dimension() * rabitq_quantizer.dimension()) *
+                 sizeof(float);
+        total += rows.memory_usage() + labels.memory_usage() + states.memory_usage() +
+                 owned_slots.memory_usage() + locks.memory_usage() +
+                 free_slots.capacity() * sizeof(vamana::idx_t);
+        total += id_map.size() * (sizeof(VectorId) + sizeof(vamana::idx_t));
+        // Disk mode: the on-disk file is not counted, only what stays resident
+        total += pq_codes.capacity() + navigator.codebooks().size() * sizeof(float);
+        total += cache_records.capacity() +
+                 cache_index.size() * (sizeof(vamana::idx_t) + sizeof(uint32_t));
+        total += slot_labels.memory_usage();
+        for (size_t node = 0; node < slot_labels.size(); ++node) {
+            total += slot_labels[node].capacity() * sizeof(FilterLabel);
+        }
+        total += label_entries.size() * (sizeof(FilterLabel) + sizeof(vamana::idx_t));
+        return total;
+    }
+
     DistanceMetric metric;
     uint32_t dimension;
-    vamana::idx_t entry_point;
-    vamana::idx_t next_internal_id;
+    std::atomic<vamana::idx_t> entry_point;
 
     uint32_t M;
     uint32_t Mmax;
     uint32_t ef_construction;
     uint32_t ef_search;
     float alpha;
-
-    std::unordered_map<vamana::idx_t, vamana::Vertex> nodes;
-    std::unordered_set<vamana::idx_t> delete_list;
-    std::unordered_map<VectorId, vamana::idx_t> id_map;
-    std::unordered_map<vamana::idx_t, VectorId> reverse_id_map;
+    uint32_t seed = kDefaultSeed;
+
+    // A loaded mapped file: the graph, states, labels and rows below point
+    // into it, so it is declared first and outlives them
+    std::shared_ptr<vamana::MappedIndex> mapping;
+    bool id_map_deferred = false;  // id_map not yet built from mapping
+    bool populate_on_load = false;
+
+    // Per-slot state, indexed by internal id. The node table grows without
+    // moving, so searches index it while inserts append; a slot is filled
+    // before any edge points at it.
+    vamana::FixedDegreeGraph graph;
+    vamana::NodeArray<const float*> rows;
+    vamana::NodeArray<VectorId> labels;
+    vamana::NodeArray<std::atomic<SlotState>> states;
+    vamana::NodeArray<size_t> owned_slots;  // owned_rows slot, or kNotOwned
+    std::vector<vamana::idx_t> free_slots;
+    vamana::NodeArray<std::mutex> locks;  // serialize writers of one adjacency record
+    size_t deleted_count = 0;
+    std::unordered_map<VectorId, vamana::idx_t> id_map;  // live external ids only
+
+    // Rows not shared with us live in owned_rows; borrowed keeps shared
+    // storage alive.
+    std::unique_ptr<VectorArena> owned_rows;
+    std::vector<std::shared_ptr<const void>> borrowed;
+
+    // Quantized storage ("storage_precision" other than fp32): query
+    // searches rank by per-slot codes and keep the rows for building and
+    // re-ranking. code_norms holds |decoded row|^2 for cosine (the exact
+    // |row|^2 under RaBitQ, which codes row - center).
+    StoragePrecision precision = StoragePrecision::FP32;
+    uint32_t rerank = 0;
+    ScalarQuantizer quantizer;
+    uint32_t rabitq_bits = kDefaultRabitqBits;
+    RaBitQuantizer rabitq_quantizer;
+    std::vector<float> center;
+    vamana::CodeArray codes;
+    vamana::NodeArray<float> code_norms;
+
+    // Filter labels per slot (sorted) and the entry point of each label
+    vamana::NodeArray<std::vector<FilterLabel>> slot_labels;
+    std::unordered_map<FilterLabel, vamana::idx_t> label_entries;
+    mutable std::shared_mutex label_mutex;  // guards label_entries
+
+    // Disk-resident mode (disk_path set at fit): rows and adjacency live in
+    // `disk`; memory keeps per-slot PQ codes for navigation and the records
+    // of the nodes nearest the entry point
+    std::string disk_path;
+    uint32_t pq_m = 0;  // 0 picks ProductQuantizer::default_m
+    uint32_t cache_nodes = kDefaultCacheNodes;
+    std::unique_ptr<vamana::DiskGraph> disk;
+    ProductQuantizer navigator;
+    std::vector<uint8_t> pq_codes;
+    std::unordered_map<vamana::idx_t, uint32_t> cache_index;  // node -> cache slot
+    std::vector<char> cache_records;
+
+    // Visited marks and heaps reused across searches and inserts
+    mutable vamana::ScratchPool scratch_pool;
+
+    // Searches, inserts, deletes and consolidation share graph_mutex and
+    // never wait for each other. It is held exclusively only to replace
+    // the whole index (fit, load), to move owned rows, and as the grace
+    // period before consolidation frees slots a search may still be
+    // holding. Writers, including each consolidation chunk, also take
+    // write_mutex (after graph_mutex), which guards everything searches
+    // do not read: id_map, free_slots, deleted_count, owned_rows.
+    mutable std::shared_mutex graph_mutex;
+    mutable std::mutex write_mutex;
+
+    // Delete consolidation worker, started on the first request
+    std::thread consolidator;
+    std::mutex consolidate_mutex;
+    std::condition_variable consolidate_cv;
+    bool consolidate_requested = false;
+    bool consolidating = false;
+    bool stop_consolidator = false;
 };
 
 VamanaANNS::VamanaANNS() : impl_(std::make_unique<Impl>()), built_(false) {
     metrics_.reset();
+    query_counters_.reset();
 }
 
 VamanaANNS::~VamanaANNS() = default;
@@ -392,9 +1727,18 @@ bool VamanaANNS::supports_distance(DistanceMetric metric) const {
 
 void VamanaANNS::fit(const std::vector<VectorEntry>& dataset,
                      const AlgorithmParams& params) {
+    for (const auto& entry : dataset) {
+        if (entry.second.size() != dataset.front().second.size()) {
+            throw std::runtime_error("Vamana: inconsistent vector dimensions");
+        }
+    }
+    fit(DatasetView::from_entries(dataset), params);
+}
+
+void VamanaANNS::fit(const DatasetView& dataset, const AlgorithmParams& params) {
     metrics_.reset();
+    query_counters_.reset();
     build_params_ = params;
-    impl_->reset();
 
     auto build_start = std::chrono::high_resolution_clock::now();
 
@@ -403,19 +1747,42 @@ void VamanaANNS::fit(const std::vector<VectorEntry>& dataset,
     impl_->ef_construction = params.get<uint32_t>("efConstruction", 50);
     impl_->ef_search = params.get<uint32_t>("efSearch", 200);
     impl_->alpha = params.get<float>("alpha", kDefaultAlpha);
+    impl_->seed = params.get<uint32_t>("seed", kDefaultSeed);
+    impl_->disk_path = params.get<std::string>("disk_path", "");
+    impl_->pq_m = params.get<uint32_t>("pq_m", 0);
+    impl_->cache_nodes = params.get<uint32_t>("cache_nodes", kDefaultCacheNodes);
+    const bool reorder = params.get<bool>("reorder", false);
     impl_->metric = static_cast<DistanceMetric>(
         params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+    // A disk-resident index navigates on PQ codes and keeps no rows
+    const StoragePrecision precision =
+        impl_->disk_path.empty()
+            ? parse_storage_precision(params.get<std::string>("storage_precision", "fp32"))
+            : StoragePrecision::FP32;
+    const uint32_t rerank = params.get<uint32_t>("rerank", 0);
+    const uint32_t rabitq_bits = params.get<uint32_t>("rabitq_bits", kDefaultRabitqBits);
 
     build_params_.set("M", impl_->M);
     build_params_.set("Mmax", impl_->Mmax);
     build_params_.set("efConstruction", impl_->ef_construction);
     build_params_.set("efSearch", impl_->ef_search);
     build_params_.set("alpha", impl_->alpha);
+    build_params_.set("seed", impl_->seed);
+    build_params_.set("disk_path", impl_->disk_path);
+    build_params_.set("pq_m", impl_->pq_m);
+    build_params_.set("cache_nodes", impl_->cache_nodes);
+    build_params_.set("reorder", reorder);
     build_params_.set("metric", static_cast<int>(impl_->metric));
+    build_params_.set("storage_precision", storage_precision_name(precision));
+    build_params_.set("rerank", rerank);
+    build_params_.set("rabitq_bits", rabitq_bits);
 
     if (!supports_distance(impl_->metric)) {
         throw std::runtime_error("Vamana: unsupported distance metric");
     }
+    impl_->stop_consolidation();
+    std::unique_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    impl_->reset();
 
     if (dataset.empty()) {
         impl_->dimension = 0;
@@ -424,20 +1791,26 @@ void VamanaANNS::fit(const std::vector<VectorEntry>& dataset,
         return;
     }
 
-    impl_->dimension = static_cast<uint32_t>(dataset.front().second.size());
+    impl_->dimension = dataset.dimension();
     build_params_.set("dimension", impl_->dimension);
-    for (const auto& [id, vec] : dataset) {
-        if (vec.size() != impl_->dimension) {
-            throw std::runtime_error("Vamana: inconsistent vector dimensions");
-        }
-        impl_->insert_node(id, vec);
+    impl_->rerank = rerank;
+    impl_->rabitq_bits = rabitq_bits;
+    impl_->configure_storage(precision, dataset.rows(), dataset.size());
+    impl_->insert_view(dataset);
+    if (reorder) {
+        impl_->reorder();
+    }
+    if (!impl_->disk_path.empty()) {
+        // Built in memory, then written out; only navigation data stays
+        impl_->move_to_disk();
+        build_params_.set("pq_m", static_cast<uint32_t>(impl_->navigator.m()));
     }
 
     built_ = true;
 
     auto build_end = std::chrono::high_resolution_clock::now();
     metrics_.build_time_seconds = std::chrono::duration<double>(build_end - build_start).count();
-    metrics_.index_size_bytes = get_memory_usage();
+    metrics_.index_size_bytes = impl_->memory_usage();
 }
 
 bool VamanaANNS::save(const std::string& path) const {
@@ -445,12 +1818,120 @@ bool VamanaANNS::save(const std::string& path) const {
         return false;
     }
 
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
+    if (!impl_->disk) {
+        return save_mapped(path);
+    }
     std::ofstream out(path, std::ios::binary);
     if (!out.is_open()) {
         return false;
     }
+    return save_disk(out);
+}
+
+// Version 4 is the mmap-able layout of vamana/mapped_index.h, written in
+// whole blocks. It goes next to path and is renamed over it, so an index
+// still mapping the old file keeps a consistent copy.
+bool VamanaANNS::save_mapped(const std::string& path) const {
+    using vamana::MappedIndex;
+    static_assert(MappedIndex::kSlotsPerChunk == vamana::FixedDegreeGraph::kNodesPerChunk &&
+                      MappedIndex::kSlotsPerChunk == vamana::NodeArray<VectorId>::kChunkSize,
+                  "mapped blocks must split into whole node-table chunks");
+    const Impl& impl = *impl_;
+
+    MappedIndex::Header header{};
+    header.version = kMappedFormatVersion;
+    header.dimension = impl.dimension;
+    header.metric = static_cast<uint32_t>(impl.metric);
+    header.M = impl.M;
+    header.max_degree = impl.Mmax;
+    header.ef_construction = impl.ef_construction;
+    header.ef_search = impl.ef_search;
+    header.alpha = impl.alpha;
+    header.slot_count = impl.graph.size();
+    header.entry_point = impl.entry_point;
+
+    const size_t slot_count = header.slot_count;
+    std::vector<Impl::SlotState> states(slot_count);
+    std::vector<VectorId> ids(slot_count);
+    std::vector<MappedIndex::IdEntry> id_entries;
+    for (vamana::idx_t node = 0; node < slot_count; ++node) {
+        states[node] = impl.states[node];
+        ids[node] = impl.labels[node];
+        if (states[node] == Impl::SlotState::kLive) {
+            id_entries.push_back({ids[node], node, 0});
+        }
+    }
+    std::sort(id_entries.begin(), id_entries.end(),
+              [](const auto& a, const auto& b) { return a.id < b.id; });
+    header.live_count = id_entries.size();
+    MappedIndex::lay_out(header);
+
+    const std::string staging = path + ".tmp";
+    {
+        std::ofstream out(staging, std::ios::binary | std::ios::trunc);
+        if (!out.is_open()) {
+            return false;
+        }
+        out.seekp(header.states_offset);
+        out.write(reinterpret_cast<const char*>(states.data()), slot_count * sizeof(Impl::SlotState));
+        out.seekp(header.ids_offset);
+        out.write(reinterpret_cast<const char*>(ids.data()), slot_count * sizeof(VectorId));
+
+        // Rows about 1 MiB at a time; free slots are zero
+        out.seekp(header.vectors_offset);
+        const size_t dim = impl.dimension;
+        const size_t rows_per_write = std::max<size_t>(1, (size_t{1} << 20) / (dim * sizeof(float)));
+        std::vector<float> staged(rows_per_write * dim);
+        for (size_t first = 0; first < slot_count; first += rows_per_write) {
+            const size_t last = std::min(slot_count, first + rows_per_write);
+            for (size_t node = first; node < last; ++node) {
+                float* dst = staged.data() + (node - first) * dim;
+                if (impl.rows[node]) {
+                    std::copy_n(impl.rows[node], dim, dst);
+                } else {
+                    std::fill_n(dst, dim, 0.0f);
+                }
+            }
+            out.write(reinterpret_cast<const char*>(staged.data()), (last - first) * dim * sizeof(float));
+        }
+
+        // One chunk of records at a time, the last padded to a whole chunk
+        out.seekp(header.adjacency_offset);
+        const size_t stride = header.record_stride;
+        std::vector<vamana::idx_t> records(MappedIndex::kSlotsPerChunk * stride);
+        for (size_t first = 0; first < slot_count; first += MappedIndex::kSlotsPerChunk) {
+            std::fill(records.begin(), records.end(), 0);
+            const size_t last = std::min(slot_count, first + MappedIndex::kSlotsPerChunk);
+            for (size_t node = first; node < last; ++node) {
+                const auto id = static_cast<vamana::idx_t>(node);
+                vamana::idx_t* record = records.data() + (node - first) * stride;
+                record[1] = impl.graph.degree(id);
+                std::copy_n(impl.graph.neighbors(id), record[1], record + 2);
+            }
+            out.write(reinterpret_cast<const char*>(records.data()), records.size() * sizeof(vamana::idx_t));
+        }
+
+        out.seekp(header.id_map_offset);
+        out.write(reinterpret_cast<const char*>(id_entries.data()),
+                  id_entries.size() * sizeof(MappedIndex::IdEntry));
+        impl.write_labels(out);
+        impl.write_storage(out);
+        header.file_size = static_cast<uint64_t>(out.tellp());
+        out.seekp(0);
+        out.write(reinterpret_cast<const char*>(&header), sizeof(header));
+        if (!out) {
+            return false;
+        }
+    }
+    return std::rename(staging.c_str(), path.c_str()) == 0;
+}
 
-    const uint32_t version_tag = 1;
+// Version 3 stores what a disk-resident index keeps in memory and refers to
+// its graph file by path; the graph file itself is left where it is
+bool VamanaANNS::save_disk(std::ostream& out) const {
+    const uint32_t version_tag = kDiskFormatVersion;
     out.write(reinterpret_cast<const char*>(&version_tag), sizeof(version_tag));
     out.write(reinterpret_cast<const char*>(&impl_->dimension), sizeof(impl_->dimension));
     uint32_t metric = static_cast<uint32_t>(impl_->metric);
@@ -461,33 +1942,36 @@ bool VamanaANNS::save(const std::string& path) const {
     out.write(reinterpret_cast<const char*>(&impl_->ef_search), sizeof(impl_->ef_search));
     out.write(reinterpret_cast<const char*>(&impl_->alpha), sizeof(impl_->alpha));
 
-    uint64_t node_count = impl_->nodes.size();
-    out.write(reinterpret_cast<const char*>(&node_count), sizeof(node_count));
-    for (const auto& [internal_id, vertex] : impl_->nodes) {
-        out.write(reinterpret_cast<const char*>(&internal_id), sizeof(internal_id));
-        uint32_t dim = static_cast<uint32_t>(vertex.vector.size());
-        out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
-        out.write(reinterpret_cast<const char*>(vertex.vector.data()), dim * sizeof(float));
-        uint32_t neighbor_count = static_cast<uint32_t>(vertex.neighbors.size());
-        out.write(reinterpret_cast<const char*>(&neighbor_count), sizeof(neighbor_count));
-        for (auto neighbor : vertex.neighbors) {
-            out.write(reinterpret_cast<const char*>(&neighbor), sizeof(neighbor));
-        }
-    }
-
-    uint64_t id_map_size = impl_->id_map.size();
-    out.write(reinterpret_cast<const char*>(&id_map_size), sizeof(id_map_size));
-    for (const auto& [external_id, internal_id] : impl_->id_map) {
-        out.write(reinterpret_cast<const char*>(&external_id), sizeof(external_id));
-        out.write(reinterpret_cast<const char*>(&internal_id), sizeof(internal_id));
-    }
-
-    return true;
+    const std::string& disk_path = impl_->disk->path();
+    const uint64_t path_size = disk_path.size();
+    out.write(reinterpret_cast<const char*>(&path_size), sizeof(path_size));
+    out.write(disk_path.data(), path_size);
+
+    const uint64_t slot_count = impl_->states.size();
+    out.write(reinterpret_cast<const char*>(&slot_count), sizeof(slot_count));
+    impl_->write_slot_table(out, slot_count);
+
+    const uint32_t pq_m = static_cast<uint32_t>(impl_->navigator.m());
+    out.write(reinterpret_cast<const char*>(&pq_m), sizeof(pq_m));
+    const auto& codebooks = impl_->navigator.codebooks();
+    out.write(reinterpret_cast<const char*>(codebooks.data()), codebooks.size() * sizeof(float));
+    out.write(reinterpret_cast<const char*>(impl_->pq_codes.data()), impl_->pq_codes.size());
+
+    const auto cached = impl_->cached_nodes();
+    const uint64_t cache_count = cached.size();
+    out.write(reinterpret_cast<const char*>(&cache_count), sizeof(cache_count));
+    out.write(reinterpret_cast<const char*>(cached.data()), cache_count * sizeof(vamana::idx_t));
+    impl_->write_labels(out);
+    return static_cast<bool>(out);
 }
 
 bool VamanaANNS::load(const std::string& path) {
     metrics_.reset();
+    query_counters_.reset();
+    impl_->stop_consolidation();
+    std::unique_lock<std::shared_mutex> lock(impl_->graph_mutex);
     impl_->reset();
+    built_ = false;
 
     std::ifstream in(path, std::ios::binary);
     if (!in.is_open()) {
@@ -496,11 +1980,43 @@ bool VamanaANNS::load(const std::string& path) {
 
     uint32_t version_tag = 0;
     in.read(reinterpret_cast<char*>(&version_tag), sizeof(version_tag));
-    if (version_tag != 1) {
+    bool loaded = false;
+    if (version_tag == kMappedFormatVersion) {
+        in.close();
+        loaded = load_mapped(path);
+    } else if (version_tag == 1 || version_tag == kFormatVersion ||
+               version_tag == kDiskFormatVersion) {
+        loaded = load_streamed(in, version_tag);
+    }
+    if (!loaded) {
+        impl_->reset();
         return false;
     }
 
-    in.read(reinterpret_cast<char*>(&impl_->dimension), sizeof(impl_->dimension));
+    build_params_ = get_default_params();
+    build_params_.set("M", impl_->M);
+    build_params_.set("Mmax", impl_->Mmax);
+    build_params_.set("efConstruction", impl_->ef_construction);
+    build_params_.set("efSearch", impl_->ef_search);
+    build_params_.set("alpha", impl_->alpha);
+    build_params_.set("metric", static_cast<int>(impl_->metric));
+    build_params_.set("dimension", impl_->dimension);
+    build_params_.set("storage_precision", storage_precision_name(impl_->precision));
+    build_params_.set("rerank", impl_->rerank);
+    build_params_.set("rabitq_bits", impl_->rabitq_bits);
+    if (impl_->disk) {
+        build_params_.set("disk_path", impl_->disk_path);
+        build_params_.set("pq_m", static_cast<uint32_t>(impl_->navigator.m()));
+        build_params_.set("cache_nodes", static_cast<uint32_t>(impl_->cache_index.size()));
+    }
+    built_ = true;
+    return true;
+}
+
+// Versions 1-3 are parsed from a stream after their version tag
+bool VamanaANNS::load_streamed(std::istream& in, uint32_t version_tag) {
+    uint32_t dimension = 0;
+    in.read(reinterpret_cast<char*>(&dimension), sizeof(dimension));
     uint32_t metric = 0;
     in.read(reinterpret_cast<char*>(&metric), sizeof(metric));
     impl_->metric = static_cast<DistanceMetric>(metric);
@@ -509,46 +2025,306 @@ bool VamanaANNS::load(const std::string& path) {
     in.read(reinterpret_cast<char*>(&impl_->ef_construction), sizeof(impl_->ef_construction));
     in.read(reinterpret_cast<char*>(&impl_->ef_search), sizeof(impl_->ef_search));
     in.read(reinterpret_cast<char*>(&impl_->alpha), sizeof(impl_->alpha));
+    if (!in) {
+        return false;
+    }
+    impl_->reset();
+    impl_->dimension = dimension;
+    impl_->owned_rows = std::make_unique<VectorArena>(dimension);
+
+    bool loaded = false;
+    if (version_tag == kDiskFormatVersion) {
+        impl_->owned_rows.reset();
+        loaded = load_disk(in);
+    } else {
+        loaded = version_tag == 1 ? load_legacy(in) : load_slots(in);
+    }
+    return loaded && impl_->read_labels(in);
+}
+
+// Version 4 is mapped, not parsed: the graph, slot states and external ids
+// are adopted in place and rows point into the mapping. Only the per-slot
+// row and lock tables and the filter labels are built here; the id map
+// waits for the first write.
+bool VamanaANNS::load_mapped(const std::string& path) {
+    static_assert(sizeof(std::atomic<Impl::SlotState>) == sizeof(Impl::SlotState),
+                  "slot states are adopted from the file as atomics");
+    auto mapping = std::make_shared<vamana::MappedIndex>();
+    if (!mapping->open(path, impl_->populate_on_load)) {
+        return false;
+    }
+    const auto& header = mapping->header();
+    impl_->metric = static_cast<DistanceMetric>(header.metric);
+    impl_->dimension = header.dimension;
+    impl_->M = header.M;
+    impl_->Mmax = header.max_degree;
+    impl_->ef_construction = header.ef_construction;
+    impl_->ef_search = header.ef_search;
+    impl_->alpha = header.alpha;
+
+    const size_t slot_count = header.slot_count;
+    impl_->graph.reset(impl_->Mmax);
+    impl_->graph.adopt(mapping->block<vamana::idx_t>(header.adjacency_offset), slot_count);
+    impl_->states.adopt(mapping->block<std::atomic<Impl::SlotState>>(header.states_offset),
+                        slot_count);
+    impl_->labels.adopt(mapping->block<VectorId>(header.ids_offset), slot_count);
+    impl_->rows.resize(slot_count);
+    impl_->owned_slots.resize(slot_count);
+    impl_->slot_labels.resize(slot_count);
+    impl_->locks.resize(slot_count);
+
+    const float* vectors = mapping->block<const float>(header.vectors_offset);
+    for (vamana::idx_t node = 0; node < slot_count; ++node) {
+        impl_->owned_slots[node] = Impl::kNotOwned;
+        switch (impl_->states[node].load(std::memory_order_relaxed)) {
+            case Impl::SlotState::kLive:
+                break;
+            case Impl::SlotState::kDeleted:
+                ++impl_->deleted_count;
+                break;
+            case Impl::SlotState::kFree:
+                impl_->free_slots.push_back(node);
+                continue;
+            default:
+                return false;
+        }
+        impl_->rows[node] = vectors + static_cast<size_t>(node) * impl_->dimension;
+    }
+
+    std::ifstream labels_in(path, std::ios::binary);
+    labels_in.seekg(static_cast<std::streamoff>(header.labels_offset));
+    if (!labels_in || !impl_->read_labels(labels_in) || !impl_->read_storage(labels_in)) {
+        return false;
+    }
+    impl_->entry_point = header.entry_point;
+    impl_->mapping = std::move(mapping);
+    impl_->id_map_deferred = true;
+    return true;
+}
+
+bool VamanaANNS::load_disk(std::istream& in) {
+    uint64_t path_size = 0;
+    in.read(reinterpret_cast<char*>(&path_size), sizeof(path_size));
+    if (!in || path_size > 4096) {
+        return false;
+    }
+    std::string disk_path(path_size, '\0');
+    in.read(disk_path.data(), path_size);
+
+    uint64_t slot_count = 0;
+    vamana::idx_t entry_point = Impl::kNoNode;
+    in.read(reinterpret_cast<char*>(&slot_count), sizeof(slot_count));
+    in.read(reinterpret_cast<char*>(&entry_point), sizeof(entry_point));
+    if (!in || slot_count >= Impl::kNoNode || entry_point >= slot_count) {
+        return false;
+    }
+
+    auto disk = std::make_unique<vamana::DiskGraph>();
+    if (!disk->open(disk_path)) {
+        return false;
+    }
+    const auto& header = disk->header();
+    if (header.node_count != slot_count || header.dimension != impl_->dimension ||
+        header.max_degree != impl_->Mmax || header.metric != static_cast<uint32_t>(impl_->metric) ||
+        header.entry_point != entry_point) {
+        return false;
+    }
+
+    std::vector<Impl::SlotState> states(slot_count);
+    std::vector<VectorId> labels(slot_count);
+    in.read(reinterpret_cast<char*>(states.data()), slot_count * sizeof(Impl::SlotState));
+    in.read(reinterpret_cast<char*>(labels.data()), slot_count * sizeof(VectorId));
+    if (!in) {
+        return false;
+    }
+    impl_->states.resize(slot_count);
+    impl_->labels.resize(slot_count);
+    for (vamana::idx_t node = 0; node < slot_count; ++node) {
+        impl_->states[node] = states[node];
+        impl_->labels[node] = labels[node];
+        switch (states[node]) {
+            case Impl::SlotState::kLive:
+                impl_->id_map.emplace(labels[node], node);
+                break;
+            case Impl::SlotState::kDeleted:
+                ++impl_->deleted_count;
+                break;
+            case Impl::SlotState::kFree:
+                impl_->free_slots.push_back(node);
+                break;
+            default:
+                return false;
+        }
+    }
+
+    uint32_t pq_m = 0;
+    in.read(reinterpret_cast<char*>(&pq_m), sizeof(pq_m));
+    if (!in || pq_m == 0 || impl_->dimension % pq_m != 0) {
+        return false;
+    }
+    impl_->navigator = ProductQuantizer(impl_->dimension, pq_m, 8);
+    std::vector<float> codebooks(impl_->navigator.codebooks().size());
+    in.read(reinterpret_cast<char*>(codebooks.data()), codebooks.size() * sizeof(float));
+    impl_->navigator.set_codebooks(std::move(codebooks));
+    impl_->pq_codes.resize(slot_count * pq_m);
+    in.read(reinterpret_cast<char*>(impl_->pq_codes.data()), impl_->pq_codes.size());
+
+    uint64_t cache_count = 0;
+    in.read(reinterpret_cast<char*>(&cache_count), sizeof(cache_count));
+    if (!in || cache_count > slot_count) {
+        return false;
+    }
+    std::vector<vamana::idx_t> cached(cache_count);
+    in.read(reinterpret_cast<char*>(cached.data()), cache_count * sizeof(vamana::idx_t));
+    if (!in || !disk->read(cached.data(), cached.size(), impl_->cache_records)) {
+        return false;
+    }
+    for (size_t i = 0; i < cached.size(); ++i) {
+        impl_->cache_index.emplace(cached[i], static_cast<uint32_t>(i));
+    }
+
+    impl_->graph.reset(impl_->Mmax);
+    impl_->disk_path = disk_path;
+    impl_->disk = std::move(disk);
+    impl_->entry_point = entry_point;
+    return true;
+}
+
+bool VamanaANNS::load_slots(std::istream& in) {
+    uint64_t slot_count = 0;
+    vamana::idx_t entry_point = Impl::kNoNode;
+    in.read(reinterpret_cast<char*>(&slot_count), sizeof(slot_count));
+    in.read(reinterpret_cast<char*>(&entry_point), sizeof(entry_point));
+    if (!in || slot_count >= Impl::kNoNode ||
+        (entry_point != Impl::kNoNode && entry_point >= slot_count)) {
+        return false;
+    }
+
+    std::vector<Impl::SlotState> states(slot_count);
+    std::vector<VectorId> labels(slot_count);
+    in.read(reinterpret_cast<char*>(states.data()), slot_count * sizeof(Impl::SlotState));
+    in.read(reinterpret_cast<char*>(labels.data()), slot_count * sizeof(VectorId));
+    if (!in) {
+        return false;
+    }
+
+    Vector vec(impl_->dimension);
+    std::vector<vamana::idx_t> free_slots;
+    for (uint64_t i = 0; i < slot_count; ++i) {
+        in.read(reinterpret_cast<char*>(vec.data()), vec.size() * sizeof(float));
+        const vamana::idx_t node = impl_->allocate_slot(labels[i], nullptr);
+        impl_->states[node] = states[i];
+        switch (states[i]) {
+            case Impl::SlotState::kLive:
+                impl_->id_map.emplace(labels[i], node);
+                break;
+            case Impl::SlotState::kDeleted:
+                ++impl_->deleted_count;
+                break;
+            case Impl::SlotState::kFree:
+                free_slots.push_back(node);
+                continue;
+            default:
+                return false;
+        }
+        impl_->owned_slots[node] = impl_->owned_rows->append(labels[i], vec.data());
+        impl_->rows[node] = impl_->owned_rows->row(impl_->owned_slots[node]);
+    }
+    impl_->free_slots = std::move(free_slots);  // only now, or allocate_slot would reuse them
+
+    std::vector<vamana::idx_t> record(impl_->Mmax + 1);
+    for (vamana::idx_t node = 0; node < slot_count; ++node) {
+        in.read(reinterpret_cast<char*>(record.data()), record.size() * sizeof(vamana::idx_t));
+        if (!in || record[0] > impl_->Mmax) {
+            return false;
+        }
+        for (uint32_t i = 1; i <= record[0]; ++i) {
+            if (record[i] >= slot_count || impl_->states[record[i]] == Impl::SlotState::kFree) {
+                return false;
+            }
+        }
+        impl_->graph.set_neighbors(node, record.data() + 1, record[0]);
+    }
+    impl_->entry_point = entry_point;
+    return true;
+}
 
+// Version 1 keyed vertices by sparse internal ids; they are renumbered
+// into dense slots in file order
+bool VamanaANNS::load_legacy(std::istream& in) {
     uint64_t node_count = 0;
     in.read(reinterpret_cast<char*>(&node_count), sizeof(node_count));
+    if (!in || node_count >= Impl::kNoNode) {
+        return false;
+    }
+
+    std::unordered_map<vamana::idx_t, vamana::idx_t> slot_of;
+    std::vector<std::vector<vamana::idx_t>> links(node_count);
+    Vector vec(impl_->dimension);
     for (uint64_t i = 0; i < node_count; ++i) {
         vamana::idx_t internal_id = 0;
         in.read(reinterpret_cast<char*>(&internal_id), sizeof(internal_id));
         uint32_t dim = 0;
         in.read(reinterpret_cast<char*>(&dim), sizeof(dim));
-        Vector vec(dim);
+        if (!in || dim != impl_->dimension) {
+            return false;
+        }
         in.read(reinterpret_cast<char*>(vec.data()), dim * sizeof(float));
-        vamana::Vertex vertex(internal_id, std::move(vec));
         uint32_t neighbor_count = 0;
         in.read(reinterpret_cast<char*>(&neighbor_count), sizeof(neighbor_count));
-        vertex.neighbors.resize(neighbor_count);
-        in.read(reinterpret_cast<char*>(vertex.neighbors.data()), neighbor_count * sizeof(vamana::idx_t));
-        impl_->nodes.emplace(internal_id, std::move(vertex));
-        impl_->next_internal_id = std::max(impl_->next_internal_id, internal_id + 1);
+        if (!in || neighbor_count > impl_->Mmax) {
+            return false;
+        }
+        links[i].resize(neighbor_count);
+        in.read(reinterpret_cast<char*>(links[i].data()), neighbor_count * sizeof(vamana::idx_t));
+
+        // Vertices without an id-map entry below were pending deletion
+        const vamana::idx_t node = impl_->allocate_slot(0, nullptr);
+        impl_->states[node] = Impl::SlotState::kDeleted;
+        impl_->owned_slots[node] = impl_->owned_rows->append(0, vec.data());
+        impl_->rows[node] = impl_->owned_rows->row(impl_->owned_slots[node]);
+        slot_of.emplace(internal_id, node);
     }
 
     uint64_t id_map_size = 0;
     in.read(reinterpret_cast<char*>(&id_map_size), sizeof(id_map_size));
-    for (uint64_t i = 0; i < id_map_size; ++i) {
+    for (uint64_t i = 0; i < id_map_size && in; ++i) {
         VectorId external_id = 0;
         vamana::idx_t internal_id = 0;
         in.read(reinterpret_cast<char*>(&external_id), sizeof(external_id));
         in.read(reinterpret_cast<char*>(&internal_id), sizeof(internal_id));
-        impl_->id_map.emplace(external_id, internal_id);
-        impl_->reverse_id_map.emplace(internal_id, external_id);
+        auto it = slot_of.find(internal_id);
+        if (it == slot_of.end()) {
+            return false;
+        }
+        impl_->labels[it->second] = external_id;
+        impl_->states[it->second] = Impl::SlotState::kLive;
+        impl_->id_map.emplace(external_id, it->second);
     }
-
-    if (!impl_->nodes.empty()) {
-        impl_->entry_point = impl_->nodes.begin()->first;
+    if (!in) {
+        return false;
     }
-
-    built_ = true;
+    impl_->deleted_count = node_count - impl_->id_map.size();
+
+    std::vector<vamana::idx_t> neighbors;
+    for (vamana::idx_t node = 0; node < node_count; ++node) {
+        neighbors.clear();
+        for (auto old : links[node]) {
+            auto it = slot_of.find(old);
+            if (it == slot_of.end()) {
+                return false;
+            }
+            neighbors.push_back(it->second);
+        }
+        impl_->graph.set_neighbors(node, neighbors.data(), neighbors.size());
+    }
+    impl_->entry_point = impl_->first_live();
     return true;
 }
 
 ANNSResult VamanaANNS::query(const Vector& query_vector,
                              const QueryConfig& config) const {
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
     if (!built_ || impl_->dimension == 0) {
         return {};
     }
@@ -558,59 +2334,132 @@ ANNSResult VamanaANNS::query(const Vector& query_vector,
 
     const uint32_t ef_override = config.algorithm_params.get<uint32_t>(
         "efSearch", impl_->ef_search);
+    const uint32_t beam_width = config.algorithm_params.get<uint32_t>(
+        "beam_width", kDefaultBeamWidth);
+    const uint32_t rerank = config.algorithm_params.get<uint32_t>("rerank", impl_->rerank);
 
+    size_t reranked = 0;
     auto start = std::chrono::high_resolution_clock::now();
-    auto result = impl_->search_single(query_vector,
+    auto result = impl_->search_single(query_vector.data(),
                                        config.k,
                                        ef_override,
-                                       config.return_distances);
+                                       beam_width,
+                                       config.prefetch_depth,
+                                       rerank,
+                                       config.filter_labels,
+                                       config.return_distances,
+                                       reranked);
     auto end = std::chrono::high_resolution_clock::now();
-    metrics_.search_time_seconds += std::chrono::duration<double>(end - start).count();
-    metrics_.distance_computations += static_cast<size_t>(result.actual_k) * impl_->dimension;
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           static_cast<size_t>(result.actual_k) * impl_->dimension, reranked);
     return result;
 }
 
 std::vector<ANNSResult> VamanaANNS::batch_query(
     const std::vector<Vector>& query_vectors,
     const QueryConfig& config) const {
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
     if (!built_ || impl_->dimension == 0) {
         return {};
     }
 
-    std::vector<ANNSResult> results;
-    results.reserve(query_vectors.size());
-
-    const uint32_t ef_override = config.algorithm_params.get<uint32_t>(
-        "efSearch", impl_->ef_search);
-
-    auto start = std::chrono::high_resolution_clock::now();
     for (const auto& query : query_vectors) {
         if (query.size() != impl_->dimension) {
             throw std::runtime_error("Vamana: query dimension mismatch");
         }
-        results.push_back(impl_->search_single(query,
-                                               config.k,
-                                               ef_override,
-                                               config.return_distances));
     }
+
+    const uint32_t ef_override = config.algorithm_params.get<uint32_t>(
+        "efSearch", impl_->ef_search);
+    const uint32_t beam_width = config.algorithm_params.get<uint32_t>(
+        "beam_width", kDefaultBeamWidth);
+    const uint32_t rerank = config.algorithm_params.get<uint32_t>("rerank", impl_->rerank);
+
+    // Graph search is read-only, so queries fan out across the shared pool
+    std::vector<ANNSResult> results(query_vectors.size());
+    std::atomic<size_t> total_reranked{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, query_vectors.size(), [&](size_t i) {
+        size_t reranked = 0;
+        results[i] = impl_->search_single(query_vectors[i].data(),
+                                          config.k,
+                                          ef_override,
+                                          beam_width,
+                                          config.prefetch_depth,
+                                          rerank,
+                                          config.filter_labels,
+                                          config.return_distances,
+                                          reranked);
+        total_reranked.fetch_add(reranked, std::memory_order_relaxed);
+    });
     auto end = std::chrono::high_resolution_clock::now();
-    metrics_.search_time_seconds += std::chrono::duration<double>(end - start).count();
     size_t total_neighbors = 0;
     for (const auto& res : results) {
         total_neighbors += res.actual_k;
     }
-    metrics_.distance_computations += total_neighbors * impl_->dimension;
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           total_neighbors * impl_->dimension, total_reranked.load());
     return results;
 }
 
+void VamanaANNS::batch_query(const QueryMatrix& queries,
+                             const QueryConfig& config,
+                             const QueryOutput& output) const {
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    if (!built_ || impl_->dimension == 0) {
+        for (size_t i = 0; i < queries.rows; ++i) {
+            output.finish(i, config.k, 0);
+        }
+        return;
+    }
+    if (queries.dimension != impl_->dimension) {
+        throw std::runtime_error("Vamana: query dimension mismatch");
+    }
+
+    const uint32_t ef_override = config.algorithm_params.get<uint32_t>(
+        "efSearch", impl_->ef_search);
+    const uint32_t beam_width = config.algorithm_params.get<uint32_t>(
+        "beam_width", kDefaultBeamWidth);
+    const uint32_t rerank = config.algorithm_params.get<uint32_t>("rerank", impl_->rerank);
+
+    std::atomic<size_t> total_neighbors{0};
+    std::atomic<size_t> total_reranked{0};
+    auto start = std::chrono::high_resolution_clock::now();
+    ThreadPool::global()->parallel_for(0, queries.rows, [&](size_t i) {
+        auto scratch = impl_->scratch_pool.acquire();
+        impl_->search(queries.row(i), config.k, ef_override, beam_width, config.prefetch_depth,
+                      rerank, config.filter_labels, *scratch);
+        const auto& hits = scratch->results;
+        VectorId* ids = output.ids + i * config.k;
+        float* distances = output.distances ? output.distances + i * config.k : nullptr;
+        for (size_t j = 0; j < hits.size(); ++j) {
+            ids[j] = impl_->labels[hits[j].second];
+            if (distances) {
+                distances[j] = hits[j].first;
+            }
+        }
+        output.finish(i, config.k, hits.size());
+        total_neighbors.fetch_add(hits.size(), std::memory_order_relaxed);
+        total_reranked.fetch_add(scratch->reranked, std::memory_order_relaxed);
+    });
+    auto end = std::chrono::high_resolution_clock::now();
+    query_counters_.record(std::chrono::duration<double>(end - start).count(),
+                           total_neighbors.load() * impl_->dimension, total_reranked.load());
+}
+
 void VamanaANNS::add_vector(const VectorEntry& entry) {
     if (!built_) {
         throw std::runtime_error("Vamana: index not built");
     }
+    if (impl_->disk) {
+        throw std::runtime_error("Vamana: disk-resident index is read-only; refit to add vectors");
+    }
     if (entry.second.size() != impl_->dimension) {
         throw std::runtime_error("Vamana: vector dimension mismatch");
     }
-    impl_->insert_node(entry.first, entry.second);
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
+    impl_->insert_owned(entry.first, entry.second.data());
 }
 
 void VamanaANNS::add_vectors(const std::vector<VectorEntry>& entries) {
@@ -619,33 +2468,77 @@ void VamanaANNS::add_vectors(const std::vector<VectorEntry>& entries) {
     }
 }
 
-void VamanaANNS::remove_vector(VectorId id) {
-    auto it = impl_->id_map.find(id);
-    if (it == impl_->id_map.end()) {
+void VamanaANNS::add_vectors(const DatasetView& entries) {
+    if (!built_) {
+        throw std::runtime_error("Vamana: index not built");
+    }
+    if (impl_->disk) {
+        throw std::runtime_error("Vamana: disk-resident index is read-only; refit to add vectors");
+    }
+    if (entries.empty()) {
         return;
     }
-    impl_->mark_deleted(it->second);
-    impl_->id_map.erase(it);
+    if (entries.dimension() != impl_->dimension) {
+        throw std::runtime_error("Vamana: vector dimension mismatch");
+    }
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
+    impl_->insert_view(entries);
+}
+
+void VamanaANNS::remove_vector(VectorId id) {
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
+    impl_->remove(id);
 }
 
 void VamanaANNS::remove_vectors(const std::vector<VectorId>& ids) {
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
     for (auto id : ids) {
-        remove_vector(id);
+        impl_->remove(id);
+    }
+}
+
+void VamanaANNS::consolidate_deletes() {
+    impl_->consolidate_now();
+}
+
+bool VamanaANNS::supports_updates() const {
+    return !impl_->disk;
+}
+
+void VamanaANNS::reorder_graph() {
+    impl_->stop_consolidation();
+    std::unique_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
+    if (impl_->disk) {
+        return;  // the graph file is laid out once, at fit
     }
+    impl_->reorder();
+    if (impl_->deleted_count > 0) {
+        impl_->request_consolidation();
+    }
+}
+
+void VamanaANNS::set_populate_on_load(bool populate) {
+    impl_->populate_on_load = populate;
+}
+
+bool VamanaANNS::supports_concurrent_updates() const {
+    return !impl_->disk;
 }
 
 size_t VamanaANNS::get_index_size() const {
-    return impl_->nodes.size() - impl_->delete_list.size();
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
+    return impl_->live_count();
 }
 
 size_t VamanaANNS::get_memory_usage() const {
-    size_t total = 0;
-    for (const auto& [_, vertex] : impl_->nodes) {
-        total += vertex.vector.size() * sizeof(float);
-        total += vertex.neighbors.size() * sizeof(vamana::idx_t);
-    }
-    total += impl_->id_map.size() * (sizeof(VectorId) + sizeof(vamana::idx_t));
-    return total;
+    std::shared_lock<std::shared_mutex> lock(impl_->graph_mutex);
+    std::lock_guard<std::mutex> write_lock(impl_->write_mutex);
+    return impl_->memory_usage();
 }
 
 std::unordered_map<std::string, std::string> VamanaANNS::get_build_params() const {
@@ -653,7 +2546,9 @@ std::unordered_map<std::string, std::string> VamanaANNS::get_build_params() cons
 }
 
 ANNSMetrics VamanaANNS::get_metrics() const {
-    return metrics_;
+    ANNSMetrics metrics = metrics_;
+    query_counters_.merge_into(metrics);
+    return metrics;
 }
 
 bool VamanaANNS::validate_params(const AlgorithmParams& params) const {
@@ -664,6 +2559,20 @@ bool VamanaANNS::validate_params(const AlgorithmParams& params) const {
     const auto alpha = params.get<float>("alpha", kDefaultAlpha);
     const auto metric = static_cast<DistanceMetric>(
         params.get<int>("metric", static_cast<int>(DistanceMetric::L2)));
+    const auto pq_m = params.get<uint32_t>("pq_m", 0);
+    const auto dimension = params.get<uint32_t>("dimension", 0);
+    if (pq_m > 0 && dimension > 0 && dimension % pq_m != 0) {
+        return false;
+    }
+    try {
+        parse_storage_precision(params.get<std::string>("storage_precision", "fp32"));
+    } catch (const std::runtime_error&) {
+        return false;
+    }
+    const auto rabitq_bits = params.get<uint32_t>("rabitq_bits", kDefaultRabitqBits);
+    if (rabitq_bits == 0 || rabitq_bits > 8) {
+        return false;
+    }
     return M > 0 && Mmax >= M && efC > 0 && efS > 0 && alpha > 0.0f && supports_distance(metric);
 }
 
@@ -674,6 +2583,14 @@ AlgorithmParams VamanaANNS::get_default_params() const {
     defaults.set("efConstruction", 50u);
     defaults.set("efSearch", 200u);
     defaults.set("alpha", kDefaultAlpha);
+    defaults.set("seed", kDefaultSeed);
+    defaults.set("disk_path", std::string());
+    defaults.set("pq_m", 0u);
+    defaults.set("cache_nodes", kDefaultCacheNodes);
+    defaults.set("reorder", false);
+    defaults.set("storage_precision", std::string("fp32"));
+    defaults.set("rerank", 0u);
+    defaults.set("rabitq_bits", kDefaultRabitqBits);
     defaults.set("metric", static_cast<int>(DistanceMetric::L2));
     return defaults;
 }
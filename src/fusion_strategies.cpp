@@ -1,4 +1,5 @@
 #include "sage_db/fusion_strategies.h"
+#include "sage_db/simd/distance.h"
 #include <algorithm>
 #include <random>
 #include <stdexcept>
@@ -345,12 +346,7 @@ float cosine_similarity(const Vector& v1, const Vector& v2) {
     float dot_product = 0.0f;
     float norm1 = 0.0f;
     float norm2 = 0.0f;
-    
-    for (size_t i = 0; i < v1.size(); ++i) {
-        dot_product += v1[i] * v2[i];
-        norm1 += v1[i] * v1[i];
-        norm2 += v2[i] * v2[i];
-    }
+    simd::dot_and_norms(v1.data(), v2.data(), v1.size(), dot_product, norm1, norm2);
     
     float denominator = std::sqrt(norm1 * norm2);
     return denominator > 0.0f ? dot_product / denominator : 0.0f;
@@ -361,13 +357,7 @@ float euclidean_distance(const Vector& v1, const Vector& v2) {
         return std::numeric_limits<float>::max();
     }
     
-    float sum = 0.0f;
-    for (size_t i = 0; i < v1.size(); ++i) {
-        float diff = v1[i] - v2[i];
-        sum += diff * diff;
-    }
-    
-    return std::sqrt(sum);
+    return simd::l2_distance(v1.data(), v2.data(), v1.size());
 }
 
 Vector align_dimension(const Vector& vec, uint32_t target_dim) {
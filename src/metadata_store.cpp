@@ -114,6 +114,85 @@ std::vector<VectorId> MetadataStore::filter_ids(const std::vector<VectorId>& ids
     return result;
 }
 
+std::vector<FilterLabel> MetadataStore::intern_labels(const Metadata& metadata,
+                                                     const std::vector<std::string>& keys) {
+    std::vector<FilterLabel> result;
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    for (const auto& key : keys) {
+        auto it = metadata.find(key);
+        if (it == metadata.end()) {
+            continue;
+        }
+        auto label = labels_.emplace(std::make_pair(key, it->second),
+                                     static_cast<FilterLabel>(labels_.size()));
+        result.push_back(label.first->second);
+    }
+    std::sort(result.begin(), result.end());
+    result.erase(std::unique(result.begin(), result.end()), result.end());
+    return result;
+}
+
+bool MetadataStore::find_label(const std::string& key, const MetadataValue& value,
+                               FilterLabel& label) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    auto it = labels_.find(std::make_pair(key, value));
+    if (it == labels_.end()) {
+        return false;
+    }
+    label = it->second;
+    return true;
+}
+
+void MetadataStore::save_labels(const std::string& filepath) const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);
+    std::ofstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        throw SageDBException("Cannot open file for writing: " + filepath);
+    }
+
+    // Binary, since values may hold any character
+    const uint64_t count = labels_.size();
+    file.write(reinterpret_cast<const char*>(&count), sizeof(count));
+    for (const auto& [pair, label] : labels_) {
+        file.write(reinterpret_cast<const char*>(&label), sizeof(label));
+        for (const std::string* text : {&pair.first, &pair.second}) {
+            const uint64_t length = text->size();
+            file.write(reinterpret_cast<const char*>(&length), sizeof(length));
+            file.write(text->data(), length);
+        }
+    }
+}
+
+void MetadataStore::load_labels(const std::string& filepath) {
+    std::ifstream file(filepath, std::ios::binary);
+    if (!file.is_open()) {
+        throw SageDBException("Cannot open file for reading: " + filepath);
+    }
+
+    std::unique_lock<std::shared_mutex> lock(mutex_);
+    labels_.clear();
+    uint64_t count = 0;
+    file.read(reinterpret_cast<char*>(&count), sizeof(count));
+    for (uint64_t i = 0; i < count && file; ++i) {
+        FilterLabel label = 0;
+        file.read(reinterpret_cast<char*>(&label), sizeof(label));
+        std::string texts[2];
+        for (auto& text : texts) {
+            uint64_t length = 0;
+            file.read(reinterpret_cast<char*>(&length), sizeof(length));
+            if (!file || length > 10000) {
+                throw SageDBException("Corrupt label file: " + filepath);
+            }
+            text.resize(length);
+            file.read(text.data(), length);
+        }
+        labels_.emplace(std::make_pair(std::move(texts[0]), std::move(texts[1])), label);
+    }
+    if (!file) {
+        throw SageDBException("Corrupt label file: " + filepath);
+    }
+}
+
 size_t MetadataStore::size() const {
     std::shared_lock<std::shared_mutex> lock(mutex_);
     return metadata_map_.size();
@@ -228,6 +307,7 @@ void MetadataStore::load(const std::string& filepath) {
 void MetadataStore::clear() {
     std::unique_lock<std::shared_mutex> lock(mutex_);
     metadata_map_.clear();
+    labels_.clear();
 }
 
 void MetadataStore::validate_metadata(const Metadata& metadata) const {
@@ -1,4 +1,5 @@
 #include "sage_db/query_engine.h"
+#include "sage_db/thread_pool.h"
 #include <chrono>
 #include <algorithm>
 #include <set>
@@ -60,6 +61,11 @@ std::vector<QueryResult> QueryEngine::filtered_search(
     
     // Apply metadata filter
     auto filtered_results = apply_metadata_filter(vector_results, filter);
+    size_t total_candidates = vector_results.size();
+    if (filtered_results.size() < params.k && vector_results.size() == expanded_params.k) {
+        filtered_results = widen_filtered_search(query, params, filter, expanded_params.k,
+                                                 std::move(filtered_results), total_candidates);
+    }
     
     // Limit to requested k
     if (filtered_results.size() > params.k) {
@@ -70,7 +76,7 @@ std::vector<QueryResult> QueryEngine::filtered_search(
     
     // Update statistics
     SearchStats stats;
-    stats.total_candidates = vector_results.size();
+    stats.total_candidates = total_candidates;
     stats.filtered_candidates = filtered_results.size();
     stats.final_results = filtered_results.size();
     stats.search_time_ms = std::chrono::duration<double, std::milli>(mid_time - start_time).count();
@@ -87,6 +93,20 @@ std::vector<QueryResult> QueryEngine::search_with_metadata(
     const std::string& metadata_key,
     const MetadataValue& metadata_value) const {
     
+    // Label keys are filtered inside the index (or by an exact scan over
+    // the labelled vectors), so selective values still fill k results
+    const auto& label_keys = vector_store_->config().filter_label_keys;
+    if (std::find(label_keys.begin(), label_keys.end(), metadata_key) != label_keys.end()) {
+        FilterLabel label = 0;
+        if (!metadata_store_->find_label(metadata_key, metadata_value, label)) {
+            update_stats(SearchStats{});
+            return {};
+        }
+        SearchParams labelled_params = params;
+        labelled_params.filter_labels = {label};
+        return search(query, labelled_params);
+    }
+    
     auto filter = [&metadata_key, &metadata_value](const Metadata& metadata) {
         auto it = metadata.find(metadata_key);
         return it != metadata.end() && it->second == metadata_value;
@@ -98,13 +118,54 @@ std::vector<QueryResult> QueryEngine::search_with_metadata(
 std::vector<std::vector<QueryResult>> QueryEngine::batch_search(
     const std::vector<Vector>& queries, const SearchParams& params) const {
     
-    std::vector<std::vector<QueryResult>> results;
-    results.reserve(queries.size());
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    // The vector store hands the whole batch to the ANNS plugin
+    return finish_batch(vector_store_->batch_search(queries, params), params, start_time);
+}
+
+std::vector<std::vector<QueryResult>> QueryEngine::batch_search(
+    const float* queries, size_t num_queries, size_t stride,
+    const SearchParams& params) const {
+    
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    return finish_batch(vector_store_->batch_search(queries, num_queries, stride, params),
+                        params, start_time);
+}
+
+std::vector<std::vector<QueryResult>> QueryEngine::finish_batch(
+    std::vector<std::vector<QueryResult>> results,
+    const SearchParams& params,
+    std::chrono::high_resolution_clock::time_point start_time) const {
+    
+    auto mid_time = std::chrono::high_resolution_clock::now();
+    
+    if (params.include_metadata) {
+        ThreadPool::global()->parallel_for(0, results.size(), [&](size_t i) {
+            for (auto& result : results[i]) {
+                metadata_store_->get_metadata(result.id, result.metadata);
+            }
+        });
+    }
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
     
-    for (const auto& query : queries) {
-        results.push_back(search(query, params));
+    size_t total_results = 0;
+    for (const auto& query_results : results) {
+        total_results += query_results.size();
     }
     
+    // Update statistics once for the whole batch
+    SearchStats stats;
+    stats.total_candidates = total_results;
+    stats.filtered_candidates = total_results;
+    stats.final_results = total_results;
+    stats.search_time_ms = std::chrono::duration<double, std::milli>(mid_time - start_time).count();
+    stats.filter_time_ms = std::chrono::duration<double, std::milli>(end_time - mid_time).count();
+    stats.total_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    update_stats(stats);
+    
     return results;
 }
 
@@ -113,12 +174,44 @@ std::vector<std::vector<QueryResult>> QueryEngine::batch_filtered_search(
     const SearchParams& params,
     const std::function<bool(const Metadata&)>& filter) const {
     
-    std::vector<std::vector<QueryResult>> results;
-    results.reserve(queries.size());
+    auto start_time = std::chrono::high_resolution_clock::now();
+    
+    // Same over-fetch as filtered_search, but as one batched vector search
+    SearchParams expanded_params = params;
+    expanded_params.k = std::min(params.k * 10, 1000u);
+    
+    auto candidates = vector_store_->batch_search(queries, expanded_params);
+    
+    auto mid_time = std::chrono::high_resolution_clock::now();
+    
+    std::vector<std::vector<QueryResult>> results(candidates.size());
+    std::vector<size_t> total_candidates(candidates.size());
+    ThreadPool::global()->parallel_for(0, candidates.size(), [&](size_t i) {
+        results[i] = apply_metadata_filter(candidates[i], filter);
+        total_candidates[i] = candidates[i].size();
+        if (results[i].size() < params.k && candidates[i].size() == expanded_params.k) {
+            results[i] = widen_filtered_search(queries[i], params, filter, expanded_params.k,
+                                               std::move(results[i]), total_candidates[i]);
+        }
+        if (results[i].size() > params.k) {
+            results[i].resize(params.k);
+        }
+    });
+    
+    auto end_time = std::chrono::high_resolution_clock::now();
     
-    for (const auto& query : queries) {
-        results.push_back(filtered_search(query, params, filter));
+    SearchStats stats;
+    stats.total_candidates = 0;
+    stats.filtered_candidates = 0;
+    for (size_t i = 0; i < results.size(); ++i) {
+        stats.total_candidates += total_candidates[i];
+        stats.filtered_candidates += results[i].size();
     }
+    stats.final_results = stats.filtered_candidates;
+    stats.search_time_ms = std::chrono::duration<double, std::milli>(mid_time - start_time).count();
+    stats.filter_time_ms = std::chrono::duration<double, std::milli>(end_time - mid_time).count();
+    stats.total_time_ms = std::chrono::duration<double, std::milli>(end_time - start_time).count();
+    update_stats(stats);
     
     return results;
 }
@@ -289,6 +382,32 @@ std::vector<QueryResult> QueryEngine::apply_metadata_filter(
     return filtered_results;
 }
 
+std::vector<QueryResult> QueryEngine::widen_filtered_search(
+    const Vector& query,
+    const SearchParams& params,
+    const std::function<bool(const Metadata&)>& filter,
+    uint32_t fetched,
+    std::vector<QueryResult> filtered_results,
+    size_t& total_candidates) const {
+    
+    // Too few candidates passed: grow the fetch until k do or the store
+    // has nothing more to give
+    const size_t store_size = vector_store_->size();
+    SearchParams expanded_params = params;
+    expanded_params.k = fetched;
+    while (expanded_params.k < store_size) {
+        expanded_params.k = static_cast<uint32_t>(
+            std::min<size_t>(static_cast<size_t>(expanded_params.k) * 4, store_size));
+        auto vector_results = vector_store_->search(query, expanded_params);
+        total_candidates += vector_results.size();
+        filtered_results = apply_metadata_filter(vector_results, filter);
+        if (filtered_results.size() >= params.k || vector_results.size() < expanded_params.k) {
+            break;
+        }
+    }
+    return filtered_results;
+}
+
 std::vector<QueryResult> QueryEngine::merge_and_rerank(
     const std::vector<QueryResult>& vector_results,
     const std::vector<VectorId>& text_results,
@@ -330,6 +449,7 @@ std::vector<QueryResult> QueryEngine::merge_and_rerank(
 }
 
 void QueryEngine::update_stats(const SearchStats& stats) const {
+    std::lock_guard<std::mutex> lock(stats_mutex_);
     last_stats_ = stats;
 }
 
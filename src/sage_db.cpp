@@ -18,7 +18,7 @@ SageDB::SageDB(const DatabaseConfig& config) : config_(config) {
 VectorId SageDB::add(const Vector& vector, const Metadata& metadata) {
     validate_dimension(vector);
     
-    VectorId id = vector_store_->add_vector(vector);
+    VectorId id = vector_store_->add_vector(vector, labels_for(metadata));
     
     if (!metadata.empty()) {
         metadata_store_->set_metadata(id, metadata);
@@ -37,7 +37,22 @@ std::vector<VectorId> SageDB::add_batch(const std::vector<Vector>& vectors,
         validate_dimension(vector);
     }
     
-    auto ids = vector_store_->add_vectors(vectors);
+    auto ids = vector_store_->add_vectors(vectors, labels_for(metadata));
+    
+    if (!metadata.empty()) {
+        metadata_store_->set_batch_metadata(ids, metadata);
+    }
+    
+    return ids;
+}
+
+std::vector<VectorId> SageDB::add_batch(const float* data, size_t num_vectors, size_t stride,
+                                       const std::vector<Metadata>& metadata) {
+    if (!metadata.empty() && metadata.size() != num_vectors) {
+        throw SageDBException("Vectors and metadata must have the same size");
+    }
+    
+    auto ids = vector_store_->add_vectors(data, num_vectors, stride, labels_for(metadata));
     
     if (!metadata.empty()) {
         metadata_store_->set_batch_metadata(ids, metadata);
@@ -61,6 +76,9 @@ bool SageDB::update(VectorId id, const Vector& vector, const Metadata& metadata)
     
     if (!metadata.empty()) {
         metadata_store_->set_metadata(id, metadata);
+        if (!config_.filter_label_keys.empty()) {
+            vector_store_->set_labels(id, labels_for(metadata));
+        }
         updated = true;
     }
     
@@ -100,6 +118,12 @@ std::vector<std::vector<QueryResult>> SageDB::batch_search(
     return query_engine_->batch_search(queries, params);
 }
 
+std::vector<std::vector<QueryResult>> SageDB::batch_search(
+    const float* queries, size_t num_queries, size_t stride,
+    const SearchParams& params) const {
+    return query_engine_->batch_search(queries, num_queries, stride, params);
+}
+
 void SageDB::build_index() {
     vector_store_->build_index();
 }
@@ -117,8 +141,15 @@ bool SageDB::is_trained() const {
     return vector_store_->is_trained();
 }
 
+std::string SageDB::last_build_error() const {
+    return vector_store_->last_build_error();
+}
+
 bool SageDB::set_metadata(VectorId id, const Metadata& metadata) {
     metadata_store_->set_metadata(id, metadata);
+    if (!config_.filter_label_keys.empty()) {
+        vector_store_->set_labels(id, labels_for(metadata));
+    }
     return true;
 }
 
@@ -134,6 +165,9 @@ std::vector<VectorId> SageDB::find_by_metadata(const std::string& key,
 void SageDB::save(const std::string& filepath) const {
     vector_store_->save(filepath + ".vectors");
     metadata_store_->save(filepath + ".metadata");
+    if (!config_.filter_label_keys.empty()) {
+        metadata_store_->save_labels(filepath + ".labels");
+    }
     
     // Save configuration
     std::ofstream config_file(filepath + ".config");
@@ -146,6 +180,11 @@ void SageDB::save(const std::string& filepath) const {
         config_file << "nbits=" << config_.nbits << "\n";
         config_file << "M=" << config_.M << "\n";
         config_file << "efConstruction=" << config_.efConstruction << "\n";
+        config_file << "filter_label_keys=";
+        for (size_t i = 0; i < config_.filter_label_keys.size(); ++i) {
+            config_file << (i ? "," : "") << config_.filter_label_keys[i];
+        }
+        config_file << "\n";
     }
 }
 
@@ -176,6 +215,17 @@ void SageDB::load(const std::string& filepath) {
                     config_.M = std::stoul(value);
                 } else if (key == "efConstruction") {
                     config_.efConstruction = std::stoul(value);
+                } else if (key == "filter_label_keys") {
+                    config_.filter_label_keys.clear();
+                    size_t begin = 0;
+                    while (begin < value.size()) {
+                        size_t end = value.find(',', begin);
+                        if (end == std::string::npos) {
+                            end = value.size();
+                        }
+                        config_.filter_label_keys.push_back(value.substr(begin, end - begin));
+                        begin = end + 1;
+                    }
                 }
             }
         }
@@ -189,6 +239,9 @@ void SageDB::load(const std::string& filepath) {
     // Load data
     vector_store_->load(filepath + ".vectors");
     metadata_store_->load(filepath + ".metadata");
+    if (!config_.filter_label_keys.empty()) {
+        metadata_store_->load_labels(filepath + ".labels");
+    }
 }
 
 size_t SageDB::size() const {
@@ -215,6 +268,26 @@ void SageDB::validate_dimension(const Vector& vector) const {
     }
 }
 
+std::vector<FilterLabel> SageDB::labels_for(const Metadata& metadata) const {
+    if (config_.filter_label_keys.empty() || metadata.empty()) {
+        return {};
+    }
+    return metadata_store_->intern_labels(metadata, config_.filter_label_keys);
+}
+
+std::vector<std::vector<FilterLabel>> SageDB::labels_for(
+    const std::vector<Metadata>& metadata) const {
+    std::vector<std::vector<FilterLabel>> labels;
+    if (config_.filter_label_keys.empty()) {
+        return labels;
+    }
+    labels.reserve(metadata.size());
+    for (const auto& entry : metadata) {
+        labels.push_back(labels_for(entry));
+    }
+    return labels;
+}
+
 void SageDB::ensure_consistent_metadata(const std::vector<Vector>& vectors,
                                        const std::vector<Metadata>& metadata) const {
     if (vectors.size() != metadata.size()) {
@@ -0,0 +1,451 @@
+#include "sage_db/simd/batch_distance.h"
+#include "sage_db/simd/aligned_allocator.h"
+#include "sage_db/simd/distance.h"
+
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SAGE_DB_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+#ifdef SAGE_DB_HAVE_BLAS
+extern "C" void sgemm_(const char* transa, const char* transb,
+                       const int* m, const int* n, const int* k,
+                       const float* alpha, const float* a, const int* lda,
+                       const float* b, const int* ldb,
+                       const float* beta, float* c, const int* ldc);
+#endif
+
+namespace sage_db {
+namespace simd {
+
+namespace {
+
+// Below this many queries sgemm's own packing does not pay off
+constexpr size_t kBlasMinQueries = 8;
+
+// Query rows handled per micro-kernel call
+constexpr int kMaxRows = 4;
+
+// ---------------------------------------------------------------------------
+// Packing. The database block is stored as column panels of `width` rows:
+// panel p holds dims 0..dim-1 of rows p*width .. p*width+width-1, with the
+// `width` values of one dimension contiguous. Missing rows are zero-filled
+// and the panel count is rounded up to even because every micro-kernel call
+// consumes two panels.
+// ---------------------------------------------------------------------------
+
+// RowAt maps a row index within the block to its first float, which lets
+// strided arenas and row-pointer views share one packing routine.
+template <typename RowAt>
+const float* pack_panels(RowAt row_at, size_t num_base, size_t dim, size_t width) {
+    thread_local AlignedFloatVector packed;
+    const size_t panels = (num_base + 2 * width - 1) / (2 * width) * 2;
+    packed.resize(panels * dim * width);
+
+    float* dst = packed.data();
+    for (size_t p = 0; p < panels; ++p) {
+        for (size_t w = 0; w < width; ++w) {
+            const size_t row = p * width + w;
+            float* column = dst + p * dim * width + w;
+            if (row < num_base) {
+                const float* src = row_at(row);
+                for (size_t d = 0; d < dim; ++d) {
+                    column[d * width] = src[d];
+                }
+            } else {
+                for (size_t d = 0; d < dim; ++d) {
+                    column[d * width] = 0.0f;
+                }
+            }
+        }
+    }
+    return packed.data();
+}
+
+// ---------------------------------------------------------------------------
+// Micro-kernels: MR query rows x two panels. Queries are broadcast one
+// dimension at a time, so accumulators stay in registers and no horizontal
+// reductions are needed.
+// ---------------------------------------------------------------------------
+
+struct ScalarPolicy {
+    static constexpr size_t kWidth = 8;
+
+    template <int MR>
+    static void micro(const float* q, size_t qs, const float* p0, const float* p1,
+                      size_t dim, float* out, size_t os, size_t cols) {
+        float acc[MR][2 * kWidth] = {};
+        for (size_t d = 0; d < dim; ++d) {
+            const float* b0 = p0 + d * kWidth;
+            const float* b1 = p1 + d * kWidth;
+            for (int r = 0; r < MR; ++r) {
+                const float qv = q[r * qs + d];
+                for (size_t w = 0; w < kWidth; ++w) {
+                    acc[r][w] += qv * b0[w];
+                    acc[r][kWidth + w] += qv * b1[w];
+                }
+            }
+        }
+        for (int r = 0; r < MR; ++r) {
+            std::memcpy(out + r * os, acc[r], cols * sizeof(float));
+        }
+    }
+};
+
+#ifdef SAGE_DB_SIMD_X86
+
+struct Avx2Policy {
+    static constexpr size_t kWidth = 8;
+
+    template <int MR>
+    __attribute__((target("avx2,fma")))
+    static void micro(const float* q, size_t qs, const float* p0, const float* p1,
+                      size_t dim, float* out, size_t os, size_t cols) {
+        __m256 acc0[MR];
+        __m256 acc1[MR];
+        for (int r = 0; r < MR; ++r) {
+            acc0[r] = _mm256_setzero_ps();
+            acc1[r] = _mm256_setzero_ps();
+        }
+        for (size_t d = 0; d < dim; ++d) {
+            const __m256 b0 = _mm256_load_ps(p0 + d * kWidth);
+            const __m256 b1 = _mm256_load_ps(p1 + d * kWidth);
+            for (int r = 0; r < MR; ++r) {
+                const __m256 qv = _mm256_broadcast_ss(q + r * qs + d);
+                acc0[r] = _mm256_fmadd_ps(qv, b0, acc0[r]);
+                acc1[r] = _mm256_fmadd_ps(qv, b1, acc1[r]);
+            }
+        }
+        for (int r = 0; r < MR; ++r) {
+            float* dst = out + r * os;
+            if (cols == 2 * kWidth) {
+                _mm256_storeu_ps(dst, acc0[r]);
+                _mm256_storeu_ps(dst + kWidth, acc1[r]);
+            } else {
+                alignas(32) float tmp[2 * kWidth];
+                _mm256_store_ps(tmp, acc0[r]);
+                _mm256_store_ps(tmp + kWidth, acc1[r]);
+                std::memcpy(dst, tmp, cols * sizeof(float));
+            }
+        }
+    }
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+struct Avx512Policy {
+    static constexpr size_t kWidth = 16;
+
+    template <int MR>
+    __attribute__((target("avx512f")))
+    static void micro(const float* q, size_t qs, const float* p0, const float* p1,
+                      size_t dim, float* out, size_t os, size_t cols) {
+        __m512 acc0[MR];
+        __m512 acc1[MR];
+        for (int r = 0; r < MR; ++r) {
+            acc0[r] = _mm512_setzero_ps();
+            acc1[r] = _mm512_setzero_ps();
+        }
+        for (size_t d = 0; d < dim; ++d) {
+            const __m512 b0 = _mm512_load_ps(p0 + d * kWidth);
+            const __m512 b1 = _mm512_load_ps(p1 + d * kWidth);
+            for (int r = 0; r < MR; ++r) {
+                const __m512 qv = _mm512_set1_ps(q[r * qs + d]);
+                acc0[r] = _mm512_fmadd_ps(qv, b0, acc0[r]);
+                acc1[r] = _mm512_fmadd_ps(qv, b1, acc1[r]);
+            }
+        }
+        const size_t cols1 = cols > kWidth ? cols - kWidth : 0;
+        const __mmask16 mask0 = cols >= kWidth ? static_cast<__mmask16>(0xFFFF)
+                                               : static_cast<__mmask16>((1u << cols) - 1u);
+        const __mmask16 mask1 = cols1 >= kWidth ? static_cast<__mmask16>(0xFFFF)
+                                                : static_cast<__mmask16>((1u << cols1) - 1u);
+        for (int r = 0; r < MR; ++r) {
+            _mm512_mask_storeu_ps(out + r * os, mask0, acc0[r]);
+            _mm512_mask_storeu_ps(out + r * os + kWidth, mask1, acc1[r]);
+        }
+    }
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SAGE_DB_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// Matrix-vector: four rows at a time share every load of x.
+// ---------------------------------------------------------------------------
+
+void matrix_vector_scalar(const float* matrix, size_t rows, size_t cols, const float* x,
+                          float* out) {
+    for (size_t r = 0; r < rows; ++r) {
+        float sum = 0.0f;
+        const float* row = matrix + r * cols;
+        for (size_t c = 0; c < cols; ++c) {
+            sum += row[c] * x[c];
+        }
+        out[r] = sum;
+    }
+}
+
+#ifdef SAGE_DB_SIMD_X86
+
+__attribute__((target("avx2,fma")))
+float horizontal_sum(__m256 v) {
+    const __m128 pair = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    const __m128 quad = _mm_add_ps(pair, _mm_movehl_ps(pair, pair));
+    return _mm_cvtss_f32(_mm_add_ss(quad, _mm_shuffle_ps(quad, quad, 1)));
+}
+
+__attribute__((target("avx2,fma")))
+void matrix_vector_avx2(const float* matrix, size_t rows, size_t cols, const float* x,
+                        float* out) {
+    const size_t body = cols & ~size_t{7};
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const float* row0 = matrix + r * cols;
+        const float* row1 = row0 + cols;
+        const float* row2 = row1 + cols;
+        const float* row3 = row2 + cols;
+        __m256 acc0 = _mm256_setzero_ps();
+        __m256 acc1 = _mm256_setzero_ps();
+        __m256 acc2 = _mm256_setzero_ps();
+        __m256 acc3 = _mm256_setzero_ps();
+        for (size_t c = 0; c < body; c += 8) {
+            const __m256 xv = _mm256_loadu_ps(x + c);
+            acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(row0 + c), xv, acc0);
+            acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(row1 + c), xv, acc1);
+            acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(row2 + c), xv, acc2);
+            acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(row3 + c), xv, acc3);
+        }
+        float sums[4] = {horizontal_sum(acc0), horizontal_sum(acc1), horizontal_sum(acc2),
+                         horizontal_sum(acc3)};
+        for (size_t c = body; c < cols; ++c) {
+            sums[0] += row0[c] * x[c];
+            sums[1] += row1[c] * x[c];
+            sums[2] += row2[c] * x[c];
+            sums[3] += row3[c] * x[c];
+        }
+        std::memcpy(out + r, sums, sizeof(sums));
+    }
+    for (; r < rows; ++r) {
+        out[r] = inner_product(matrix + r * cols, x, cols);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+#endif
+
+__attribute__((target("avx512f")))
+void matrix_vector_avx512(const float* matrix, size_t rows, size_t cols, const float* x,
+                          float* out) {
+    const __mmask16 tail = static_cast<__mmask16>((1u << (cols % 16)) - 1u);
+    const size_t body = cols & ~size_t{15};
+    size_t r = 0;
+    for (; r + 4 <= rows; r += 4) {
+        const float* row0 = matrix + r * cols;
+        const float* row1 = row0 + cols;
+        const float* row2 = row1 + cols;
+        const float* row3 = row2 + cols;
+        __m512 acc0 = _mm512_setzero_ps();
+        __m512 acc1 = _mm512_setzero_ps();
+        __m512 acc2 = _mm512_setzero_ps();
+        __m512 acc3 = _mm512_setzero_ps();
+        for (size_t c = 0; c < body; c += 16) {
+            const __m512 xv = _mm512_loadu_ps(x + c);
+            acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(row0 + c), xv, acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(row1 + c), xv, acc1);
+            acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(row2 + c), xv, acc2);
+            acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(row3 + c), xv, acc3);
+        }
+        if (tail) {
+            const __m512 xv = _mm512_maskz_loadu_ps(tail, x + body);
+            acc0 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, row0 + body), xv, acc0);
+            acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, row1 + body), xv, acc1);
+            acc2 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, row2 + body), xv, acc2);
+            acc3 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(tail, row3 + body), xv, acc3);
+        }
+        out[r] = _mm512_reduce_add_ps(acc0);
+        out[r + 1] = _mm512_reduce_add_ps(acc1);
+        out[r + 2] = _mm512_reduce_add_ps(acc2);
+        out[r + 3] = _mm512_reduce_add_ps(acc3);
+    }
+    for (; r < rows; ++r) {
+        out[r] = inner_product(matrix + r * cols, x, cols);
+    }
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SAGE_DB_SIMD_X86
+
+template <typename Policy, typename RowAt>
+void inner_product_block_packed(const float* queries, size_t num_queries, size_t query_stride,
+                                RowAt row_at, size_t num_base,
+                                size_t dim, float* out, size_t out_stride) {
+    constexpr size_t width = Policy::kWidth;
+    const float* packed = pack_panels(row_at, num_base, dim, width);
+
+    for (size_t j = 0; j < num_base; j += 2 * width) {
+        const float* p0 = packed + (j / width) * dim * width;
+        const float* p1 = p0 + dim * width;
+        const size_t cols = std::min(2 * width, num_base - j);
+
+        size_t i = 0;
+        for (; i + kMaxRows <= num_queries; i += kMaxRows) {
+            Policy::template micro<kMaxRows>(queries + i * query_stride, query_stride, p0, p1,
+                                             dim, out + i * out_stride + j, out_stride, cols);
+        }
+        const float* q = queries + i * query_stride;
+        float* o = out + i * out_stride + j;
+        switch (num_queries - i) {
+            case 3:
+                Policy::template micro<3>(q, query_stride, p0, p1, dim, o, out_stride, cols);
+                break;
+            case 2:
+                Policy::template micro<2>(q, query_stride, p0, p1, dim, o, out_stride, cols);
+                break;
+            case 1:
+                Policy::template micro<1>(q, query_stride, p0, p1, dim, o, out_stride, cols);
+                break;
+            default:
+                break;
+        }
+    }
+}
+
+#ifdef SAGE_DB_HAVE_BLAS
+bool inner_product_block_blas(const float* queries, size_t num_queries, size_t query_stride,
+                              const float* base, size_t num_base, size_t base_stride,
+                              size_t dim, float* out, size_t out_stride) {
+    constexpr size_t kIntMax = static_cast<size_t>(std::numeric_limits<int>::max());
+    if (num_queries > kIntMax || num_base > kIntMax || dim > kIntMax ||
+        query_stride > kIntMax || base_stride > kIntMax || out_stride > kIntMax) {
+        return false;
+    }
+
+    // Row-major out (nq x nb) is column-major out^T = base * queries^T
+    const char transa = 'T';
+    const char transb = 'N';
+    const int m = static_cast<int>(num_base);
+    const int n = static_cast<int>(num_queries);
+    const int k = static_cast<int>(dim);
+    const int lda = static_cast<int>(base_stride);
+    const int ldb = static_cast<int>(query_stride);
+    const int ldc = static_cast<int>(out_stride);
+    const float alpha = 1.0f;
+    const float beta = 0.0f;
+    sgemm_(&transa, &transb, &m, &n, &k, &alpha, base, &lda, queries, &ldb, &beta, out, &ldc);
+    return true;
+}
+#endif
+
+template <typename RowAt>
+void inner_product_block_dispatch(const float* queries, size_t num_queries, size_t query_stride,
+                                  RowAt row_at, size_t num_base,
+                                  size_t dim, float* out, size_t out_stride) {
+    switch (active_instruction_set()) {
+#ifdef SAGE_DB_SIMD_X86
+        case InstructionSet::AVX512:
+            inner_product_block_packed<Avx512Policy>(queries, num_queries, query_stride,
+                                                     row_at, num_base, dim, out, out_stride);
+            return;
+        case InstructionSet::AVX2:
+            inner_product_block_packed<Avx2Policy>(queries, num_queries, query_stride,
+                                                   row_at, num_base, dim, out, out_stride);
+            return;
+#endif
+        default:
+            inner_product_block_packed<ScalarPolicy>(queries, num_queries, query_stride,
+                                                     row_at, num_base, dim, out, out_stride);
+            return;
+    }
+}
+
+} // namespace
+
+void matrix_vector(const float* matrix, size_t rows, size_t cols, const float* x, float* out) {
+    switch (active_instruction_set()) {
+#ifdef SAGE_DB_SIMD_X86
+        case InstructionSet::AVX512:
+            matrix_vector_avx512(matrix, rows, cols, x, out);
+            return;
+        case InstructionSet::AVX2:
+            matrix_vector_avx2(matrix, rows, cols, x, out);
+            return;
+#endif
+        default:
+            matrix_vector_scalar(matrix, rows, cols, x, out);
+            return;
+    }
+}
+
+bool blas_available() {
+#ifdef SAGE_DB_HAVE_BLAS
+    return true;
+#else
+    return false;
+#endif
+}
+
+void inner_product_block(const float* queries, size_t num_queries, size_t query_stride,
+                         const float* base, size_t num_base, size_t base_stride,
+                         size_t dim, float* out, size_t out_stride,
+                         bool allow_blas) {
+    if (num_queries == 0 || num_base == 0) {
+        return;
+    }
+    if (dim == 0) {
+        for (size_t i = 0; i < num_queries; ++i) {
+            std::fill_n(out + i * out_stride, num_base, 0.0f);
+        }
+        return;
+    }
+
+#ifdef SAGE_DB_HAVE_BLAS
+    if (allow_blas && num_queries >= kBlasMinQueries &&
+        inner_product_block_blas(queries, num_queries, query_stride,
+                                 base, num_base, base_stride, dim, out, out_stride)) {
+        return;
+    }
+#else
+    (void)allow_blas;
+#endif
+
+    inner_product_block_dispatch(queries, num_queries, query_stride,
+                                 [base, base_stride](size_t row) { return base + row * base_stride; },
+                                 num_base, dim, out, out_stride);
+}
+
+void inner_product_block_rows(const float* queries, size_t num_queries, size_t query_stride,
+                              const float* const* base_rows, size_t num_base,
+                              size_t dim, float* out, size_t out_stride) {
+    if (num_queries == 0 || num_base == 0) {
+        return;
+    }
+    if (dim == 0) {
+        for (size_t i = 0; i < num_queries; ++i) {
+            std::fill_n(out + i * out_stride, num_base, 0.0f);
+        }
+        return;
+    }
+    inner_product_block_dispatch(queries, num_queries, query_stride,
+                                 [base_rows](size_t row) { return base_rows[row]; },
+                                 num_base, dim, out, out_stride);
+}
+
+} // namespace simd
+} // namespace sage_db
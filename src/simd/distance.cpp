@@ -0,0 +1,402 @@
+#include "sage_db/simd/distance.h"
+
+#include <atomic>
+#include <initializer_list>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SAGE_DB_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace sage_db {
+namespace simd {
+
+namespace {
+
+struct Kernels {
+    InstructionSet isa;
+    float (*l2_squared)(const float*, const float*, size_t);
+    float (*inner_product)(const float*, const float*, size_t);
+    float (*norm_squared)(const float*, size_t);
+    void (*dot_and_norms)(const float*, const float*, size_t, float&, float&, float&);
+};
+
+// ---------------------------------------------------------------------------
+// Scalar fallback. Four independent accumulators keep the loop free of a
+// single serial dependency chain so the compiler can still pipeline it.
+// ---------------------------------------------------------------------------
+
+float l2_squared_scalar(const float* a, const float* b, size_t dim) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    size_t i = 0;
+    for (; i + 4 <= dim; i += 4) {
+        const float d0 = a[i] - b[i];
+        const float d1 = a[i + 1] - b[i + 1];
+        const float d2 = a[i + 2] - b[i + 2];
+        const float d3 = a[i + 3] - b[i + 3];
+        s0 += d0 * d0;
+        s1 += d1 * d1;
+        s2 += d2 * d2;
+        s3 += d3 * d3;
+    }
+    for (; i < dim; ++i) {
+        const float d = a[i] - b[i];
+        s0 += d * d;
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+float inner_product_scalar(const float* a, const float* b, size_t dim) {
+    float s0 = 0.0f, s1 = 0.0f, s2 = 0.0f, s3 = 0.0f;
+    size_t i = 0;
+    for (; i + 4 <= dim; i += 4) {
+        s0 += a[i] * b[i];
+        s1 += a[i + 1] * b[i + 1];
+        s2 += a[i + 2] * b[i + 2];
+        s3 += a[i + 3] * b[i + 3];
+    }
+    for (; i < dim; ++i) {
+        s0 += a[i] * b[i];
+    }
+    return (s0 + s1) + (s2 + s3);
+}
+
+float norm_squared_scalar(const float* a, size_t dim) {
+    return inner_product_scalar(a, a, dim);
+}
+
+void dot_and_norms_scalar(const float* a, const float* b, size_t dim,
+                          float& dot, float& norm_a_sq, float& norm_b_sq) {
+    float d = 0.0f, na = 0.0f, nb = 0.0f;
+    for (size_t i = 0; i < dim; ++i) {
+        d += a[i] * b[i];
+        na += a[i] * a[i];
+        nb += b[i] * b[i];
+    }
+    dot = d;
+    norm_a_sq = na;
+    norm_b_sq = nb;
+}
+
+constexpr Kernels kScalarKernels{
+    InstructionSet::SCALAR,
+    &l2_squared_scalar,
+    &inner_product_scalar,
+    &norm_squared_scalar,
+    &dot_and_norms_scalar,
+};
+
+#ifdef SAGE_DB_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// AVX2 + FMA: 4 x 8 lanes per iteration, then an 8-lane step and scalar tail.
+// ---------------------------------------------------------------------------
+
+__attribute__((target("avx2,fma")))
+inline float hsum256(__m256 v) {
+    __m128 lo = _mm256_castps256_ps128(v);
+    __m128 hi = _mm256_extractf128_ps(v, 1);
+    lo = _mm_add_ps(lo, hi);
+    __m128 shuf = _mm_movehdup_ps(lo);
+    __m128 sums = _mm_add_ps(lo, shuf);
+    shuf = _mm_movehl_ps(shuf, sums);
+    sums = _mm_add_ss(sums, shuf);
+    return _mm_cvtss_f32(sums);
+}
+
+__attribute__((target("avx2,fma")))
+float l2_squared_avx2(const float* a, const float* b, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= dim; i += 32) {
+        const __m256 d0 = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        const __m256 d1 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8));
+        const __m256 d2 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16));
+        const __m256 d3 = _mm256_sub_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24));
+        acc0 = _mm256_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm256_fmadd_ps(d1, d1, acc1);
+        acc2 = _mm256_fmadd_ps(d2, d2, acc2);
+        acc3 = _mm256_fmadd_ps(d3, d3, acc3);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        const __m256 d = _mm256_sub_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i));
+        acc0 = _mm256_fmadd_ps(d, d, acc0);
+    }
+    float sum = hsum256(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for (; i < dim; ++i) {
+        const float d = a[i] - b[i];
+        sum += d * d;
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+float inner_product_avx2(const float* a, const float* b, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    __m256 acc2 = _mm256_setzero_ps();
+    __m256 acc3 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 32 <= dim; i += 32) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 8), _mm256_loadu_ps(b + i + 8), acc1);
+        acc2 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 16), _mm256_loadu_ps(b + i + 16), acc2);
+        acc3 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i + 24), _mm256_loadu_ps(b + i + 24), acc3);
+    }
+    for (; i + 8 <= dim; i += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(a + i), _mm256_loadu_ps(b + i), acc0);
+    }
+    float sum = hsum256(_mm256_add_ps(_mm256_add_ps(acc0, acc1), _mm256_add_ps(acc2, acc3)));
+    for (; i < dim; ++i) {
+        sum += a[i] * b[i];
+    }
+    return sum;
+}
+
+__attribute__((target("avx2,fma")))
+float norm_squared_avx2(const float* a, size_t dim) {
+    return inner_product_avx2(a, a, dim);
+}
+
+__attribute__((target("avx2,fma")))
+void dot_and_norms_avx2(const float* a, const float* b, size_t dim,
+                        float& dot, float& norm_a_sq, float& norm_b_sq) {
+    __m256 dot0 = _mm256_setzero_ps(), dot1 = _mm256_setzero_ps();
+    __m256 na0 = _mm256_setzero_ps(), na1 = _mm256_setzero_ps();
+    __m256 nb0 = _mm256_setzero_ps(), nb1 = _mm256_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        const __m256 a0 = _mm256_loadu_ps(a + i);
+        const __m256 b0 = _mm256_loadu_ps(b + i);
+        const __m256 a1 = _mm256_loadu_ps(a + i + 8);
+        const __m256 b1 = _mm256_loadu_ps(b + i + 8);
+        dot0 = _mm256_fmadd_ps(a0, b0, dot0);
+        dot1 = _mm256_fmadd_ps(a1, b1, dot1);
+        na0 = _mm256_fmadd_ps(a0, a0, na0);
+        na1 = _mm256_fmadd_ps(a1, a1, na1);
+        nb0 = _mm256_fmadd_ps(b0, b0, nb0);
+        nb1 = _mm256_fmadd_ps(b1, b1, nb1);
+    }
+    float d = hsum256(_mm256_add_ps(dot0, dot1));
+    float na = hsum256(_mm256_add_ps(na0, na1));
+    float nb = hsum256(_mm256_add_ps(nb0, nb1));
+    for (; i < dim; ++i) {
+        d += a[i] * b[i];
+        na += a[i] * a[i];
+        nb += b[i] * b[i];
+    }
+    dot = d;
+    norm_a_sq = na;
+    norm_b_sq = nb;
+}
+
+constexpr Kernels kAvx2Kernels{
+    InstructionSet::AVX2,
+    &l2_squared_avx2,
+    &inner_product_avx2,
+    &norm_squared_avx2,
+    &dot_and_norms_avx2,
+};
+
+// ---------------------------------------------------------------------------
+// AVX-512F: 4 x 16 lanes per iteration, masked loads for the tail.
+// ---------------------------------------------------------------------------
+
+// GCC 12 flags the _mm*_undefined_* placeholders inside its own AVX-512
+// headers as uninitialized (GCC bug 105593).
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+__attribute__((target("avx512f")))
+float l2_squared_avx512(const float* a, const float* b, size_t dim) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps();
+    __m512 acc3 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 64 <= dim; i += 64) {
+        const __m512 d0 = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        const __m512 d1 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16));
+        const __m512 d2 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32));
+        const __m512 d3 = _mm512_sub_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48));
+        acc0 = _mm512_fmadd_ps(d0, d0, acc0);
+        acc1 = _mm512_fmadd_ps(d1, d1, acc1);
+        acc2 = _mm512_fmadd_ps(d2, d2, acc2);
+        acc3 = _mm512_fmadd_ps(d3, d3, acc3);
+    }
+    for (; i + 16 <= dim; i += 16) {
+        const __m512 d = _mm512_sub_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i));
+        acc0 = _mm512_fmadd_ps(d, d, acc0);
+    }
+    if (i < dim) {
+        const __mmask16 mask = static_cast<__mmask16>((1u << (dim - i)) - 1u);
+        const __m512 d = _mm512_sub_ps(_mm512_maskz_loadu_ps(mask, a + i),
+                                       _mm512_maskz_loadu_ps(mask, b + i));
+        acc1 = _mm512_fmadd_ps(d, d, acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3)));
+}
+
+__attribute__((target("avx512f")))
+float inner_product_avx512(const float* a, const float* b, size_t dim) {
+    __m512 acc0 = _mm512_setzero_ps();
+    __m512 acc1 = _mm512_setzero_ps();
+    __m512 acc2 = _mm512_setzero_ps();
+    __m512 acc3 = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 64 <= dim; i += 64) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+        acc1 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 16), _mm512_loadu_ps(b + i + 16), acc1);
+        acc2 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 32), _mm512_loadu_ps(b + i + 32), acc2);
+        acc3 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i + 48), _mm512_loadu_ps(b + i + 48), acc3);
+    }
+    for (; i + 16 <= dim; i += 16) {
+        acc0 = _mm512_fmadd_ps(_mm512_loadu_ps(a + i), _mm512_loadu_ps(b + i), acc0);
+    }
+    if (i < dim) {
+        const __mmask16 mask = static_cast<__mmask16>((1u << (dim - i)) - 1u);
+        acc1 = _mm512_fmadd_ps(_mm512_maskz_loadu_ps(mask, a + i),
+                               _mm512_maskz_loadu_ps(mask, b + i), acc1);
+    }
+    return _mm512_reduce_add_ps(_mm512_add_ps(_mm512_add_ps(acc0, acc1), _mm512_add_ps(acc2, acc3)));
+}
+
+__attribute__((target("avx512f")))
+float norm_squared_avx512(const float* a, size_t dim) {
+    return inner_product_avx512(a, a, dim);
+}
+
+__attribute__((target("avx512f")))
+void dot_and_norms_avx512(const float* a, const float* b, size_t dim,
+                          float& dot, float& norm_a_sq, float& norm_b_sq) {
+    __m512 d = _mm512_setzero_ps();
+    __m512 na = _mm512_setzero_ps();
+    __m512 nb = _mm512_setzero_ps();
+    size_t i = 0;
+    for (; i + 16 <= dim; i += 16) {
+        const __m512 va = _mm512_loadu_ps(a + i);
+        const __m512 vb = _mm512_loadu_ps(b + i);
+        d = _mm512_fmadd_ps(va, vb, d);
+        na = _mm512_fmadd_ps(va, va, na);
+        nb = _mm512_fmadd_ps(vb, vb, nb);
+    }
+    if (i < dim) {
+        const __mmask16 mask = static_cast<__mmask16>((1u << (dim - i)) - 1u);
+        const __m512 va = _mm512_maskz_loadu_ps(mask, a + i);
+        const __m512 vb = _mm512_maskz_loadu_ps(mask, b + i);
+        d = _mm512_fmadd_ps(va, vb, d);
+        na = _mm512_fmadd_ps(va, va, na);
+        nb = _mm512_fmadd_ps(vb, vb, nb);
+    }
+    dot = _mm512_reduce_add_ps(d);
+    norm_a_sq = _mm512_reduce_add_ps(na);
+    norm_b_sq = _mm512_reduce_add_ps(nb);
+}
+
+constexpr Kernels kAvx512Kernels{
+    InstructionSet::AVX512,
+    &l2_squared_avx512,
+    &inner_product_avx512,
+    &norm_squared_avx512,
+    &dot_and_norms_avx512,
+};
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+#endif // SAGE_DB_SIMD_X86
+
+const Kernels* kernels_for(InstructionSet isa) {
+    switch (isa) {
+#ifdef SAGE_DB_SIMD_X86
+        case InstructionSet::AVX512:
+            return &kAvx512Kernels;
+        case InstructionSet::AVX2:
+            return &kAvx2Kernels;
+#endif
+        default:
+            return &kScalarKernels;
+    }
+}
+
+const Kernels* detect_kernels() {
+    for (auto isa : {InstructionSet::AVX512, InstructionSet::AVX2}) {
+        if (is_supported(isa)) {
+            return kernels_for(isa);
+        }
+    }
+    return &kScalarKernels;
+}
+
+std::atomic<const Kernels*>& active_kernels() {
+    static std::atomic<const Kernels*> kernels{detect_kernels()};
+    return kernels;
+}
+
+inline const Kernels& kernels() {
+    return *active_kernels().load(std::memory_order_relaxed);
+}
+
+} // namespace
+
+bool is_supported(InstructionSet isa) {
+    switch (isa) {
+        case InstructionSet::SCALAR:
+            return true;
+#ifdef SAGE_DB_SIMD_X86
+        case InstructionSet::AVX2:
+            return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma");
+        case InstructionSet::AVX512:
+            return __builtin_cpu_supports("avx512f");
+#endif
+        default:
+            return false;
+    }
+}
+
+InstructionSet active_instruction_set() {
+    return kernels().isa;
+}
+
+bool set_instruction_set(InstructionSet isa) {
+    if (!is_supported(isa)) {
+        return false;
+    }
+    active_kernels().store(kernels_for(isa), std::memory_order_relaxed);
+    return true;
+}
+
+std::string instruction_set_name(InstructionSet isa) {
+    switch (isa) {
+        case InstructionSet::SCALAR: return "scalar";
+        case InstructionSet::AVX2: return "avx2";
+        case InstructionSet::AVX512: return "avx512";
+        default: return "unknown";
+    }
+}
+
+float l2_squared(const float* a, const float* b, size_t dim) {
+    return kernels().l2_squared(a, b, dim);
+}
+
+float inner_product(const float* a, const float* b, size_t dim) {
+    return kernels().inner_product(a, b, dim);
+}
+
+float norm_squared(const float* a, size_t dim) {
+    return kernels().norm_squared(a, dim);
+}
+
+void dot_and_norms(const float* a, const float* b, size_t dim,
+                   float& dot, float& norm_a_sq, float& norm_b_sq) {
+    kernels().dot_and_norms(a, b, dim, dot, norm_a_sq, norm_b_sq);
+}
+
+} // namespace simd
+} // namespace sage_db
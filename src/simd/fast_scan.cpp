@@ -0,0 +1,89 @@
+#include "sage_db/simd/fast_scan.h"
+
+#include "sage_db/simd/distance.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SAGE_DB_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace sage_db {
+namespace simd {
+
+namespace {
+
+using AccumulateFn = void (*)(const uint8_t*, size_t, size_t, const uint8_t*, uint16_t*);
+
+void accumulate_scalar(const uint8_t* blocks, size_t block_count, size_t m,
+                       const uint8_t* luts, uint16_t* sums) {
+    const size_t pairs = fast_scan_pairs(m);
+    const size_t block_bytes = fast_scan_block_bytes(m);
+    for (size_t b = 0; b < block_count; ++b) {
+        const uint8_t* block = blocks + b * block_bytes;
+        uint16_t* out = sums + b * kFastScanBlock;
+        for (size_t i = 0; i < kFastScanBlock; ++i) {
+            uint32_t sum = 0;
+            for (size_t p = 0; p < pairs; ++p) {
+                const uint8_t byte = block[p * kFastScanBlock + i];
+                sum += luts[(2 * p) * 16 + (byte & 0x0F)] + luts[(2 * p + 1) * 16 + (byte >> 4)];
+            }
+            out[i] = static_cast<uint16_t>(sum);
+        }
+    }
+}
+
+#ifdef SAGE_DB_SIMD_X86
+
+// VPSHUFB looks up within each 128-bit lane, so every table is broadcast
+// to both lanes and the 32 vectors' codes are shuffled in one go
+__attribute__((target("avx2")))
+void accumulate_avx2(const uint8_t* blocks, size_t block_count, size_t m,
+                     const uint8_t* luts, uint16_t* sums) {
+    const size_t pairs = fast_scan_pairs(m);
+    const size_t block_bytes = fast_scan_block_bytes(m);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0F);
+    for (size_t b = 0; b < block_count; ++b) {
+        const uint8_t* block = blocks + b * block_bytes;
+        __m256i first = _mm256_setzero_si256();   // vectors 0..15
+        __m256i second = _mm256_setzero_si256();  // vectors 16..31
+        for (size_t p = 0; p < pairs; ++p) {
+            const __m256i codes =
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(block + p * kFastScanBlock));
+            const __m256i low_table = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(luts + (2 * p) * 16)));
+            const __m256i high_table = _mm256_broadcastsi128_si256(
+                _mm_loadu_si128(reinterpret_cast<const __m128i*>(luts + (2 * p + 1) * 16)));
+            const __m256i low = _mm256_shuffle_epi8(low_table, _mm256_and_si256(codes, low_nibbles));
+            const __m256i high = _mm256_shuffle_epi8(
+                high_table, _mm256_and_si256(_mm256_srli_epi16(codes, 4), low_nibbles));
+            first = _mm256_add_epi16(first, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(low)));
+            first = _mm256_add_epi16(first, _mm256_cvtepu8_epi16(_mm256_castsi256_si128(high)));
+            second = _mm256_add_epi16(second, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(low, 1)));
+            second = _mm256_add_epi16(second, _mm256_cvtepu8_epi16(_mm256_extracti128_si256(high, 1)));
+        }
+        uint16_t* out = sums + b * kFastScanBlock;
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), first);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 16), second);
+    }
+}
+
+#endif // SAGE_DB_SIMD_X86
+
+inline AccumulateFn accumulate_kernel() {
+#ifdef SAGE_DB_SIMD_X86
+    if (active_instruction_set() != InstructionSet::SCALAR) {
+        return &accumulate_avx2;
+    }
+#endif
+    return &accumulate_scalar;
+}
+
+} // namespace
+
+void fast_scan_accumulate(const uint8_t* blocks, size_t block_count, size_t m,
+                          const uint8_t* luts, uint16_t* sums) {
+    accumulate_kernel()(blocks, block_count, m, luts, sums);
+}
+
+} // namespace simd
+} // namespace sage_db
@@ -0,0 +1,151 @@
+#include "sage_db/simd/hamming.h"
+
+#include "sage_db/simd/distance.h"
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SAGE_DB_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace sage_db {
+namespace simd {
+
+void pack_signs(const float* row, size_t dim, uint64_t* code) {
+    const size_t words = binary_code_words(dim);
+    for (size_t w = 0; w < words; ++w) {
+        uint64_t bits = 0;
+        const size_t first = w * 64;
+        const size_t last = first + 64 < dim ? first + 64 : dim;
+        for (size_t d = first; d < last; ++d) {
+            bits |= static_cast<uint64_t>(row[d] > 0.0f) << (d - first);
+        }
+        code[w] = bits;
+    }
+}
+
+namespace {
+
+struct HammingKernels {
+    uint32_t (*distance)(const uint64_t*, const uint64_t*, size_t);
+};
+
+uint32_t popcount64(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return static_cast<uint32_t>(__builtin_popcountll(value));
+#else
+    uint32_t count = 0;
+    for (; value; value &= value - 1) {
+        ++count;
+    }
+    return count;
+#endif
+}
+
+uint32_t hamming_scalar(const uint64_t* a, const uint64_t* b, size_t words) {
+    uint32_t count = 0;
+    for (size_t w = 0; w < words; ++w) {
+        count += popcount64(a[w] ^ b[w]);
+    }
+    return count;
+}
+
+constexpr HammingKernels kScalarKernels{&hamming_scalar};
+
+#ifdef SAGE_DB_SIMD_X86
+
+// Bits set in each byte: a 16-entry nibble table looked up with PSHUFB.
+// Byte counts reach at most 8 per vector, so up to 31 vectors add up in
+// bytes before PSADBW widens them.
+__attribute__((target("avx2,popcnt")))
+uint32_t hamming_avx2(const uint64_t* a, const uint64_t* b, size_t words) {
+    const __m256i table = _mm256_setr_epi8(0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4,
+                                           0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4);
+    const __m256i low_nibbles = _mm256_set1_epi8(0x0F);
+    __m256i total = _mm256_setzero_si256();
+    size_t w = 0;
+    while (w + 4 <= words) {
+        __m256i bytes = _mm256_setzero_si256();
+        for (size_t block = 0; block < 31 && w + 4 <= words; ++block, w += 4) {
+            const __m256i diff = _mm256_xor_si256(
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(a + w)),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(b + w)));
+            const __m256i low = _mm256_shuffle_epi8(table, _mm256_and_si256(diff, low_nibbles));
+            const __m256i high = _mm256_shuffle_epi8(
+                table, _mm256_and_si256(_mm256_srli_epi16(diff, 4), low_nibbles));
+            bytes = _mm256_add_epi8(bytes, _mm256_add_epi8(low, high));
+        }
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(bytes, _mm256_setzero_si256()));
+    }
+    uint64_t lanes[4];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(lanes), total);
+    uint64_t count = lanes[0] + lanes[1] + lanes[2] + lanes[3];
+    for (; w < words; ++w) {
+        count += static_cast<uint64_t>(__builtin_popcountll(a[w] ^ b[w]));
+    }
+    return static_cast<uint32_t>(count);
+}
+
+// GCC 12 flags the _mm*_undefined_* placeholders inside its own AVX-512
+// headers as uninitialized (GCC bug 105593).
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wuninitialized"
+#endif
+
+__attribute__((target("avx512f,avx512vpopcntdq")))
+uint32_t hamming_avx512(const uint64_t* a, const uint64_t* b, size_t words) {
+    __m512i total = _mm512_setzero_si512();
+    size_t w = 0;
+    for (; w + 8 <= words; w += 8) {
+        const __m512i diff = _mm512_xor_si512(_mm512_loadu_si512(a + w), _mm512_loadu_si512(b + w));
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(diff));
+    }
+    if (w < words) {
+        const __mmask8 tail = static_cast<__mmask8>((1u << (words - w)) - 1u);
+        const __m512i diff = _mm512_xor_si512(_mm512_maskz_loadu_epi64(tail, a + w),
+                                              _mm512_maskz_loadu_epi64(tail, b + w));
+        total = _mm512_add_epi64(total, _mm512_popcnt_epi64(diff));
+    }
+    return static_cast<uint32_t>(_mm512_reduce_add_epi64(total));
+}
+
+#if defined(__GNUC__) && !defined(__clang__)
+#pragma GCC diagnostic pop
+#endif
+
+constexpr HammingKernels kAvx2Kernels{&hamming_avx2};
+constexpr HammingKernels kAvx512Kernels{&hamming_avx512};
+
+#endif // SAGE_DB_SIMD_X86
+
+inline const HammingKernels& kernels() {
+#ifdef SAGE_DB_SIMD_X86
+    static const bool has_vpopcntdq = __builtin_cpu_supports("avx512vpopcntdq");
+    static const bool has_popcnt = __builtin_cpu_supports("popcnt");
+    const InstructionSet isa = active_instruction_set();
+    if (isa == InstructionSet::AVX512 && has_vpopcntdq) {
+        return kAvx512Kernels;
+    }
+    if (isa != InstructionSet::SCALAR && has_popcnt) {
+        return kAvx2Kernels;
+    }
+#endif
+    return kScalarKernels;
+}
+
+} // namespace
+
+uint32_t hamming_distance(const uint64_t* a, const uint64_t* b, size_t words) {
+    return kernels().distance(a, b, words);
+}
+
+void hamming_scan(const uint64_t* query, const uint64_t* codes, size_t count, size_t words,
+                  uint32_t* out) {
+    const auto distance = kernels().distance;  // one dispatch for the whole scan
+    for (size_t i = 0; i < count; ++i) {
+        out[i] = distance(query, codes + i * words, words);
+    }
+}
+
+} // namespace simd
+} // namespace sage_db
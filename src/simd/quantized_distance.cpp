@@ -0,0 +1,476 @@
+#include "sage_db/simd/quantized_distance.h"
+
+#include "sage_db/simd/distance.h"
+
+#include <cstring>
+
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__x86_64__) || defined(__i386__))
+#define SAGE_DB_SIMD_X86 1
+#include <immintrin.h>
+#endif
+
+namespace sage_db {
+namespace simd {
+
+uint16_t float_to_half(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    const uint32_t sign = (bits >> 16) & 0x8000u;
+    const uint32_t magnitude = bits & 0x7FFFFFFFu;
+    if (magnitude >= 0x7F800000u) {  // inf stays inf, NaN stays quiet NaN
+        return static_cast<uint16_t>(sign | 0x7C00u | (magnitude > 0x7F800000u ? 0x200u : 0u));
+    }
+    if (magnitude >= 0x477FF000u) {  // rounds past 65504
+        return static_cast<uint16_t>(sign | 0x7C00u);
+    }
+    if (magnitude < 0x38800000u) {  // below 2^-14: subnormal half, units of 2^-24
+        if (magnitude < 0x33000000u) {
+            return static_cast<uint16_t>(sign);
+        }
+        const uint32_t mantissa = (magnitude & 0x7FFFFFu) | 0x800000u;
+        const uint32_t shift = 126u - (magnitude >> 23);
+        uint32_t half = mantissa >> shift;
+        const uint32_t rest = mantissa & ((1u << shift) - 1u);
+        const uint32_t tie = 1u << (shift - 1u);
+        if (rest > tie || (rest == tie && (half & 1u))) {
+            ++half;
+        }
+        return static_cast<uint16_t>(sign | half);
+    }
+    uint32_t half = (magnitude - 0x38000000u) >> 13;  // rebias 127 -> 15
+    const uint32_t rest = magnitude & 0x1FFFu;
+    if (rest > 0x1000u || (rest == 0x1000u && (half & 1u))) {
+        ++half;
+    }
+    return static_cast<uint16_t>(sign | half);
+}
+
+float half_to_float(uint16_t value) {
+    const uint32_t sign = static_cast<uint32_t>(value & 0x8000u) << 16;
+    const uint32_t exponent = (value >> 10) & 0x1Fu;
+    const uint32_t mantissa = value & 0x3FFu;
+    uint32_t bits;
+    if (exponent == 0) {
+        const float magnitude = static_cast<float>(mantissa) * 5.9604644775390625e-8f;  // 2^-24
+        std::memcpy(&bits, &magnitude, sizeof(bits));
+        bits |= sign;
+    } else if (exponent == 0x1Fu) {
+        bits = sign | 0x7F800000u | (mantissa << 13);
+    } else {
+        bits = sign | ((exponent + 112u) << 23) | (mantissa << 13);
+    }
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+uint16_t float_to_bfloat16(float value) {
+    uint32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    if ((bits & 0x7FFFFFFFu) > 0x7F800000u) {
+        return static_cast<uint16_t>((bits >> 16) | 0x40u);
+    }
+    bits += 0x7FFFu + ((bits >> 16) & 1u);
+    return static_cast<uint16_t>(bits >> 16);
+}
+
+float bfloat16_to_float(uint16_t value) {
+    const uint32_t bits = static_cast<uint32_t>(value) << 16;
+    float result;
+    std::memcpy(&result, &bits, sizeof(result));
+    return result;
+}
+
+namespace {
+
+struct QuantizedKernels {
+    float (*l2_squared_fp16)(const float*, const uint16_t*, size_t);
+    float (*inner_product_fp16)(const float*, const uint16_t*, size_t);
+    float (*l2_squared_bf16)(const float*, const uint16_t*, size_t);
+    float (*inner_product_bf16)(const float*, const uint16_t*, size_t);
+    float (*l2_squared_u8)(const float*, const float*, const uint8_t*, size_t);
+    float (*weighted_sum_u8)(const float*, const uint8_t*, size_t);
+    float (*l2_squared_u4)(const float*, const float*, const uint8_t*, size_t);
+    float (*weighted_sum_u4)(const float*, const uint8_t*, size_t);
+};
+
+// ---------------------------------------------------------------------------
+// Scalar fallback; the AVX2 variants also use these for their tails.
+// ---------------------------------------------------------------------------
+
+inline uint8_t nibble(const uint8_t* code, size_t d) {
+    return (d & 1) ? static_cast<uint8_t>(code[d >> 1] >> 4)
+                   : static_cast<uint8_t>(code[d >> 1] & 0x0F);
+}
+
+float l2_squared_fp16_scalar_from(const float* query, const uint16_t* code, size_t begin,
+                                  size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        const float diff = query[d] - half_to_float(code[d]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+float inner_product_fp16_scalar_from(const float* query, const uint16_t* code, size_t begin,
+                                     size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        sum += query[d] * half_to_float(code[d]);
+    }
+    return sum;
+}
+
+float l2_squared_bf16_scalar_from(const float* query, const uint16_t* code, size_t begin,
+                                  size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        const float diff = query[d] - bfloat16_to_float(code[d]);
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+float inner_product_bf16_scalar_from(const float* query, const uint16_t* code, size_t begin,
+                                     size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        sum += query[d] * bfloat16_to_float(code[d]);
+    }
+    return sum;
+}
+
+float l2_squared_u8_scalar_from(const float* residual, const float* step, const uint8_t* code,
+                                size_t begin, size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        const float diff = residual[d] - static_cast<float>(code[d]) * step[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+float weighted_sum_u8_scalar_from(const float* weight, const uint8_t* code, size_t begin,
+                                  size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        sum += weight[d] * static_cast<float>(code[d]);
+    }
+    return sum;
+}
+
+float l2_squared_u4_scalar_from(const float* residual, const float* step, const uint8_t* code,
+                                size_t begin, size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        const float diff = residual[d] - static_cast<float>(nibble(code, d)) * step[d];
+        sum += diff * diff;
+    }
+    return sum;
+}
+
+float weighted_sum_u4_scalar_from(const float* weight, const uint8_t* code, size_t begin,
+                                  size_t dim) {
+    float sum = 0.0f;
+    for (size_t d = begin; d < dim; ++d) {
+        sum += weight[d] * static_cast<float>(nibble(code, d));
+    }
+    return sum;
+}
+
+float l2_squared_fp16_scalar(const float* query, const uint16_t* code, size_t dim) {
+    return l2_squared_fp16_scalar_from(query, code, 0, dim);
+}
+
+float inner_product_fp16_scalar(const float* query, const uint16_t* code, size_t dim) {
+    return inner_product_fp16_scalar_from(query, code, 0, dim);
+}
+
+float l2_squared_bf16_scalar(const float* query, const uint16_t* code, size_t dim) {
+    return l2_squared_bf16_scalar_from(query, code, 0, dim);
+}
+
+float inner_product_bf16_scalar(const float* query, const uint16_t* code, size_t dim) {
+    return inner_product_bf16_scalar_from(query, code, 0, dim);
+}
+
+float l2_squared_u8_scalar(const float* residual, const float* step, const uint8_t* code,
+                           size_t dim) {
+    return l2_squared_u8_scalar_from(residual, step, code, 0, dim);
+}
+
+float weighted_sum_u8_scalar(const float* weight, const uint8_t* code, size_t dim) {
+    return weighted_sum_u8_scalar_from(weight, code, 0, dim);
+}
+
+float l2_squared_u4_scalar(const float* residual, const float* step, const uint8_t* code,
+                           size_t dim) {
+    return l2_squared_u4_scalar_from(residual, step, code, 0, dim);
+}
+
+float weighted_sum_u4_scalar(const float* weight, const uint8_t* code, size_t dim) {
+    return weighted_sum_u4_scalar_from(weight, code, 0, dim);
+}
+
+constexpr QuantizedKernels kScalarKernels{
+    &l2_squared_fp16_scalar,
+    &inner_product_fp16_scalar,
+    &l2_squared_bf16_scalar,
+    &inner_product_bf16_scalar,
+    &l2_squared_u8_scalar,
+    &weighted_sum_u8_scalar,
+    &l2_squared_u4_scalar,
+    &weighted_sum_u4_scalar,
+};
+
+#ifdef SAGE_DB_SIMD_X86
+
+// ---------------------------------------------------------------------------
+// AVX2 + FMA + F16C: codes widen to 8 float lanes in registers, two
+// accumulators per loop, scalar tail.
+// ---------------------------------------------------------------------------
+
+#define SAGE_DB_QUANTIZED_TARGET __attribute__((target("avx2,fma,f16c")))
+
+SAGE_DB_QUANTIZED_TARGET
+inline float hsum(__m256 v) {
+    __m128 lo = _mm_add_ps(_mm256_castps256_ps128(v), _mm256_extractf128_ps(v, 1));
+    lo = _mm_add_ps(lo, _mm_movehl_ps(lo, lo));
+    lo = _mm_add_ss(lo, _mm_movehdup_ps(lo));
+    return _mm_cvtss_f32(lo);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+inline __m256 load_fp16(const uint16_t* code) {
+    return _mm256_cvtph_ps(_mm_loadu_si128(reinterpret_cast<const __m128i*>(code)));
+}
+
+SAGE_DB_QUANTIZED_TARGET
+inline __m256 load_bf16(const uint16_t* code) {
+    const __m256i wide =
+        _mm256_cvtepu16_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(code)));
+    return _mm256_castsi256_ps(_mm256_slli_epi32(wide, 16));
+}
+
+SAGE_DB_QUANTIZED_TARGET
+inline __m256 widen_u8(__m128i bytes) {
+    return _mm256_cvtepi32_ps(_mm256_cvtepu8_epi32(bytes));
+}
+
+SAGE_DB_QUANTIZED_TARGET
+inline __m256 load_u8(const uint8_t* code) {
+    return widen_u8(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(code)));
+}
+
+// 16 codes from 8 bytes, in dimension order
+SAGE_DB_QUANTIZED_TARGET
+inline __m128i unpack_u4(const uint8_t* code) {
+    const __m128i bytes = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(code));
+    const __m128i mask = _mm_set1_epi8(0x0F);
+    const __m128i low = _mm_and_si128(bytes, mask);
+    const __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), mask);
+    return _mm_unpacklo_epi8(low, high);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float l2_squared_fp16_avx2(const float* query, const uint16_t* code, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        const __m256 diff0 = _mm256_sub_ps(_mm256_loadu_ps(query + d), load_fp16(code + d));
+        const __m256 diff1 = _mm256_sub_ps(_mm256_loadu_ps(query + d + 8), load_fp16(code + d + 8));
+        acc0 = _mm256_fmadd_ps(diff0, diff0, acc0);
+        acc1 = _mm256_fmadd_ps(diff1, diff1, acc1);
+    }
+    for (; d + 8 <= dim; d += 8) {
+        const __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(query + d), load_fp16(code + d));
+        acc0 = _mm256_fmadd_ps(diff, diff, acc0);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) + l2_squared_fp16_scalar_from(query, code, d, dim);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float inner_product_fp16_avx2(const float* query, const uint16_t* code, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d), load_fp16(code + d), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d + 8), load_fp16(code + d + 8), acc1);
+    }
+    for (; d + 8 <= dim; d += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d), load_fp16(code + d), acc0);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) + inner_product_fp16_scalar_from(query, code, d, dim);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float l2_squared_bf16_avx2(const float* query, const uint16_t* code, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        const __m256 diff0 = _mm256_sub_ps(_mm256_loadu_ps(query + d), load_bf16(code + d));
+        const __m256 diff1 = _mm256_sub_ps(_mm256_loadu_ps(query + d + 8), load_bf16(code + d + 8));
+        acc0 = _mm256_fmadd_ps(diff0, diff0, acc0);
+        acc1 = _mm256_fmadd_ps(diff1, diff1, acc1);
+    }
+    for (; d + 8 <= dim; d += 8) {
+        const __m256 diff = _mm256_sub_ps(_mm256_loadu_ps(query + d), load_bf16(code + d));
+        acc0 = _mm256_fmadd_ps(diff, diff, acc0);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) + l2_squared_bf16_scalar_from(query, code, d, dim);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float inner_product_bf16_avx2(const float* query, const uint16_t* code, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d), load_bf16(code + d), acc0);
+        acc1 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d + 8), load_bf16(code + d + 8), acc1);
+    }
+    for (; d + 8 <= dim; d += 8) {
+        acc0 = _mm256_fmadd_ps(_mm256_loadu_ps(query + d), load_bf16(code + d), acc0);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) + inner_product_bf16_scalar_from(query, code, d, dim);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float l2_squared_u8_avx2(const float* residual, const float* step, const uint8_t* code,
+                         size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        const __m256 diff0 = _mm256_fnmadd_ps(load_u8(code + d), _mm256_loadu_ps(step + d),
+                                              _mm256_loadu_ps(residual + d));
+        const __m256 diff1 = _mm256_fnmadd_ps(load_u8(code + d + 8), _mm256_loadu_ps(step + d + 8),
+                                              _mm256_loadu_ps(residual + d + 8));
+        acc0 = _mm256_fmadd_ps(diff0, diff0, acc0);
+        acc1 = _mm256_fmadd_ps(diff1, diff1, acc1);
+    }
+    for (; d + 8 <= dim; d += 8) {
+        const __m256 diff = _mm256_fnmadd_ps(load_u8(code + d), _mm256_loadu_ps(step + d),
+                                             _mm256_loadu_ps(residual + d));
+        acc0 = _mm256_fmadd_ps(diff, diff, acc0);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) +
+           l2_squared_u8_scalar_from(residual, step, code, d, dim);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float weighted_sum_u8_avx2(const float* weight, const uint8_t* code, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        acc0 = _mm256_fmadd_ps(load_u8(code + d), _mm256_loadu_ps(weight + d), acc0);
+        acc1 = _mm256_fmadd_ps(load_u8(code + d + 8), _mm256_loadu_ps(weight + d + 8), acc1);
+    }
+    for (; d + 8 <= dim; d += 8) {
+        acc0 = _mm256_fmadd_ps(load_u8(code + d), _mm256_loadu_ps(weight + d), acc0);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) + weighted_sum_u8_scalar_from(weight, code, d, dim);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float l2_squared_u4_avx2(const float* residual, const float* step, const uint8_t* code,
+                         size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        const __m128i codes = unpack_u4(code + d / 2);
+        const __m256 diff0 = _mm256_fnmadd_ps(widen_u8(codes), _mm256_loadu_ps(step + d),
+                                              _mm256_loadu_ps(residual + d));
+        const __m256 diff1 = _mm256_fnmadd_ps(widen_u8(_mm_srli_si128(codes, 8)),
+                                              _mm256_loadu_ps(step + d + 8),
+                                              _mm256_loadu_ps(residual + d + 8));
+        acc0 = _mm256_fmadd_ps(diff0, diff0, acc0);
+        acc1 = _mm256_fmadd_ps(diff1, diff1, acc1);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) +
+           l2_squared_u4_scalar_from(residual, step, code, d, dim);
+}
+
+SAGE_DB_QUANTIZED_TARGET
+float weighted_sum_u4_avx2(const float* weight, const uint8_t* code, size_t dim) {
+    __m256 acc0 = _mm256_setzero_ps();
+    __m256 acc1 = _mm256_setzero_ps();
+    size_t d = 0;
+    for (; d + 16 <= dim; d += 16) {
+        const __m128i codes = unpack_u4(code + d / 2);
+        acc0 = _mm256_fmadd_ps(widen_u8(codes), _mm256_loadu_ps(weight + d), acc0);
+        acc1 = _mm256_fmadd_ps(widen_u8(_mm_srli_si128(codes, 8)),
+                               _mm256_loadu_ps(weight + d + 8), acc1);
+    }
+    return hsum(_mm256_add_ps(acc0, acc1)) + weighted_sum_u4_scalar_from(weight, code, d, dim);
+}
+
+#undef SAGE_DB_QUANTIZED_TARGET
+
+constexpr QuantizedKernels kAvx2Kernels{
+    &l2_squared_fp16_avx2,
+    &inner_product_fp16_avx2,
+    &l2_squared_bf16_avx2,
+    &inner_product_bf16_avx2,
+    &l2_squared_u8_avx2,
+    &weighted_sum_u8_avx2,
+    &l2_squared_u4_avx2,
+    &weighted_sum_u4_avx2,
+};
+
+#endif // SAGE_DB_SIMD_X86
+
+// Follows the float kernels' selection, so set_instruction_set(SCALAR)
+// also pins these to scalar code
+inline const QuantizedKernels& kernels() {
+#ifdef SAGE_DB_SIMD_X86
+    static const bool has_f16c = __builtin_cpu_supports("f16c");
+    if (has_f16c && active_instruction_set() != InstructionSet::SCALAR) {
+        return kAvx2Kernels;
+    }
+#endif
+    return kScalarKernels;
+}
+
+} // namespace
+
+float l2_squared_fp16(const float* query, const uint16_t* code, size_t dim) {
+    return kernels().l2_squared_fp16(query, code, dim);
+}
+
+float inner_product_fp16(const float* query, const uint16_t* code, size_t dim) {
+    return kernels().inner_product_fp16(query, code, dim);
+}
+
+float l2_squared_bf16(const float* query, const uint16_t* code, size_t dim) {
+    return kernels().l2_squared_bf16(query, code, dim);
+}
+
+float inner_product_bf16(const float* query, const uint16_t* code, size_t dim) {
+    return kernels().inner_product_bf16(query, code, dim);
+}
+
+float l2_squared_u8(const float* residual, const float* step, const uint8_t* code, size_t dim) {
+    return kernels().l2_squared_u8(residual, step, code, dim);
+}
+
+float weighted_sum_u8(const float* weight, const uint8_t* code, size_t dim) {
+    return kernels().weighted_sum_u8(weight, code, dim);
+}
+
+float l2_squared_u4(const float* residual, const float* step, const uint8_t* code, size_t dim) {
+    return kernels().l2_squared_u4(residual, step, code, dim);
+}
+
+float weighted_sum_u4(const float* weight, const uint8_t* code, size_t dim) {
+    return kernels().weighted_sum_u4(weight, code, dim);
+}
+
+} // namespace simd
+} // namespace sage_db
@@ -0,0 +1,211 @@
+#include "sage_db/thread_pool.h"
+
+#include <algorithm>
+#include <exception>
+
+namespace sage_db {
+
+namespace {
+
+// Identifies the pool (and deque) owned by the current worker thread
+thread_local const ThreadPool* tls_pool = nullptr;
+thread_local size_t tls_queue = 0;
+
+size_t resolve_thread_count(size_t requested) {
+    if (requested > 0) {
+        return requested;
+    }
+    return std::max<size_t>(std::thread::hardware_concurrency(), 1);
+}
+
+std::mutex& global_mutex() {
+    static std::mutex mutex;
+    return mutex;
+}
+
+std::shared_ptr<ThreadPool>& global_slot() {
+    static std::shared_ptr<ThreadPool> pool;
+    return pool;
+}
+
+} // namespace
+
+ThreadPool::ThreadPool(size_t num_threads) {
+    const size_t total = resolve_thread_count(num_threads);
+    const size_t worker_count = total - 1;
+    queues_.reserve(std::max<size_t>(worker_count, 1));
+    for (size_t i = 0; i < std::max<size_t>(worker_count, 1); ++i) {
+        queues_.push_back(std::make_unique<WorkQueue>());
+    }
+    workers_.reserve(worker_count);
+    for (size_t i = 0; i < worker_count; ++i) {
+        workers_.emplace_back([this, i] { worker_loop(i); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+    for (auto& worker : workers_) {
+        worker.join();
+    }
+}
+
+size_t ThreadPool::home_queue() const {
+    if (tls_pool == this) {
+        return tls_queue;
+    }
+    return next_queue_.load(std::memory_order_relaxed) % queues_.size();
+}
+
+void ThreadPool::submit(Task task) {
+    // Workers push to their own deque; external callers spread round-robin
+    size_t index = tls_pool == this
+        ? tls_queue
+        : next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size();
+    {
+        std::lock_guard<std::mutex> lock(queues_[index]->mutex);
+        queues_[index]->tasks.push_back(std::move(task));
+    }
+    pending_.fetch_add(1, std::memory_order_release);
+    {
+        // Pairs with the predicate check in worker_loop so a wakeup is never lost
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+    }
+    wake_.notify_one();
+}
+
+bool ThreadPool::pop_local(size_t index, Task& task) {
+    auto& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) {
+        return false;
+    }
+    task = std::move(queue.tasks.back());
+    queue.tasks.pop_back();
+    return true;
+}
+
+bool ThreadPool::steal(size_t thief, Task& task) {
+    const size_t count = queues_.size();
+    for (size_t offset = 1; offset < count; ++offset) {
+        auto& queue = *queues_[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (!queue.tasks.empty()) {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+            return true;
+        }
+    }
+    return false;
+}
+
+bool ThreadPool::run_one(size_t home) {
+    Task task;
+    if (!pop_local(home, task) && !steal(home, task)) {
+        return false;
+    }
+    pending_.fetch_sub(1, std::memory_order_acq_rel);
+    task();
+    return true;
+}
+
+void ThreadPool::worker_loop(size_t index) {
+    tls_pool = this;
+    tls_queue = index;
+    while (true) {
+        if (run_one(index)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] {
+            return stop_ || pending_.load(std::memory_order_acquire) > 0;
+        });
+        if (stop_ && pending_.load(std::memory_order_acquire) == 0) {
+            return;
+        }
+    }
+}
+
+void ThreadPool::parallel_for(size_t begin, size_t end,
+                              const std::function<void(size_t)>& fn,
+                              size_t grain) {
+    if (begin >= end) {
+        return;
+    }
+    const size_t count = end - begin;
+    grain = std::max<size_t>(grain, 1);
+    if (workers_.empty() || count <= grain) {
+        for (size_t i = begin; i < end; ++i) {
+            fn(i);
+        }
+        return;
+    }
+
+    // A few chunks per thread lets stealing smooth out uneven query costs
+    const size_t max_chunks = size() * 4;
+    const size_t chunks = std::min((count + grain - 1) / grain, max_chunks);
+    const size_t chunk_size = (count + chunks - 1) / chunks;
+
+    std::atomic<size_t> remaining{chunks};
+    std::exception_ptr error;
+    std::mutex error_mutex;
+
+    auto run_chunk = [&](size_t chunk) {
+        const size_t lo = begin + chunk * chunk_size;
+        const size_t hi = std::min(end, lo + chunk_size);
+        try {
+            for (size_t i = lo; i < hi; ++i) {
+                fn(i);
+            }
+        } catch (...) {
+            std::lock_guard<std::mutex> lock(error_mutex);
+            if (!error) {
+                error = std::current_exception();
+            }
+        }
+        remaining.fetch_sub(1, std::memory_order_acq_rel);
+    };
+
+    for (size_t chunk = 1; chunk < chunks; ++chunk) {
+        submit([&run_chunk, chunk] { run_chunk(chunk); });
+    }
+    run_chunk(0);
+
+    // Help drain the queues instead of blocking; this is what makes nested
+    // parallel_for calls from worker threads safe.
+    const size_t home = home_queue();
+    while (remaining.load(std::memory_order_acquire) > 0) {
+        if (!run_one(home)) {
+            std::this_thread::yield();
+        }
+    }
+
+    if (error) {
+        std::rethrow_exception(error);
+    }
+}
+
+std::shared_ptr<ThreadPool> ThreadPool::global() {
+    std::lock_guard<std::mutex> lock(global_mutex());
+    auto& pool = global_slot();
+    if (!pool) {
+        pool = std::make_shared<ThreadPool>();
+    }
+    return pool;
+}
+
+void ThreadPool::configure_global(size_t num_threads) {
+    const size_t total = resolve_thread_count(num_threads);
+    std::lock_guard<std::mutex> lock(global_mutex());
+    auto& pool = global_slot();
+    if (pool && pool->size() == total) {
+        return;
+    }
+    pool = std::make_shared<ThreadPool>(total);
+}
+
+} // namespace sage_db
@@ -0,0 +1,48 @@
+#include "sage_db/vector_arena.h"
+
+#include <cstring>
+
+namespace sage_db {
+
+namespace {
+
+// Pad rows to a cache line only when that costs at most 1/8 of the row;
+// small dimensions are packed tightly since memory is the scarcer resource.
+size_t arena_row_stride(Dimension dimension) {
+    const size_t padded = simd::padded_row_stride(dimension);
+    return padded - dimension <= dimension / 8 ? padded : dimension;
+}
+
+} // namespace
+
+VectorArena::VectorArena(Dimension dimension)
+    : dimension_(dimension), stride_(arena_row_stride(dimension)) {}
+
+size_t VectorArena::append(VectorId id, const float* values) {
+    const size_t slot = ids_.size();
+    if (slot % kRowsPerChunk == 0) {
+        // Zero-filled, so padding lanes are well defined for the kernels
+        chunks_.emplace_back(kRowsPerChunk * stride_, 0.0f);
+    }
+    float* dst = chunks_.back().data() + (slot % kRowsPerChunk) * stride_;
+    std::memcpy(dst, values, dimension_ * sizeof(float));
+    ids_.push_back(id);
+    live_.push_back(1);
+    ++live_count_;
+    return slot;
+}
+
+void VectorArena::release(size_t slot) {
+    if (slot < live_.size() && live_[slot]) {
+        live_[slot] = 0;
+        --live_count_;
+    }
+}
+
+size_t VectorArena::memory_usage() const {
+    return chunks_.size() * kRowsPerChunk * stride_ * sizeof(float) +
+           ids_.capacity() * sizeof(VectorId) +
+           live_.capacity() * sizeof(uint8_t);
+}
+
+} // namespace sage_db
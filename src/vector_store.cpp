@@ -1,173 +1,435 @@
 #include "sage_db/vector_store.h"
 #include "sage_db/anns/anns_interface.h"
 #include "sage_db/anns/brute_force_plugin.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/thread_pool.h"
+#include "sage_db/vector_arena.h"
 #ifdef ENABLE_FAISS
 #include "sage_db/anns/faiss_plugin.h"
 #endif
 
 #include <algorithm>
+#include <atomic>
 #include <chrono>
+#include <condition_variable>
 #include <cstdio>
 #include <fstream>
 #include <mutex>
 #include <shared_mutex>
+#include <span>
 #include <stdexcept>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 namespace sage_db {
 namespace {
-constexpr uint32_t kVectorStoreFormatVersion = 1;
+// Version 2 appends the per-vector filter labels
+constexpr uint32_t kVectorStoreFormatVersion = 2;
+
+// Sorted and deduplicated, the form DatasetView and the index expect
+std::vector<FilterLabel> normalized_labels(std::vector<FilterLabel> labels) {
+    std::sort(labels.begin(), labels.end());
+    labels.erase(std::unique(labels.begin(), labels.end()), labels.end());
+    return labels;
 }
+}
+
+// Writes not yet reflected in an index. `added` ids are scanned exactly
+// from the arena; `tombstones` are ids the index may still return but
+// whose vectors were removed or overwritten after it was built.
+struct DeltaLog {
+    std::unordered_set<VectorId> added;
+    std::unordered_set<VectorId> tombstones;
+
+    bool empty() const { return added.empty() && tombstones.empty(); }
+    size_t size() const { return added.size() + tombstones.size(); }
+
+    void clear() {
+        added.clear();
+        tombstones.clear();
+    }
+
+    void note_add(VectorId id) { added.insert(id); }
+
+    void note_remove(VectorId id) {
+        // Ids added after the build were never indexed; updated ids are
+        // already tombstoned.
+        if (added.erase(id) == 0) {
+            tombstones.insert(id);
+        }
+    }
+
+    void note_update(VectorId id) {
+        if (added.insert(id).second) {
+            tombstones.insert(id);
+        }
+    }
+};
 
 class VectorStore::Impl {
 public:
-    explicit Impl(const DatabaseConfig& config)
-        : config_(config), algorithm_name_(select_algorithm(config.anns_algorithm)) {
+    Impl(const DatabaseConfig& config, std::shared_mutex& store_mutex, std::mutex& writer_mutex)
+        : config_(config),
+          algorithm_name_(select_algorithm(config.anns_algorithm, config.index_type)),
+          arena_(std::make_shared<VectorArena>(config.dimension)),
+          store_mutex_(store_mutex),
+          writer_mutex_(writer_mutex) {
         initialize_algorithm();
     }
 
-    VectorId add_vector(const Vector& vector) {
+    ~Impl() {
+        {
+            std::lock_guard<std::mutex> lock(builder_mutex_);
+            stop_builder_ = true;
+        }
+        builder_cv_.notify_all();
+        if (builder_.joinable()) {
+            builder_.join();
+        }
+    }
+
+    // Mutators run under the writer mutex and the store's exclusive lock.
+    // Vectors are stored once, in arena_; indexes that can borrow rows
+    // reference them in place.
+    VectorId add_vector(const Vector& vector, std::vector<FilterLabel> labels,
+                        std::unique_lock<std::shared_mutex>& lock) {
         VectorId id = next_id_++;
-        dataset_.push_back({id, vector});
-        id_to_index_[id] = dataset_.size() - 1;
+        const size_t slot = arena_->append(id, vector.data());
+        id_to_slot_[id] = slot;
+        if (!labels.empty()) {
+            labels_[id] = normalized_labels(std::move(labels));
+        }
 
+        if (building_) {
+            pending_.note_add(id);
+        }
+        auto view = arena_view();
         if (index_built_ && algorithm_->supports_updates()) {
-            algorithm_->add_vector(dataset_.back());
-        } else {
-            index_dirty_ = true;
+            append_row(view, id, arena_->row(slot));
+        } else if (index_built_) {
+            delta_.note_add(id);
         }
+        note_writes(1);
+        schedule_rebuild_if_needed();
+        insert_into_index(view, lock);
         return id;
     }
 
-    std::vector<VectorId> add_vectors(const std::vector<Vector>& vectors) {
+    // row_at(i) yields the first float of input row i; labels is empty or
+    // holds one set per row
+    template <typename RowAt>
+    std::vector<VectorId> add_vectors(size_t count, RowAt row_at,
+                                      const std::vector<std::vector<FilterLabel>>& labels,
+                                      std::unique_lock<std::shared_mutex>& lock) {
         std::vector<VectorId> ids;
-        ids.reserve(vectors.size());
+        ids.reserve(count);
 
-        std::vector<anns::VectorEntry> entries;
-        entries.reserve(vectors.size());
+        auto view = arena_view();
+        view.reserve(count);
 
-        for (const auto& vec : vectors) {
+        for (size_t i = 0; i < count; ++i) {
             VectorId id = next_id_++;
             ids.push_back(id);
-            dataset_.push_back({id, vec});
-            id_to_index_[id] = dataset_.size() - 1;
-            entries.emplace_back(id, vec);
+            const size_t slot = arena_->append(id, row_at(i));
+            id_to_slot_[id] = slot;
+            if (!labels.empty() && !labels[i].empty()) {
+                labels_[id] = normalized_labels(labels[i]);
+            }
+            append_row(view, id, arena_->row(slot));
+            if (building_) {
+                pending_.note_add(id);
+            }
         }
 
-        if (index_built_ && !entries.empty() && algorithm_->supports_updates()) {
-            algorithm_->add_vectors(entries);
-        } else if (!entries.empty()) {
-            index_dirty_ = true;
+        if (!index_built_ || !algorithm_->supports_updates()) {
+            if (index_built_) {
+                for (VectorId id : ids) {
+                    delta_.note_add(id);
+                }
+            }
+            view = arena_view();
         }
+        note_writes(count);
+        schedule_rebuild_if_needed();
+        insert_into_index(view, lock);
 
         return ids;
     }
 
+    // Last step of an add. An index that takes concurrent updates is
+    // extended under a shared lock, so searches only wait for the
+    // bookkeeping above; the caller's writer mutex keeps other writers and
+    // the builder's swap away until the insert lands.
+    void insert_into_index(const anns::DatasetView& view,
+                           std::unique_lock<std::shared_mutex>& lock) {
+        if (view.empty()) {
+            return;
+        }
+        if (!algorithm_->supports_concurrent_updates()) {
+            algorithm_->add_vectors(view);
+            return;
+        }
+        lock.unlock();
+        std::shared_lock<std::shared_mutex> shared(store_mutex_);
+        algorithm_->add_vectors(view);
+    }
+
     bool remove_vector(VectorId id) {
-        auto it = id_to_index_.find(id);
-        if (it == id_to_index_.end()) {
+        auto it = id_to_slot_.find(id);
+        if (it == id_to_slot_.end()) {
             return false;
         }
 
-        size_t index = it->second;
-        size_t last_index = dataset_.size() - 1;
+        // The row stays readable for indexes still borrowing it
+        arena_->release(it->second);
+        id_to_slot_.erase(it);
+        labels_.erase(id);
 
-        if (index != last_index) {
-            std::swap(dataset_[index], dataset_[last_index]);
-            id_to_index_[dataset_[index].first] = index;
+        if (building_) {
+            pending_.note_remove(id);
         }
-
-        dataset_.pop_back();
-        id_to_index_.erase(it);
-
-        if (index_built_ && algorithm_->supports_deletions()) {
+        if (index_built_ && algorithm_->supports_deletions() && !delta_.added.count(id)) {
             algorithm_->remove_vector(id);
-        } else {
-            index_dirty_ = true;
+        } else if (index_built_) {
+            delta_.note_remove(id);
         }
+        note_writes(1);
+        schedule_rebuild_if_needed();
         return true;
     }
 
     bool update_vector(VectorId id, const Vector& vector) {
-        auto it = id_to_index_.find(id);
-        if (it == id_to_index_.end()) {
+        auto it = id_to_slot_.find(id);
+        if (it == id_to_slot_.end()) {
             return false;
         }
 
-        dataset_[it->second].second = vector;
+        // Copy-on-write: rows are immutable once borrowed, so the new value
+        // gets a fresh slot and the old one is released.
+        arena_->release(it->second);
+        it->second = arena_->append(id, vector.data());
+        reindex(id, it->second);
+        return true;
+    }
 
-        if (index_built_ && algorithm_->supports_updates() && algorithm_->supports_deletions()) {
-            algorithm_->remove_vector(id);
-            algorithm_->add_vector({id, vector});
+    bool set_labels(VectorId id, std::vector<FilterLabel> labels) {
+        auto it = id_to_slot_.find(id);
+        if (it == id_to_slot_.end()) {
+            return false;
+        }
+        labels = normalized_labels(std::move(labels));
+        auto current = labels_of(id);
+        if (std::equal(current.begin(), current.end(), labels.begin(), labels.end())) {
+            return true;
+        }
+        if (labels.empty()) {
+            labels_.erase(id);
         } else {
-            index_dirty_ = true;
+            labels_[id] = std::move(labels);
+        }
+        // Other indexes never see labels; filters on them scan exactly
+        if (algorithm_->supports_filtered_search()) {
+            reindex(id, it->second);
         }
         return true;
     }
 
-    std::vector<QueryResult> search(const Vector& query, const SearchParams& params) {
-        if (dataset_.empty()) {
-            return {};
+    // Re-inserts a changed vector into an updatable index, or routes it
+    // through the delta until the next rebuild
+    void reindex(VectorId id, size_t slot) {
+        if (building_) {
+            pending_.note_update(id);
+        }
+        if (index_built_ && algorithm_->supports_updates() && algorithm_->supports_deletions() &&
+            !delta_.added.count(id)) {
+            algorithm_->remove_vector(id);
+            auto view = arena_view();
+            append_row(view, id, arena_->row(slot));
+            algorithm_->add_vectors(view);
+        } else if (index_built_) {
+            delta_.note_update(id);
         }
+        note_writes(1);
+        schedule_rebuild_if_needed();
+    }
 
-        ensure_index_ready();
+    // Readers run under the store's shared lock and never build: while a
+    // rebuild is pending, results come from the current index (minus
+    // tombstones) merged with an exact scan of the delta.
+    std::vector<QueryResult> search(const Vector& query, const SearchParams& params) const {
+        if (id_to_slot_.empty()) {
+            return {};
+        }
 
         auto query_config = create_query_config(params);
+        const bool range = params.radius > 0.0f && algorithm_->supports_range_search();
+        const bool use_index = index_usable(params);
 
-        if (params.radius > 0.0f && algorithm_->supports_range_search()) {
-            auto range_result = execute_range_query(query, params.radius, query_config);
-            last_metrics_ = algorithm_->get_metrics();
-            return convert_result(range_result);
+        if (use_index && delta_.empty()) {
+            if (range) {
+                auto range_result = execute_range_query(query, params.radius, query_config);
+                return convert_result(range_result);
+            }
+            auto result = execute_query(query, query_config);
+            return convert_result(result);
         }
 
-        auto result = execute_query(query, query_config);
-        last_metrics_ = algorithm_->get_metrics();
-        return convert_result(result);
+        anns::ANNSResult index_result;
+        bool exact = !use_index;
+        if (use_index) {
+            if (range) {
+                index_result = execute_range_query(query, params.radius, query_config);
+            } else {
+                const size_t fetched = index_fetch_k(params.k);
+                query_config.k = static_cast<uint32_t>(fetched);
+                index_result = execute_query(query, query_config);
+                exact = tombstones_hid_hits(index_result.ids.data(), index_result.ids.size(),
+                                            fetched, params.k);
+            }
+        }
+        return merge_with_delta(query.data(),
+                                exact ? nullptr : index_result.ids.data(),
+                                exact ? 0 : index_result.ids.size(),
+                                range ? params.radius : 0.0f, params.k, params.filter_labels);
+    }
+
+    // Tombstoned hits are dropped after the index answers, so it is asked
+    // for extra results: one per tombstone, at most kTombstoneOverfetch * k
+    size_t index_fetch_k(size_t k) const {
+        return k + std::min(delta_.tombstones.size(), kTombstoneOverfetch * k);
     }
 
-    std::vector<std::vector<QueryResult>> batch_search(const std::vector<Vector>& queries,
-                                                       const SearchParams& params) {
-        if (queries.empty()) {
+    // A full answer from the index that tombstones cut below k may have
+    // missed live rows; such a query is answered by the exact scan instead
+    bool tombstones_hid_hits(const VectorId* ids, size_t count, size_t fetched,
+                             size_t k) const {
+        if (count < fetched || delta_.tombstones.empty()) {
+            return false;  // the index returned everything it had
+        }
+        size_t live = 0;
+        for (size_t i = 0; i < count && live < k; ++i) {
+            live += delta_.tombstones.count(ids[i]) == 0;
+        }
+        return live < k;
+    }
+
+    // Filters on labels the index cannot search fall back to an exact scan
+    bool index_usable(const SearchParams& params) const {
+        return index_built_ &&
+               (params.filter_labels.empty() || algorithm_->supports_filtered_search());
+    }
+
+    // Queries are read in place and plugins write into one id/distance
+    // buffer for the whole batch.
+    std::vector<std::vector<QueryResult>> batch_search(const anns::QueryMatrix& queries,
+                                                       const SearchParams& params) const {
+        if (queries.rows == 0) {
             return {};
         }
-        ensure_index_ready();
+        if (id_to_slot_.empty()) {
+            return std::vector<std::vector<QueryResult>>(queries.rows);
+        }
         auto query_config = create_query_config(params);
+        const bool use_index = index_usable(params);
+        const bool merge = !use_index || !delta_.empty();
+        if (use_index && merge) {
+            query_config.k = static_cast<uint32_t>(index_fetch_k(params.k));
+        }
 
-    auto batch_results = execute_batch_query(queries, query_config);
-    last_metrics_ = algorithm_->get_metrics();
+        const size_t k = query_config.k;
+        std::vector<VectorId> ids;
+        std::vector<float> distances;
+        std::vector<size_t> counts(queries.rows, 0);
+        if (use_index) {
+            ids.resize(queries.rows * k);
+            distances.resize(queries.rows * k);
+            anns::QueryOutput output;
+            output.ids = ids.data();
+            output.distances = distances.data();
+            output.counts = counts.data();
+            algorithm_->batch_query(queries, query_config, output);
+        }
 
-        std::vector<std::vector<QueryResult>> converted;
-        converted.reserve(batch_results.size());
-        for (const auto& res : batch_results) {
-            converted.emplace_back(convert_result(res));
+        std::vector<std::vector<QueryResult>> converted(queries.rows);
+        if (!merge) {
+            for (size_t i = 0; i < queries.rows; ++i) {
+                converted[i].reserve(counts[i]);
+                for (size_t j = 0; j < counts[i]; ++j) {
+                    converted[i].emplace_back(ids[i * k + j], distances[i * k + j]);
+                }
+            }
+            return converted;
         }
+
+        ThreadPool::global()->parallel_for(0, queries.rows, [&](size_t i) {
+            const VectorId* hits = use_index ? ids.data() + i * k : nullptr;
+            if (hits && tombstones_hid_hits(hits, counts[i], k, params.k)) {
+                hits = nullptr;
+            }
+            converted[i] = merge_with_delta(queries.row(i), hits, hits ? counts[i] : 0, 0.0f,
+                                            params.k, params.filter_labels);
+        });
         return converted;
     }
 
+    // Synchronous build on the caller's thread; supersedes any background build.
     void build_index() {
-        if (dataset_.empty()) {
-            index_built_ = true;
-            index_dirty_ = false;
+        ++build_generation_;
+        index_stale_ = false;
+        build_failed_ = false;
+        delta_.clear();
+
+        if (id_to_slot_.empty()) {
+            algorithm_ = create_algorithm();
+            index_built_ = false;
             return;
         }
 
-        auto build_params = compose_build_params();
-        algorithm_->fit(dataset_, build_params);
+        if (arena_needs_compaction()) {
+            // The current index keeps the old arena alive until replaced
+            arena_ = compact_arena(id_to_slot_);
+        }
+        auto fresh = create_algorithm();
+        const auto params = compose_build_params();
+        if (training_) {
+            fresh->train(live_view(*training_, training_), params);
+        }
+        fresh->fit(live_view(*arena_, arena_, &labels_), params);
+        algorithm_ = std::move(fresh);
         index_built_ = algorithm_->is_built();
-        index_dirty_ = false;
+        build_error_.clear();
     }
 
     void set_training_data(const std::vector<Vector>& training) {
-        training_data_ = training;
-        index_dirty_ = true;
+        if (training.empty()) {
+            training_.reset();
+        } else {
+            auto arena = std::make_shared<VectorArena>(config_.dimension);
+            for (size_t i = 0; i < training.size(); ++i) {
+                arena->append(static_cast<VectorId>(i), training[i].data());
+            }
+            training_ = std::move(arena);
+        }
+        index_stale_ = true;
+        build_failed_ = false;
+        schedule_rebuild_if_needed();
     }
 
     bool is_trained() const {
-        return index_built_ && !index_dirty_ && algorithm_->is_built();
+        return index_built_ && delta_.empty() && !index_stale_ && algorithm_->is_built();
+    }
+
+    bool supports_filtered_search() const {
+        return algorithm_->supports_filtered_search();
+    }
+
+    const std::string& last_build_error() const {
+        return build_error_;
     }
 
     size_t size() const {
-        return dataset_.size();
+        return id_to_slot_.size();
     }
 
     void save(const std::string& filepath) const {
@@ -187,20 +449,34 @@ public:
         out.write(reinterpret_cast<const char*>(&metric_value), sizeof(metric_value));
         out.write(reinterpret_cast<const char*>(&config_.dimension), sizeof(config_.dimension));
 
-        uint64_t count = dataset_.size();
+        uint64_t count = id_to_slot_.size();
         out.write(reinterpret_cast<const char*>(&count), sizeof(count));
-        for (const auto& entry : dataset_) {
-            out.write(reinterpret_cast<const char*>(&entry.first), sizeof(entry.first));
-            Dimension dim = static_cast<Dimension>(entry.second.size());
+        const Dimension dim = arena_->dimension();
+        for (size_t slot = 0; slot < arena_->slot_count(); ++slot) {
+            if (!arena_->is_live(slot)) {
+                continue;
+            }
+            const VectorId id = arena_->id(slot);
+            out.write(reinterpret_cast<const char*>(&id), sizeof(id));
             out.write(reinterpret_cast<const char*>(&dim), sizeof(dim));
-            out.write(reinterpret_cast<const char*>(entry.second.data()), dim * sizeof(float));
+            out.write(reinterpret_cast<const char*>(arena_->row(slot)), dim * sizeof(float));
         }
 
         out.write(reinterpret_cast<const char*>(&next_id_), sizeof(next_id_));
+
+        const uint64_t labelled = labels_.size();
+        out.write(reinterpret_cast<const char*>(&labelled), sizeof(labelled));
+        for (const auto& [id, labels] : labels_) {
+            const uint32_t label_count = static_cast<uint32_t>(labels.size());
+            out.write(reinterpret_cast<const char*>(&id), sizeof(id));
+            out.write(reinterpret_cast<const char*>(&label_count), sizeof(label_count));
+            out.write(reinterpret_cast<const char*>(labels.data()),
+                      label_count * sizeof(FilterLabel));
+        }
         out.close();
 
         std::string index_path = filepath + ".anns";
-        if (algorithm_ && index_built_ && !index_dirty_) {
+        if (is_trained()) {
             algorithm_->save(index_path);
         } else {
             std::remove(index_path.c_str());
@@ -215,7 +491,7 @@ public:
 
         uint32_t version = 0;
         in.read(reinterpret_cast<char*>(&version), sizeof(version));
-        if (version != kVectorStoreFormatVersion) {
+        if (version != 1 && version != kVectorStoreFormatVersion) {
             throw SageDBException("Unsupported vector store format version");
         }
 
@@ -225,9 +501,11 @@ public:
         in.read(stored_name.data(), name_length);
 
         if (stored_name != algorithm_name_) {
-            algorithm_name_ = select_algorithm(stored_name);
+            algorithm_name_ = select_algorithm(stored_name, config_.index_type);
             initialize_algorithm();
         }
+        ++build_generation_;
+        delta_.clear();
 
         int metric_value = 0;
         in.read(reinterpret_cast<char*>(&metric_value), sizeof(metric_value));
@@ -237,54 +515,408 @@ public:
         uint64_t count = 0;
         in.read(reinterpret_cast<char*>(&count), sizeof(count));
 
-        dataset_.clear();
-        id_to_index_.clear();
-        dataset_.reserve(count);
+        arena_ = std::make_shared<VectorArena>(config_.dimension);
+        id_to_slot_.clear();
+        id_to_slot_.reserve(count);
 
+        Vector vec(config_.dimension);
+        VectorId max_id = 0;
         for (uint64_t i = 0; i < count; ++i) {
             VectorId id;
             Dimension dim;
             in.read(reinterpret_cast<char*>(&id), sizeof(id));
             in.read(reinterpret_cast<char*>(&dim), sizeof(dim));
-            Vector vec(dim);
+            if (!in || dim != config_.dimension) {
+                throw SageDBException("Corrupt vector store file: " + filepath);
+            }
             in.read(reinterpret_cast<char*>(vec.data()), dim * sizeof(float));
-            dataset_.emplace_back(id, std::move(vec));
-            id_to_index_[id] = dataset_.size() - 1;
+            id_to_slot_[id] = arena_->append(id, vec.data());
+            max_id = std::max(max_id, id);
         }
 
         in.read(reinterpret_cast<char*>(&next_id_), sizeof(next_id_));
-        if (next_id_ <= 1 && !dataset_.empty()) {
-            next_id_ = dataset_.back().first + 1;
+        if (next_id_ <= 1 && !id_to_slot_.empty()) {
+            next_id_ = max_id + 1;
+        }
+
+        labels_.clear();
+        uint64_t labelled = 0;
+        if (version >= 2) {
+            in.read(reinterpret_cast<char*>(&labelled), sizeof(labelled));
+        }
+        for (uint64_t i = 0; i < labelled; ++i) {
+            VectorId id = 0;
+            uint32_t label_count = 0;
+            in.read(reinterpret_cast<char*>(&id), sizeof(id));
+            in.read(reinterpret_cast<char*>(&label_count), sizeof(label_count));
+            if (!in || label_count > count) {
+                throw SageDBException("Corrupt vector store file: " + filepath);
+            }
+            std::vector<FilterLabel> labels(label_count);
+            in.read(reinterpret_cast<char*>(labels.data()), label_count * sizeof(FilterLabel));
+            labels_[id] = std::move(labels);
+        }
+        if (!in) {
+            throw SageDBException("Corrupt vector store file: " + filepath);
         }
 
         in.close();
 
         std::string index_path = filepath + ".anns";
-        bool loaded_index = algorithm_->load(index_path);
-        index_built_ = loaded_index;
-        index_dirty_ = !loaded_index;
-
-        if (loaded_index) {
-            size_t algo_size = algorithm_->get_index_size();
-            if (algo_size != dataset_.size()) {
-                index_built_ = false;
-                index_dirty_ = true;
-            }
+        algorithm_ = create_algorithm();
+        index_built_ = algorithm_->load(index_path) &&
+                       algorithm_->get_index_size() == id_to_slot_.size();
+        if (!index_built_) {
+            algorithm_ = create_algorithm();
         }
+        index_stale_ = false;
+        build_failed_ = false;
+        build_error_.clear();
+        schedule_rebuild_if_needed();
     }
 
     const DatabaseConfig& config() const { return config_; }
 
-    void ensure_index_ready() {
-        if (!index_built_ || index_dirty_) {
-            build_index();
+private:
+    // Below this many pending changes the delta scan is cheaper than a refit
+    static constexpr size_t kMinRebuildDelta = 1024;
+    static constexpr size_t kRebuildDeltaDivisor = 10;
+    // Extra index results per requested one that a query spends on tombstones
+    static constexpr size_t kTombstoneOverfetch = 4;
+
+    static size_t rebuild_threshold(size_t indexed) {
+        return std::max(kMinRebuildDelta, indexed / kRebuildDeltaDivisor);
+    }
+
+    bool needs_background_build() const {
+        if (id_to_slot_.empty()) {
+            return false;
+        }
+        if (build_failed_) {
+            // Same params, same outcome: short of new training data or an
+            // explicit build, only enough writes are worth another fit
+            return writes_since_failure_ >= rebuild_threshold(failed_size_);
         }
+        if (!index_built_ || index_stale_ || arena_needs_compaction()) {
+            return true;
+        }
+        return delta_.size() >= rebuild_threshold(algorithm_->get_index_size());
     }
 
-private:
-    static std::string select_algorithm(const std::string& requested) {
+    // Adds, removes and updates count toward retrying a failed build
+    void note_writes(size_t count) {
+        if (build_failed_) {
+            writes_since_failure_ += count;
+        }
+    }
+
+    void schedule_rebuild_if_needed() {
+        if (building_ || !needs_background_build()) {
+            return;
+        }
+        std::lock_guard<std::mutex> lock(builder_mutex_);
+        if (!builder_.joinable()) {
+            builder_ = std::thread([this] { builder_loop(); });
+        }
+        build_requested_ = true;
+        builder_cv_.notify_one();
+    }
+
+    void builder_loop() {
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(builder_mutex_);
+                builder_cv_.wait(lock, [this] { return stop_builder_ || build_requested_; });
+                if (stop_builder_) {
+                    return;
+                }
+                build_requested_ = false;
+            }
+            run_background_build();
+        }
+    }
+
+    void run_background_build() {
+        std::shared_ptr<VectorArena> arena;
+        std::shared_ptr<VectorArena> training;
+        std::unordered_map<VectorId, size_t> compacted_slots;
+        anns::DatasetView snapshot;
+        anns::AlgorithmParams params;
+        uint64_t generation = 0;
+        {
+            // Readers keep going while the snapshot is taken; only writers
+            // wait, which is what makes pending_ a complete change log.
+            // Rows never change in place, so the snapshot is a list of row
+            // pointers unless the arena is worth compacting first.
+            std::shared_lock<std::shared_mutex> lock(store_mutex_);
+            if (!needs_background_build()) {
+                return;
+            }
+            arena = arena_needs_compaction() ? compact_arena(compacted_slots) : arena_;
+            snapshot = live_view(*arena, arena, &labels_);
+            params = compose_build_params();
+            training = training_;
+            generation = ++build_generation_;
+            pending_.clear();
+            building_ = true;
+            index_stale_ = false;
+            build_failed_ = false;
+        }
+
+        auto fresh = create_algorithm();
+        std::string error;
+        try {
+            if (training) {
+                fresh->train(live_view(*training, training), params);
+            }
+            fresh->fit(snapshot, params);
+            if (!fresh->is_built()) {
+                error = algorithm_name_ + ": fit did not build the index";
+            }
+        } catch (const std::exception& e) {
+            error = e.what();
+            if (error.empty()) {
+                error = algorithm_name_ + ": fit failed";
+            }
+        }
+        const bool fitted = error.empty();
+        snapshot = {};
+
+        // The old index is destroyed after the locks are released
+        std::unique_ptr<anns::ANNSAlgorithm> retired;
+        std::lock_guard<std::mutex> writer(writer_mutex_);
+        std::unique_lock<std::shared_mutex> lock(store_mutex_);
+        building_ = false;
+        if (!fitted || generation != build_generation_) {
+            // A synchronous build or load superseded this one, or it failed;
+            // keep serving the current index. A failure is kept for
+            // last_build_error() and holds off retries (see
+            // needs_background_build()).
+            pending_.clear();
+            retired = std::move(fresh);
+            if (fitted) {
+                schedule_rebuild_if_needed();
+            } else if (generation == build_generation_) {
+                index_stale_ = true;
+                build_failed_ = true;
+                failed_size_ = id_to_slot_.size();
+                writes_since_failure_ = 0;
+                build_error_ = std::move(error);
+            }
+            return;
+        }
+
+        if (arena != arena_) {
+            adopt_compacted_arena(std::move(arena), std::move(compacted_slots));
+        }
+        retired = std::move(algorithm_);
+        algorithm_ = std::move(fresh);
+        index_built_ = true;
+        build_error_.clear();
+        delta_.clear();
+        if (algorithm_->supports_updates() && pending_.size() < kMinRebuildDelta) {
+            absorb_pending();
+        } else {
+            delta_ = std::move(pending_);
+        }
+        pending_.clear();
+        schedule_rebuild_if_needed();
+    }
+
+    bool arena_needs_compaction() const {
+        return arena_->dead_count() >= std::max(kMinRebuildDelta, arena_->live_count());
+    }
+
+    // Copies the live rows into a fresh arena; slots receives their new
+    // positions. Only reads arena_, so a shared lock suffices.
+    std::shared_ptr<VectorArena> compact_arena(std::unordered_map<VectorId, size_t>& slots) const {
+        auto compacted = std::make_shared<VectorArena>(arena_->dimension());
+        std::unordered_map<VectorId, size_t> remapped;
+        remapped.reserve(id_to_slot_.size());
+        for (size_t slot = 0; slot < arena_->slot_count(); ++slot) {
+            if (arena_->is_live(slot)) {
+                remapped[arena_->id(slot)] = compacted->append(arena_->id(slot), arena_->row(slot));
+            }
+        }
+        slots = std::move(remapped);
+        return compacted;
+    }
+
+    // Switches to an arena compacted at snapshot time, carrying over the
+    // writes recorded in pending_ since then.
+    void adopt_compacted_arena(std::shared_ptr<VectorArena> arena,
+                               std::unordered_map<VectorId, size_t> slots) {
+        for (VectorId id : pending_.tombstones) {
+            auto it = slots.find(id);
+            if (it != slots.end()) {
+                arena->release(it->second);
+                slots.erase(it);
+            }
+        }
+        for (VectorId id : pending_.added) {
+            auto it = id_to_slot_.find(id);
+            if (it != id_to_slot_.end()) {
+                slots[id] = arena->append(id, arena_->row(it->second));
+            }
+        }
+        arena_ = std::move(arena);
+        id_to_slot_ = std::move(slots);
+    }
+
+    anns::DatasetView arena_view() const {
+        return anns::DatasetView(arena_->dimension(), arena_);
+    }
+
+    // labels, when given, tags each row with its filter labels
+    static anns::DatasetView live_view(
+        const VectorArena& arena,
+        const std::shared_ptr<VectorArena>& owner,
+        const std::unordered_map<VectorId, std::vector<FilterLabel>>* labels = nullptr) {
+        anns::DatasetView view(arena.dimension(), owner);
+        view.reserve(arena.live_count());
+        for (size_t slot = 0; slot < arena.slot_count(); ++slot) {
+            if (!arena.is_live(slot)) {
+                continue;
+            }
+            std::span<const FilterLabel> row_labels;
+            if (labels) {
+                auto it = labels->find(arena.id(slot));
+                if (it != labels->end()) {
+                    row_labels = it->second;
+                }
+            }
+            view.append(arena.id(slot), arena.row(slot), row_labels);
+        }
+        return view;
+    }
+
+    std::span<const FilterLabel> labels_of(VectorId id) const {
+        auto it = labels_.find(id);
+        return it == labels_.end() ? std::span<const FilterLabel>() : it->second;
+    }
+
+    void append_row(anns::DatasetView& view, VectorId id, const float* row) const {
+        view.append(id, row, labels_of(id));
+    }
+
+    // Filters match a vector carrying any of their labels
+    bool matches(VectorId id, const std::vector<FilterLabel>& filter) const {
+        if (filter.empty()) {
+            return true;
+        }
+        auto labels = labels_of(id);
+        return std::any_of(filter.begin(), filter.end(), [&](FilterLabel label) {
+            return std::binary_search(labels.begin(), labels.end(), label);
+        });
+    }
+
+    // Replays writes that landed during the build into an updatable index
+    void absorb_pending() {
+        const bool deletions = algorithm_->supports_deletions();
+        for (VectorId id : pending_.tombstones) {
+            if (deletions) {
+                algorithm_->remove_vector(id);
+            } else {
+                delta_.tombstones.insert(id);
+            }
+        }
+        auto entries = arena_view();
+        for (VectorId id : pending_.added) {
+            if (!deletions && pending_.tombstones.count(id)) {
+                delta_.added.insert(id);
+                continue;
+            }
+            auto it = id_to_slot_.find(id);
+            if (it != id_to_slot_.end()) {
+                append_row(entries, id, arena_->row(it->second));
+            }
+        }
+        if (!entries.empty()) {
+            algorithm_->add_vectors(entries);
+        }
+    }
+
+    // Exact score in the brute-force convention: L2 distance, raw inner
+    // product (higher is better) or cosine distance.
+    float exact_score(const float* a, const float* b) const {
+        switch (config_.metric) {
+            case DistanceMetric::L2:
+                return simd::l2_distance(a, b, config_.dimension);
+            case DistanceMetric::INNER_PRODUCT:
+                return simd::inner_product(a, b, config_.dimension);
+            case DistanceMetric::COSINE:
+                return simd::cosine_distance(a, b, config_.dimension);
+        }
+        return 0.0f;
+    }
+
+    // Index hits and delta rows are rescored exactly so the two sources rank
+    // on one scale; radius > 0 selects range semantics instead of top-k.
+    // index_ids is null when there is no index to merge with.
+    std::vector<QueryResult> merge_with_delta(const float* query,
+                                              const VectorId* index_ids,
+                                              size_t index_count,
+                                              float radius,
+                                              size_t k,
+                                              const std::vector<FilterLabel>& filter) const {
+        std::vector<QueryResult> merged;
+        auto consider = [&](VectorId id) {
+            auto it = id_to_slot_.find(id);
+            if (it == id_to_slot_.end() || !matches(id, filter)) {
+                return;
+            }
+            const float score = exact_score(query, arena_->row(it->second));
+            if (radius > 0.0f && score > radius) {
+                return;
+            }
+            merged.emplace_back(id, score);
+        };
+
+        if (index_ids) {
+            for (size_t i = 0; i < index_count; ++i) {
+                if (!delta_.tombstones.count(index_ids[i])) {
+                    consider(index_ids[i]);
+                }
+            }
+            for (VectorId id : delta_.added) {
+                consider(id);
+            }
+        } else {
+            for (const auto& entry : id_to_slot_) {
+                consider(entry.first);
+            }
+        }
+
+        const bool higher_is_better = config_.metric == DistanceMetric::INNER_PRODUCT;
+        auto better = [higher_is_better](const QueryResult& a, const QueryResult& b) {
+            return higher_is_better ? a.score > b.score : a.score < b.score;
+        };
+        if (radius <= 0.0f && merged.size() > k) {
+            std::partial_sort(merged.begin(), merged.begin() + k, merged.end(), better);
+            merged.resize(k);
+        } else {
+            std::sort(merged.begin(), merged.end(), better);
+        }
+        return merged;
+    }
+
+    std::unique_ptr<anns::ANNSAlgorithm> create_algorithm() const {
+        return factory_->create();
+    }
+
+    // "auto" follows the configured index type; types without a native
+    // plugin yet fall back to brute force
+    static std::string select_algorithm(const std::string& requested, IndexType index_type) {
         if (requested.empty() || requested == "AUTO" || requested == "auto") {
-            return "brute_force";
+            switch (index_type) {
+                case IndexType::HNSW:
+                    return "hnsw";
+                case IndexType::IVF_FLAT:
+                case IndexType::IVF_PQ:
+                    return "ivf";
+                default:
+                    return "brute_force";
+            }
         }
         return requested;
     }
@@ -295,27 +927,38 @@ private:
             algorithm_name_ = "brute_force";
         }
 
-        const auto* factory = registry.get_factory(algorithm_name_);
-        if (!factory) {
+        factory_ = registry.get_factory(algorithm_name_);
+        if (!factory_) {
             throw SageDBException("Failed to locate ANNS factory for algorithm: " + algorithm_name_);
         }
 
-        base_build_params_ = factory->default_build_params();
-        base_query_config_ = factory->default_query_config();
-        algorithm_ = factory->create();
+        base_build_params_ = factory_->default_build_params();
+        base_query_config_ = factory_->default_query_config();
+        algorithm_ = factory_->create();
         index_built_ = false;
-        index_dirty_ = true;
+        ++build_generation_;
     }
 
     anns::AlgorithmParams compose_build_params() const {
         auto params = base_build_params_;
         params.set("metric", static_cast<int>(config_.metric));
         params.set("dimension", static_cast<int>(config_.dimension));
+        if (config_.index_type == IndexType::HNSW) {
+            params.set("M", static_cast<int>(config_.M));
+            params.set("efConstruction", static_cast<int>(config_.efConstruction));
+        } else if (config_.index_type == IndexType::IVF_FLAT) {
+            params.set("nlist", static_cast<int>(config_.nlist));
+            params.set("m", 0);
+        } else if (config_.index_type == IndexType::IVF_PQ) {
+            params.set("nlist", static_cast<int>(config_.nlist));
+            params.set("m", static_cast<int>(config_.m));
+            params.set("nbits", static_cast<int>(config_.nbits));
+        }
         for (const auto& kv : config_.anns_build_params) {
             params.set_raw(kv.first, kv.second);
         }
-        if (!training_data_.empty()) {
-            params.set("training_size", static_cast<int>(training_data_.size()));
+        if (training_) {
+            params.set("training_size", static_cast<int>(training_->live_count()));
         }
         return params;
     }
@@ -324,6 +967,7 @@ private:
         auto query_config = base_query_config_;
         query_config.k = search_params.k;
         query_config.return_distances = true;
+        query_config.filter_labels = search_params.filter_labels;
         for (const auto& kv : config_.anns_query_params) {
             query_config.set_raw_param(kv.first, kv.second);
         }
@@ -346,11 +990,6 @@ private:
         return algorithm_->range_query(query, radius, config);
     }
 
-    std::vector<anns::ANNSResult> execute_batch_query(
-        const std::vector<Vector>& queries, const anns::QueryConfig& config) const {
-        return algorithm_->batch_query(queries, config);
-    }
-
     std::vector<QueryResult> convert_result(const anns::ANNSResult& result) const {
         std::vector<QueryResult> converted;
         converted.reserve(result.ids.size());
@@ -363,46 +1002,93 @@ private:
 
     DatabaseConfig config_;
     std::string algorithm_name_;
+    const anns::ANNSFactory* factory_ = nullptr;
     std::unique_ptr<anns::ANNSAlgorithm> algorithm_;
     anns::AlgorithmParams base_build_params_;
     anns::QueryConfig base_query_config_;
-    std::vector<anns::VectorEntry> dataset_;
-    std::unordered_map<VectorId, size_t> id_to_index_;
-    std::vector<Vector> training_data_;
-    anns::ANNSMetrics last_metrics_;
+    std::shared_ptr<VectorArena> arena_;            // the only copy of the raw vectors
+    std::unordered_map<VectorId, size_t> id_to_slot_;
+    std::shared_ptr<VectorArena> training_;  // train_index() sample, handed to train()
+    std::unordered_map<VectorId, std::vector<FilterLabel>> labels_;  // sorted; labelled ids only
     bool index_built_ = false;
-    bool index_dirty_ = true;
+    std::atomic<bool> index_stale_{false};  // training data changed since the build
     VectorId next_id_ = 1;
+
+    DeltaLog delta_;    // changes the serving index does not reflect
+    DeltaLog pending_;  // changes since the in-flight build took its snapshot
+
+    // Background builder; build_generation_ invalidates superseded results
+    std::shared_mutex& store_mutex_;
+    std::mutex& writer_mutex_;
+    std::thread builder_;
+    std::mutex builder_mutex_;
+    std::condition_variable builder_cv_;
+    bool build_requested_ = false;
+    bool stop_builder_ = false;
+    bool building_ = false;
+    uint64_t build_generation_ = 0;
+    std::string build_error_;  // why the last build failed; cleared by a success
+    bool build_failed_ = false;  // holds off background retries
+    size_t failed_size_ = 0;     // rows stored when that build failed
+    size_t writes_since_failure_ = 0;
 };
 
 VectorStore::VectorStore(const DatabaseConfig& config)
-    : impl_(std::make_unique<Impl>(config)), config_(config) {}
+    : impl_(std::make_unique<Impl>(config, mutex_, writer_mutex_)), config_(config) {
+    if (config.num_threads > 0) {
+        ThreadPool::configure_global(config.num_threads);
+    }
+}
 
 VectorStore::~VectorStore() = default;
 
-VectorId VectorStore::add_vector(const Vector& vector) {
-    std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
+VectorId VectorStore::add_vector(const Vector& vector, std::vector<FilterLabel> labels) {
     validate_vector(vector);
-    return impl_->add_vector(vector);
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
+    return impl_->add_vector(vector, std::move(labels), lock);
 }
 
 bool VectorStore::remove_vector(VectorId id) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
     std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
     return impl_->remove_vector(id);
 }
 
 bool VectorStore::update_vector(VectorId id, const Vector& vector) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
     std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
     validate_vector(vector);
     return impl_->update_vector(id, vector);
 }
 
-std::vector<VectorId> VectorStore::add_vectors(const std::vector<Vector>& vectors) {
+bool VectorStore::set_labels(VectorId id, std::vector<FilterLabel> labels) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
     std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
+    return impl_->set_labels(id, std::move(labels));
+}
+
+std::vector<VectorId> VectorStore::add_vectors(
+    const std::vector<Vector>& vectors, const std::vector<std::vector<FilterLabel>>& labels) {
     for (const auto& vec : vectors) {
         validate_vector(vec);
     }
-    return impl_->add_vectors(vectors);
+    validate_labels(vectors.size(), labels);
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
+    return impl_->add_vectors(vectors.size(), [&](size_t i) { return vectors[i].data(); },
+                              labels, lock);
+}
+
+std::vector<VectorId> VectorStore::add_vectors(
+    const float* data, size_t num_vectors, size_t stride,
+    const std::vector<std::vector<FilterLabel>>& labels) {
+    validate_matrix(stride);
+    validate_labels(num_vectors, labels);
+    std::lock_guard<std::mutex> writer(writer_mutex_);
+    std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
+    return impl_->add_vectors(num_vectors, [&](size_t i) { return data + i * stride; }, labels,
+                              lock);
 }
 
 std::vector<QueryResult> VectorStore::search(const Vector& query, const SearchParams& params) const {
@@ -413,19 +1099,38 @@ std::vector<QueryResult> VectorStore::search(const Vector& query, const SearchPa
 
 std::vector<std::vector<QueryResult>> VectorStore::batch_search(
     const std::vector<Vector>& queries, const SearchParams& params) const {
-    std::shared_lock<std::shared_mutex> lock(mutex_);  // Allow concurrent reads!
     for (const auto& query : queries) {
         validate_vector(query);
     }
-    return impl_->batch_search(queries, params);
+    // One contiguous block, so plugins see the same layout as NumPy callers
+    const Dimension dim = config_.dimension;
+    std::vector<float> packed(queries.size() * dim);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        std::copy(queries[i].begin(), queries[i].end(), packed.begin() + i * dim);
+    }
+    std::shared_lock<std::shared_mutex> lock(mutex_);  // Allow concurrent reads!
+    return impl_->batch_search(anns::QueryMatrix(packed.data(), queries.size(), dim), params);
+}
+
+std::vector<std::vector<QueryResult>> VectorStore::batch_search(
+    const float* queries, size_t num_queries, size_t stride, const SearchParams& params) const {
+    validate_matrix(stride);
+    std::shared_lock<std::shared_mutex> lock(mutex_);  // Allow concurrent reads!
+    return impl_->batch_search(
+        anns::QueryMatrix(queries, num_queries, config_.dimension, stride), params);
 }
 
 void VectorStore::build_index() {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
     std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
     impl_->build_index();
 }
 
 void VectorStore::train_index(const std::vector<Vector>& training_data) {
+    for (const auto& vec : training_data) {
+        validate_vector(vec);
+    }
+    std::lock_guard<std::mutex> writer(writer_mutex_);
     std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
     impl_->set_training_data(training_data);
 }
@@ -435,6 +1140,16 @@ bool VectorStore::is_trained() const {
     return impl_->is_trained();
 }
 
+std::string VectorStore::last_build_error() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);  // Allow concurrent reads!
+    return impl_->last_build_error();
+}
+
+bool VectorStore::supports_filtered_search() const {
+    std::shared_lock<std::shared_mutex> lock(mutex_);  // Allow concurrent reads!
+    return impl_->supports_filtered_search();
+}
+
 size_t VectorStore::size() const {
     std::shared_lock<std::shared_mutex> lock(mutex_);  // Allow concurrent reads!
     return impl_->size();
@@ -454,6 +1169,7 @@ void VectorStore::save(const std::string& filepath) const {
 }
 
 void VectorStore::load(const std::string& filepath) {
+    std::lock_guard<std::mutex> writer(writer_mutex_);
     std::unique_lock<std::shared_mutex> lock(mutex_);  // Exclusive write lock
     impl_->load(filepath);
     config_ = impl_->config();
@@ -470,6 +1186,24 @@ void VectorStore::validate_vector(const Vector& vector) const {
     }
 }
 
+void VectorStore::validate_matrix(size_t stride) const {
+    if (config_.dimension == 0) {
+        throw SageDBException("Database dimension is not configured");
+    }
+    if (stride < config_.dimension) {
+        throw SageDBException("Row stride " + std::to_string(stride) +
+                             " is smaller than the dimension " +
+                             std::to_string(config_.dimension));
+    }
+}
+
+void VectorStore::validate_labels(size_t count,
+                                  const std::vector<std::vector<FilterLabel>>& labels) const {
+    if (!labels.empty() && labels.size() != count) {
+        throw SageDBException("Vectors and labels must have the same size");
+    }
+}
+
 void VectorStore::ensure_trained() const {
     if (!is_trained()) {
         throw SageDBException("Index is not trained. Call build_index() first.");
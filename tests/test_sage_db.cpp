@@ -1,6 +1,29 @@
+// The checks in this file are asserts and must run in Release builds too
+#undef NDEBUG
+
 #include "sage_db/sage_db.h"
+#include "sage_db/anns/binary_plugin.h"
+#include "sage_db/anns/brute_force_plugin.h"
+#include "sage_db/anns/hnsw_plugin.h"
+#include "sage_db/anns/ivf_plugin.h"
+#include "sage_db/anns/pq_fast_scan_plugin.h"
+#include "sage_db/anns/pre_transform.h"
+#include "sage_db/anns/rabitq.h"
+#include "sage_db/anns/vamana_plugin.h"
+#include "sage_db/simd/batch_distance.h"
+#include "sage_db/simd/distance.h"
+#include "sage_db/simd/hamming.h"
+#include "sage_db/simd/quantized_distance.h"
+#include "sage_db/thread_pool.h"
+#include "sage_db/vector_arena.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <fstream>
 #include <iostream>
 #include <random>
+#include <unordered_map>
+#include <thread>
 #include <chrono>
 #include <cassert>
 
@@ -129,6 +152,83 @@ void test_filtered_search() {
     std::cout << "✅ Filtered search test passed" << std::endl;
 }
 
+void test_label_filtered_search() {
+    std::cout << "Testing label filtered search..." << std::endl;
+
+    std::mt19937 gen(67);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    std::vector<Vector> vectors(2000, Vector(16));
+    std::vector<Metadata> metadata;
+    for (size_t i = 0; i < vectors.size(); ++i) {
+        for (auto& x : vectors[i]) x = dis(gen);
+        metadata.push_back({{"tenant", "t" + std::to_string(i % 200)},
+                            {"category", i % 2 == 0 ? "even" : "odd"}});
+    }
+    Vector query(16);
+    for (auto& x : query) x = dis(gen);
+    auto tenant_is = [](const std::string& tenant) {
+        return [tenant](const Metadata& meta) {
+            auto it = meta.find("tenant");
+            return it != meta.end() && it->second == tenant;
+        };
+    };
+
+    for (const std::string algorithm : {"Vamana", "brute_force"}) {
+        DatabaseConfig config(16);
+        config.anns_algorithm = algorithm;
+        config.filter_label_keys = {"tenant"};
+        SageDB db(config);
+        auto ids = db.add_batch(vectors, metadata);
+        db.build_index();
+
+        // Ten vectors per tenant: the 0.5% filter still fills k
+        SearchParams params;
+        params.k = 5;
+        auto results = db.query_engine().search_with_metadata(query, params, "tenant", "t7");
+        assert(results.size() == 5);
+        auto exact = db.filtered_search(query, params, tenant_is("t7"));
+        assert(exact.size() == 5);
+        size_t overlap = 0;
+        for (const auto& result : results) {
+            assert(result.metadata.at("tenant") == "t7");
+            for (const auto& truth : exact) {
+                overlap += truth.id == result.id;
+            }
+        }
+        assert(overlap >= 4);
+        assert(db.query_engine().search_with_metadata(query, params, "tenant", "t999").empty());
+
+        // Generic predicates widen their over-fetch instead of coming up short
+        params.k = 10;
+        auto widened = db.filtered_search(query, params, tenant_is("t3"));
+        assert(widened.size() == 10);
+        for (const auto& result : widened) {
+            assert(result.metadata.at("tenant") == "t3");
+        }
+
+        // Metadata updates move a vector between labels
+        db.update(ids[8], {}, {{"tenant", "t7"}, {"category", "even"}});
+        params.k = 11;
+        results = db.query_engine().search_with_metadata(query, params, "tenant", "t7");
+        assert(results.size() == 11);
+        assert(std::any_of(results.begin(), results.end(),
+                           [&](const QueryResult& r) { return r.id == ids[8]; }));
+
+        // Labels and their dictionary persist with the database
+        const std::string path = "/tmp/sage_db_test_labels";
+        db.save(path);
+        SageDB reloaded(config);
+        reloaded.load(path);
+        results = reloaded.query_engine().search_with_metadata(query, params, "tenant", "t7");
+        assert(results.size() == 11);
+        for (const char* suffix : {".vectors", ".vectors.anns", ".metadata", ".labels", ".config"}) {
+            std::remove((path + suffix).c_str());
+        }
+    }
+
+    std::cout << "✅ Label filtered search test passed" << std::endl;
+}
+
 void test_persistence() {
     std::cout << "Testing persistence..." << std::endl;
     
@@ -169,6 +269,2621 @@ void test_persistence() {
     std::cout << "✅ Persistence test passed" << std::endl;
 }
 
+void test_simd_distance_kernels() {
+    std::cout << "Testing SIMD distance kernels..." << std::endl;
+
+    std::mt19937 gen(7);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+
+    const auto original = simd::active_instruction_set();
+    for (auto isa : {simd::InstructionSet::SCALAR,
+                     simd::InstructionSet::AVX2,
+                     simd::InstructionSet::AVX512}) {
+        if (!simd::set_instruction_set(isa)) {
+            continue;
+        }
+        for (size_t dim : {1u, 3u, 8u, 15u, 16u, 31u, 67u, 128u, 769u}) {
+            Vector a(dim), b(dim);
+            for (size_t i = 0; i < dim; ++i) {
+                a[i] = dis(gen);
+                b[i] = dis(gen);
+            }
+
+            double l2 = 0.0, dot = 0.0, na = 0.0, nb = 0.0;
+            for (size_t i = 0; i < dim; ++i) {
+                l2 += (a[i] - b[i]) * (a[i] - b[i]);
+                dot += a[i] * b[i];
+                na += a[i] * a[i];
+                nb += b[i] * b[i];
+            }
+
+            const double tol = 1e-4 * dim;
+            assert(std::abs(simd::l2_squared(a.data(), b.data(), dim) - l2) < tol);
+            assert(std::abs(simd::inner_product(a.data(), b.data(), dim) - dot) < tol);
+            assert(std::abs(simd::norm_squared(a.data(), dim) - na) < tol);
+            const double cos_dist = 1.0 - dot / (std::sqrt(na) * std::sqrt(nb));
+            assert(std::abs(simd::cosine_distance(a.data(), b.data(), dim) - cos_dist) < 1e-4);
+        }
+        std::cout << "   verified " << simd::instruction_set_name(isa) << " kernels" << std::endl;
+    }
+    simd::set_instruction_set(original);
+
+    std::cout << "✅ SIMD distance kernel test passed" << std::endl;
+}
+
+void test_brute_force_arena() {
+    std::cout << "Testing brute-force vector arena..." << std::endl;
+
+    const size_t dim = 20; // not a multiple of the row padding
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 1; id <= 50; ++id) {
+        dataset.emplace_back(id, Vector(dim, static_cast<float>(id)));
+    }
+
+    anns::BruteForceANNS index;
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    index.fit(dataset, params);
+    assert(index.get_index_size() == 50);
+
+    // Removing from the middle moves the last row into the hole
+    index.remove_vector(10);
+    index.remove_vector(10); // unknown ids are ignored
+    assert(index.get_index_size() == 49);
+    index.add_vector({51, Vector(dim, 10.2f)});
+
+    anns::QueryConfig query_config;
+    query_config.k = 3;
+    auto result = index.query(Vector(dim, 10.0f), query_config);
+    assert(result.ids.size() == 3);
+    assert(result.ids[0] == 51);
+    assert(result.ids[1] == 11 || result.ids[1] == 9);
+    for (size_t i = 1; i < result.distances.size(); ++i) {
+        assert(result.distances[i - 1] <= result.distances[i]);
+    }
+
+    result = index.query(Vector(dim, 50.0f), query_config);
+    assert(result.ids[0] == 50);
+    assert(result.distances[0] == 0.0f);
+
+    std::cout << "✅ Brute-force arena test passed" << std::endl;
+}
+
+void test_shared_vector_arena() {
+    std::cout << "Testing shared vector arena..." << std::endl;
+
+    const Dimension dim = 12;
+    auto arena = std::make_shared<VectorArena>(dim);
+    Vector row(dim);
+    for (VectorId id = 1; id <= 1500; ++id) { // spans two chunks
+        std::fill(row.begin(), row.end(), static_cast<float>(id));
+        arena->append(id, row.data());
+    }
+    const float* first = arena->row(0);
+    std::fill(row.begin(), row.end(), -1.0f);
+    arena->append(1501, row.data());
+    assert(arena->row(0) == first); // appends never move rows
+    assert(arena->row(1499)[dim - 1] == 1500.0f);
+    arena->release(0);
+    arena->release(0);
+    assert(arena->live_count() == 1500 && arena->dead_count() == 1);
+    assert(first[0] == 1.0f); // released rows stay readable
+
+    // Graph plugins borrow rows from a view with storage instead of copying
+    // them; brute force copies them into its own aligned scan arena
+    anns::DatasetView view(dim, arena);
+    for (size_t slot = 0; slot < arena->slot_count(); ++slot) {
+        if (arena->is_live(slot)) {
+            view.append(arena->id(slot), arena->row(slot));
+        }
+    }
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    auto vamana = anns::ANNSRegistry::instance().create_algorithm("Vamana");
+    vamana->fit(view, params);
+    auto vamana_copied = anns::ANNSRegistry::instance().create_algorithm("Vamana");
+    vamana_copied->fit(view.to_entries(), params);
+    assert(vamana->get_index_size() == 1500);
+    assert(vamana->get_memory_usage() + view.size() * dim * sizeof(float) <=
+           vamana_copied->get_memory_usage());
+    anns::BruteForceANNS copied;
+    copied.fit(view, params);
+    assert(copied.get_memory_usage() >= view.size() * dim * sizeof(float));
+
+    std::weak_ptr<VectorArena> watch = arena;
+    arena.reset();
+    view = anns::DatasetView();
+    assert(!watch.expired()); // indexes keep borrowed storage alive
+
+    anns::QueryConfig query_config;
+    query_config.k = 1;
+    auto result = copied.query(Vector(dim, 700.0f), query_config);
+    assert(result.ids.size() == 1 && result.ids[0] == 700);
+    result = vamana->query(Vector(dim, 700.0f), query_config);
+    assert(result.ids.size() == 1 && result.ids[0] == 700);
+
+    // Updates are copy-on-write; enough garbage makes the store compact
+    DatabaseConfig config(dim);
+    SageDB db(config);
+    std::vector<Vector> vectors;
+    for (int i = 0; i < 100; ++i) {
+        vectors.push_back(Vector(dim, static_cast<float>(i)));
+    }
+    auto ids = db.add_batch(vectors);
+    db.build_index();
+    for (int round = 1; round <= 12; ++round) {
+        for (size_t i = 0; i < ids.size(); ++i) {
+            db.update(ids[i], Vector(dim, static_cast<float>(i) + 0.5f * round));
+        }
+    }
+    db.build_index();
+    assert(db.size() == 100);
+    auto hits = db.search(Vector(dim, 46.0f), 1);
+    assert(hits.size() == 1 && hits[0].id == ids[40]);
+
+    std::cout << "✅ Shared vector arena test passed" << std::endl;
+}
+
+void test_blocked_batch_query() {
+    std::cout << "Testing blocked batch query..." << std::endl;
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+
+    // Inner-product tiles against a direct reference, odd shapes included
+    const size_t nq = 7, nb = 45, dim = 19;
+    std::vector<float> q(nq * dim), b(nb * dim), out(nq * nb);
+    for (auto& v : q) v = dis(gen);
+    for (auto& v : b) v = dis(gen);
+
+    const auto original = simd::active_instruction_set();
+    for (auto isa : {simd::InstructionSet::SCALAR,
+                     simd::InstructionSet::AVX2,
+                     simd::InstructionSet::AVX512}) {
+        if (!simd::set_instruction_set(isa)) {
+            continue;
+        }
+        for (bool allow_blas : {false, true}) {
+            simd::inner_product_block(q.data(), nq, dim, b.data(), nb, dim, dim,
+                                      out.data(), nb, allow_blas);
+            for (size_t i = 0; i < nq; ++i) {
+                for (size_t j = 0; j < nb; ++j) {
+                    double ref = 0.0;
+                    for (size_t d = 0; d < dim; ++d) {
+                        ref += q[i * dim + d] * b[j * dim + d];
+                    }
+                    assert(std::abs(out[i * nb + j] - ref) < 1e-4);
+                }
+            }
+        }
+    }
+    simd::set_instruction_set(original);
+
+    // Batched brute-force results must match the per-query path
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 300; ++id) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        dataset.emplace_back(id, std::move(v));
+    }
+    std::vector<Vector> queries(37, Vector(dim));
+    for (auto& v : queries) {
+        for (auto& x : v) x = dis(gen);
+    }
+
+    for (auto metric : {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE}) {
+        anns::BruteForceANNS index;
+        anns::AlgorithmParams params;
+        params.set("metric", static_cast<int>(metric));
+        index.fit(dataset, params);
+
+        // With use_blas the tiles go through sgemm when the build has it
+        for (bool use_blas : {false, true}) {
+            anns::QueryConfig config;
+            config.k = 5;
+            config.set_param("base_block", static_cast<size_t>(64));
+            config.set_param("use_blas", use_blas);
+            auto batch = index.batch_query(queries, config);
+            assert(batch.size() == queries.size());
+            std::vector<float> block(queries.size() * dim);
+            for (size_t i = 0; i < queries.size(); ++i) {
+                std::copy(queries[i].begin(), queries[i].end(), block.begin() + i * dim);
+            }
+            std::vector<VectorId> ids(queries.size() * config.k);
+            std::vector<float> distances(ids.size());
+            anns::QueryOutput output;
+            output.ids = ids.data();
+            output.distances = distances.data();
+            index.batch_query(anns::QueryMatrix(block.data(), queries.size(), dim), config,
+                              output);
+            for (size_t i = 0; i < queries.size(); ++i) {
+                auto single = index.query(queries[i], config);
+                assert(batch[i].ids == single.ids);
+                for (size_t j = 0; j < single.distances.size(); ++j) {
+                    assert(std::abs(batch[i].distances[j] - single.distances[j]) < 1e-3);
+                    assert(ids[i * config.k + j] == single.ids[j]);
+                    assert(std::abs(distances[i * config.k + j] - single.distances[j]) < 1e-3);
+                }
+            }
+        }
+    }
+
+    std::cout << "✅ Blocked batch query test passed" << std::endl;
+}
+
+void test_thread_pool_batch_search() {
+    std::cout << "Testing thread pool and parallel batch search..." << std::endl;
+
+    ThreadPool pool(4);
+    assert(pool.size() == 4);
+
+    // Nested parallel_for must not deadlock and must cover every index once
+    std::vector<std::atomic<int>> hits(64 * 16);
+    pool.parallel_for(0, 64, [&](size_t i) {
+        pool.parallel_for(0, 16, [&](size_t j) {
+            hits[i * 16 + j].fetch_add(1);
+        });
+    });
+    for (const auto& hit : hits) {
+        assert(hit.load() == 1);
+    }
+
+    bool caught = false;
+    try {
+        pool.parallel_for(0, 100, [](size_t i) {
+            if (i == 42) {
+                throw std::runtime_error("boom");
+            }
+        });
+    } catch (const std::runtime_error&) {
+        caught = true;
+    }
+    assert(caught);
+
+    DatabaseConfig config(16);
+    config.num_threads = 3;
+    SageDB db(config);
+    assert(ThreadPool::global()->size() == 3);
+
+    std::mt19937 gen(5);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    for (int i = 0; i < 200; ++i) {
+        Vector vec(16);
+        for (auto& x : vec) x = dis(gen);
+        db.add(vec, {{"parity", (i % 2 == 0) ? "even" : "odd"}});
+    }
+
+    std::vector<Vector> queries(20, Vector(16));
+    for (auto& q : queries) {
+        for (auto& x : q) x = dis(gen);
+    }
+
+    SearchParams params;
+    params.k = 5;
+    auto batch = db.batch_search(queries, params);
+    assert(batch.size() == queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        auto single = db.search(queries[i], params);
+        assert(batch[i].size() == single.size());
+        for (size_t j = 0; j < single.size(); ++j) {
+            assert(batch[i][j].id == single[j].id);
+        }
+        assert(batch[i][0].metadata.count("parity") == 1);
+    }
+
+    auto odd_only = [](const Metadata& meta) {
+        auto it = meta.find("parity");
+        return it != meta.end() && it->second == "odd";
+    };
+    auto filtered = db.query_engine().batch_filtered_search(queries, params, odd_only);
+    assert(filtered.size() == queries.size());
+    for (size_t i = 0; i < queries.size(); ++i) {
+        auto single = db.filtered_search(queries[i], params, odd_only);
+        assert(filtered[i].size() == single.size());
+        for (size_t j = 0; j < single.size(); ++j) {
+            assert(filtered[i][j].id == single[j].id);
+            assert(filtered[i][j].metadata.at("parity") == "odd");
+        }
+    }
+
+    ThreadPool::configure_global(0);
+
+    std::cout << "✅ Thread pool batch search test passed" << std::endl;
+}
+
+void test_concurrent_search() {
+    std::cout << "Testing concurrent search path..." << std::endl;
+
+    DatabaseConfig config(8);
+    SageDB db(config);
+
+    std::mt19937 gen(11);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    auto random_vector = [&]() {
+        Vector vec(8);
+        for (auto& x : vec) x = dis(gen);
+        return vec;
+    };
+
+    for (int i = 0; i < 300; ++i) {
+        db.add(random_vector());
+    }
+    std::vector<Vector> queries;
+    for (int i = 0; i < 16; ++i) {
+        queries.push_back(random_vector());
+    }
+    std::vector<Vector> extra;
+    for (int i = 0; i < 50; ++i) {
+        extra.push_back(random_vector());
+    }
+
+    // The index is stale: the first readers race to rebuild it while a
+    // writer keeps dirtying it.
+    SearchParams params;
+    params.k = 5;
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (int t = 0; t < 4; ++t) {
+        readers.emplace_back([&, t]() {
+            for (int round = 0; round < 25; ++round) {
+                const auto& query = queries[(t * 25 + round) % queries.size()];
+                auto results = round % 5 == 0
+                    ? db.batch_search({query, query}, params).front()
+                    : db.search(query, params);
+                if (results.size() != params.k) {
+                    failures.fetch_add(1);
+                }
+            }
+        });
+    }
+    std::thread writer([&]() {
+        for (const auto& vec : extra) {
+            db.add(vec);
+        }
+    });
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    writer.join();
+    assert(failures.load() == 0);
+    assert(db.size() == 350);
+
+    // Query counters stay exact under concurrent const queries
+    anns::BruteForceANNS index;
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 1; id <= 100; ++id) {
+        dataset.emplace_back(id, random_vector());
+    }
+    index.fit(dataset, index.get_default_params());
+    anns::QueryConfig query_config;
+    query_config.k = 3;
+    std::vector<std::thread> workers;
+    for (int t = 0; t < 4; ++t) {
+        workers.emplace_back([&]() {
+            for (const auto& query : queries) {
+                index.query(query, query_config);
+            }
+        });
+    }
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    auto metrics = index.get_metrics();
+    assert(metrics.distance_computations == 4 * queries.size() * dataset.size());
+    assert(metrics.additional_metrics.at("search_calls") == 4.0 * queries.size());
+
+    std::cout << "✅ Concurrent search test passed" << std::endl;
+}
+
+// Brute force that cannot be updated in place and whose fit can be held,
+// standing in for a slow static index such as IVF.
+std::atomic<bool> g_hold_static_fit{false};
+std::atomic<bool> g_fail_static_fit{false};
+std::atomic<int> g_static_fit_calls{0};
+
+class StaticBruteForceANNS : public anns::BruteForceANNS {
+public:
+    std::string name() const override { return "static_brute_force"; }
+    bool supports_updates() const override { return false; }
+    bool supports_deletions() const override { return false; }
+
+    void fit(const anns::DatasetView& dataset,
+             const anns::AlgorithmParams& params = {}) override {
+        g_static_fit_calls.fetch_add(1);
+        while (g_hold_static_fit.load()) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        if (g_fail_static_fit.load()) {
+            throw std::runtime_error("static_brute_force: fit refused");
+        }
+        anns::BruteForceANNS::fit(dataset, params);
+    }
+};
+
+class StaticBruteForceANNSFactory : public anns::BruteForceANNSFactory {
+public:
+    std::unique_ptr<anns::ANNSAlgorithm> create() const override {
+        return std::make_unique<StaticBruteForceANNS>();
+    }
+    std::string algorithm_name() const override { return "static_brute_force"; }
+};
+
+void test_background_rebuild() {
+    std::cout << "Testing background rebuild with delta scan..." << std::endl;
+
+    anns::ANNSRegistry::instance().register_factory(
+        std::make_unique<StaticBruteForceANNSFactory>());
+
+    DatabaseConfig config(8);
+    config.anns_algorithm = "static_brute_force";
+    SageDB db(config);
+
+    std::mt19937 gen(21);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    auto random_vector = [&]() {
+        Vector vec(8);
+        for (auto& x : vec) x = dis(gen);
+        return vec;
+    };
+
+    std::unordered_map<VectorId, Vector> live;
+    auto exact_top_k = [&](const Vector& query, size_t k) {
+        std::vector<std::pair<float, VectorId>> scored;
+        for (const auto& [id, vec] : live) {
+            scored.emplace_back(simd::l2_distance(query.data(), vec.data(), 8), id);
+        }
+        std::sort(scored.begin(), scored.end());
+        std::vector<VectorId> ids;
+        for (size_t i = 0; i < std::min(k, scored.size()); ++i) {
+            ids.push_back(scored[i].second);
+        }
+        return ids;
+    };
+    auto check_exact = [&]() {
+        SearchParams params;
+        params.k = 5;
+        std::vector<Vector> queries;
+        for (int i = 0; i < 5; ++i) {
+            queries.push_back(random_vector());
+        }
+        auto batch = db.batch_search(queries, params);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            auto expected = exact_top_k(queries[i], params.k);
+            auto single = db.search(queries[i], params);
+            assert(single.size() == expected.size());
+            assert(batch[i].size() == expected.size());
+            for (size_t j = 0; j < expected.size(); ++j) {
+                assert(single[j].id == expected[j]);
+                assert(batch[i][j].id == expected[j]);
+            }
+        }
+    };
+
+    // The first write schedules a build; hold it to observe the delta path
+    g_hold_static_fit = true;
+    std::vector<Vector> vectors;
+    for (int i = 0; i < 200; ++i) {
+        vectors.push_back(random_vector());
+    }
+    auto ids = db.add_batch(vectors);
+    for (size_t i = 0; i < ids.size(); ++i) {
+        live[ids[i]] = vectors[i];
+    }
+
+    // Searches are served by an exact scan while the fit is stuck
+    check_exact();
+    assert(!db.is_trained());
+
+    g_hold_static_fit = false;
+    for (int i = 0; i < 2000 && !db.is_trained(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(db.is_trained());
+    const int fits_after_build = g_static_fit_calls.load();
+
+    // Small writes go to the delta instead of triggering another fit
+    for (int i = 0; i < 5; ++i) {
+        Vector vec = random_vector();
+        live[db.add(vec)] = vec;
+    }
+    const bool removed = db.remove(ids[0]);
+    assert(removed);
+    live.erase(ids[0]);
+    Vector moved = random_vector();
+    const bool updated = db.update(ids[1], moved);
+    assert(updated);
+    live[ids[1]] = moved;
+
+    check_exact();
+    assert(!db.is_trained());
+    assert(g_static_fit_calls.load() == fits_after_build);
+
+    // An explicit build folds the delta back in synchronously
+    db.build_index();
+    assert(db.is_trained());
+    check_exact();
+    assert(db.last_build_error().empty());
+
+    // Enough rows that a rebuild's worth of removes fits in the store
+    std::vector<Vector> bulk;
+    for (int i = 0; i < 1100; ++i) {
+        bulk.push_back(random_vector());
+    }
+    auto bulk_ids = db.add_batch(bulk);
+    for (size_t i = 0; i < bulk_ids.size(); ++i) {
+        live[bulk_ids[i]] = bulk[i];
+    }
+    db.build_index();
+
+    // A failed background fit is reported and not retried on every write
+    g_fail_static_fit = true;
+    db.train_index({random_vector(), random_vector()});
+    for (int i = 0; i < 2000 && db.last_build_error().empty(); ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(db.last_build_error() == "static_brute_force: fit refused");
+    const int fits_after_failure = g_static_fit_calls.load();
+    for (int i = 0; i < 5; ++i) {
+        Vector vec = random_vector();
+        live[db.add(vec)] = vec;
+    }
+    check_exact();
+    assert(!db.is_trained());
+    assert(g_static_fit_calls.load() == fits_after_failure);
+
+    // Removes count toward a retry as much as adds do
+    for (size_t i = 0; i < 1024; ++i) {
+        const bool dropped = db.remove(bulk_ids[i]);
+        assert(dropped);
+        live.erase(bulk_ids[i]);
+    }
+    for (int i = 0; i < 2000 && g_static_fit_calls.load() == fits_after_failure; ++i) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    assert(g_static_fit_calls.load() > fits_after_failure);
+    check_exact();
+
+    g_fail_static_fit = false;
+    db.build_index();
+    assert(db.is_trained());
+    assert(db.last_build_error().empty());
+    check_exact();
+
+    // Tombstones over the nearest rows exhaust the capped over-fetch; those
+    // queries fall back to the exact scan
+    const Vector center = random_vector();
+    std::vector<Vector> cluster;
+    for (int i = 0; i < 30; ++i) {
+        Vector vec = center;
+        vec[i % 8] += 1e-3f * static_cast<float>(i + 1);
+        cluster.push_back(vec);
+    }
+    auto cluster_ids = db.add_batch(cluster);
+    db.build_index();
+    for (VectorId id : cluster_ids) {
+        const bool dropped = db.remove(id);
+        assert(dropped);
+    }
+    assert(!db.is_trained());
+    SearchParams near;
+    near.k = 5;
+    const auto expected = exact_top_k(center, near.k);
+    const auto single = db.search(center, near);
+    const auto batch = db.batch_search({center, center}, near);
+    assert(single.size() == expected.size());
+    for (size_t j = 0; j < expected.size(); ++j) {
+        assert(single[j].id == expected[j]);
+        assert(batch[1][j].id == expected[j]);
+    }
+
+    std::cout << "✅ Background rebuild test passed" << std::endl;
+}
+
+void test_matrix_view_query() {
+    std::cout << "Testing matrix view query..." << std::endl;
+
+    std::mt19937 gen(23);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+
+    const Dimension dim = 10;
+    const size_t stride = 13; // padded rows, read in place
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 200; ++id) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        dataset.emplace_back(id, std::move(v));
+    }
+    const size_t nq = 21;
+    std::vector<float> block(nq * stride, 99.0f);
+    std::vector<Vector> queries(nq, Vector(dim));
+    for (size_t i = 0; i < nq; ++i) {
+        for (size_t d = 0; d < dim; ++d) {
+            queries[i][d] = block[i * stride + d] = dis(gen);
+        }
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::QueryConfig config;
+    config.k = 6;
+    for (const std::string name : {"brute_force", "Vamana", "FlatGPU"}) {
+        auto index = anns::ANNSRegistry::instance().create_algorithm(name);
+        index->fit(dataset, params);
+        auto expected = index->batch_query(queries, config);
+
+        for (size_t rows : {size_t{1}, nq}) {
+            std::vector<VectorId> ids(rows * config.k);
+            std::vector<float> distances(rows * config.k);
+            std::vector<size_t> counts(rows);
+            anns::QueryOutput output;
+            output.ids = ids.data();
+            output.distances = distances.data();
+            output.counts = counts.data();
+            index->batch_query(anns::QueryMatrix(block.data(), rows, dim, stride), config, output);
+            for (size_t i = 0; i < rows; ++i) {
+                assert(counts[i] == expected[i].ids.size());
+                for (size_t j = 0; j < counts[i]; ++j) {
+                    assert(ids[i * config.k + j] == expected[i].ids[j]);
+                    assert(std::abs(distances[i * config.k + j] - expected[i].distances[j]) < 1e-3);
+                }
+            }
+        }
+    }
+
+    // Slots past the end of a short result are padded
+    {
+        anns::BruteForceANNS index;
+        index.fit(std::vector<anns::VectorEntry>(dataset.begin(), dataset.begin() + 3), params);
+        std::vector<VectorId> ids(nq * config.k, 0);
+        std::vector<size_t> counts(nq);
+        anns::QueryOutput output;
+        output.ids = ids.data();
+        output.counts = counts.data();
+        index.batch_query(anns::QueryMatrix(block.data(), nq, dim, stride), config, output);
+        for (size_t i = 0; i < nq; ++i) {
+            assert(counts[i] == 3);
+            assert(ids[i * config.k + 3] == anns::kInvalidVectorId);
+        }
+    }
+
+    // The database accepts the same strided blocks for inserts and searches
+    DatabaseConfig db_config(dim);
+    SageDB db(db_config);
+    std::vector<float> rows(dataset.size() * stride, 0.0f);
+    for (size_t i = 0; i < dataset.size(); ++i) {
+        std::copy(dataset[i].second.begin(), dataset[i].second.end(), rows.begin() + i * stride);
+    }
+    auto ids = db.add_batch(rows.data(), dataset.size(), stride);
+    assert(ids.size() == dataset.size() && db.size() == dataset.size());
+    bool threw = false;
+    try {
+        db.add_batch(rows.data(), 1, dim - 1);
+    } catch (const SageDBException&) {
+        threw = true;
+    }
+    assert(threw);
+
+    SearchParams search_params(4);
+    search_params.include_metadata = false;
+    for (int pass = 0; pass < 2; ++pass) {
+        if (pass == 1) {
+            db.build_index();
+            db.add(Vector(dim, 0.0f)); // the delta path reads the block too
+        }
+        auto by_pointer = db.batch_search(block.data(), nq, stride, search_params);
+        auto by_vector = db.batch_search(queries, search_params);
+        assert(by_pointer.size() == nq);
+        for (size_t i = 0; i < nq; ++i) {
+            assert(by_pointer[i].size() == by_vector[i].size());
+            for (size_t j = 0; j < by_vector[i].size(); ++j) {
+                assert(by_pointer[i][j].id == by_vector[i][j].id);
+            }
+        }
+    }
+
+    std::cout << "✅ Matrix view query test passed" << std::endl;
+}
+
+void test_hnsw_index() {
+    std::cout << "Testing native HNSW index..." << std::endl;
+
+    ThreadPool::configure_global(4); // parallel construction even on one core
+
+    std::mt19937 gen(31);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 24;
+    auto random_entries = [&](VectorId first, size_t count) {
+        std::vector<anns::VectorEntry> entries;
+        for (VectorId id = first; id < first + count; ++id) {
+            Vector v(dim);
+            for (auto& x : v) x = dis(gen);
+            entries.emplace_back(id, std::move(v));
+        }
+        return entries;
+    };
+    auto dataset = random_entries(0, 3000);
+    std::vector<Vector> queries;
+    for (const auto& entry : random_entries(0, 50)) {
+        queries.push_back(entry.second);
+    }
+
+    anns::QueryConfig config;
+    config.k = 10;
+    auto recall = [&](const anns::ANNSAlgorithm& index, const anns::ANNSAlgorithm& exact) {
+        auto expected = exact.batch_query(queries, config);
+        auto found = index.batch_query(queries, config);
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (VectorId id : found[i].ids) {
+                hits += std::count(expected[i].ids.begin(), expected[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+
+    for (auto metric : {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE}) {
+        anns::AlgorithmParams params;
+        params.set("metric", static_cast<int>(metric));
+        params.set("M", 12);
+        params.set("efConstruction", 100);
+        auto index = anns::ANNSRegistry::instance().create_algorithm("hnsw");
+        index->fit(dataset, params);
+        anns::BruteForceANNS exact;
+        exact.fit(dataset, params);
+        assert(index->get_index_size() == dataset.size());
+        assert(recall(*index, exact) >= 0.9);
+
+        // Distances follow the brute-force conventions
+        auto single = index->query(queries[0], config);
+        auto reference = exact.query(queries[0], config);
+        assert(single.ids[0] == reference.ids[0]);
+        assert(std::abs(single.distances[0] - reference.distances[0]) < 1e-3);
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::HnswANNS index;
+    index.fit(dataset, params);
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+
+    // efSearch from the query config widens the search
+    auto work = [&](uint32_t ef) {
+        anns::QueryConfig wide = config;
+        wide.set_param("efSearch", ef);
+        const size_t before = index.get_metrics().distance_computations;
+        index.batch_query(queries, wide);
+        return index.get_metrics().distance_computations - before;
+    };
+    assert(work(200) > work(10));
+
+    // Soft deletes never surface; incremental inserts are searchable
+    std::vector<VectorId> removed;
+    for (VectorId id = 0; id < 3000; id += 7) {
+        removed.push_back(id);
+    }
+    index.remove_vectors(removed);
+    exact.remove_vectors(removed);
+    auto extra = random_entries(3000, 500);
+    index.add_vectors(extra);
+    exact.add_vectors(extra);
+    assert(index.get_index_size() == 3500 - removed.size());
+    for (const auto& result : index.batch_query(queries, config)) {
+        for (VectorId id : result.ids) {
+            assert(id % 7 != 0 || id >= 3000);
+        }
+    }
+    assert(recall(index, exact) >= 0.9);
+    size_t self_hits = 0;
+    for (const auto& entry : extra) {
+        self_hits += index.query(entry.second, config).ids.front() == entry.first;
+    }
+    assert(self_hits >= extra.size() * 95 / 100);
+
+    // Save/load round-trips the graph, deletions included
+    const std::string path = "/tmp/sage_db_test_hnsw.bin";
+    const bool saved = index.save(path);
+    assert(saved);
+    anns::HnswANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    assert(loaded.get_index_size() == index.get_index_size());
+    auto before = index.batch_query(queries, config);
+    auto after = loaded.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(before[i].ids == after[i].ids);
+    }
+    std::remove(path.c_str());
+
+    // IndexType::HNSW now resolves to the native plugin without FAISS
+    DatabaseConfig db_config(dim);
+    db_config.index_type = IndexType::HNSW;
+    db_config.M = 8;
+    db_config.efConstruction = 64;
+    SageDB db(db_config);
+    std::vector<Vector> vectors;
+    for (const auto& entry : dataset) {
+        vectors.push_back(entry.second);
+    }
+    auto ids = db.add_batch(vectors);
+    db.build_index();
+    auto results = db.search(vectors[42], 1, false);
+    assert(results.size() == 1 && results[0].id == ids[42]);
+
+    ThreadPool::configure_global(0);
+
+    std::cout << "✅ Native HNSW index test passed" << std::endl;
+}
+
+void test_ivf_index() {
+    std::cout << "Testing native IVF index..." << std::endl;
+
+    ThreadPool::configure_global(4);
+
+    // Clustered data so the coarse quantizer has structure to find
+    std::mt19937 gen(47);
+    std::normal_distribution<float> noise(0.0f, 0.15f);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 16;
+    std::vector<Vector> centers(32, Vector(dim));
+    for (auto& center : centers) {
+        for (auto& x : center) x = dis(gen);
+    }
+    auto clustered = [&](VectorId first, size_t count) {
+        std::vector<anns::VectorEntry> entries;
+        for (VectorId id = first; id < first + count; ++id) {
+            Vector v = centers[id % centers.size()];
+            for (auto& x : v) x += noise(gen);
+            entries.emplace_back(id, std::move(v));
+        }
+        return entries;
+    };
+    auto dataset = clustered(0, 4000);
+    std::vector<Vector> queries;
+    for (const auto& entry : clustered(0, 50)) {
+        queries.push_back(entry.second);
+    }
+
+    anns::QueryConfig config;
+    config.k = 10;
+    auto recall = [&](const anns::ANNSAlgorithm& index, const anns::ANNSAlgorithm& exact,
+                      const anns::QueryConfig& query_config) {
+        auto expected = exact.batch_query(queries, query_config);
+        auto found = index.batch_query(queries, query_config);
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (VectorId id : found[i].ids) {
+                hits += std::count(expected[i].ids.begin(), expected[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * query_config.k);
+    };
+    auto probing = [&](uint32_t nprobe) {
+        anns::QueryConfig probed = config;
+        probed.set_param("nprobe", nprobe);
+        return probed;
+    };
+
+    // Probing every list makes IVF-Flat exact, distances included
+    for (auto metric : {DistanceMetric::L2, DistanceMetric::INNER_PRODUCT, DistanceMetric::COSINE}) {
+        anns::AlgorithmParams params;
+        params.set("metric", static_cast<int>(metric));
+        params.set("nlist", 32);
+        anns::IvfANNS index;
+        index.fit(dataset, params);
+        anns::BruteForceANNS exact;
+        exact.fit(dataset, params);
+        assert(index.get_index_size() == dataset.size());
+        assert(recall(index, exact, probing(32)) >= 0.99);
+
+        auto single = index.query(queries[0], probing(32));
+        auto reference = exact.query(queries[0], config);
+        assert(single.ids[0] == reference.ids[0]);
+        assert(std::abs(single.distances[0] - reference.distances[0]) < 1e-3);
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    params.set("nlist", 64);
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+
+    // train() on a separate sample; fit() keeps those quantizers
+    std::vector<anns::VectorEntry> sample = clustered(100000, 2000);
+    anns::IvfANNS flat;
+    flat.train(anns::DatasetView::from_entries(sample), params);
+    flat.fit(dataset, params);
+    assert(flat.get_metrics().additional_metrics.at("train_time_seconds") > 0.0);
+    const double narrow = recall(flat, exact, probing(1));
+    const double wide = recall(flat, exact, probing(16));
+    assert(wide >= 0.95 && wide >= narrow);
+
+    // IVF-PQ trades a little recall for 4 bytes per vector
+    anns::AlgorithmParams pq_params = params;
+    pq_params.set("m", 4);
+    pq_params.set("nbits", 8);
+    anns::IvfANNS pq;
+    pq.fit(dataset, pq_params);
+    assert(recall(pq, exact, probing(16)) >= 0.5);
+    assert(pq.get_memory_usage() < flat.get_memory_usage());
+
+    // Deletes never surface; incremental adds and re-adds are searchable
+    std::vector<VectorId> removed;
+    for (VectorId id = 0; id < 4000; id += 7) {
+        removed.push_back(id);
+    }
+    for (auto* index : {&flat, &pq}) {
+        index->remove_vectors(removed);
+    }
+    exact.remove_vectors(removed);
+    auto extra = clustered(4000, 300);
+    flat.add_vectors(extra);
+    pq.add_vectors(extra);
+    pq.add_vectors(std::vector<anns::VectorEntry>(extra.begin(), extra.begin() + 10));
+    exact.add_vectors(extra);
+    assert(flat.get_index_size() == 4300 - removed.size());
+    assert(pq.get_index_size() == flat.get_index_size());
+    for (const auto& result : pq.batch_query(queries, probing(64))) {
+        for (VectorId id : result.ids) {
+            assert(id % 7 != 0 || id >= 4000);
+        }
+    }
+    assert(recall(flat, exact, probing(64)) >= 0.99);
+    size_t self_hits = 0;
+    for (const auto& entry : extra) {
+        self_hits += flat.query(entry.second, probing(4)).ids.front() == entry.first;
+    }
+    assert(self_hits >= extra.size() * 95 / 100);
+
+    // Save/load round-trips quantizers and lists
+    const std::string path = "/tmp/sage_db_test_ivf.bin";
+    const bool saved = pq.save(path);
+    assert(saved);
+    anns::IvfANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    assert(loaded.get_index_size() == pq.get_index_size());
+    auto before = pq.batch_query(queries, probing(8));
+    auto after = loaded.batch_query(queries, probing(8));
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(before[i].ids == after[i].ids);
+    }
+    std::remove(path.c_str());
+
+    // IndexType::IVF_FLAT resolves to the native plugin and uses train_index()
+    DatabaseConfig db_config(dim);
+    db_config.index_type = IndexType::IVF_FLAT;
+    db_config.nlist = 32;
+    SageDB db(db_config);
+    std::vector<Vector> vectors;
+    for (const auto& entry : dataset) {
+        vectors.push_back(entry.second);
+    }
+    std::vector<Vector> training;
+    for (const auto& entry : sample) {
+        training.push_back(entry.second);
+    }
+    auto ids = db.add_batch(vectors);
+    db.train_index(training);
+    db.build_index();
+    SearchParams search_params(1);
+    search_params.nprobe = 4;
+    auto results = db.search(vectors[42], search_params);
+    assert(results.size() == 1 && results[0].id == ids[42]);
+
+    ThreadPool::configure_global(0);
+
+    std::cout << "✅ Native IVF index test passed" << std::endl;
+}
+
+void test_vamana_graph() {
+    std::cout << "Testing Vamana graph layout..." << std::endl;
+
+    std::mt19937 gen(53);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 16;
+    auto random_entries = [&](VectorId first, size_t count) {
+        std::vector<anns::VectorEntry> entries;
+        for (VectorId id = first; id < first + count; ++id) {
+            Vector v(dim);
+            for (auto& x : v) x = dis(gen);
+            entries.emplace_back(id, std::move(v));
+        }
+        return entries;
+    };
+    auto dataset = random_entries(0, 2000);
+    std::vector<Vector> queries;
+    for (const auto& entry : random_entries(0, 40)) {
+        queries.push_back(entry.second);
+    }
+
+    anns::QueryConfig config;
+    config.k = 10;
+    auto recall = [&](const anns::ANNSAlgorithm& index, const anns::ANNSAlgorithm& exact) {
+        auto expected = exact.batch_query(queries, config);
+        auto found = index.batch_query(queries, config);
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (VectorId id : found[i].ids) {
+                hits += std::count(expected[i].ids.begin(), expected[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+
+    ThreadPool::configure_global(4); // parallel two-pass build even on one core
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS index;
+    index.fit(dataset, params);
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+    assert(index.get_index_size() == dataset.size());
+    assert(recall(index, exact) >= 0.9);
+
+    // The batch-built graph navigates well with a short search list
+    anns::QueryConfig narrow = config;
+    narrow.set_param("efSearch", 10);
+    anns::VamanaANNS narrow_index;
+    anns::AlgorithmParams narrow_params = params;
+    narrow_params.set("efSearch", 10);
+    narrow_index.fit(dataset, narrow_params);
+    {
+        auto expected = exact.batch_query(queries, config);
+        auto found = narrow_index.batch_query(queries, narrow);
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (VectorId id : found[i].ids) {
+                hits += std::count(expected[i].ids.begin(), expected[i].ids.end(), id);
+            }
+        }
+        assert(hits >= queries.size() * config.k * 8 / 10);
+    }
+
+    // Concurrent searches lease their own scratch and agree with serial ones
+    auto parallel = index.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(parallel[i].ids == index.query(queries[i], config).ids);
+    }
+
+    // Enough deletes to trigger compaction; freed slots take new inserts
+    std::vector<VectorId> removed;
+    for (VectorId id = 0; id < 2000; id += 10) {
+        removed.push_back(id);
+    }
+    index.remove_vectors(removed);
+    exact.remove_vectors(removed);
+    auto extra = random_entries(2000, 150);
+    index.add_vectors(extra);
+    exact.add_vectors(extra);
+    index.consolidate_deletes();
+    assert(index.get_index_size() == 2150 - removed.size());
+    for (const auto& result : index.batch_query(queries, config)) {
+        assert(result.ids.size() == config.k);
+        for (VectorId id : result.ids) {
+            assert(id % 10 != 0 || id >= 2000);
+        }
+    }
+    assert(recall(index, exact) >= 0.9);
+
+    // Re-adding an id replaces its vertex instead of duplicating it
+    index.add_vector({extra[0].first, queries[0]});
+    assert(index.get_index_size() == 2150 - removed.size());
+    auto replaced = index.query(queries[0], config);
+    assert(replaced.ids[0] == extra[0].first);
+    assert(std::count(replaced.ids.begin(), replaced.ids.end(), extra[0].first) == 1);
+
+    // Save/load round-trips slots, tombstones and adjacency
+    const std::string path = "/tmp/sage_db_test_vamana.bin";
+    index.remove_vector(extra[1].first);
+    const bool saved = index.save(path);
+    assert(saved);
+    anns::VamanaANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    assert(loaded.get_index_size() == index.get_index_size());
+    auto before = index.batch_query(queries, config);
+    auto after = loaded.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(before[i].ids == after[i].ids);
+    }
+    std::remove(path.c_str());
+
+    ThreadPool::configure_global(0);
+
+    std::cout << "✅ Vamana graph layout test passed" << std::endl;
+}
+
+void test_vamana_disk() {
+    std::cout << "Testing disk-resident Vamana..." << std::endl;
+
+    std::mt19937 gen(59);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 32;
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 3000; ++id) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        dataset.emplace_back(id, std::move(v));
+    }
+    std::vector<Vector> queries;
+    for (size_t i = 0; i < 30; ++i) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        queries.push_back(std::move(v));
+    }
+
+    anns::QueryConfig config;
+    config.k = 10;
+    auto recall = [&](const anns::ANNSAlgorithm& index, const anns::ANNSAlgorithm& exact) {
+        auto expected = exact.batch_query(queries, config);
+        auto found = index.batch_query(queries, config);
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (VectorId id : found[i].ids) {
+                hits += std::count(expected[i].ids.begin(), expected[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+
+    const std::string graph_path = "/tmp/sage_db_test_vamana_disk.graph";
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS in_memory;
+    in_memory.fit(dataset, params);
+    params.set("disk_path", graph_path);
+    params.set("cache_nodes", 64u);
+    anns::VamanaANNS index;
+    index.fit(dataset, params);
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+
+    // Rows and adjacency moved out; PQ codes and the cache stay resident
+    assert(index.get_index_size() == dataset.size());
+    assert(!index.supports_updates());
+    assert(index.get_memory_usage() < in_memory.get_memory_usage() / 2);
+    assert(recall(index, exact) >= 0.9);
+
+    // Returned distances are exact, and a one-wide beam still converges
+    auto single = index.query(queries[0], config);
+    auto truth = exact.query(queries[0], config);
+    assert(std::abs(single.distances[0] - truth.distances[0]) < 1e-3f);
+    anns::QueryConfig narrow_beam = config;
+    narrow_beam.set_param("beam_width", 1);
+    assert(index.query(queries[0], narrow_beam).ids == single.ids);
+
+    // Deletes are tombstoned in memory; inserts need a refit
+    std::vector<VectorId> removed;
+    for (VectorId id = 0; id < 3000; id += 7) {
+        removed.push_back(id);
+    }
+    index.remove_vectors(removed);
+    exact.remove_vectors(removed);
+    for (const auto& result : index.batch_query(queries, config)) {
+        assert(result.ids.size() == config.k);
+        for (VectorId id : result.ids) {
+            assert(id % 7 != 0);
+        }
+    }
+    assert(recall(index, exact) >= 0.9);
+    bool rejected = false;
+    try {
+        index.add_vector({5000, queries[0]});
+    } catch (const std::runtime_error&) {
+        rejected = true;
+    }
+    assert(rejected);
+
+    // The saved index points at the graph file and reloads its cache
+    const std::string path = "/tmp/sage_db_test_vamana_disk.bin";
+    const bool saved = index.save(path);
+    assert(saved);
+    anns::VamanaANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    assert(loaded.get_index_size() == index.get_index_size());
+    auto before = index.batch_query(queries, config);
+    auto after = loaded.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(before[i].ids == after[i].ids);
+    }
+    std::remove(path.c_str());
+    std::remove(graph_path.c_str());
+
+    std::cout << "✅ Disk-resident Vamana test passed" << std::endl;
+}
+
+void test_vamana_filtered() {
+    std::cout << "Testing filtered Vamana..." << std::endl;
+
+    std::mt19937 gen(61);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 16;
+    const size_t n = 3000;
+    // Each point has a tenant label (1% selective) and one of four categories
+    std::vector<Vector> vectors(n, Vector(dim));
+    std::vector<std::vector<FilterLabel>> point_labels(n);
+    anns::DatasetView view(dim);
+    for (size_t i = 0; i < n; ++i) {
+        for (auto& x : vectors[i]) x = dis(gen);
+        point_labels[i] = {static_cast<FilterLabel>(i % 100), static_cast<FilterLabel>(100 + i % 4)};
+        view.append(i, vectors[i].data(), point_labels[i]);
+    }
+    std::vector<Vector> queries(20, Vector(dim));
+    for (auto& q : queries) {
+        for (auto& x : q) x = dis(gen);
+    }
+
+    auto exact_filtered = [&](const Vector& q, const std::vector<FilterLabel>& filter,
+                              const std::vector<bool>& removed, size_t k) {
+        std::vector<std::pair<float, VectorId>> scored;
+        for (size_t i = 0; i < n; ++i) {
+            bool match = false;
+            for (auto label : filter) {
+                match = match || std::count(point_labels[i].begin(), point_labels[i].end(), label);
+            }
+            if (match && !removed[i]) {
+                scored.emplace_back(simd::l2_distance(q.data(), vectors[i].data(), dim), i);
+            }
+        }
+        std::sort(scored.begin(), scored.end());
+        std::vector<VectorId> ids;
+        for (size_t i = 0; i < std::min(k, scored.size()); ++i) {
+            ids.push_back(scored[i].second);
+        }
+        return ids;
+    };
+    std::vector<bool> removed(n, false);
+    auto filtered_recall = [&](const anns::ANNSAlgorithm& index,
+                               const std::vector<FilterLabel>& filter) {
+        anns::QueryConfig config;
+        config.k = 10;
+        config.filter_labels = filter;
+        size_t hits = 0;
+        size_t expected_total = 0;
+        for (const auto& q : queries) {
+            auto expected = exact_filtered(q, filter, removed, config.k);
+            auto found = index.query(q, config);
+            assert(found.ids.size() == expected.size());
+            for (VectorId id : found.ids) {
+                assert(!removed[id]);
+                bool match = false;
+                for (auto label : filter) {
+                    match = match || std::count(point_labels[id].begin(), point_labels[id].end(), label);
+                }
+                assert(match);
+                hits += std::count(expected.begin(), expected.end(), id);
+            }
+            expected_total += expected.size();
+        }
+        return expected_total == 0 ? 1.0 : static_cast<double>(hits) / expected_total;
+    };
+
+    ThreadPool::configure_global(4);
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS index;
+    index.fit(view, params);
+    assert(index.supports_filtered_search());
+    assert(!anns::BruteForceANNS().supports_filtered_search());
+
+    // Selective, multi-label and broad filters all fill k with matches
+    assert(filtered_recall(index, {7}) >= 0.9);
+    assert(filtered_recall(index, {7, 42}) >= 0.9);
+    assert(filtered_recall(index, {101}) >= 0.9);
+    double total_recall = 0.0;
+    for (FilterLabel label = 0; label < 100; ++label) {
+        total_recall += filtered_recall(index, {label});
+    }
+    assert(total_recall / 100 >= 0.95);
+
+    // Unfiltered search still navigates the whole graph
+    {
+        anns::QueryConfig config;
+        config.k = 10;
+        size_t hits = 0;
+        for (const auto& q : queries) {
+            auto expected = exact_filtered(q, {100, 101, 102, 103}, removed, config.k);
+            for (VectorId id : index.query(q, config).ids) {
+                hits += std::count(expected.begin(), expected.end(), id);
+            }
+        }
+        assert(hits >= queries.size() * 9);
+    }
+
+    // Compaction frees whole labels and moves entry points off freed slots
+    std::vector<VectorId> doomed;
+    for (size_t i = 0; i < n; ++i) {
+        if (i % 10 == 0 || (i % 100 == 7 && i < 1500)) {
+            doomed.push_back(i);
+            removed[i] = true;
+        }
+    }
+    index.remove_vectors(doomed);
+    index.consolidate_deletes();
+    assert(filtered_recall(index, {7}) >= 0.9);
+    assert(filtered_recall(index, {10}) == 1.0);  // nothing left to find
+    anns::QueryConfig gone;
+    gone.filter_labels = {10};
+    assert(index.query(queries[0], gone).ids.empty());
+
+    // Labels and entry points survive save/load
+    const std::string path = "/tmp/sage_db_test_vamana_filtered.bin";
+    const bool saved = index.save(path);
+    assert(saved);
+    anns::VamanaANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    anns::QueryConfig config;
+    config.k = 10;
+    config.filter_labels = {42};
+    for (const auto& q : queries) {
+        assert(loaded.query(q, config).ids == index.query(q, config).ids);
+    }
+    std::remove(path.c_str());
+
+    ThreadPool::configure_global(0);
+
+    std::cout << "✅ Filtered Vamana test passed" << std::endl;
+}
+
+void test_vamana_lazy_delete() {
+    std::cout << "Testing Vamana delete consolidation..." << std::endl;
+
+    std::mt19937 gen(71);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 16;
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 3000; ++id) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        dataset.emplace_back(id, std::move(v));
+    }
+    std::vector<Vector> queries(20, Vector(dim));
+    for (auto& q : queries) {
+        for (auto& x : q) x = dis(gen);
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS index;
+    index.fit(dataset, params);
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+    anns::QueryConfig config;
+    config.k = 10;
+
+    // A delete storm in small batches while readers keep searching; the
+    // background rounds interleave with both
+    std::atomic<bool> storming{true};
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < 2; ++t) {
+        readers.emplace_back([&, t] {
+            while (storming.load()) {
+                auto result = index.query(queries[t], config);
+                assert(result.ids.size() == config.k);
+            }
+        });
+    }
+    std::vector<VectorId> removed;
+    for (VectorId id = 0; id < 3000; ++id) {
+        if (id % 10 != 0) {
+            removed.push_back(id);
+        }
+        if (removed.size() == 50 || id == 2999) {
+            index.remove_vectors(removed);
+            exact.remove_vectors(removed);
+            removed.clear();
+        }
+    }
+    storming = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+
+    // Nine in ten nodes are gone, the entry point among them; searches
+    // still reach the survivors once the tombstones are freed
+    index.consolidate_deletes();
+    assert(index.get_index_size() == 300);
+    size_t hits = 0;
+    for (const auto& q : queries) {
+        auto expected = exact.query(q, config);
+        auto found = index.query(q, config);
+        assert(found.ids.size() == config.k);
+        for (VectorId id : found.ids) {
+            assert(id % 10 == 0);
+            hits += std::count(expected.ids.begin(), expected.ids.end(), id);
+        }
+    }
+    assert(hits >= queries.size() * config.k * 9 / 10);
+
+    // Freed slots take new inserts
+    std::vector<anns::VectorEntry> extra;
+    for (VectorId id = 3000; id < 3500; ++id) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        extra.emplace_back(id, std::move(v));
+    }
+    index.add_vectors(extra);
+    exact.add_vectors(extra);
+    assert(index.get_index_size() == 800);
+    hits = 0;
+    for (const auto& q : queries) {
+        auto expected = exact.query(q, config);
+        for (VectorId id : index.query(q, config).ids) {
+            hits += std::count(expected.ids.begin(), expected.ids.end(), id);
+        }
+    }
+    assert(hits >= queries.size() * config.k * 9 / 10);
+
+    std::cout << "✅ Vamana delete consolidation test passed" << std::endl;
+}
+
+void test_vamana_concurrent_insert() {
+    std::cout << "Testing concurrent Vamana inserts..." << std::endl;
+
+    std::mt19937 gen(83);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 16;
+    auto random_vector = [&]() {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        return v;
+    };
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 1000; ++id) {
+        dataset.emplace_back(id, random_vector());
+    }
+    // Enough streamed rows to grow the node table past its first chunk
+    std::vector<anns::VectorEntry> streamed;
+    for (VectorId id = 1000; id < 6000; ++id) {
+        streamed.emplace_back(id, random_vector());
+    }
+    std::vector<Vector> queries(20, Vector(dim));
+    for (auto& q : queries) {
+        q = random_vector();
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS index;
+    index.fit(dataset, params);
+    assert(index.supports_concurrent_updates());
+    anns::QueryConfig config;
+    config.k = 10;
+
+    // One writer streams single inserts, deleting every seventh original
+    // row along the way, while readers search without any outside lock
+    std::atomic<bool> streaming{true};
+    std::atomic<int> failures{0};
+    std::vector<std::thread> readers;
+    for (size_t t = 0; t < 3; ++t) {
+        readers.emplace_back([&, t] {
+            for (size_t round = 0; streaming.load(); ++round) {
+                auto result = index.query(queries[(t + round) % queries.size()], config);
+                if (result.ids.size() != config.k) {
+                    failures.fetch_add(1);
+                }
+                for (VectorId id : result.ids) {
+                    if (id >= 6000) {
+                        failures.fetch_add(1);
+                    }
+                }
+            }
+        });
+    }
+    for (const auto& entry : streamed) {
+        index.add_vector(entry);
+        if (entry.first % 5 == 0) {
+            const VectorId old = (entry.first - 1000) / 5 * 7;
+            if (old < 1000) {
+                index.remove_vector(old);
+            }
+        }
+    }
+    streaming = false;
+    for (auto& reader : readers) {
+        reader.join();
+    }
+    assert(failures.load() == 0);
+
+    // Every streamed row is reachable afterwards
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+    exact.add_vectors(streamed);
+    for (VectorId id = 0; id < 1000; id += 7) {
+        exact.remove_vector(id);
+    }
+    assert(index.get_index_size() == exact.get_index_size());
+    size_t hits = 0;
+    for (const auto& q : queries) {
+        auto expected = exact.query(q, config);
+        for (VectorId id : index.query(q, config).ids) {
+            hits += std::count(expected.ids.begin(), expected.ids.end(), id);
+        }
+    }
+    assert(hits >= queries.size() * config.k * 9 / 10);
+
+    // Through the store, adds into a built Vamana index run beside searches
+    DatabaseConfig db_config(dim);
+    db_config.anns_algorithm = "vamana";
+    SageDB db(db_config);
+    for (size_t i = 0; i < 500; ++i) {
+        db.add(random_vector());
+    }
+    db.build_index();
+    std::vector<Vector> extra;
+    for (size_t i = 0; i < 500; ++i) {
+        extra.push_back(random_vector());
+    }
+    SearchParams search_params;
+    search_params.k = 5;
+    std::atomic<bool> adding{true};
+    std::thread reader([&] {
+        while (adding.load()) {
+            if (db.search(queries[0], search_params).size() != search_params.k) {
+                failures.fetch_add(1);
+            }
+        }
+    });
+    for (const auto& vec : extra) {
+        db.add(vec);
+    }
+    adding = false;
+    reader.join();
+    assert(failures.load() == 0);
+    assert(db.size() == 1000);
+    auto found = db.search(extra.back(), search_params);
+    assert(!found.empty() && found.front().score < 1e-4f);
+
+    std::cout << "✅ Concurrent Vamana insert test passed" << std::endl;
+}
+
+void test_vamana_mapped_file() {
+    std::cout << "Testing mapped Vamana index file..." << std::endl;
+
+    std::mt19937 gen(97);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 16;
+    auto random_entries = [&](VectorId first, size_t count) {
+        std::vector<anns::VectorEntry> entries;
+        for (VectorId id = first; id < first + count; ++id) {
+            Vector v(dim);
+            for (auto& x : v) x = dis(gen);
+            entries.emplace_back(id, std::move(v));
+        }
+        return entries;
+    };
+    // More slots than one node-table chunk, so the last one is partial
+    auto dataset = random_entries(0, 5000);
+    std::vector<Vector> queries;
+    for (const auto& entry : random_entries(0, 20)) {
+        queries.push_back(entry.second);
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS index;
+    index.fit(dataset, params);
+    for (VectorId id = 0; id < 100; id += 3) {
+        index.remove_vector(id);
+    }
+    anns::QueryConfig config;
+    config.k = 10;
+
+    const std::string path = "/tmp/sage_db_test_vamana_mapped.bin";
+    const bool saved = index.save(path);
+    assert(saved);
+    anns::VamanaANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    assert(loaded.get_index_size() == index.get_index_size());
+    auto before = index.batch_query(queries, config);
+    auto after = loaded.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(before[i].ids == after[i].ids);
+    }
+
+    // Writes after a load change the mapping's private pages, not the file
+    auto extra = random_entries(5000, 300);
+    loaded.add_vectors(extra);
+    loaded.remove_vector(1);
+    assert(loaded.get_index_size() == index.get_index_size() + 300 - 1);
+    auto found = loaded.query(extra[7].second, config);
+    assert(found.ids[0] == extra[7].first);
+    for (VectorId id : loaded.query(dataset[1].second, config).ids) {
+        assert(id != 1);
+    }
+    anns::VamanaANNS pristine;
+    pristine.set_populate_on_load(true);
+    const bool pristine_restored = pristine.load(path);
+    assert(pristine_restored);
+    assert(pristine.get_index_size() == index.get_index_size());
+
+    // Saving over the file it maps leaves the loaded index intact
+    const bool resaved = loaded.save(path);
+    assert(resaved);
+    assert(loaded.query(extra[7].second, config).ids == found.ids);
+    anns::VamanaANNS reloaded;
+    const bool reloaded_restored = reloaded.load(path);
+    assert(reloaded_restored);
+    assert(reloaded.get_index_size() == loaded.get_index_size());
+    assert(reloaded.query(extra[7].second, config).ids == found.ids);
+
+    // A truncated file is rejected
+    {
+        std::ifstream in(path, std::ios::binary);
+        std::vector<char> head(8192);
+        in.read(head.data(), head.size());
+        std::ofstream out(path, std::ios::binary | std::ios::trunc);
+        out.write(head.data(), head.size());
+    }
+    anns::VamanaANNS truncated;
+    const bool truncated_restored = truncated.load(path);
+    assert(!truncated_restored);
+    assert(!truncated.is_built());
+    std::remove(path.c_str());
+
+    std::cout << "✅ Mapped Vamana index file test passed" << std::endl;
+}
+
+void test_graph_reorder() {
+    std::cout << "Testing graph reordering..." << std::endl;
+
+    std::mt19937 gen(101);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 16;
+    auto random_entries = [&](VectorId first, size_t count) {
+        std::vector<anns::VectorEntry> entries;
+        for (VectorId id = first; id < first + count; ++id) {
+            Vector v(dim);
+            for (auto& x : v) x = dis(gen);
+            entries.emplace_back(id, std::move(v));
+        }
+        return entries;
+    };
+    auto dataset = random_entries(0, 3000);
+    std::vector<Vector> queries;
+    for (const auto& entry : random_entries(0, 20)) {
+        queries.push_back(entry.second);
+    }
+    anns::QueryConfig config;
+    config.k = 10;
+
+    // Renumbering keeps every edge, so searches return the same ids; build
+    // inline so both graphs come out identical
+    ThreadPool::configure_global(1);
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS plain;
+    plain.fit(dataset, params);
+    params.set("reorder", true);
+    anns::VamanaANNS reordered;
+    reordered.fit(dataset, params);
+    assert(reordered.get_build_params().at("reorder") == "true");
+    auto expected = plain.batch_query(queries, config);
+    auto found = reordered.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(found[i].ids == expected[i].ids);
+    }
+
+    // Ids stay mapped through deletes, inserts, a later pass and save/load
+    for (VectorId id = 0; id < 3000; id += 4) {
+        reordered.remove_vector(id);
+    }
+    auto extra = random_entries(3000, 500);
+    reordered.add_vectors(extra);
+    reordered.reorder_graph();
+    assert(reordered.get_index_size() == 3000 - 750 + 500);
+    for (const auto& entry : {extra[3], dataset[5]}) {
+        assert(reordered.query(entry.second, config).ids[0] == entry.first);
+    }
+    for (VectorId id : reordered.query(dataset[8].second, config).ids) {
+        assert(id % 4 != 0);
+    }
+    const std::string path = "/tmp/sage_db_test_reorder.bin";
+    const bool saved = reordered.save(path);
+    assert(saved);
+    anns::VamanaANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    for (const auto& q : queries) {
+        assert(loaded.query(q, config).ids == reordered.query(q, config).ids);
+    }
+    std::remove(path.c_str());
+
+    anns::AlgorithmParams hnsw_params;
+    hnsw_params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::HnswANNS hnsw_plain;
+    hnsw_plain.fit(dataset, hnsw_params);
+    hnsw_params.set("reorder", true);
+    anns::HnswANNS hnsw_reordered;
+    hnsw_reordered.fit(dataset, hnsw_params);
+    expected = hnsw_plain.batch_query(queries, config);
+    found = hnsw_reordered.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(found[i].ids == expected[i].ids);
+    }
+    hnsw_reordered.remove_vector(5);
+    hnsw_reordered.add_vectors(extra);
+    assert(hnsw_reordered.query(extra[3].second, config).ids[0] == extra[3].first);
+    for (VectorId id : hnsw_reordered.query(dataset[5].second, config).ids) {
+        assert(id != 5);
+    }
+
+    // Ids fitted twice keep their last row; renumbering can put the dead
+    // copy after the live one, and loading must still resolve the id to it
+    auto duplicated = random_entries(0, 200);
+    for (const auto& entry : random_entries(0, 100)) {
+        duplicated.push_back(entry);
+    }
+    anns::HnswANNS hnsw_duplicated;
+    hnsw_duplicated.fit(duplicated, hnsw_params);
+    const std::string hnsw_path = "/tmp/sage_db_test_hnsw_reorder.bin";
+    const bool hnsw_saved = hnsw_duplicated.save(hnsw_path);
+    assert(hnsw_saved);
+    anns::HnswANNS hnsw_loaded;
+    const bool hnsw_restored = hnsw_loaded.load(hnsw_path);
+    assert(hnsw_restored);
+    std::remove(hnsw_path.c_str());
+    assert(hnsw_loaded.get_index_size() == hnsw_duplicated.get_index_size());
+    for (size_t i = 200; i < duplicated.size(); ++i) {
+        assert(hnsw_loaded.query(duplicated[i].second, config).ids[0] == duplicated[i].first);
+    }
+    ThreadPool::configure_global(0);
+
+    std::cout << "✅ Graph reordering test passed" << std::endl;
+}
+
+void test_graph_prefetch() {
+    std::cout << "Testing graph search prefetching..." << std::endl;
+
+    // Wide rows span many cache lines; prefetching must not change results
+    std::mt19937 gen(103);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 1024;
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 400; ++id) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        dataset.emplace_back(id, std::move(v));
+    }
+    std::vector<Vector> queries;
+    for (size_t i = 0; i < 10; ++i) {
+        queries.push_back(dataset[i * 37].second);
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::L2));
+    anns::VamanaANNS vamana;
+    vamana.fit(dataset, params);
+    anns::HnswANNS hnsw;
+    hnsw.fit(dataset, params);
+
+    anns::QueryConfig config;
+    config.k = 5;
+    assert(config.prefetch_depth == anns::kDefaultPrefetchDepth);
+    for (anns::ANNSAlgorithm* index : {static_cast<anns::ANNSAlgorithm*>(&vamana),
+                                       static_cast<anns::ANNSAlgorithm*>(&hnsw)}) {
+        config.prefetch_depth = anns::kDefaultPrefetchDepth;
+        const auto expected = index->batch_query(queries, config);
+        for (uint32_t depth : {0u, 1u, 64u}) {
+            config.prefetch_depth = depth;
+            const auto found = index->batch_query(queries, config);
+            for (size_t i = 0; i < queries.size(); ++i) {
+                assert(found[i].ids == expected[i].ids);
+                assert(found[i].ids[0] == dataset[i * 37].first);
+            }
+        }
+    }
+
+    std::cout << "✅ Graph search prefetching test passed" << std::endl;
+}
+
+void test_scalar_quantization() {
+    std::cout << "Testing scalar-quantized storage..." << std::endl;
+
+    // 16-bit conversions round to nearest and keep exact values exact
+    for (float x : {0.0f, 1.0f, -2.5f, 65504.0f, 0.000061035156f}) {
+        assert(simd::half_to_float(simd::float_to_half(x)) == x);
+        assert(std::fabs(simd::bfloat16_to_float(simd::float_to_bfloat16(x)) - x) <=
+               std::fabs(x) / 128.0f);
+    }
+
+    std::mt19937 gen(211);
+    std::uniform_real_distribution<float> dis(-1.0f, 1.0f);
+    const Dimension dim = 67;  // not a multiple of any vector width
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 600; ++id) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        dataset.emplace_back(id, std::move(v));
+    }
+    std::vector<Vector> queries;
+    for (size_t i = 0; i < 20; ++i) {
+        Vector q = dataset[i * 29].second;
+        for (auto& x : q) x += 0.01f * dis(gen);
+        queries.push_back(std::move(q));
+    }
+
+    // Every kernel variant agrees with the scalar one
+    {
+        anns::ScalarQuantizer int8(dim, anns::StoragePrecision::INT8);
+        anns::ScalarQuantizer int4(dim, anns::StoragePrecision::INT4);
+        anns::ScalarQuantizer fp16(dim, anns::StoragePrecision::FP16);
+        std::vector<const float*> rows;
+        for (const auto& entry : dataset) rows.push_back(entry.second.data());
+        int8.train(rows.data(), rows.size());
+        int4.train(rows.data(), rows.size());
+        std::vector<float> expected;
+        const auto original = simd::active_instruction_set();
+        for (auto isa : {simd::InstructionSet::SCALAR, simd::InstructionSet::AVX2}) {
+            if (!simd::set_instruction_set(isa)) {
+                continue;
+            }
+            std::vector<float> got;
+            for (const auto* sq : {&int8, &int4, &fp16}) {
+                std::vector<uint8_t> code(sq->code_size());
+                sq->encode(dataset[3].second.data(), code.data());
+                anns::ScalarQuantizer::Query prepared;
+                sq->prepare(queries[0].data(), prepared);
+                got.push_back(sq->l2_squared(prepared, code.data()));
+                got.push_back(sq->inner_product(prepared, code.data()));
+            }
+            if (expected.empty()) {
+                expected = got;
+            }
+            for (size_t i = 0; i < got.size(); ++i) {
+                assert(std::fabs(got[i] - expected[i]) <= 1e-3f * (1.0f + std::fabs(expected[i])));
+            }
+        }
+        simd::set_instruction_set(original);
+    }
+
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, {});
+    anns::QueryConfig config;
+    config.k = 10;
+    const auto truth = exact.batch_query(queries, config);
+    auto recall = [&](const std::vector<anns::ANNSResult>& found) {
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (auto id : found[i].ids) {
+                hits += std::count(truth[i].ids.begin(), truth[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+
+    for (const char* precision : {"fp16", "bf16", "int8", "int4"}) {
+        anns::AlgorithmParams params;
+        params.set("storage_precision", std::string(precision));
+        anns::BruteForceANNS coded;
+        assert(coded.validate_params(params));
+        coded.fit(dataset, params);
+        assert(coded.get_build_params().at("storage_precision") == precision);
+        assert(coded.get_memory_usage() < exact.get_memory_usage());
+        assert(recall(coded.batch_query(queries, config)) >= 0.6);
+
+        // Re-ranking on the kept float rows restores exact order
+        params.set("rerank", 50u);
+        anns::BruteForceANNS reranked;
+        reranked.fit(dataset, params);
+        const auto found = reranked.batch_query(queries, config);
+        assert(recall(found) >= 0.99);
+        assert(std::fabs(found[0].distances[0] - truth[0].distances[0]) < 1e-3f);
+    }
+    anns::AlgorithmParams bad;
+    bad.set("storage_precision", std::string("int3"));
+    assert(!exact.validate_params(bad));
+
+    // Quantized brute force round-trips through save/load
+    {
+        anns::AlgorithmParams params;
+        params.set("storage_precision", std::string("int8"));
+        anns::BruteForceANNS coded;
+        coded.fit(dataset, params);
+        const std::string path = "/tmp/sage_db_test_sq_flat.bin";
+        const bool saved = coded.save(path);
+        assert(saved);
+        anns::BruteForceANNS loaded;
+        const bool restored = loaded.load(path);
+        assert(restored);
+        std::remove(path.c_str());
+        assert(loaded.get_build_params().at("storage_precision") == "int8");
+        const auto before = coded.batch_query(queries, config);
+        const auto after = loaded.batch_query(queries, config);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            assert(before[i].ids == after[i].ids);
+        }
+    }
+
+    // Vamana ranks by codes and re-ranks on rows; results survive reload
+    {
+        anns::AlgorithmParams params;
+        params.set("storage_precision", std::string("int8"));
+        params.set("rerank", 30u);
+        anns::VamanaANNS vamana;
+        vamana.fit(dataset, params);
+        assert(vamana.get_build_params().at("storage_precision") == "int8");
+        const auto found = vamana.batch_query(queries, config);
+        assert(recall(found) >= 0.9);
+
+        const std::string path = "/tmp/sage_db_test_sq_vamana.bin";
+        const bool saved = vamana.save(path);
+        assert(saved);
+        anns::VamanaANNS loaded;
+        const bool restored = loaded.load(path);
+        assert(restored);
+        const auto reloaded = loaded.batch_query(queries, config);
+        for (size_t i = 0; i < queries.size(); ++i) {
+            assert(reloaded[i].ids == found[i].ids);
+        }
+        std::remove(path.c_str());
+
+        // Without re-ranking the code estimates order the hits
+        anns::QueryConfig estimates = config;
+        estimates.algorithm_params.set("rerank", 0u);
+        assert(recall(vamana.batch_query(queries, estimates)) >= 0.6);
+    }
+
+    std::cout << "✅ Scalar-quantized storage test passed" << std::endl;
+}
+
+void test_binary_quantization() {
+    std::cout << "Testing binary codes with Hamming pre-filter..." << std::endl;
+
+    std::mt19937 gen(223);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+    auto unit_vector = [&](Dimension dim) {
+        Vector v(dim);
+        for (auto& x : v) x = dis(gen);
+        const float norm = std::sqrt(simd::norm_squared(v.data(), dim));
+        for (auto& x : v) x /= norm;
+        return v;
+    };
+
+    // Every popcount variant agrees with the scalar one, tails included
+    for (Dimension dim : {64u, 100u, 1024u, 1100u}) {
+        const Vector a = unit_vector(dim);
+        const Vector b = unit_vector(dim);
+        const size_t words = simd::binary_code_words(dim);
+        std::vector<uint64_t> code_a(words), code_b(words);
+        simd::pack_signs(a.data(), dim, code_a.data());
+        simd::pack_signs(b.data(), dim, code_b.data());
+        uint32_t expected = 0;
+        for (size_t d = 0; d < dim; ++d) {
+            expected += (a[d] > 0.0f) != (b[d] > 0.0f);
+        }
+        const auto original = simd::active_instruction_set();
+        for (auto isa : {simd::InstructionSet::SCALAR,
+                         simd::InstructionSet::AVX2,
+                         simd::InstructionSet::AVX512}) {
+            if (simd::set_instruction_set(isa)) {
+                assert(simd::hamming_distance(code_a.data(), code_b.data(), words) == expected);
+            }
+        }
+        simd::set_instruction_set(original);
+    }
+
+    // Clustered embeddings, so the true neighbours stand out in angle
+    const Dimension dim = 256;
+    std::vector<Vector> centers;
+    for (size_t c = 0; c < 40; ++c) {
+        centers.push_back(unit_vector(dim));
+    }
+    auto near = [&](const Vector& center, float spread) {
+        Vector v = unit_vector(dim);
+        for (size_t d = 0; d < dim; ++d) v[d] = center[d] + spread * v[d];
+        return v;
+    };
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 2000; ++id) {
+        dataset.emplace_back(id, near(centers[id % centers.size()], 0.8f));
+    }
+    std::vector<Vector> queries;
+    for (size_t i = 0; i < 20; ++i) {
+        queries.push_back(near(dataset[i * 97].second, 0.3f));
+    }
+
+    anns::AlgorithmParams params;
+    params.set("metric", static_cast<int>(DistanceMetric::COSINE));
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+    params.set("oversample", 10.0f);
+    anns::BinaryANNS binary;
+    assert(binary.validate_params(params));
+    binary.fit(dataset, params);
+    assert(binary.get_index_size() == dataset.size());
+
+    anns::QueryConfig config;
+    config.k = 10;
+    const auto truth = exact.batch_query(queries, config);
+    auto recall = [&](const std::vector<anns::ANNSResult>& found) {
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (auto id : found[i].ids) {
+                hits += std::count(truth[i].ids.begin(), truth[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+    const auto found = binary.batch_query(queries, config);
+    assert(recall(found) >= 0.9);
+    // Hits are re-ranked on float rows, so distances are exact
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(found[i].ids.size() == config.k);
+        assert(found[i].ids[0] == truth[i].ids[0]);
+        assert(std::fabs(found[i].distances[0] - truth[i].distances[0]) < 1e-4f);
+        assert(std::is_sorted(found[i].distances.begin(), found[i].distances.end()));
+    }
+
+    // Per-query oversampling: more candidates never lose recall, and one
+    // candidate per result still returns k hits
+    anns::QueryConfig wide = config;
+    wide.algorithm_params.set("oversample", 50.0f);
+    assert(recall(binary.batch_query(queries, wide)) >= recall(found));
+    anns::QueryConfig narrow = config;
+    narrow.algorithm_params.set("oversample", 1.0f);
+    assert(binary.query(queries[0], narrow).ids.size() == config.k);
+
+    // Removal, reload and the store all keep working on the codes
+    binary.remove_vector(dataset[0].first);
+    assert(binary.get_index_size() == dataset.size() - 1);
+    const std::string path = "/tmp/sage_db_test_binary.bin";
+    const bool saved = binary.save(path);
+    assert(saved);
+    anns::BinaryANNS loaded;
+    const bool restored = loaded.load(path);
+    assert(restored);
+    std::remove(path.c_str());
+    const auto before = binary.batch_query(queries, config);
+    const auto after = loaded.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(before[i].ids == after[i].ids);
+    }
+
+    DatabaseConfig db_config(dim);
+    db_config.anns_algorithm = "binary";
+    db_config.metric = DistanceMetric::COSINE;
+    SageDB db(db_config);
+    for (const auto& entry : dataset) {
+        db.add(entry.second);
+    }
+    db.build_index();
+    SearchParams search_params;
+    search_params.k = 5;
+    assert(db.search(dataset[5].second, search_params).front().score < 1e-4f);
+
+    std::cout << "✅ Binary Hamming pre-filter test passed" << std::endl;
+}
+
+void test_pq_fast_scan() {
+    std::cout << "Testing PQ4 fast scan..." << std::endl;
+
+    std::mt19937 gen(230);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+    std::uniform_int_distribution<int> nibble(0, 15);
+
+    // Packed codes round-trip, and every kernel sums the tables the same
+    // way, odd m and a partial last block included
+    for (size_t m : {1u, 7u, 16u, 33u}) {
+        anns::FastScanCodes codes(m);
+        std::vector<std::vector<uint8_t>> plain;
+        for (size_t i = 0; i < 70; ++i) {
+            std::vector<uint8_t> code(m);
+            for (auto& c : code) c = static_cast<uint8_t>(nibble(gen));
+            codes.push_back(code.data());
+            plain.push_back(code);
+        }
+        codes.remove(3);
+        plain[3] = plain.back();
+        plain.pop_back();
+        assert(codes.size() == plain.size() && codes.block_count() == 3);
+        std::vector<uint8_t> code(m);
+        for (size_t i = 0; i < plain.size(); ++i) {
+            codes.get(i, code.data());
+            assert(code == plain[i]);
+        }
+
+        std::vector<float> table(m * 16);
+        for (auto& t : table) t = dis(gen);
+        anns::FastScanTable quantized;
+        quantized.quantize(table.data(), m);
+        std::vector<uint16_t> expected(codes.block_count() * simd::kFastScanBlock);
+        std::vector<uint16_t> sums(expected.size());
+        const auto original = simd::active_instruction_set();
+        simd::set_instruction_set(simd::InstructionSet::SCALAR);
+        codes.scan(quantized, expected.data());
+        for (size_t i = 0; i < plain.size(); ++i) {
+            uint32_t sum = 0;
+            float exact = 0.0f;
+            for (size_t j = 0; j < m; ++j) {
+                sum += quantized.luts[j * 16 + plain[i][j]];
+                exact += table[j * 16 + plain[i][j]];
+            }
+            assert(expected[i] == sum);
+            // Each table entry rounds by at most half a level
+            assert(std::fabs(quantized.key(expected[i]) - exact) <=
+                   0.5f * m * quantized.inv_scale + 1e-4f);
+        }
+        for (auto isa : {simd::InstructionSet::AVX2, simd::InstructionSet::AVX512}) {
+            if (simd::set_instruction_set(isa)) {
+                codes.scan(quantized, sums.data());
+                assert(std::equal(sums.begin(), sums.begin() + plain.size(), expected.begin()));
+            }
+        }
+        simd::set_instruction_set(original);
+    }
+
+    // Clustered data, so neighbours are well separated from the rest
+    const Dimension dim = 64;
+    std::vector<Vector> centers(50, Vector(dim));
+    for (auto& center : centers) {
+        for (auto& x : center) x = 4.0f * dis(gen);
+    }
+    auto near = [&](const Vector& center, float spread) {
+        Vector v(dim);
+        for (size_t d = 0; d < dim; ++d) v[d] = center[d] + spread * dis(gen);
+        return v;
+    };
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 3000; ++id) {
+        dataset.emplace_back(id, near(centers[id % centers.size()], 1.0f));
+    }
+    std::vector<Vector> queries;
+    for (size_t i = 0; i < 20; ++i) {
+        queries.push_back(near(dataset[i * 131].second, 0.3f));
+    }
+
+    anns::AlgorithmParams params;
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+    anns::QueryConfig config;
+    config.k = 10;
+    const auto truth = exact.batch_query(queries, config);
+    auto recall = [&](const std::vector<anns::ANNSResult>& found) {
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (auto id : found[i].ids) {
+                hits += std::count(truth[i].ids.begin(), truth[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+
+    anns::PQFastScanANNS flat;
+    flat.fit(dataset, params);
+    assert(flat.get_index_size() == dataset.size());
+    const auto found = flat.batch_query(queries, config);
+    assert(recall(found) >= 0.9);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        // Re-ranked hits carry exact distances
+        assert(found[i].ids[0] == truth[i].ids[0]);
+        assert(std::fabs(found[i].distances[0] - truth[i].distances[0]) < 1e-3f);
+        assert(std::is_sorted(found[i].distances.begin(), found[i].distances.end()));
+    }
+    // Estimates alone rank the nearest cluster, if not within it
+    anns::QueryConfig estimates = config;
+    estimates.algorithm_params.set("rerank", 0u);
+    assert(recall(flat.batch_query(queries, estimates)) >= 0.4);
+
+    flat.remove_vector(dataset[0].first);
+    assert(flat.get_index_size() == dataset.size() - 1);
+    const std::string flat_path = "/tmp/sage_db_test_pq_fast_scan.bin";
+    const bool flat_saved = flat.save(flat_path);
+    assert(flat_saved);
+    anns::PQFastScanANNS loaded;
+    const bool flat_restored = loaded.load(flat_path);
+    assert(flat_restored);
+    std::remove(flat_path.c_str());
+    const auto before = flat.batch_query(queries, config);
+    const auto after = loaded.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(before[i].ids == after[i].ids);
+    }
+
+    // As the IVF list format: same recall as byte codes, fewer bytes
+    anns::AlgorithmParams ivf_params;
+    ivf_params.set("nlist", 16);
+    ivf_params.set("m", 32);
+    ivf_params.set("nbits", 4);
+    anns::IvfANNS bytes;
+    bytes.fit(dataset, ivf_params);
+    ivf_params.set("fast_scan", true);
+    ivf_params.set("rerank", 50);
+    anns::IvfANNS fast;
+    assert(fast.validate_params(ivf_params));
+    fast.fit(dataset, ivf_params);
+    anns::QueryConfig probing = config;
+    probing.algorithm_params.set("nprobe", 16);
+    const auto ivf_found = fast.batch_query(queries, probing);
+    assert(recall(ivf_found) >= 0.9);
+    assert(recall(ivf_found) >= recall(bytes.batch_query(queries, probing)));
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(std::fabs(ivf_found[i].distances[0] - truth[i].distances[0]) < 1e-3f);
+    }
+    probing.algorithm_params.set("rerank", 0u);
+    assert(recall(fast.batch_query(queries, probing)) >= 0.4);
+    probing.algorithm_params.set("rerank", 50u);
+
+    for (VectorId id = 0; id < 100; ++id) {
+        fast.remove_vector(id);
+    }
+    fast.add_vectors(std::vector<anns::VectorEntry>(dataset.begin(), dataset.begin() + 50));
+    assert(fast.get_index_size() == dataset.size() - 50);
+    const std::string ivf_path = "/tmp/sage_db_test_ivf_fast_scan.bin";
+    const bool ivf_saved = fast.save(ivf_path);
+    assert(ivf_saved);
+    anns::IvfANNS ivf_loaded;
+    const bool ivf_restored = ivf_loaded.load(ivf_path);
+    assert(ivf_restored);
+    std::remove(ivf_path.c_str());
+    const auto ivf_before = fast.batch_query(queries, probing);
+    const auto ivf_after = ivf_loaded.batch_query(queries, probing);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(ivf_before[i].ids == ivf_after[i].ids);
+    }
+    ivf_params.set("rerank", 0);
+    ivf_params.set("nbits", 8);
+    assert(!fast.validate_params(ivf_params));
+
+    DatabaseConfig db_config(dim);
+    db_config.anns_algorithm = "pq_fast_scan";
+    SageDB db(db_config);
+    for (const auto& entry : dataset) {
+        db.add(entry.second);
+    }
+    db.build_index();
+    SearchParams search_params;
+    search_params.k = 5;
+    assert(db.search(dataset[5].second, search_params).front().score < 1e-3f);
+
+    std::cout << "✅ PQ4 fast scan test passed" << std::endl;
+}
+
+void test_rabitq() {
+    std::cout << "Testing RaBitQ storage..." << std::endl;
+
+    std::mt19937 gen(240);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+
+    // Estimates sit within their bounds, and more bits tighten both
+    const size_t code_dim = 96;
+    for (size_t bits : {1u, 4u, 8u}) {
+        anns::RaBitQuantizer quantizer(code_dim, bits, 7);
+        std::vector<uint8_t> code(quantizer.code_size());
+        anns::RaBitQuantizer::Query prepared;
+        std::vector<float> residual(code_dim);
+        std::vector<float> target(code_dim);
+        size_t outside = 0;
+        double error_sum = 0.0;
+        for (size_t trial = 0; trial < 200; ++trial) {
+            for (auto& x : residual) x = dis(gen);
+            for (auto& x : target) x = dis(gen);
+            quantizer.encode(residual.data(), code.data());
+            quantizer.prepare(target.data(), prepared);
+            const auto estimate = quantizer.estimate(prepared, code.data());
+            const float exact = simd::inner_product(residual.data(), target.data(), code_dim);
+            outside += std::fabs(estimate.dot - exact) > estimate.error;
+            error_sum += std::fabs(estimate.dot - exact);
+            assert(std::fabs(quantizer.residual_norm(code.data()) -
+                             std::sqrt(simd::norm_squared(residual.data(), code_dim))) < 1e-3f);
+        }
+        assert(outside <= 24);
+        // |r| |t| ~ 96; sign codes keep the typical miss to a few units
+        assert(error_sum / 200 < (bits == 1 ? 8.0 : 1.0));
+    }
+
+    const Dimension dim = 64;
+    std::vector<Vector> centers(50, Vector(dim));
+    for (auto& center : centers) {
+        for (auto& x : center) x = 4.0f * dis(gen);
+    }
+    auto near = [&](const Vector& center, float spread) {
+        Vector v(dim);
+        for (size_t d = 0; d < dim; ++d) v[d] = center[d] + spread * dis(gen);
+        return v;
+    };
+    std::vector<anns::VectorEntry> dataset;
+    for (VectorId id = 0; id < 3000; ++id) {
+        dataset.emplace_back(id, near(centers[id % centers.size()], 1.0f));
+    }
+    std::vector<Vector> queries;
+    for (size_t i = 0; i < 20; ++i) {
+        queries.push_back(near(dataset[i * 131].second, 0.3f));
+    }
+
+    anns::AlgorithmParams params;
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+    anns::QueryConfig config;
+    config.k = 10;
+    const auto truth = exact.batch_query(queries, config);
+    auto recall = [&](const std::vector<anns::ANNSResult>& found) {
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (auto id : found[i].ids) {
+                hits += std::count(truth[i].ids.begin(), truth[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+
+    anns::AlgorithmParams rabitq_params;
+    rabitq_params.set("storage_precision", std::string("rabitq"));
+    assert(!exact.validate_params(rabitq_params));
+
+    // IVF: bounds cut the re-rank pool short of its full size
+    anns::AlgorithmParams ivf_params = rabitq_params;
+    ivf_params.set("nlist", 16);
+    ivf_params.set("rerank", 200);
+    anns::IvfANNS ivf;
+    assert(ivf.validate_params(ivf_params));
+    ivf.fit(dataset, ivf_params);
+    anns::QueryConfig probing = config;
+    probing.algorithm_params.set("nprobe", 16);
+    const auto ivf_found = ivf.batch_query(queries, probing);
+    assert(recall(ivf_found) >= 0.9);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(std::fabs(ivf_found[i].distances[0] - truth[i].distances[0]) < 1e-3f);
+    }
+    const double ivf_reranked = ivf.get_metrics().additional_metrics.at("reranked_rows");
+    assert(ivf_reranked < 0.5 * queries.size() * 200);
+
+    ivf.remove_vector(dataset[0].first);
+    const std::string ivf_path = "/tmp/sage_db_test_ivf_rabitq.bin";
+    const bool ivf_saved = ivf.save(ivf_path);
+    assert(ivf_saved);
+    anns::IvfANNS ivf_loaded;
+    const bool ivf_restored = ivf_loaded.load(ivf_path);
+    assert(ivf_restored);
+    std::remove(ivf_path.c_str());
+    assert(ivf_loaded.get_build_params().at("storage_precision") == "rabitq");
+    const auto ivf_before = ivf.batch_query(queries, probing);
+    const auto ivf_after = ivf_loaded.batch_query(queries, probing);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(ivf_before[i].ids == ivf_after[i].ids);
+    }
+    ivf_params.set("m", 16);
+    assert(!ivf.validate_params(ivf_params));
+
+    // Vamana, wider codes: the graph walks estimates as well as it walks
+    // rows, and re-ranking keeps distances exact
+    anns::VamanaANNS vamana_fp32;
+    vamana_fp32.fit(dataset, params);
+    anns::AlgorithmParams vamana_params = rabitq_params;
+    vamana_params.set("rabitq_bits", 4);
+    vamana_params.set("rerank", 50);
+    anns::VamanaANNS vamana;
+    assert(vamana.validate_params(vamana_params));
+    vamana.fit(dataset, vamana_params);
+    const auto vamana_found = vamana.batch_query(queries, config);
+    assert(recall(vamana_found) >= recall(vamana_fp32.batch_query(queries, config)) - 0.05);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        const auto& row = dataset[vamana_found[i].ids[0]].second;
+        assert(std::fabs(vamana_found[i].distances[0] -
+                         simd::l2_distance(queries[i].data(), row.data(), dim)) < 1e-3f);
+    }
+    assert(vamana.get_metrics().additional_metrics.at("reranked_rows") <
+           static_cast<double>(queries.size() * 50));
+
+    const std::string vamana_path = "/tmp/sage_db_test_vamana_rabitq.bin";
+    const bool vamana_saved = vamana.save(vamana_path);
+    assert(vamana_saved);
+    anns::VamanaANNS vamana_loaded;
+    const bool vamana_restored = vamana_loaded.load(vamana_path);
+    assert(vamana_restored);
+    std::remove(vamana_path.c_str());
+    assert(vamana_loaded.get_build_params().at("rabitq_bits") == "4");
+    const auto vamana_before = vamana.batch_query(queries, config);
+    const auto vamana_after = vamana_loaded.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(vamana_before[i].ids == vamana_after[i].ids);
+    }
+    vamana_params.set("rabitq_bits", 9);
+    assert(!vamana.validate_params(vamana_params));
+
+    std::cout << "✅ RaBitQ storage test passed" << std::endl;
+}
+
+void test_opq() {
+    std::cout << "Testing OPQ pre-transform..." << std::endl;
+
+    std::mt19937 gen(250);
+    std::normal_distribution<float> dis(0.0f, 1.0f);
+
+    // Every matrix-vector kernel matches the scalar sums, ragged shapes included
+    for (size_t rows : {1u, 5u, 32u}) {
+        for (size_t cols : {3u, 16u, 37u}) {
+            std::vector<float> matrix(rows * cols);
+            std::vector<float> x(cols);
+            for (auto& v : matrix) v = dis(gen);
+            for (auto& v : x) v = dis(gen);
+            std::vector<float> expected(rows);
+            std::vector<float> out(rows);
+            const auto original = simd::active_instruction_set();
+            simd::set_instruction_set(simd::InstructionSet::SCALAR);
+            simd::matrix_vector(matrix.data(), rows, cols, x.data(), expected.data());
+            for (size_t r = 0; r < rows; ++r) {
+                float sum = 0.0f;
+                for (size_t c = 0; c < cols; ++c) sum += matrix[r * cols + c] * x[c];
+                assert(std::fabs(expected[r] - sum) < 1e-4f);
+            }
+            for (auto isa : {simd::InstructionSet::AVX2, simd::InstructionSet::AVX512}) {
+                if (simd::set_instruction_set(isa)) {
+                    simd::matrix_vector(matrix.data(), rows, cols, x.data(), out.data());
+                    for (size_t r = 0; r < rows; ++r) {
+                        assert(std::fabs(out[r] - expected[r]) < 1e-4f);
+                    }
+                }
+            }
+            simd::set_instruction_set(original);
+        }
+    }
+
+    // Anisotropic clusters: variance decays over latent dimensions that a
+    // random rotation then mixes across every PQ sub-space
+    const Dimension dim = 32;
+    anns::RaBitQuantizer mixer(dim, 1, 99);
+    std::vector<Vector> centers(40, Vector(dim));
+    for (auto& center : centers) {
+        for (size_t d = 0; d < dim; ++d) center[d] = 6.0f * std::exp(-0.2f * d) * dis(gen);
+    }
+    auto near = [&](const Vector& center, float spread) {
+        Vector latent(dim);
+        for (size_t d = 0; d < dim; ++d) {
+            latent[d] = center[d] + spread * std::exp(-0.1f * d) * dis(gen);
+        }
+        return latent;
+    };
+    auto mixed = [&](const Vector& latent) {
+        Vector v(dim);
+        mixer.rotate(latent.data(), v.data());
+        return v;
+    };
+    std::vector<anns::VectorEntry> dataset;
+    std::vector<Vector> latents;
+    for (VectorId id = 0; id < 4000; ++id) {
+        latents.push_back(near(centers[id % centers.size()], 1.0f));
+        dataset.emplace_back(id, mixed(latents.back()));
+    }
+    std::vector<Vector> queries;
+    for (size_t i = 0; i < 20; ++i) {
+        queries.push_back(mixed(near(latents[i * 157], 0.3f)));
+    }
+
+    // The learned map is a rotation and lowers the PQ reconstruction error
+    const size_t m = 8;
+    std::vector<float> sample(dataset.size() * dim);
+    for (size_t i = 0; i < dataset.size(); ++i) {
+        std::copy(dataset[i].second.begin(), dataset[i].second.end(), sample.begin() + i * dim);
+    }
+    auto pq_error = [&](const anns::PreTransform& transform) {
+        std::vector<float> rows = sample;
+        transform.apply(rows.data(), dataset.size());
+        anns::ProductQuantizer quantizer(dim, m, 4);
+        quantizer.train(rows.data(), dataset.size());
+        double error = 0.0;
+        std::vector<uint8_t> code(m);
+        Vector decoded(dim);
+        for (size_t i = 0; i < dataset.size(); ++i) {
+            quantizer.encode(rows.data() + i * dim, code.data());
+            quantizer.decode(code.data(), decoded.data());
+            error += simd::l2_squared(rows.data() + i * dim, decoded.data(), dim);
+        }
+        return error;
+    };
+    anns::PreTransform opq(anns::PreTransformKind::OPQ, dim, 8);
+    opq.train(sample.data(), dataset.size(), m, 4, {});
+    const auto& rotation = opq.matrix();
+    for (size_t i = 0; i < dim; ++i) {
+        for (size_t j = 0; j < dim; ++j) {
+            const float dot = simd::inner_product(rotation.data() + i * dim,
+                                                  rotation.data() + j * dim, dim);
+            assert(std::fabs(dot - (i == j ? 1.0f : 0.0f)) < 1e-3f);
+        }
+    }
+    const double plain_error = pq_error(anns::PreTransform());
+    const double opq_error = pq_error(opq);
+    assert(opq_error < 0.9 * plain_error);
+    Vector single(dim);
+    std::vector<float> batch(sample.begin(), sample.begin() + 2 * dim);
+    opq.apply(sample.data() + dim, single.data());
+    opq.apply(batch.data(), 2);
+    for (size_t d = 0; d < dim; ++d) {
+        assert(std::fabs(single[d] - batch[dim + d]) < 1e-4f);
+    }
+
+    anns::AlgorithmParams params;
+    anns::BruteForceANNS exact;
+    exact.fit(dataset, params);
+    anns::QueryConfig config;
+    config.k = 10;
+    const auto truth = exact.batch_query(queries, config);
+    auto recall = [&](const std::vector<anns::ANNSResult>& found) {
+        size_t hits = 0;
+        for (size_t i = 0; i < queries.size(); ++i) {
+            for (auto id : found[i].ids) {
+                hits += std::count(truth[i].ids.begin(), truth[i].ids.end(), id);
+            }
+        }
+        return static_cast<double>(hits) / (queries.size() * config.k);
+    };
+
+    // IVF-PQ: the rotation is learned with the coarse quantizer and saved
+    anns::AlgorithmParams ivf_params;
+    ivf_params.set("nlist", 16);
+    ivf_params.set("m", static_cast<uint32_t>(m));
+    anns::IvfANNS ivf_plain;
+    ivf_plain.fit(dataset, ivf_params);
+    ivf_params.set("pre_transform", std::string("opq"));
+    anns::IvfANNS ivf;
+    assert(ivf.validate_params(ivf_params));
+    ivf.train(anns::DatasetView::from_entries(dataset), ivf_params);
+    ivf.fit(dataset, ivf_params);
+    assert(ivf.get_build_params().at("pre_transform") == "opq");
+    anns::QueryConfig probing = config;
+    probing.algorithm_params.set("nprobe", 16);
+    const double ivf_recall = recall(ivf.batch_query(queries, probing));
+    assert(ivf_recall >= recall(ivf_plain.batch_query(queries, probing)));
+
+    const std::string ivf_path = "/tmp/sage_db_test_ivf_opq.bin";
+    const bool ivf_saved = ivf.save(ivf_path);
+    assert(ivf_saved);
+    anns::IvfANNS ivf_loaded;
+    const bool ivf_restored = ivf_loaded.load(ivf_path);
+    assert(ivf_restored);
+    std::remove(ivf_path.c_str());
+    assert(ivf_loaded.get_build_params().at("pre_transform") == "opq");
+    const auto ivf_before = ivf.batch_query(queries, probing);
+    const auto ivf_after = ivf_loaded.batch_query(queries, probing);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(ivf_before[i].ids == ivf_after[i].ids);
+    }
+    ivf_params.set("m", 0u);
+    assert(!ivf.validate_params(ivf_params));
+    ivf_params.set("m", static_cast<uint32_t>(m));
+    ivf_params.set("pre_transform", std::string("pca"));
+    assert(!ivf.validate_params(ivf_params));
+
+    // Flat fast scan: estimates improve, re-ranking reads the rows as given
+    anns::AlgorithmParams flat_params;
+    flat_params.set("m", static_cast<uint32_t>(m));
+    anns::PQFastScanANNS flat_plain;
+    flat_plain.fit(dataset, flat_params);
+    flat_params.set("pre_transform", std::string("opq"));
+    anns::PQFastScanANNS flat;
+    flat.fit(dataset, flat_params);
+    anns::QueryConfig estimates = config;
+    estimates.algorithm_params.set("rerank", 0u);
+    assert(recall(flat.batch_query(queries, estimates)) >=
+           recall(flat_plain.batch_query(queries, estimates)));
+    const auto reranked = flat.batch_query(queries, config);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(std::fabs(reranked[i].distances[0] - truth[i].distances[0]) < 1e-3f);
+    }
+
+    const std::string flat_path = "/tmp/sage_db_test_pq_fast_scan_opq.bin";
+    const bool flat_saved = flat.save(flat_path);
+    assert(flat_saved);
+    anns::PQFastScanANNS flat_loaded;
+    const bool flat_restored = flat_loaded.load(flat_path);
+    assert(flat_restored);
+    std::remove(flat_path.c_str());
+    assert(flat_loaded.get_build_params().at("pre_transform") == "opq");
+    const auto flat_before = flat.batch_query(queries, estimates);
+    const auto flat_after = flat_loaded.batch_query(queries, estimates);
+    for (size_t i = 0; i < queries.size(); ++i) {
+        assert(flat_before[i].ids == flat_after[i].ids);
+    }
+
+    std::cout << "✅ OPQ pre-transform test passed" << std::endl;
+}
+
 void benchmark_performance() {
     std::cout << "Running performance benchmark..." << std::endl;
     
@@ -248,7 +2963,31 @@ int main() {
         test_metadata_operations();
         test_batch_operations();
         test_filtered_search();
+        test_label_filtered_search();
         test_persistence();
+        test_simd_distance_kernels();
+        test_brute_force_arena();
+        test_shared_vector_arena();
+        test_blocked_batch_query();
+        test_thread_pool_batch_search();
+        test_concurrent_search();
+        test_background_rebuild();
+        test_matrix_view_query();
+        test_hnsw_index();
+        test_ivf_index();
+        test_vamana_graph();
+        test_vamana_disk();
+        test_vamana_filtered();
+        test_vamana_lazy_delete();
+        test_vamana_concurrent_insert();
+        test_vamana_mapped_file();
+        test_graph_reorder();
+        test_graph_prefetch();
+        test_scalar_quantization();
+        test_binary_quantization();
+        test_pq_fast_scan();
+        test_rabitq();
+        test_opq();
         benchmark_performance();
         
         std::cout << std::endl;